@@ -3,6 +3,7 @@
 static_assert(__cplusplus >= 202002L, "C++20 required");
 
 #include <array>
+#include <cstdlib>
 #include <filesystem>
 #include <format>
 #include <fstream>
@@ -18,7 +19,9 @@ static_assert(__cplusplus >= 202002L, "C++20 required");
 class Args {
   struct GlobalState {
     int verbose;
-    GlobalState() : verbose(0) {}
+    bool autotune;
+    double headless; // simulated seconds to run without a window, 0: windowed
+    GlobalState() : verbose(0), autotune(false), headless(0.0) {}
   };
 
 protected:
@@ -26,10 +29,14 @@ protected:
 
 public:
   static auto &verbose() { return global.verbose; }
+  static auto &autotune() { return global.autotune; }
+  static auto &headless() { return global.headless; }
 
   static void parse(int argc, char **argv) {
     static auto const long_opts =
         std::array{option{"verbose", no_argument, nullptr, 'v'},
+                   option{"autotune", no_argument, nullptr, 'a'},
+                   option{"headless", required_argument, nullptr, 'H'},
                    option{"help", no_argument, nullptr, 'h'},
                    option{nullptr, 0, nullptr, 0}};
 
@@ -39,7 +46,9 @@ public:
                         [](std::string acc, const option &opt) {
                           if (!opt.name)
                             return acc;
-                          return acc + (char)opt.val;
+                          return acc + (char)opt.val +
+                                 (opt.has_arg == required_argument ? ":"
+                                                                   : "");
                         });
 
     static auto const usage =
@@ -48,8 +57,13 @@ public:
     static auto const help =
         std::format("{}\n"
                     "Options:\n"
-                    "  -h, --help     display this help and exit\n"
-                    "  -v, --verbose  increase verbosity\n",
+                    "  -h, --help      display this help and exit\n"
+                    "  -v, --verbose   increase verbosity\n"
+                    "  -a, --autotune  run the GPU autotuner (takes a few seconds)\n"
+                    "  -H, --headless=SECONDS\n"
+                    "                  run the simulation for SECONDS of "
+                    "simulated time\n"
+                    "                  without a window, then exit\n",
                     usage);
 
     for (int opt; (opt = getopt_long(argc, argv, short_opts.c_str(),
@@ -58,6 +72,16 @@ public:
       case 'v':
         verbose()++;
         break;
+      case 'a':
+        autotune() = true;
+        break;
+      case 'H':
+        headless() = std::strtod(optarg, nullptr);
+        if (headless() <= 0.0) {
+          std::cerr << help;
+          exit(EXIT_FAILURE);
+        }
+        break;
       case 'h':
         std::cout << help;
         exit(EXIT_SUCCESS);
@@ -78,6 +102,23 @@ struct Config {
     FULLSCREEN,
     GFX_WIDTH,
     GFX_HEIGHT,
+    GFX_COMPUTE_PRESENT,
+    GFX_POST_CHAIN,
+    GFX_POST_PATH,
+    GFX_MSAA,
+    GFX_DEPTH,
+    GFX_DEPTH_PREPASS,
+    GFX_FRAME_CAP,
+    GFX_AUTOTUNE,
+    GFX_QUALITY_GOVERNOR,
+    SIM_WIND_CELLS,
+    SIM_WIND_CELL_SIZE,
+    SIM_WIND_BUDGET_MS,
+    SIM_BALLOONS,
+    SIM_STEP_RATE,
+    FEED_SOCKET,
+    CONTROL_SOCKET,
+    STATS_PAGE,
   };
 
   using Value = std::variant<bool, int64_t, double, std::string>;
@@ -93,7 +134,48 @@ private:
   inline static std::unordered_map<Key, std::pair<std::string, Value>>
       jsonp_keymap = {{Key::FULLSCREEN, {"/display/fullscreen", false}},
                       {Key::GFX_WIDTH, {"/display/width", 800}},
-                      {Key::GFX_HEIGHT, {"/display/height", 600}}};
+                      {Key::GFX_HEIGHT, {"/display/height", 600}},
+                      {Key::GFX_COMPUTE_PRESENT,
+                       {"/display/compute_present", false}},
+                      {Key::GFX_POST_CHAIN, {"/render/post_chain", false}},
+                      // "auto", "subpass" (on-tile) or "compute"
+                      {Key::GFX_POST_PATH,
+                       {"/render/post_path", std::string{"auto"}}},
+                      // quality tier: "off", "low", "medium" or "high"
+                      {Key::GFX_MSAA, {"/render/msaa", std::string{"off"}}},
+                      {Key::GFX_DEPTH, {"/render/depth", true}},
+                      {Key::GFX_DEPTH_PREPASS,
+                       {"/render/depth_prepass", false}},
+                      // frames per second; 0 leaves pacing to the display
+                      {Key::GFX_FRAME_CAP, {"/display/frame_cap", 0.0}},
+                      // benchmark swapchain and upload settings the first
+                      // time a GPU / driver is seen (see DeviceTuning)
+                      {Key::GFX_AUTOTUNE, {"/display/autotune", false}},
+                      // step MSAA and the post chain down (and back up to
+                      // their configured values) to hold the frame budget
+                      {Key::GFX_QUALITY_GOVERNOR,
+                       {"/render/quality_governor", true}},
+                      // wind solver grid: cells along x and z (half as
+                      // many up), metres per cell, GPU milliseconds per step
+                      {Key::SIM_WIND_CELLS, {"/sim/wind/cells", 64}},
+                      {Key::SIM_WIND_CELL_SIZE, {"/sim/wind/cell_size", 50.0}},
+                      {Key::SIM_WIND_BUDGET_MS,
+                       {"/sim/wind/budget_ms", 1.0}},
+                      // balloon fleet size and fixed simulation steps per
+                      // second, whatever the frame rate
+                      {Key::SIM_BALLOONS, {"/sim/balloons", 256}},
+                      {Key::SIM_STEP_RATE, {"/sim/step_rate", 120}},
+                      // Unix socket path for columnar data producers;
+                      // empty disables the feed server
+                      {Key::FEED_SOCKET, {"/feed/socket", std::string{""}}},
+                      // Unix socket path for JSON runtime commands (see
+                      // ControlServer); empty disables it
+                      {Key::CONTROL_SOCKET,
+                       {"/control/socket", std::string{""}}},
+                      // shm_open name of the live stats page (see
+                      // StatsPage, hotair-top), e.g. "/hotair-stats"; empty
+                      // disables it, one per running instance
+                      {Key::STATS_PAGE, {"/stats/page", std::string{""}}}};
 
 public:
   /**
@@ -233,6 +315,30 @@ public:
     }
   }
 
+  /**
+   * A free-form subtree by JSON pointer, for data keyed at runtime (e.g.
+   * per device); null if absent
+   */
+  static nlohmann::json section(std::string const &pointer) {
+    if (config_doc.is_null())
+      load();
+
+    auto const ptr = nlohmann::json::json_pointer(pointer);
+    return config_doc.contains(ptr) ? config_doc[ptr] : nlohmann::json();
+  }
+
+  /**
+   * Replace a free-form subtree and write the config out
+   */
+  static void setSection(std::string const &pointer,
+                         nlohmann::json const &value) {
+    if (config_doc.is_null())
+      load();
+
+    config_doc[nlohmann::json::json_pointer(pointer)] = value;
+    write_out();
+  }
+
   /**
    * Set a config value by key.
    * Makes sure a config file is present or one is created with defaults.
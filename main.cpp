@@ -6,9 +6,22 @@ static_assert(__cplusplus >= 202002L, "C++20 required");
 #include <wayland-client-protocol.h>
 #include <wayland-client.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "args.hpp"
+#include "src/balloonSim.hpp"
+#include "src/controlServer.hpp"
+#include "src/feedServer.hpp"
+#include "src/fixedStep.hpp"
+#include "src/frameLimiter.hpp"
+#include "src/frameTrace.hpp"
+#include "src/qualityGovernor.hpp"
+#include "src/statsPage.hpp"
 #include "src/waylandGfx.hpp"
 
 int main(int argc, char **argv) {
@@ -18,15 +31,331 @@ int main(int argc, char **argv) {
 
   Config::load();
 
+  // the balloon fleet advances in fixed steps whatever the frame rate: a
+  // worker thread runs ahead of the frame loop, headless runs step inline
+  struct SimSnapshot {
+    uint64_t step = 0;
+    std::vector<std::array<float, 3>> positions;
+  };
+  auto const balloons = static_cast<size_t>(
+      std::get<int64_t>(Config::get(Config::Key::SIM_BALLOONS)));
+  auto const step_rate =
+      std::get<int64_t>(Config::get(Config::Key::SIM_STEP_RATE));
+  auto pool = WorkerPool();
+  auto sim =
+      BalloonSim(balloons, 1.0f / static_cast<float>(step_rate), &pool);
+  auto const rows = static_cast<size_t>(
+      std::ceil(std::sqrt(static_cast<double>(balloons))));
+  for (auto i = size_t{0}; i < balloons; ++i) {
+    sim.add({.position = {30.0f * static_cast<float>(i % rows), 0.0f,
+                          30.0f * static_cast<float>(i / rows)},
+             .temperature = 340.0f + static_cast<float>(i % 9) * 5.0f,
+             .burner = static_cast<float>(i % 4) * 0.25f});
+  }
+  auto runner = FixedStepRunner<SimSnapshot>(
+      FixedStep(sim.step()), [&sim] { sim.advance(); },
+      [&sim](SimSnapshot &snapshot) {
+        snapshot.step = sim.steps();
+        snapshot.positions.resize(sim.size());
+        for (auto i = size_t{0}; i < sim.size(); ++i)
+          snapshot.positions[i] = {sim.positionX()[i], sim.positionY()[i],
+                                   sim.positionZ()[i]};
+      },
+      Args::headless() == 0.0);
+  // mean altitude between the frame's two snapshots, as rendering sees it
+  auto const mean_altitude =
+      [](FixedStepRunner<SimSnapshot>::Frame const &frame) {
+        auto const &from = frame.from.positions;
+        auto const &to = frame.to.positions;
+        auto sum = 0.0;
+        for (auto i = size_t{0}; i < to.size(); ++i)
+          sum += std::lerp(from[i][1], to[i][1], frame.alpha);
+        return to.empty() ? 0.0 : sum / static_cast<double>(to.size());
+      };
+
+  if (Args::headless() > 0.0) {
+    constexpr auto frameSeconds = 1.0 / 60.0;
+    auto const steps = static_cast<uint64_t>(Args::headless() * step_rate);
+    for (;;) {
+      auto const frame = runner.frame(frameSeconds);
+      if (frame.step >= steps) {
+        std::cout << std::format(
+            "{} balloons, {} steps, mean altitude {:.3f} m\n",
+            frame.from.positions.size(), frame.step, mean_altitude(frame));
+        return 0;
+      }
+    }
+  }
+
   std::unique_ptr<PlatformGfx> gfx = std::make_unique<WaylandGfx>();
 
   gfx->init();
 
+  auto feed = std::unique_ptr<FeedServer>();
+  if (auto const socket_path =
+          std::get<std::string>(Config::get(Config::Key::FEED_SOCKET));
+      !socket_path.empty())
+    feed = std::make_unique<FeedServer>(*gfx, socket_path);
+
+  // config.json may hold the cap as an integer or a double; the control
+  // socket changes it for this run only, Config keeps the configured one
+  auto frame_cap = std::visit(
+      [](auto const &value) -> double {
+        if constexpr (std::is_arithmetic_v<std::decay_t<decltype(value)>>) {
+          return static_cast<double>(value);
+        } else {
+          throw std::runtime_error(
+              std::format("{}:{}: /display/frame_cap must be a number",
+                          __FILE__, __LINE__));
+        }
+      },
+      Config::get(Config::Key::GFX_FRAME_CAP));
+  auto limiter = FrameLimiter(frame_cap);
+  auto const frame_budget_ms = [&] {
+    return limiter.capped() ? 1000.0 / frame_cap : 1000.0 / 60.0;
+  };
+
+  // knobs start at their Config values, which are the most the governor
+  // will ever raise them to
+  auto quality = PlatformGfx::Quality{
+      .msaa = std::get<std::string>(Config::get(Config::Key::GFX_MSAA)),
+      .post_chain = std::get<bool>(Config::get(Config::Key::GFX_POST_CHAIN))};
+  // knobs are added in statsQualityKnobs order, the stats page relies on it
+  auto governor = std::unique_ptr<QualityGovernor>();
+  if (std::get<bool>(Config::get(Config::Key::GFX_QUALITY_GOVERNOR))) {
+    governor = std::make_unique<QualityGovernor>(
+        QualityGovernor::Settings{.budget_ms = frame_budget_ms()});
+
+    static auto const msaa_levels =
+        std::vector<std::string>{"off", "low", "medium", "high"};
+    auto const msaa_level = std::ranges::find(msaa_levels, quality.msaa);
+    governor->addKnob(
+        {.name = "msaa",
+         .levels = msaa_levels,
+         .level = msaa_level == msaa_levels.end()
+                      ? 0
+                      : static_cast<size_t>(msaa_level - msaa_levels.begin()),
+         .relieves = QualityGovernor::Relieves::Gpu,
+         .apply =
+             [&](size_t const level) {
+               quality.msaa = msaa_levels[level];
+               gfx->requestQuality(quality);
+             }});
+    governor->addKnob({.name = "post_chain",
+                       .levels = {"off", "on"},
+                       .level = quality.post_chain ? 1U : 0U,
+                       .relieves = QualityGovernor::Relieves::Gpu,
+                       .apply =
+                           [&](size_t const level) {
+                             quality.post_chain = level == 1;
+                             gfx->requestQuality(quality);
+                           }});
+  }
+
   auto loop_accounting_ticks = 0ULL;
   auto loop_accounting_last = std::chrono::high_resolution_clock::now();
+  auto last_fps = 0ULL;
+  auto last_pacing = FrameLimiter::Stats();
+  auto late_frames = 0ULL;
+  auto frames = 0ULL;
+  auto feed_batch = 0ULL;
+
+  // published for external monitors every statsInterval
+  auto stats_page = std::unique_ptr<StatsPage>();
+  if (auto const page_name =
+          std::get<std::string>(Config::get(Config::Key::STATS_PAGE));
+      !page_name.empty())
+    stats_page = std::make_unique<StatsPage>(page_name);
+  auto frame_times = FrameTimeWindow();
+  auto stats_last = FrameTrace::Clock::now();
+  constexpr auto statsInterval = std::chrono::milliseconds(100);
+
+  auto trace = FrameTrace();
+  auto last_tick = FrameTrace::Clock::now();
+  auto sim_step = uint64_t{0};
+  auto sim_altitude = 0.0;
+  auto tick_work = FrameTrace::Clock::duration(); // last tick, without pacing
+
+  auto control = std::unique_ptr<ControlServer>();
+  if (auto const socket_path =
+          std::get<std::string>(Config::get(Config::Key::CONTROL_SOCKET));
+      !socket_path.empty()) {
+    control = std::make_unique<ControlServer>(*gfx, socket_path);
+
+    control->on("frame_cap", "{\"fps\": n} cap frame rate, 0 uncaps",
+                [&](nlohmann::json const &request) {
+                  auto const fps = request.at("fps").get<double>();
+                  frame_cap = fps;
+                  limiter.setCap(fps);
+                  if (governor)
+                    governor->setBudget(frame_budget_ms());
+                  return nlohmann::json{{"fps", fps}};
+                });
+
+    control->on("present_mode",
+                "{\"mode\": \"FIFO\"|\"FIFO_RELAXED\"|\"MAILBOX\"|"
+                "\"IMMEDIATE\"}",
+                [&](nlohmann::json const &request) {
+                  auto const mode = request.at("mode").get<std::string>();
+                  if (!gfx->requestPresentMode(mode))
+                    throw std::runtime_error(
+                        std::format("present mode {} not supported", mode));
+                  return nlohmann::json{{"mode", mode}};
+                });
+
+    control->on("quality",
+                "{\"knob\": \"msaa\"|\"post_chain\", \"level\": n} set a "
+                "quality governor knob's level, 0 is lowest",
+                [&](nlohmann::json const &request) {
+                  if (!governor)
+                    throw std::runtime_error("quality governor is off");
+                  auto const knob = request.at("knob").get<std::string>();
+                  auto const level = request.at("level").get<size_t>();
+                  if (!governor->setLevel(knob, level))
+                    throw std::runtime_error(std::format(
+                        "no quality knob {} with level {}", knob, level));
+                  return nlohmann::json{{"knob", knob}, {"level", level}};
+                });
+
+    control->on("trace",
+                "{\"on\": true, \"path\": \"...\"} start a Chrome trace "
+                "capture, {\"on\": false} write it",
+                [&](nlohmann::json const &request) {
+                  if (request.at("on").get<bool>()) {
+                    auto const path =
+                        request.value("path", std::string{"hotair-trace.json"});
+                    trace.start(path);
+                    return nlohmann::json{{"tracing", path}};
+                  }
+                  return nlohmann::json{{"events", trace.stop()}};
+                });
+
+    control->on("stats", "frame rate, pacing and feed counters",
+                [&](nlohmann::json const &) {
+                  auto stats = nlohmann::json{
+                      {"fps", last_fps},
+                      {"frame_cap", frame_cap},
+                      {"pacing",
+                       {{"overshoot_ns", last_pacing.overshoot.count()},
+                        {"worst_ns", last_pacing.worst.count()},
+                        {"late", last_pacing.late}}},
+                      {"tracing", trace.active()},
+                      {"sim",
+                       {{"balloons", balloons},
+                        {"step", sim_step},
+                        {"dropped_steps", runner.fixedStep().dropped()},
+                        {"mean_altitude_m", sim_altitude}}}};
+                  if (governor) {
+                    auto knobs = nlohmann::json::object();
+                    for (auto i = size_t{0}; i < governor->knobCount(); ++i) {
+                      auto const &knob = governor->knob(i);
+                      knobs[knob.name] = knob.levels[knob.level];
+                    }
+                    auto decisions = nlohmann::json::array();
+                    for (auto const &d : governor->decisions()) {
+                      auto const &knob = governor->knob(d.knob);
+                      decisions.push_back(
+                          {{"frame", d.frame},
+                           {"knob", knob.name},
+                           {"from", knob.levels[d.from]},
+                           {"to", knob.levels[d.to]},
+                           {"frame_ms", d.frame_ms},
+                           {"bound", d.gpu_bound ? "gpu" : "cpu"},
+                           {"manual", d.manual}});
+                    }
+                    stats["quality"] = {
+                        {"knobs", knobs},
+                        {"changes", governor->decisionCount()},
+                        {"decisions", decisions}};
+                  }
+                  if (feed) {
+                    auto const totals = feed->stats();
+                    stats["feed"] = {{"updates", totals.updates},
+                                     {"inline_bytes", totals.inline_bytes},
+                                     {"memfd_bytes", totals.memfd_bytes},
+                                     {"clients", feed->clientCount()},
+                                     {"rejected", totals.rejected}};
+                  }
+                  return stats;
+                });
+  }
 
   gfx->platformEventLoop([&]() {
     auto const t_now = std::chrono::high_resolution_clock::now();
+    auto const tick = FrameTrace::Clock::now();
+    trace.record("frame", last_tick, tick);
+    frame_times.add(
+        std::chrono::duration<float, std::milli>(tick - last_tick).count());
+    auto const sim_frame = runner.frame(
+        std::chrono::duration<double>(tick - last_tick).count());
+    sim_step = sim_frame.step;
+    sim_altitude = mean_altitude(sim_frame);
+    trace.record("sim", tick, FrameTrace::Clock::now());
+    last_tick = tick;
+    ++frames;
+
+    if (governor) {
+      auto const cost = gfx->frameCost();
+      governor->frame(
+          cost.cpu_ms +
+              std::chrono::duration<double, std::milli>(tick_work).count(),
+          cost.gpu_ms);
+    }
+
+    if (stats_page && tick - stats_last >= statsInterval) {
+      stats_last = tick;
+      auto const frame_ms = frame_times.percentiles();
+      auto const [rss, peak_rss] = residentBytes();
+      auto sample = StatsSample{
+          .published_ns = static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  tick.time_since_epoch())
+                  .count()),
+          .frames = frames,
+          .fps = static_cast<double>(last_fps),
+          .frame_ms_p50 = frame_ms.p50,
+          .frame_ms_p90 = frame_ms.p90,
+          .frame_ms_p99 = frame_ms.p99,
+          .frame_ms_max = frame_ms.max,
+          .frame_cap = limiter.capped() ? frame_cap : 0.0,
+          .late_frames = late_frames,
+          .control_queued = control ? control->queuedCount() : 0,
+          .feed_batch = feed_batch,
+          .rss_bytes = rss,
+          .peak_rss_bytes = peak_rss};
+      if (feed) {
+        auto const totals = feed->stats();
+        sample.feed_clients = feed->clientCount();
+        sample.feed_updates = totals.updates;
+        sample.feed_bytes = totals.inline_bytes + totals.memfd_bytes;
+        sample.feed_rejected = totals.rejected;
+      }
+      if (governor) {
+        sample.quality_governed = 1;
+        sample.quality_msaa = governor->knob(0).level;
+        sample.quality_post_chain = governor->knob(1).level;
+        sample.quality_changes = governor->decisionCount();
+        auto const &decisions = governor->decisions();
+        auto const recent = std::min(decisions.size(), statsQualityRecent);
+        for (auto i = size_t{0}; i < recent; ++i) {
+          auto const &d = decisions[decisions.size() - 1 - i];
+          sample.quality_recent[i] = {
+              .frame = d.frame,
+              .frame_ms = static_cast<float>(d.frame_ms),
+              .knob = static_cast<uint8_t>(d.knob),
+              .from = static_cast<uint8_t>(d.from),
+              .to = static_cast<uint8_t>(d.to),
+              .flags = static_cast<uint8_t>(
+                  (d.gpu_bound ? statsQualityGpuBound : 0) |
+                  (d.manual ? statsQualityManual : 0))};
+        }
+      }
+      stats_page->publish(sample);
+    }
+
+    // commands change state between frames, never during one
+    if (control)
+      control->apply();
 
     auto const t_diff = std::chrono::duration_cast<std::chrono::milliseconds>(
                             t_now - loop_accounting_last)
@@ -34,12 +363,36 @@ int main(int argc, char **argv) {
 
     if (t_diff > 1000) {
       std::cerr << std::format("fps: {}\n", loop_accounting_ticks);
+      last_fps = loop_accounting_ticks;
       loop_accounting_ticks = 0;
       loop_accounting_last = t_now;
+
+      auto const pacing = limiter.takeStats();
+      last_pacing = pacing;
+      late_frames += pacing.late;
+      if (limiter.capped() && Args::verbose() > 1)
+        std::cerr << std::format(
+            "frame cap: overshoot mean {}ns worst {}ns, spin {}ns, {} late\n",
+            pacing.overshoot.count(), pacing.worst.count(),
+            pacing.spin.count(), pacing.late);
     }
 
     loop_accounting_ticks++;
 
+    auto const pace_start = FrameTrace::Clock::now();
+    limiter.wait();
+    auto const pace_end = FrameTrace::Clock::now();
+    trace.record("pace", tick, pace_end);
+
+    // everything producers sent since the last frame, as one batch
+    if (feed) {
+      auto const drain_start = FrameTrace::Clock::now();
+      feed_batch = 0;
+      feed->drain([&](FeedServer::Update const &) { ++feed_batch; });
+      trace.record("feed", drain_start, FrameTrace::Clock::now());
+    }
+
+    tick_work = FrameTrace::Clock::now() - tick - (pace_end - pace_start);
     return true;
   });
 
@@ -0,0 +1,73 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * One up-front block carved into cache-line aligned arrays. Meant for SoA
+ * state whose capacity is known at startup: every array starts on its own
+ * cache line (no false sharing between streams, aligned SIMD loads) and
+ * nothing is freed individually; reset() drops everything at once.
+ */
+struct AlignedArena {
+  static constexpr size_t alignment = 64;
+
+private:
+  struct Free {
+    void operator()(std::byte *p) const { std::free(p); }
+  };
+
+  std::unique_ptr<std::byte, Free> block;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+
+public:
+  explicit AlignedArena(size_t const bytes) {
+    capacity_ = (bytes + alignment - 1) / alignment * alignment;
+    block.reset(static_cast<std::byte *>(
+        std::aligned_alloc(alignment, std::max(capacity_, alignment))));
+    if (!block)
+      throw std::bad_alloc();
+  }
+
+  /**
+   * count value-initialized Ts, starting on a fresh cache line
+   */
+  template <typename T> std::span<T> allocate(size_t const count) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "arena memory is released without running destructors");
+    static_assert(alignof(T) <= alignment);
+
+    auto const bytes = (count * sizeof(T) + alignment - 1) / alignment *
+                       alignment;
+    if (bytes > capacity_ - used_)
+      throw std::runtime_error(std::format(
+          "{}:{}: arena exhausted ({} of {} bytes used, {} requested)",
+          __FILE__, __LINE__, used_, capacity_, bytes));
+
+    auto *data = reinterpret_cast<T *>(block.get() + used_);
+    used_ += bytes;
+    std::uninitialized_value_construct_n(data, count);
+    return {data, count};
+  }
+
+  /**
+   * Bytes allocate() takes for count Ts
+   */
+  template <typename T> static constexpr size_t footprint(size_t const count) {
+    return (count * sizeof(T) + alignment - 1) / alignment * alignment;
+  }
+
+  void reset() { used_ = 0; }
+
+  [[nodiscard]] size_t used() const { return used_; }
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+};
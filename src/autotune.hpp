@@ -0,0 +1,55 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "deviceTuning.hpp"
+#include "uploadRing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+/**
+ * GPU microbenchmarks for the autotuner. The swapchain trials need the
+ * platform's frame loop and live in WaylandGfx::autotune(); these only need
+ * a device.
+ */
+
+/**
+ * Throughput of UploadRing::copyToBuffer into device-local memory with
+ * copies of at most chunk bytes, through a ring of ring_bytes
+ */
+[[nodiscard]] inline UploadTrial
+measureUploadChunk(GpuContext const &context, vk::DeviceSize const chunk,
+                   vk::DeviceSize const ring_bytes = vk::DeviceSize{32} << 20,
+                   vk::DeviceSize const total_bytes = vk::DeviceSize{128}
+                                                      << 20) {
+  auto const block = std::min(total_bytes, vk::DeviceSize{32} << 20);
+  auto target = createBuffer(context, block,
+                             vk::BufferUsageFlagBits::eTransferDst,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal);
+  auto const source = std::vector<std::byte>(block, std::byte{0x5a});
+
+  auto seconds = 0.0;
+  {
+    auto ring = UploadRing(context, ring_bytes, chunk);
+    // one untimed round to fault in the staging memory
+    ring.copyToBuffer(target.buffer, 0, source);
+    ring.flush();
+    ring.waitIdle();
+
+    auto const start = std::chrono::steady_clock::now();
+    for (auto done = vk::DeviceSize{0}; done < total_bytes; done += block) {
+      ring.copyToBuffer(target.buffer, 0, source);
+      ring.flush();
+    }
+    ring.waitIdle();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  }
+  destroyBuffer(context, target);
+
+  auto const bytes = static_cast<double>(total_bytes / block * block);
+  return {.chunk = chunk,
+          .gib_per_second = seconds > 0.0 ? bytes / seconds / (1 << 30) : 0.0};
+}
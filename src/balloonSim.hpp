@@ -0,0 +1,302 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "alignedArena.hpp"
+#include "workerPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <experimental/simd>
+#include <format>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+
+namespace stdx = std::experimental;
+
+/**
+ * One balloon as seen from outside the simulation
+ */
+struct Balloon {
+  std::array<float, 3> position{}; // m, y up
+  std::array<float, 3> velocity{}; // m/s
+  float temperature = 288.15f;     // envelope air, K
+  float mass = 400.0f;             // envelope, basket and load, kg
+  float volume = 2800.0f;          // envelope, m^3
+  float burner = 0.0f;             // throttle, 0..1
+};
+
+/**
+ * Hot-air balloon fleet, stored structure-of-arrays in one AlignedArena and
+ * integrated with a fixed step by SIMD kernels (std::experimental::simd,
+ * so AVX2 / AVX-512 / NEON as the build target allows) over chunks spread
+ * across a WorkerPool.
+ *
+ * Per step: ISA ambient temperature and an exponential pressure profile
+ * give the air densities inside and outside the envelope; buoyancy minus
+ * weight, quadratic drag against the wind, burner heating and Newtonian
+ * cooling are integrated semi-implicitly. buoyancy() keeps the net lift of
+ * the last step (N).
+ *
+ * Drag acts against environment.wind plus a per-balloon local wind, which
+ * sampleWind() fills from a wind field (e.g. a WindGrid readback).
+ */
+struct BalloonSim {
+  struct Environment {
+    std::array<float, 3> wind{}; // m/s
+    float gravity = 9.80665f;
+    float heat_rate = 1.5f;       // K/s at full burner
+    float cooling_rate = 0.004f;  // 1/s, towards ambient
+    float drag_coefficient = 0.5f;
+  };
+
+  /* kernels work on whole vectors; streams are padded to this many floats */
+  static constexpr size_t lanes = AlignedArena::alignment / sizeof(float);
+  static constexpr size_t chunk = 4096; // entities per parallel task
+
+private:
+  using Stream = std::span<float>;
+
+  struct Streams {
+    Stream px, py, pz;
+    Stream vx, vy, vz;
+    Stream temperature;
+    Stream mass;
+    Stream volume;
+    Stream area; // envelope cross-section, derived from volume
+    Stream burner;
+    Stream buoyancy;
+    Stream wx, wy, wz; // local wind on top of Environment::wind
+  };
+  static constexpr size_t streamCount = 15;
+
+  AlignedArena arena;
+  Streams s;
+  size_t capacity_;
+  size_t count = 0;
+
+  float stepSeconds;
+  uint64_t stepCount = 0;
+  WorkerPool *pool;
+
+public:
+  Environment environment;
+
+  /**
+   * pool may be null to run single threaded
+   */
+  BalloonSim(size_t const capacity, float const step_seconds = 1.0f / 120.0f,
+             WorkerPool *worker_pool = nullptr)
+      : arena{streamCount * AlignedArena::footprint<float>(padded(capacity))},
+        capacity_{capacity}, stepSeconds{step_seconds}, pool{worker_pool} {
+    auto const n = padded(capacity);
+    for (auto *stream : {&s.px, &s.py, &s.pz, &s.vx, &s.vy, &s.vz,
+                         &s.temperature, &s.mass, &s.volume, &s.area,
+                         &s.burner, &s.buoyancy, &s.wx, &s.wy, &s.wz}) {
+      *stream = arena.allocate<float>(n);
+    }
+    // padding lanes are integrated too; keep them inert and finite
+    std::ranges::fill(s.mass, 1.0f);
+    std::ranges::fill(s.temperature, Balloon{}.temperature);
+  }
+
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+  [[nodiscard]] float step() const { return stepSeconds; }
+  [[nodiscard]] uint64_t steps() const { return stepCount; }
+
+  size_t add(Balloon const &balloon) {
+    if (count == capacity_)
+      throw std::runtime_error(
+          std::format("{}:{}: balloon capacity {} reached", __FILE__, __LINE__,
+                      capacity_));
+    set(count, balloon);
+    s.buoyancy[count] = 0.0f;
+    return count++;
+  }
+
+  /**
+   * Swap-remove: the last balloon takes index's place
+   */
+  void remove(size_t const index) {
+    auto const last = count - 1;
+    for (auto *stream : {&s.buoyancy, &s.wx, &s.wy, &s.wz}) {
+      (*stream)[index] = (*stream)[last];
+      (*stream)[last] = 0.0f;
+    }
+    if (index != last)
+      set(index, get(last));
+    set(last, Balloon{.mass = 1.0f, .volume = 0.0f});
+    count = last;
+  }
+
+  [[nodiscard]] Balloon get(size_t const i) const {
+    return {.position = {s.px[i], s.py[i], s.pz[i]},
+            .velocity = {s.vx[i], s.vy[i], s.vz[i]},
+            .temperature = s.temperature[i],
+            .mass = s.mass[i],
+            .volume = s.volume[i],
+            .burner = s.burner[i]};
+  }
+
+  void set(size_t const i, Balloon const &b) {
+    s.px[i] = b.position[0];
+    s.py[i] = b.position[1];
+    s.pz[i] = b.position[2];
+    s.vx[i] = b.velocity[0];
+    s.vy[i] = b.velocity[1];
+    s.vz[i] = b.velocity[2];
+    s.temperature[i] = b.temperature;
+    s.mass[i] = b.mass;
+    s.volume[i] = b.volume;
+    auto const radius =
+        std::cbrt(b.volume * 3.0f / (4.0f * std::numbers::pi_v<float>));
+    s.area[i] = std::numbers::pi_v<float> * radius * radius;
+    s.burner[i] = b.burner;
+  }
+
+  void setBurner(size_t const i, float const throttle) {
+    s.burner[i] = std::clamp(throttle, 0.0f, 1.0f);
+  }
+
+  /**
+   * Set every balloon's local wind to sampler.sample(position), where
+   * sample takes and returns std::array<float, 3>. Call between steps.
+   */
+  template <typename Sampler> void sampleWind(Sampler const &sampler) {
+    for (auto i = size_t{0}; i < count; ++i) {
+      auto const wind = sampler.sample({s.px[i], s.py[i], s.pz[i]});
+      s.wx[i] = wind[0];
+      s.wy[i] = wind[1];
+      s.wz[i] = wind[2];
+    }
+  }
+
+  [[nodiscard]] std::span<float const> positionX() const {
+    return s.px.first(count);
+  }
+  [[nodiscard]] std::span<float const> positionY() const {
+    return s.py.first(count);
+  }
+  [[nodiscard]] std::span<float const> positionZ() const {
+    return s.pz.first(count);
+  }
+  [[nodiscard]] std::span<float const> temperature() const {
+    return s.temperature.first(count);
+  }
+  [[nodiscard]] std::span<float const> buoyancy() const {
+    return s.buoyancy.first(count);
+  }
+
+  /**
+   * Advance every balloon by one fixed step
+   */
+  void advance() { advanceWith<stdx::native_simd<float>>(); }
+
+  /**
+   * advance() with an explicit vector type, e.g. the scalar ABI as a
+   * reference for the vector kernels
+   */
+  template <typename V> void advanceWith() {
+    static_assert(lanes % V::size() == 0);
+    auto const n = padded(count);
+    auto const run = [this](size_t const begin, size_t const end) {
+      integrate<V>(s, begin, end, environment, stepSeconds);
+    };
+
+    if (pool) {
+      pool->parallelFor(n, chunk, run);
+    } else {
+      run(0, n);
+    }
+    ++stepCount;
+  }
+
+private:
+  static constexpr size_t padded(size_t const n) {
+    return (n + lanes - 1) / lanes * lanes;
+  }
+
+  template <typename V>
+  static void integrate(Streams const &streams, size_t const begin,
+                        size_t const end, Environment const &env,
+                        float const h) {
+    constexpr auto r_air = 287.05f;     // J/(kg K)
+    constexpr auto p0 = 101325.0f;      // Pa
+    constexpr auto t0 = 288.15f;        // K
+    constexpr auto lapse = 0.0065f;     // K/m
+    constexpr auto scale_height = 8434.0f;
+    constexpr auto aligned = stdx::vector_aligned;
+
+    auto const g = V(env.gravity);
+    auto const zero = V(0.0f);
+
+    for (auto i = begin; i < end; i += V::size()) {
+      auto load = [&](Stream const &stream) {
+        return V(stream.data() + i, aligned);
+      };
+      auto px = load(streams.px), py = load(streams.py), pz = load(streams.pz);
+      auto vx = load(streams.vx), vy = load(streams.vy), vz = load(streams.vz);
+      auto temperature = load(streams.temperature);
+      auto const mass = load(streams.mass);
+      auto const volume = load(streams.volume);
+      auto const area = load(streams.area);
+      auto const burner = load(streams.burner);
+      auto const wx = env.wind[0] + load(streams.wx);
+      auto const wy = env.wind[1] + load(streams.wy);
+      auto const wz = env.wind[2] + load(streams.wz);
+
+      // atmosphere at the balloon's altitude
+      auto const altitude = stdx::clamp(py, zero, V(11000.0f));
+      auto const ambient = t0 - lapse * altitude;
+      auto const pressure = p0 * stdx::exp(-altitude / scale_height);
+      auto const rho_air = pressure / (r_air * ambient);
+      auto const rho_hot = pressure / (r_air * temperature);
+
+      // buoyancy of the displaced air against everything carried, hot air
+      // included
+      auto const carried = mass + rho_hot * volume;
+      auto const lift = (rho_air - rho_hot) * volume * g - mass * g;
+      auto const inv_carried = 1.0f / carried;
+
+      // quadratic drag on the envelope cross-section against the wind
+      auto const rx = vx - wx;
+      auto const ry = vy - wy;
+      auto const rz = vz - wz;
+      auto const speed = stdx::sqrt(rx * rx + ry * ry + rz * rz);
+      auto const drag =
+          0.5f * env.drag_coefficient * rho_air * area * speed * inv_carried;
+
+      // semi-implicit Euler; drag is applied implicitly so a light envelope
+      // in a strong wind cannot overshoot
+      auto const damping = 1.0f / (1.0f + drag * h);
+      vx = (vx + drag * h * wx) * damping;
+      vy = (vy + lift * inv_carried * h + drag * h * wy) * damping;
+      vz = (vz + drag * h * wz) * damping;
+      px += vx * h;
+      py += vy * h;
+      pz += vz * h;
+
+      // resting on the ground
+      auto const grounded = py < zero;
+      stdx::where(grounded, py) = zero;
+      stdx::where(grounded && vy < zero, vy) = zero;
+
+      temperature += (burner * env.heat_rate -
+                      (temperature - ambient) * env.cooling_rate) *
+                     h;
+
+      auto store = [&](V const &v, Stream const &stream) {
+        v.copy_to(stream.data() + i, aligned);
+      };
+      store(px, streams.px);
+      store(py, streams.py);
+      store(pz, streams.pz);
+      store(vx, streams.vx);
+      store(vy, streams.vy);
+      store(vz, streams.vz);
+      store(temperature, streams.temperature);
+      store(lift, streams.buoyancy);
+    }
+  }
+};
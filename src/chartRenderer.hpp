@@ -0,0 +1,344 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "seriesPyramid.hpp"
+#include "uploadRing.hpp"
+#include "vulkanCommon.hpp"
+
+#include <memory>
+
+/**
+ * Time-series line charts in the overlay. Every series keeps a
+ * SeriesPyramid on the CPU and the same node array in a device-local
+ * storage buffer; upload() copies only the nodes appends touched. record()
+ * picks the pyramid window for the chart's pixel width and draws it as a
+ * line strip of a min and a max vertex per bucket, generated in the vertex
+ * shader from gl_VertexIndex, so a chart costs O(width) whatever the number
+ * of samples.
+ */
+struct ChartRenderer {
+  /**
+   * Must match Params in shaders/chart.vert
+   */
+  struct Params {
+    std::array<float, 4> rect;    // x y width height, pixels
+    std::array<float, 4> color;   // straight-alpha RGBA
+    std::array<float, 4> mapping; // value min, value max, x0, dx (pixels)
+    std::array<float, 2> scale;   // 2 / screen size
+    uint32_t first_node = 0;      // of the window, in the node array
+  };
+
+  /**
+   * What record() shows of a series
+   */
+  struct View {
+    std::array<float, 4> rect{};
+    std::array<float, 4> color{1.0f, 1.0f, 1.0f, 1.0f};
+    uint32_t first = 0; // sample range
+    uint32_t samples = UINT32_MAX;
+    bool autoscale = true; // else value_min .. value_max
+    float value_min = 0.0f;
+    float value_max = 1.0f;
+  };
+
+private:
+  struct Series {
+    SeriesPyramid pyramid;
+    GpuBuffer buffer;
+    vk::DescriptorSet set;
+  };
+
+  GpuContext context;
+  UploadRing &ring;
+  uint32_t maxSeries;
+  std::vector<std::unique_ptr<Series>> series;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline pipeline;
+
+  vk::Semaphore uploaded;
+
+public:
+  ChartRenderer(GpuContext const &gpu_context, UploadRing &upload_ring,
+                VulkanGfxBase::PassTarget const &target,
+                uint32_t const max_series = 64)
+      : context{gpu_context}, ring{upload_ring},
+        maxSeries{std::max(max_series, 1U)} {
+    createDescriptors();
+    createPipeline(target);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+  }
+
+  ChartRenderer(ChartRenderer const &) = delete;
+  ChartRenderer &operator=(ChartRenderer const &) = delete;
+  ChartRenderer(ChartRenderer &&) = delete;
+  ChartRenderer &operator=(ChartRenderer &&) = delete;
+
+  ~ChartRenderer() {
+    ring.waitIdle();
+
+    auto const &device = context.device;
+    device.destroySemaphore(uploaded);
+    for (auto &s : series)
+      destroyBuffer(context, s->buffer);
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the sets
+    device.destroyDescriptorSetLayout(setLayout);
+  }
+
+  /**
+   * New empty series holding up to sample_capacity samples; returns its id
+   */
+  uint32_t addSeries(uint32_t const sample_capacity) {
+    if (series.size() >= maxSeries)
+      throw std::runtime_error(std::format("{}:{}: more than {} chart series",
+                                           __FILE__, __LINE__, maxSeries));
+
+    auto s = std::make_unique<Series>(Series{
+        .pyramid = SeriesPyramid(sample_capacity), .buffer = {}, .set = {}});
+    s->buffer = createBuffer(
+        context, s->pyramid.data().size_bytes(),
+        vk::BufferUsageFlagBits::eStorageBuffer |
+            vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    auto const &device = context.device;
+    s->set = device
+                 .allocateDescriptorSets(
+                     vk::DescriptorSetAllocateInfo(descriptorPool, setLayout))
+                 .front();
+    auto const buffer_info =
+        vk::DescriptorBufferInfo(s->buffer.buffer, 0, VK_WHOLE_SIZE);
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet(s->set, 0, 0,
+                               vk::DescriptorType::eStorageBuffer, {},
+                               buffer_info),
+        nullptr);
+
+    series.push_back(std::move(s));
+    return static_cast<uint32_t>(series.size() - 1);
+  }
+
+  /**
+   * Samples beyond the series' capacity are dropped; returns how many were
+   * taken
+   */
+  size_t append(uint32_t const id, std::span<float const> const samples) {
+    return series[id]->pyramid.append(samples);
+  }
+
+  [[nodiscard]] SeriesPyramid const &pyramid(uint32_t const id) const {
+    return series[id]->pyramid;
+  }
+
+  /**
+   * Copy the pyramid nodes appends changed since the last call. Returns a
+   * semaphore for VulkanGfxBase::waitBeforeNextFrame (vertex shader stage)
+   * or a null handle when nothing was appended.
+   */
+  vk::Semaphore upload() {
+    auto copied = vk::DeviceSize{0};
+    for (auto &s : series) {
+      auto const nodes = s->pyramid.data();
+      s->pyramid.takeDirty([&](uint32_t const first, uint32_t const count) {
+        ring.copyToBuffer(s->buffer.buffer,
+                          vk::DeviceSize{first} * sizeof(SeriesPyramid::MinMax),
+                          std::as_bytes(nodes.subspan(first, count)));
+        copied += count * sizeof(SeriesPyramid::MinMax);
+      });
+    }
+    if (copied == 0)
+      return {};
+
+    if (Args::verbose() > 1) {
+      std::cerr << std::format("{}:{}: chart upload {} bytes\n", __FILE__,
+                               __LINE__, copied);
+    }
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  /**
+   * Draw one series into view.rect, one bucket at most per pixel column.
+   * Viewport and scissor must already be set.
+   */
+  void record(vk::CommandBuffer const cmd, uint32_t const id, View const &view,
+              vk::Extent2D const extent) const {
+    auto const &s = *series[id];
+    auto const columns = static_cast<uint32_t>(std::max(view.rect[2], 1.0f));
+    auto const window = s.pyramid.window(view.first, view.samples, columns);
+    if (window.buckets == 0)
+      return;
+
+    auto value_min = view.value_min;
+    auto value_max = view.value_max;
+    if (view.autoscale) {
+      auto const range = s.pyramid.range(window);
+      value_min = range.min;
+      value_max = range.max;
+    }
+    if (!(value_max > value_min)) {
+      value_min -= 0.5f;
+      value_max = value_min + 1.0f;
+    }
+
+    // bucket centres in pixels; doubles keep precision past 2^24 samples
+    auto const shown = static_cast<double>(
+        std::min<uint64_t>(view.samples, s.pyramid.size() - view.first));
+    auto const bucket_samples = static_cast<double>(uint64_t{1} << window.level);
+    auto const pixels_per_sample = static_cast<double>(view.rect[2]) / shown;
+    auto const x0 =
+        (static_cast<double>(window.first_bucket) * bucket_samples +
+         0.5 * (bucket_samples - 1.0) - static_cast<double>(view.first)) *
+        pixels_per_sample;
+
+    auto const params = Params{
+        .rect = view.rect,
+        .color = view.color,
+        .mapping = {value_min, value_max, static_cast<float>(x0),
+                    static_cast<float>(bucket_samples * pixels_per_sample)},
+        .scale = {2.0f / static_cast<float>(extent.width),
+                  2.0f / static_cast<float>(extent.height)},
+        .first_node =
+            s.pyramid.levelOffset(window.level) + window.first_bucket};
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+                           s.set, nullptr);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
+                      sizeof(Params), &params);
+    cmd.draw(2 * window.buckets, 1, 0, 0);
+  }
+
+  /**
+   * Rebuild the pipeline when the overlay target changes; series and their
+   * descriptor sets stay
+   */
+  void recreatePipeline(VulkanGfxBase::PassTarget const &target) {
+    context.device.destroyPipeline(pipeline);
+    pipeline = nullptr;
+    createPipeline(target);
+  }
+
+private:
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto const binding =
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer,
+                                       1, vk::ShaderStageFlagBits::eVertex);
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, binding));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create chart descriptor set layout");
+    }
+
+    auto const pool_size =
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, maxSeries);
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, maxSeries, pool_size));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create chart descriptor pool");
+    }
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex, 0, sizeof(Params));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create chart pipeline layout");
+    }
+  }
+
+  void createPipeline(VulkanGfxBase::PassTarget const &target) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/chart.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/chart.frag.spv"
+    };
+
+    auto const &device = context.device;
+
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    // vertices come from the storage buffer
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo();
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::eLineStrip;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f; // wideLines is optional
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    // overlay: no depth
+    auto const depth = vk::PipelineDepthStencilStateCreateInfo();
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.blendEnable = vk::Bool32{true};
+    color_blend_attachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+    color_blend_attachment.dstColorBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.colorBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.dstAlphaBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipelineLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create chart pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    pipeline = pipeline_result.value;
+  }
+};
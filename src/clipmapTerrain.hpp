@@ -0,0 +1,546 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "terrainFormat.hpp"
+#include "uploadRing.hpp"
+#include "vulkanCommon.hpp"
+
+/**
+ * Geometry clipmap terrain over a tiled heightmap (terrainFormat.hpp).
+ *
+ * Every level keeps clipmapSize^2 samples of its pyramid level resident in
+ * one layer of an R16_UINT array texture, addressed toroidally, so the GPU
+ * footprint is fixed at 128 KiB per level whatever the size of the terrain.
+ * When the camera moves only the newly exposed bands are read from the
+ * mapped file and copied through the transfer queue; the frame waits for
+ * them with a semaphore. Drawing is one instanced call of a shared
+ * clipmapPatch^2 grid, one instance per patch not covered by a finer level.
+ */
+struct ClipmapTerrain {
+  /**
+   * Must match TerrainParams in shaders/terrain.vert
+   */
+  struct TerrainParams {
+    std::array<float, 16> view_proj{}; // column major
+    std::array<float, 4> camera{};     // world xyz, level 0 spacing
+    std::array<float, 4> heights{};    // offset, scale
+  };
+
+  using PatchInstance = std::array<int32_t, 4>; // level, origin x, origin y
+
+private:
+  GpuContext context;
+  UploadRing &ring;
+  TerrainTiles tiles;
+  uint32_t levels;
+
+  vk::Image heightImage;
+  vk::DeviceMemory heightMemory;
+  vk::ImageView heightView;
+  vk::Sampler sampler;
+
+  GpuBuffer gridVertices; // (clipmapPatch + 1)^2 R8G8_UINT
+  GpuBuffer gridIndices;
+  GpuBuffer instances; // host visible, rewritten by update()
+  GpuBuffer regions;   // host visible ivec4 origin[MAX_LEVELS]
+  uint32_t instanceCount = 0;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline pipeline;
+
+  vk::Semaphore uploaded;
+
+  /* region origin per level currently in the texture */
+  std::array<std::optional<std::array<int64_t, 2>>,
+             TerrainFileHeader::MAX_LEVELS>
+      resident;
+
+  static constexpr auto gridIndexCount =
+      uint32_t{clipmapPatch * clipmapPatch * 6};
+
+public:
+  /**
+   * levels is clamped to the levels stored in the file
+   */
+  ClipmapTerrain(GpuContext const &gpu_context, UploadRing &upload_ring,
+                 std::filesystem::path const &path,
+                 VulkanGfxBase::PassTarget const &target,
+                 vk::PipelineDepthStencilStateCreateInfo const &depth_state,
+                 uint32_t const requested_levels = 8)
+      : context{gpu_context}, ring{upload_ring}, tiles{path},
+        levels{std::clamp(requested_levels, 1U, tiles.header.level_count)} {
+    createHeightImage();
+    createBuffers();
+    createDescriptors();
+    createPipeline(target, depth_state);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format(
+          "{}:{}: terrain {}x{} samples, {} clipmap levels ({} KiB resident)\n",
+          __FILE__, __LINE__, tiles.header.width, tiles.header.height, levels,
+          levels * clipmapSize * clipmapSize * sizeof(uint16_t) / 1024);
+    }
+  }
+
+  ClipmapTerrain(ClipmapTerrain const &) = delete;
+  ClipmapTerrain &operator=(ClipmapTerrain const &) = delete;
+  ClipmapTerrain(ClipmapTerrain &&) = delete;
+  ClipmapTerrain &operator=(ClipmapTerrain &&) = delete;
+
+  ~ClipmapTerrain() {
+    ring.waitIdle();
+
+    auto const &device = context.device;
+    device.destroySemaphore(uploaded);
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+    for (auto *buffer : {&gridVertices, &gridIndices, &instances, &regions}) {
+      destroyBuffer(context, *buffer);
+    }
+    device.destroySampler(sampler);
+    device.destroyImageView(heightView);
+    device.destroyImage(heightImage);
+    device.freeMemory(heightMemory);
+  }
+
+  /**
+   * Move the clipmap to a camera at world position (x, height, z). Call
+   * from the frame-begin hook, i.e. once the frame slot's previous
+   * submission has completed. Returns a semaphore to hand to
+   * VulkanGfxBase::waitBeforeNextFrame (at the vertex shader stage) when
+   * texels were uploaded, or a null handle when nothing moved.
+   */
+  vk::Semaphore update(std::array<double, 3> const &camera) {
+    auto const spacing = double{tiles.header.sample_spacing};
+    auto origins = std::array<std::array<int64_t, 2>,
+                              TerrainFileHeader::MAX_LEVELS>{};
+    auto uploaded_samples = uint64_t{0};
+
+    for (auto level = 0U; level < levels; ++level) {
+      auto const level_spacing = spacing * std::ldexp(1.0, level);
+      origins[level] = clipmapOrigin(camera[0] / level_spacing,
+                                     camera[2] / level_spacing);
+
+      for (auto const &rect : clipmapDelta(resident[level], origins[level])) {
+        for (auto const &piece : clipmapWrap(rect)) {
+          auto const staged = ring.writeImage(
+              heightImage, vk::ImageLayout::eGeneral,
+              vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0,
+                                         level, 1),
+              vk::Offset3D(static_cast<int32_t>(wrapTexel(piece.x)),
+                           static_cast<int32_t>(wrapTexel(piece.y)), 0),
+              vk::Extent3D(piece.width, piece.height, 1), sizeof(uint16_t));
+          // fill before staging anything else: the ring may flush
+          tiles.readRect(level, piece.x, piece.y, piece.width, piece.height,
+                         {reinterpret_cast<uint16_t *>(staged.data()),
+                          staged.size() / sizeof(uint16_t)});
+          uploaded_samples += uint64_t{piece.width} * piece.height;
+        }
+      }
+      resident[level] = origins[level];
+    }
+
+    writeRegions(origins);
+    writeInstances(origins);
+
+    if (uploaded_samples == 0)
+      return {};
+
+    if (Args::verbose() > 1) {
+      std::cerr << std::format("{}:{}: terrain streamed {} samples\n",
+                               __FILE__, __LINE__, uploaded_samples);
+    }
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  /**
+   * Record the terrain draw into the target subpass. Viewport and scissor
+   * are dynamic and must already be set.
+   */
+  void record(vk::CommandBuffer const cmd, TerrainParams const &params) const {
+    if (instanceCount == 0)
+      return;
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout,
+                           0, descriptorSet, nullptr);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex |
+                                          vk::ShaderStageFlagBits::eFragment,
+                      0, sizeof(TerrainParams), &params);
+    cmd.bindVertexBuffers(0, {gridVertices.buffer, instances.buffer},
+                          {vk::DeviceSize{0}, vk::DeviceSize{0}});
+    cmd.bindIndexBuffer(gridIndices.buffer, 0, vk::IndexType::eUint16);
+    cmd.drawIndexed(gridIndexCount, instanceCount, 0, 0, 0);
+  }
+
+  /**
+   * Push constants for record(), filling in the terrain's own scales
+   */
+  [[nodiscard]] TerrainParams
+  params(std::array<float, 16> const &view_proj,
+         std::array<double, 3> const &camera) const {
+    return {.view_proj = view_proj,
+            .camera = {static_cast<float>(camera[0]),
+                       static_cast<float>(camera[1]),
+                       static_cast<float>(camera[2]),
+                       tiles.header.sample_spacing},
+            .heights = {tiles.header.height_offset, tiles.header.height_scale,
+                        0.0f, 0.0f}};
+  }
+
+  [[nodiscard]] uint32_t levelCount() const { return levels; }
+
+  /**
+   * Rebuild the pipeline for a new scene target, e.g. from the gfx targets
+   * rebuilt hook; no frame drawing the terrain may be in flight
+   */
+  void recreatePipeline(
+      VulkanGfxBase::PassTarget const &target,
+      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    context.device.destroyPipeline(pipeline);
+    pipeline = nullptr;
+    createPipeline(target, depth_state);
+  }
+
+private:
+  static int64_t wrapTexel(int64_t const v) {
+    return ((v % clipmapSize) + clipmapSize) % clipmapSize;
+  }
+
+  void writeRegions(std::array<std::array<int64_t, 2>,
+                               TerrainFileHeader::MAX_LEVELS> const &origins) {
+    auto *out = static_cast<std::array<int32_t, 4> *>(regions.mapped);
+    for (auto level = 0U; level < levels; ++level) {
+      out[level] = {static_cast<int32_t>(origins[level][0]),
+                    static_cast<int32_t>(origins[level][1]), 0, 0};
+    }
+  }
+
+  /**
+   * One instance per patch of each level, minus the patches the next finer
+   * level covers. Snapping keeps a finer region on the coarser patch grid.
+   */
+  void writeInstances(std::array<std::array<int64_t, 2>,
+                                 TerrainFileHeader::MAX_LEVELS> const &origins) {
+    constexpr auto patches = clipmapSize / clipmapPatch;
+    auto *out = static_cast<PatchInstance *>(instances.mapped);
+    instanceCount = 0;
+
+    for (auto level = 0U; level < levels; ++level) {
+      auto const [ox, oy] = origins[level];
+      for (auto py = 0; py < patches; ++py) {
+        for (auto px = 0; px < patches; ++px) {
+          auto const x = ox + px * clipmapPatch;
+          auto const y = oy + py * clipmapPatch;
+
+          if (level > 0) {
+            auto const inner_x = origins[level - 1][0] / 2;
+            auto const inner_y = origins[level - 1][1] / 2;
+            if (x >= inner_x && x < inner_x + clipmapSize / 2 &&
+                y >= inner_y && y < inner_y + clipmapSize / 2)
+              continue;
+          }
+
+          out[instanceCount++] = {static_cast<int32_t>(level),
+                                  static_cast<int32_t>(x),
+                                  static_cast<int32_t>(y), 0};
+        }
+      }
+    }
+  }
+
+  void createHeightImage() {
+    auto const &device = context.device;
+
+    auto families = std::vector<uint32_t>{context.graphics_family};
+    if (context.transfer_family != context.graphics_family)
+      families.push_back(context.transfer_family);
+
+    auto image_info = vk::ImageCreateInfo();
+    image_info.imageType = vk::ImageType::e2D;
+    image_info.format = vk::Format::eR16Uint;
+    image_info.extent = vk::Extent3D(clipmapSize, clipmapSize, 1);
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = levels;
+    image_info.samples = vk::SampleCountFlagBits::e1;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage =
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    if (families.size() > 1) {
+      image_info.sharingMode = vk::SharingMode::eConcurrent;
+      image_info.setQueueFamilyIndices(families);
+    } else {
+      image_info.sharingMode = vk::SharingMode::eExclusive;
+    }
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+
+    heightImage = device.createImage(image_info);
+    if (!heightImage) {
+      throw std::runtime_error("failed to create terrain height image");
+    }
+
+    auto const requirements = device.getImageMemoryRequirements(heightImage);
+    heightMemory = device.allocateMemory(vk::MemoryAllocateInfo(
+        requirements.size,
+        findMemoryType(context.physical_device, requirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    if (!heightMemory) {
+      throw std::runtime_error("failed to allocate terrain height memory");
+    }
+    device.bindImageMemory(heightImage, heightMemory, 0);
+
+    auto const range =
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0,
+                                  levels);
+
+    auto view_info = vk::ImageViewCreateInfo();
+    view_info.image = heightImage;
+    view_info.viewType = vk::ImageViewType::e2DArray;
+    view_info.format = vk::Format::eR16Uint;
+    view_info.subresourceRange = range;
+    heightView = device.createImageView(view_info);
+    if (!heightView) {
+      throw std::runtime_error("failed to create terrain height view");
+    }
+
+    // texelFetch only, but a combined sampler is still required
+    sampler = device.createSampler(vk::SamplerCreateInfo(
+        {}, vk::Filter::eNearest, vk::Filter::eNearest,
+        vk::SamplerMipmapMode::eNearest, vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge));
+    if (!sampler) {
+      throw std::runtime_error("failed to create terrain sampler");
+    }
+
+    // the image stays in GENERAL: written by copies, read by the vertex stage
+    auto barrier = vk::ImageMemoryBarrier();
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eGeneral;
+    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.image = heightImage;
+    barrier.subresourceRange = range;
+    ring.batch().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                 vk::PipelineStageFlagBits::eTransfer, {},
+                                 nullptr, nullptr, barrier);
+  }
+
+  void createBuffers() {
+    constexpr auto edge = clipmapPatch + 1;
+
+    auto grid = std::vector<std::array<uint8_t, 2>>();
+    grid.reserve(edge * edge);
+    for (auto y = 0; y < edge; ++y)
+      for (auto x = 0; x < edge; ++x)
+        grid.push_back({static_cast<uint8_t>(x), static_cast<uint8_t>(y)});
+
+    auto indices = std::vector<uint16_t>();
+    indices.reserve(gridIndexCount);
+    for (auto y = 0; y < clipmapPatch; ++y) {
+      for (auto x = 0; x < clipmapPatch; ++x) {
+        auto const i = static_cast<uint16_t>(y * edge + x);
+        indices.insert(indices.end(),
+                       {i, static_cast<uint16_t>(i + edge),
+                        static_cast<uint16_t>(i + 1),
+                        static_cast<uint16_t>(i + 1),
+                        static_cast<uint16_t>(i + edge),
+                        static_cast<uint16_t>(i + edge + 1)});
+      }
+    }
+
+    auto const device_local =
+        vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eDeviceLocal};
+    auto const host_visible = vk::MemoryPropertyFlagBits::eHostVisible |
+                              vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    gridVertices = createBuffer(context, std::as_bytes(std::span(grid)).size(),
+                                vk::BufferUsageFlagBits::eVertexBuffer |
+                                    vk::BufferUsageFlagBits::eTransferDst,
+                                device_local);
+    ring.copyToBuffer(gridVertices.buffer, 0, std::as_bytes(std::span(grid)));
+
+    gridIndices = createBuffer(context,
+                               std::as_bytes(std::span(indices)).size(),
+                               vk::BufferUsageFlagBits::eIndexBuffer |
+                                   vk::BufferUsageFlagBits::eTransferDst,
+                               device_local);
+    ring.copyToBuffer(gridIndices.buffer, 0,
+                      std::as_bytes(std::span(indices)));
+
+    constexpr auto patches_per_level =
+        (clipmapSize / clipmapPatch) * (clipmapSize / clipmapPatch);
+    instances = createBuffer(
+        context, vk::DeviceSize{levels} * patches_per_level * sizeof(PatchInstance),
+        vk::BufferUsageFlagBits::eVertexBuffer, host_visible);
+
+    regions = createBuffer(context,
+                           TerrainFileHeader::MAX_LEVELS *
+                               sizeof(std::array<int32_t, 4>),
+                           vk::BufferUsageFlagBits::eUniformBuffer,
+                           host_visible);
+    std::memset(regions.mapped, 0, regions.size);
+
+    ring.waitIdle();
+  }
+
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto const bindings = std::array{
+        vk::DescriptorSetLayoutBinding(
+            0, vk::DescriptorType::eCombinedImageSampler, 1,
+            vk::ShaderStageFlagBits::eVertex),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer,
+                                       1, vk::ShaderStageFlagBits::eVertex),
+    };
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, bindings));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create terrain descriptor set layout");
+    }
+
+    auto const pool_sizes = std::array{
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1),
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 1)};
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 1, pool_sizes));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create terrain descriptor pool");
+    }
+    descriptorSet = device
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo(
+                            descriptorPool, setLayout))
+                        .front();
+
+    auto const image_info = vk::DescriptorImageInfo(
+        sampler, heightView, vk::ImageLayout::eGeneral);
+    auto const buffer_info =
+        vk::DescriptorBufferInfo(regions.buffer, 0, regions.size);
+    device.updateDescriptorSets(
+        std::array{
+            vk::WriteDescriptorSet(descriptorSet, 0, 0,
+                                   vk::DescriptorType::eCombinedImageSampler,
+                                   image_info),
+            vk::WriteDescriptorSet(descriptorSet, 1, 0,
+                                   vk::DescriptorType::eUniformBuffer, {},
+                                   buffer_info)},
+        nullptr);
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+        0, sizeof(TerrainParams));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create terrain pipeline layout");
+    }
+  }
+
+  void createPipeline(VulkanGfxBase::PassTarget const &target,
+                      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/terrain.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/terrain.frag.spv"
+    };
+
+    auto const &device = context.device;
+
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const spec_values = std::array<int32_t, 3>{
+        clipmapSize, clipmapSnap, static_cast<int32_t>(levels)};
+    auto const spec_entries = std::array{
+        vk::SpecializationMapEntry(0, 0, sizeof(int32_t)),
+        vk::SpecializationMapEntry(1, sizeof(int32_t), sizeof(int32_t)),
+        vk::SpecializationMapEntry(2, 2 * sizeof(int32_t), sizeof(int32_t))};
+    auto const spec_info = vk::SpecializationInfo(
+        spec_entries.size(), spec_entries.data(),
+        sizeof(spec_values), spec_values.data());
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main",
+            &spec_info),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    auto const vertex_bindings = std::array{
+        vk::VertexInputBindingDescription(0, sizeof(std::array<uint8_t, 2>),
+                                          vk::VertexInputRate::eVertex),
+        vk::VertexInputBindingDescription(1, sizeof(PatchInstance),
+                                          vk::VertexInputRate::eInstance)};
+    auto const vertex_attributes = std::array{
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR8G8Uint, 0),
+        vk::VertexInputAttributeDescription(1, 1, vk::Format::eR32G32B32A32Sint,
+                                            0)};
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo(
+        {}, vertex_bindings, vertex_attributes);
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f;
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth_state;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipelineLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create terrain pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    pipeline = pipeline_result.value;
+  }
+};
@@ -0,0 +1,231 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "../args.hpp"
+#include "platformGfx.hpp"
+#include "unixSocket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+/**
+ * Runtime control over a local Unix stream socket. Clients send one JSON
+ * object per line, {"cmd": "<name>", ...}; each gets one JSON line back,
+ * {"ok": true, ...} with the handler's result merged in, or
+ * {"ok": false, "error": "..."}.
+ *
+ * The event loop only buffers and parses; commands run in apply(), which
+ * the frame loop calls at a frame boundary, so handlers may change
+ * anything the frame reads. Handlers are registered by whoever owns the
+ * state they change; "help" lists them.
+ */
+struct ControlServer {
+  using Handler = std::function<nlohmann::json(nlohmann::json const &)>;
+
+  static constexpr size_t maxLine = size_t{64} << 10;
+
+private:
+  struct Client {
+    int fd = -1;
+    std::string pending; // bytes after the last complete line
+    bool closed = false;
+  };
+
+  struct Command {
+    std::weak_ptr<Client> client;
+    nlohmann::json request;
+  };
+
+  PlatformGfx &platform;
+  std::filesystem::path socketPath;
+  int listenFd = -1;
+  std::vector<std::shared_ptr<Client>> clients;
+  std::deque<Command> queued;
+  std::map<std::string, std::pair<std::string, Handler>, std::less<>> handlers;
+
+public:
+  ControlServer(PlatformGfx &platform_gfx, std::filesystem::path path)
+      : platform{platform_gfx}, socketPath{std::move(path)} {
+    listenFd = listenUnixSocket(socketPath);
+
+    platform.addEventSource(listenFd, [this] { acceptClients(); });
+
+    on("help", "list commands", [this](nlohmann::json const &) {
+      auto commands = nlohmann::json::object();
+      for (auto const &[name, entry] : handlers)
+        commands[name] = entry.first;
+      return nlohmann::json{{"commands", commands}};
+    });
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format("{}:{}: control socket on {}\n", __FILE__,
+                               __LINE__, socketPath.native());
+    }
+  }
+
+  ControlServer(ControlServer const &) = delete;
+  ControlServer &operator=(ControlServer const &) = delete;
+  ControlServer(ControlServer &&) = delete;
+  ControlServer &operator=(ControlServer &&) = delete;
+
+  ~ControlServer() {
+    for (auto const &client : clients)
+      dropClient(*client);
+    platform.removeEventSource(listenFd);
+    close(listenFd);
+    std::filesystem::remove(socketPath);
+  }
+
+  /**
+   * Commands received and waiting for apply()
+   */
+  [[nodiscard]] size_t queuedCount() const { return queued.size(); }
+
+  /**
+   * Register (or replace) command name. handler gets the whole request and
+   * returns fields for the reply; it throws (std::exception) to fail.
+   */
+  void on(std::string const &name, std::string description,
+          Handler handler) {
+    handlers.insert_or_assign(name,
+                              std::pair{std::move(description),
+                                        std::move(handler)});
+  }
+
+  /**
+   * Run the commands received since the last call and answer them.
+   * Returns the number of commands run.
+   */
+  size_t apply() {
+    auto ran = size_t{0};
+    while (!queued.empty()) {
+      auto const command = std::move(queued.front());
+      queued.pop_front();
+      auto reply = run(command.request);
+      ++ran;
+      if (auto const client = command.client.lock(); client && !client->closed)
+        respond(*client, reply);
+    }
+
+    std::erase_if(clients, [this](std::shared_ptr<Client> const &client) {
+      if (client->closed)
+        dropClient(*client);
+      return client->closed;
+    });
+    return ran;
+  }
+
+  /**
+   * One command, without a client: for tests and for replaying commands
+   */
+  nlohmann::json run(nlohmann::json const &request) {
+    auto const cmd = request.is_object() ? request.find("cmd") : request.end();
+    if (!request.is_object() || cmd == request.end() || !cmd->is_string())
+      return failure("expected {\"cmd\": \"<name>\", ...}");
+
+    auto const handler = handlers.find(cmd->get<std::string>());
+    if (handler == handlers.end())
+      return failure(std::format("unknown command {}", cmd->dump()));
+
+    try {
+      auto reply = handler->second.second(request);
+      if (!reply.is_object())
+        reply = nlohmann::json{{"result", std::move(reply)}};
+      reply["ok"] = true;
+      if (Args::verbose() > 0) {
+        std::cerr << std::format("{}:{}: control: {}\n", __FILE__, __LINE__,
+                                 request.dump());
+      }
+      return reply;
+    } catch (std::exception const &error) {
+      return failure(error.what());
+    }
+  }
+
+private:
+  static nlohmann::json failure(std::string const &error) {
+    return {{"ok", false}, {"error", error}};
+  }
+
+  void acceptClients() {
+    while (true) {
+      auto const fd = accept4(listenFd, nullptr, nullptr,
+                              SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd == -1)
+        return;
+      auto const &client = clients.emplace_back(std::make_shared<Client>());
+      client->fd = fd;
+      platform.addEventSource(fd, [this, c = client.get()] { readClient(*c); });
+    }
+  }
+
+  void readClient(Client &client) {
+    char chunk[4096];
+    while (true) {
+      auto const got = read(client.fd, chunk, sizeof(chunk));
+      if (got < 0 && (errno == EAGAIN || errno == EINTR))
+        break;
+      if (got <= 0) {
+        disconnect(client);
+        break;
+      }
+      client.pending.append(chunk, static_cast<size_t>(got));
+    }
+
+    // complete lines become commands, in order
+    auto const shared = std::ranges::find(
+        clients, &client, [](auto const &owned) { return owned.get(); });
+    auto begin = size_t{0};
+    for (auto end = client.pending.find('\n'); end != std::string::npos;
+         end = client.pending.find('\n', begin)) {
+      auto const line = std::string_view(client.pending).substr(begin, end - begin);
+      begin = end + 1;
+      if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+        continue;
+      auto request = nlohmann::json::parse(line, nullptr, false);
+      if (request.is_discarded()) {
+        respond(client, failure("malformed JSON"));
+        continue;
+      }
+      queued.push_back({*shared, std::move(request)});
+    }
+    client.pending.erase(0, begin);
+
+    if (client.pending.size() > maxLine) {
+      respond(client, failure("line too long"));
+      disconnect(client);
+    }
+  }
+
+  void respond(Client &client, nlohmann::json const &reply) {
+    auto const line = reply.dump() + '\n';
+    // replies are small; a client that doesn't read them loses them
+    if (send(client.fd, line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT) <
+        0)
+      disconnect(client);
+  }
+
+  void disconnect(Client &client) {
+    if (client.closed)
+      return;
+    client.closed = true;
+    platform.removeEventSource(client.fd);
+  }
+
+  void dropClient(Client &client) {
+    if (!client.closed)
+      platform.removeEventSource(client.fd);
+    close(client.fd);
+  }
+};
@@ -0,0 +1,121 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+/**
+ * Swapchain and upload parameters measured for one GPU and driver by the
+ * autotuner (--autotune), stored in the config file under
+ * /autotune/<deviceTuningKey> and applied as the device comes up.
+ *
+ * Frames in flight are not tuned: the frame loop keeps exactly one (a single
+ * fence and semaphore pair, and FrameHook uploads rely on the previous frame
+ * being done), so a deeper queue needs per-frame sync objects first.
+ */
+struct DeviceTuning {
+  std::string present_mode = "FIFO"; // FIFO, FIFO_RELAXED or MAILBOX
+  uint32_t image_count = 0;          // 0: one more than the surface minimum
+  uint64_t upload_chunk = 0;         // bytes per staged copy, 0: half the ring
+
+  [[nodiscard]] nlohmann::json toJson() const {
+    return {{"present_mode", present_mode},
+            {"image_count", image_count},
+            {"upload_chunk", upload_chunk}};
+  }
+
+  /**
+   * Missing or mistyped fields keep their defaults
+   */
+  static DeviceTuning fromJson(nlohmann::json const &json) {
+    auto tuning = DeviceTuning();
+    if (!json.is_object())
+      return tuning;
+    if (auto const it = json.find("present_mode");
+        it != json.end() && it->is_string())
+      tuning.present_mode = it->get<std::string>();
+    if (auto const it = json.find("image_count");
+        it != json.end() && it->is_number_integer() && *it >= 0)
+      tuning.image_count = it->get<uint32_t>();
+    if (auto const it = json.find("upload_chunk");
+        it != json.end() && it->is_number_integer() && *it >= 0)
+      tuning.upload_chunk = it->get<uint64_t>();
+    return tuning;
+  }
+};
+
+/**
+ * Config key for a device: vendor and device id, the pipeline cache UUID
+ * (which changes with the driver build) and the driver version
+ */
+[[nodiscard]] inline std::string
+deviceTuningKey(uint32_t const vendor_id, uint32_t const device_id,
+                std::span<uint8_t const, 16> const pipeline_cache_uuid,
+                uint32_t const driver_version) {
+  auto key = std::format("{:04x}-{:04x}-", vendor_id, device_id);
+  for (auto const byte : pipeline_cache_uuid)
+    key += std::format("{:02x}", unsigned{byte});
+  return key + std::format("-{:x}", driver_version);
+}
+
+/**
+ * One swapchain configuration's measurement
+ */
+struct PresentTrial {
+  std::string present_mode;
+  uint32_t image_count = 0;
+  double p95_interval_ms = 0.0; // between frames, pacing
+  double mean_blocked_ms = 0.0; // waiting on fence and acquire, latency
+};
+
+/**
+ * Best of the trials: slow frames and time spent blocked both count, so
+ * a mode that paces as well but queues less latency wins; ties go to the
+ * fewer swapchain images. Null for no trials.
+ */
+[[nodiscard]] inline PresentTrial const *
+pickPresentTrial(std::span<PresentTrial const> const trials) {
+  auto const score = [](PresentTrial const &trial) {
+    return trial.p95_interval_ms + trial.mean_blocked_ms;
+  };
+  auto const *best = static_cast<PresentTrial const *>(nullptr);
+  for (auto const &trial : trials) {
+    if (!best || score(trial) < score(*best) * 0.98 ||
+        (score(trial) <= score(*best) * 1.02 &&
+         trial.image_count < best->image_count))
+      best = &trial;
+  }
+  return best;
+}
+
+/**
+ * One upload chunk size's measurement
+ */
+struct UploadTrial {
+  uint64_t chunk = 0;
+  double gib_per_second = 0.0;
+};
+
+/**
+ * Smallest chunk within 5% of the best throughput: smaller chunks keep
+ * less of the staging ring tied up per copy. 0 for no trials.
+ */
+[[nodiscard]] inline uint64_t
+pickUploadChunk(std::span<UploadTrial const> const trials) {
+  auto best = 0.0;
+  for (auto const &trial : trials)
+    best = std::max(best, trial.gib_per_second);
+  auto chunk = uint64_t{0};
+  for (auto const &trial : trials) {
+    if (trial.gib_per_second >= 0.95 * best &&
+        (chunk == 0 || trial.chunk < chunk))
+      chunk = trial.chunk;
+  }
+  return chunk;
+}
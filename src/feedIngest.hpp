@@ -0,0 +1,393 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "../args.hpp"
+#include "mmappedFile.hpp"
+#include "spscQueue.hpp"
+
+#include <simdjson.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <poll.h>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+/**
+ * Decodes newline-delimited JSON objects into rows of doubles, one per
+ * requested top-level field, with simdjson On-Demand: each object is
+ * walked once, only the wanted values are parsed, and nothing is
+ * allocated per document. Missing or non-numeric values are NaN.
+ *
+ * A malformed line is counted in errors() and skipped; decoding resumes at
+ * the next line.
+ */
+struct FeedDecoder {
+  /* must exceed the longest line */
+  static constexpr size_t batchBytes = size_t{1} << 20;
+  static constexpr size_t padding = simdjson::SIMDJSON_PADDING;
+
+private:
+  simdjson::ondemand::parser parser;
+  std::vector<std::string> names;
+  std::vector<double> row;
+  uint64_t errorCount = 0;
+
+public:
+  explicit FeedDecoder(std::vector<std::string> fields)
+      : names{std::move(fields)}, row(names.size()) {}
+
+  [[nodiscard]] std::span<std::string const> fields() const { return names; }
+  [[nodiscard]] uint64_t errors() const { return errorCount; }
+
+  /**
+   * Decode every document in data[0, length), calling emit(row) with a
+   * span of fields().size() values until it returns false. data must have
+   * padding readable bytes past length (simdjson reads ahead). Returns the
+   * rows emitted.
+   */
+  template <typename Emit>
+  size_t decode(char const *data, size_t const length, Emit &&emit) {
+    auto rows = size_t{0};
+    auto offset = size_t{0};
+    while (offset < length) {
+      auto stream = simdjson::ondemand::document_stream();
+      if (parser.iterate_many(data + offset, length - offset, batchBytes)
+              .get(stream)) {
+        ++errorCount;
+        break;
+      }
+
+      auto failed_at = length;
+      for (auto it = stream.begin(); it != stream.end(); ++it) {
+        if (!decodeRow(*it)) {
+          failed_at = offset + it.current_index();
+          break;
+        }
+        ++rows;
+        if (!emit(std::span<double const>(row)))
+          return rows;
+      }
+      if (failed_at >= length)
+        break;
+
+      ++errorCount;
+      auto const *newline = static_cast<char const *>(
+          std::memchr(data + failed_at, '\n', length - failed_at));
+      offset = newline ? static_cast<size_t>(newline - data) + 1 : length;
+    }
+    return rows;
+  }
+
+private:
+  bool decodeRow(
+      simdjson::simdjson_result<simdjson::ondemand::document_reference> doc) {
+    auto object = simdjson::ondemand::object();
+    if (doc.get_object().get(object))
+      return false;
+
+    std::ranges::fill(row, std::numeric_limits<double>::quiet_NaN());
+    for (auto field : object) {
+      auto key = std::string_view();
+      if (field.unescaped_key().get(key))
+        return false;
+      auto const match = std::ranges::find(names, key);
+      if (match == names.end())
+        continue; // skipped without parsing
+
+      auto value = 0.0;
+      if (field.value().get_double().get(value) == simdjson::SUCCESS)
+        row[static_cast<size_t>(match - names.begin())] = value;
+    }
+    return true;
+  }
+};
+
+/**
+ * Columns of up to batch_rows decoded rows, column i for field i
+ */
+struct FeedBatch {
+  size_t rows = 0;
+  std::vector<std::vector<double>> columns;
+};
+
+/**
+ * Live feed ingestion: a worker thread decodes NDJSON from a file (mapped
+ * with MMapped and parsed in place) or a pipe / socket into FeedBatches
+ * and hands them to the render thread through an SpscQueue. Batches are
+ * allocated up front and recycled through a second queue, so steady-state
+ * ingestion allocates nothing; when the consumer falls behind, the worker
+ * waits for a free batch rather than dropping rows.
+ */
+struct FeedIngest {
+  struct Stats {
+    uint64_t rows = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+  };
+
+private:
+  static constexpr size_t pipeChunk = size_t{1} << 20;
+  static constexpr auto freeBatchWait = std::chrono::microseconds(100);
+
+  FeedDecoder decoder;
+  size_t batchRows;
+  std::vector<FeedBatch> batches;
+  SpscQueue<FeedBatch *> ready;
+  SpscQueue<FeedBatch *> spare;
+
+  std::optional<MMapped<char>> file;
+  int inputFd = -1;
+
+  std::atomic<uint64_t> rowCount{0};
+  std::atomic<uint64_t> errorCount{0};
+  std::atomic<uint64_t> byteCount{0};
+  std::atomic<bool> done{false};
+  uint64_t droppedLines = 0; // worker only: longer than pipeChunk
+
+  std::jthread worker; // last: stopped and joined before the rest goes
+
+public:
+  /**
+   * Ingest a whole NDJSON file
+   */
+  FeedIngest(std::filesystem::path const &path, std::vector<std::string> fields,
+             size_t const batch_rows = 4096, size_t const batch_count = 8)
+      : FeedIngest(std::move(fields), batch_rows, batch_count) {
+    if (std::filesystem::file_size(path) > 0)
+      file.emplace(path);
+    worker = std::jthread(
+        [this](std::stop_token const &stop) { ingestFile(stop); });
+  }
+
+  /**
+   * Ingest from fd (a pipe or socket) until end of file; fd is not closed
+   */
+  FeedIngest(int const fd, std::vector<std::string> fields,
+             size_t const batch_rows = 4096, size_t const batch_count = 8)
+      : FeedIngest(std::move(fields), batch_rows, batch_count) {
+    inputFd = fd;
+    worker = std::jthread(
+        [this](std::stop_token const &stop) { ingestStream(stop); });
+  }
+
+  FeedIngest(FeedIngest const &) = delete;
+  FeedIngest &operator=(FeedIngest const &) = delete;
+  FeedIngest(FeedIngest &&) = delete;
+  FeedIngest &operator=(FeedIngest &&) = delete;
+
+  ~FeedIngest() = default;
+
+  [[nodiscard]] std::span<std::string const> fields() const {
+    return decoder.fields();
+  }
+
+  /**
+   * Consumer side: fn(batch) for every batch decoded so far, which is then
+   * recycled. Returns the number of rows seen.
+   */
+  template <typename Fn> size_t poll(Fn const &fn) {
+    auto rows = size_t{0};
+    while (auto batch = ready.tryPop()) {
+      fn(static_cast<FeedBatch const &>(**batch));
+      rows += (*batch)->rows;
+      (*batch)->rows = 0;
+      spare.tryPush(*batch);
+    }
+    return rows;
+  }
+
+  /**
+   * The source is exhausted and every batch was polled
+   */
+  [[nodiscard]] bool finished() const {
+    return done.load(std::memory_order_acquire) && ready.size() == 0;
+  }
+
+  [[nodiscard]] Stats stats() const {
+    return {.rows = rowCount.load(std::memory_order_relaxed),
+            .errors = errorCount.load(std::memory_order_relaxed),
+            .bytes = byteCount.load(std::memory_order_relaxed)};
+  }
+
+private:
+  FeedIngest(std::vector<std::string> fields, size_t const batch_rows,
+             size_t const batch_count)
+      : decoder{std::move(fields)}, batchRows{std::max<size_t>(batch_rows, 1)},
+        batches(std::max<size_t>(batch_count, 2)), ready{batches.size()},
+        spare{batches.size()} {
+    for (auto &batch : batches) {
+      batch.columns.assign(decoder.fields().size(),
+                           std::vector<double>(batchRows));
+      spare.tryPush(&batch);
+    }
+  }
+
+  /**
+   * Worker-side row sink, bound to one decode run
+   */
+  struct Filler {
+    FeedIngest &ingest;
+    std::stop_token const &stop;
+    FeedBatch *batch = nullptr;
+
+    bool operator()(std::span<double const> const row) {
+      if (!batch && !(batch = ingest.acquire(stop)))
+        return false;
+      for (auto c = size_t{0}; c < row.size(); ++c)
+        batch->columns[c][batch->rows] = row[c];
+      if (++batch->rows == ingest.batchRows)
+        publish();
+      return true;
+    }
+
+    void publish() {
+      if (batch && batch->rows > 0) {
+        ingest.rowCount.fetch_add(batch->rows, std::memory_order_relaxed);
+        ingest.ready.tryPush(batch);
+        batch = nullptr;
+      }
+    }
+  };
+
+  FeedBatch *acquire(std::stop_token const &stop) {
+    while (!stop.stop_requested()) {
+      if (auto batch = spare.tryPop())
+        return *batch;
+      std::this_thread::sleep_for(freeBatchWait);
+    }
+    return nullptr;
+  }
+
+  void finish(Filler &filler, std::chrono::steady_clock::time_point start) {
+    filler.publish();
+    errorCount.store(decoder.errors() + droppedLines,
+                     std::memory_order_relaxed);
+    done.store(true, std::memory_order_release);
+
+    if (Args::verbose() > 0) {
+      auto const seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+      std::cerr << std::format(
+          "{}:{}: feed: {} rows, {} errors, {:.1f} MiB at {:.1f} MiB/s\n",
+          __FILE__, __LINE__, rowCount.load(), errorCount.load(),
+          static_cast<double>(byteCount.load()) / (1 << 20),
+          static_cast<double>(byteCount.load()) / (1 << 20) /
+              std::max(seconds, 1e-9));
+    }
+  }
+
+  void ingestFile(std::stop_token const &stop) {
+    auto const start = std::chrono::steady_clock::now();
+    auto filler = Filler{*this, stop};
+    if (!file) {
+      finish(filler, start);
+      return;
+    }
+
+    auto const *data = file->data().get();
+    auto const size = static_cast<size_t>(file->size());
+
+    // parse in place up to the last line that leaves simdjson's read-ahead
+    // inside the mapping; only the short tail is copied
+    auto in_place = size_t{0};
+    if (size > FeedDecoder::padding) {
+      auto const limit = size - FeedDecoder::padding;
+      auto const *newline = static_cast<char const *>(
+          memrchr(data, '\n', limit));
+      in_place = newline ? static_cast<size_t>(newline - data) + 1 : 0;
+    }
+    decoder.decode(data, in_place, filler);
+    byteCount.store(in_place, std::memory_order_relaxed);
+
+    if (!stop.stop_requested() && in_place < size) {
+      auto tail = std::vector<char>(size - in_place + FeedDecoder::padding);
+      std::memcpy(tail.data(), data + in_place, size - in_place);
+      decoder.decode(tail.data(), size - in_place, filler);
+      byteCount.store(size, std::memory_order_relaxed);
+    }
+    finish(filler, start);
+  }
+
+  void ingestStream(std::stop_token const &stop) {
+    auto const start = std::chrono::steady_clock::now();
+    auto filler = Filler{*this, stop};
+    auto buffer = std::vector<char>(pipeChunk + FeedDecoder::padding);
+    auto filled = size_t{0};
+    auto skipping = false; // inside a line longer than the buffer
+
+    while (!stop.stop_requested()) {
+      auto pfd = pollfd{.fd = inputFd, .events = POLLIN, .revents = 0};
+      if (::poll(&pfd, 1, 100) == 0)
+        continue; // timed out: check for stop
+
+      auto const got = ::read(inputFd, buffer.data() + filled,
+                              pipeChunk - filled);
+      if (got < 0) {
+        if (errno == EINTR || errno == EAGAIN)
+          continue;
+        if (Args::verbose() > 0) {
+          std::cerr << std::format("{}:{}: feed read failed: {}\n", __FILE__,
+                                   __LINE__, strerror(errno));
+        }
+        break;
+      }
+      if (got == 0) {
+        // end of input: a last line may lack its newline
+        if (!skipping)
+          decoder.decode(buffer.data(), filled, filler);
+        break;
+      }
+      filled += static_cast<size_t>(got);
+      byteCount.fetch_add(static_cast<uint64_t>(got),
+                          std::memory_order_relaxed);
+
+      if (skipping) {
+        // drop the rest of the overlong line only; what follows its
+        // newline is ordinary input
+        auto const *end = static_cast<char const *>(
+            std::memchr(buffer.data(), '\n', filled));
+        if (!end) {
+          filled = 0;
+          continue;
+        }
+        auto const dropped = static_cast<size_t>(end - buffer.data()) + 1;
+        std::memmove(buffer.data(), buffer.data() + dropped, filled - dropped);
+        filled -= dropped;
+        skipping = false;
+      }
+
+      auto const *newline = static_cast<char const *>(
+          memrchr(buffer.data(), '\n', filled));
+      if (!newline) {
+        if (filled == pipeChunk) {
+          // a line longer than the buffer: drop it up to its newline
+          ++droppedLines;
+          skipping = true;
+          filled = 0;
+        }
+        continue;
+      }
+
+      auto const complete = static_cast<size_t>(newline - buffer.data()) + 1;
+      decoder.decode(buffer.data(), complete, filler);
+      std::memmove(buffer.data(), buffer.data() + complete, filled - complete);
+      filled -= complete;
+
+      // low feed rates: hand over what arrived instead of waiting for a
+      // full batch
+      filler.publish();
+      errorCount.store(decoder.errors() + droppedLines,
+                       std::memory_order_relaxed);
+    }
+    finish(filler, start);
+  }
+};
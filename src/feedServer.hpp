@@ -0,0 +1,300 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "../args.hpp"
+#include "feedWire.hpp"
+#include "platformGfx.hpp"
+#include "unixSocket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Accepts columnar updates (see feedWire.hpp) from local producer
+ * processes on a Unix stream socket. The listening socket and every client
+ * are event sources of the platform event loop, whose handlers only move
+ * bytes and passed memfds into per-client buffers; drain(), called once
+ * per frame, parses everything that arrived since the last frame and hands
+ * each update to the consumer as spans into those buffers or into the
+ * mapped memfd, without copying the payload again.
+ *
+ * A client that sends a malformed message is disconnected. A client whose
+ * unread backlog exceeds maxBacklog is no longer read until the next
+ * drain(), which pushes back on the producer through the socket.
+ */
+struct FeedServer {
+  struct Update {
+    uint32_t stream = 0;
+    uint32_t rows = 0;
+    std::span<FeedColumn const> columns;
+  };
+
+  struct Stats {
+    uint64_t updates = 0;
+    uint64_t inline_bytes = 0;
+    uint64_t memfd_bytes = 0;
+    uint64_t clients = 0;
+    uint64_t rejected = 0; // clients dropped for protocol errors
+  };
+
+  static constexpr size_t readChunk = size_t{64} << 10;
+  static constexpr size_t maxBacklog = size_t{256} << 20;
+  static constexpr size_t maxPassedFds = 16; // per recvmsg
+
+private:
+  struct Client {
+    int fd = -1;
+    std::vector<std::byte> buffer; // 16-byte aligned by operator new
+    size_t filled = 0;
+    std::deque<int> passedFds; // SCM_RIGHTS, in arrival order
+    bool watched = true;
+    bool hungUp = false; // dropped once drained
+    bool failed = false; // protocol error; dropped without draining
+  };
+
+  PlatformGfx &platform;
+  std::filesystem::path socketPath;
+  int listenFd = -1;
+  std::vector<std::unique_ptr<Client>> clients;
+  std::vector<FeedColumn> columns; // of the update being delivered
+  Stats totals;
+
+public:
+  FeedServer(PlatformGfx &platform_gfx, std::filesystem::path path)
+      : platform{platform_gfx}, socketPath{std::move(path)} {
+    listenFd = listenUnixSocket(socketPath);
+
+    platform.addEventSource(listenFd, [this] { acceptClients(); });
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format("{}:{}: feed listening on {}\n", __FILE__,
+                               __LINE__, socketPath.native());
+    }
+  }
+
+  FeedServer(FeedServer const &) = delete;
+  FeedServer &operator=(FeedServer const &) = delete;
+  FeedServer(FeedServer &&) = delete;
+  FeedServer &operator=(FeedServer &&) = delete;
+
+  ~FeedServer() {
+    for (auto &client : clients)
+      dropClient(*client);
+    platform.removeEventSource(listenFd);
+    close(listenFd);
+    std::filesystem::remove(socketPath);
+  }
+
+  [[nodiscard]] Stats stats() const { return totals; }
+  [[nodiscard]] size_t clientCount() const { return clients.size(); }
+
+  /**
+   * Deliver every complete update received since the last call to
+   * fn(Update const &), in arrival order per client. The spans are valid
+   * only during the call. Returns the number of updates.
+   */
+  template <typename Fn> size_t drain(Fn const &fn) {
+    auto updates = size_t{0};
+    for (auto &client : clients) {
+      auto offset = size_t{0};
+      while (!client->failed) {
+        auto const bytes =
+            std::span(client->buffer).subspan(offset, client->filled - offset);
+        auto error = std::string();
+        auto const message = parseFeedMessage(bytes, error);
+        if (!message) {
+          if (!error.empty())
+            reject(*client, error);
+          break;
+        }
+        if (!message->usesMemfd() && bytes.size() < message->size())
+          break; // payload still arriving
+
+        if (!deliver(*client, *message, bytes, fn))
+          break;
+        offset += message->size();
+        ++updates;
+      }
+
+      // keep the unparsed tail; offsets stay multiples of 8
+      std::memmove(client->buffer.data(), client->buffer.data() + offset,
+                   client->filled - offset);
+      client->filled -= offset;
+      if (!client->watched && !client->hungUp && !client->failed) {
+        client->watched = true;
+        watch(*client);
+      }
+    }
+
+    std::erase_if(clients, [this](std::unique_ptr<Client> const &client) {
+      auto const done = client->hungUp || client->failed;
+      if (done)
+        dropClient(*client);
+      return done;
+    });
+
+    if (updates > 0 && Args::verbose() > 2) {
+      std::cerr << std::format("{}:{}: feed: {} updates this frame\n",
+                               __FILE__, __LINE__, updates);
+    }
+    return updates;
+  }
+
+private:
+  void acceptClients() {
+    while (true) {
+      auto const fd = accept4(listenFd, nullptr, nullptr,
+                              SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd == -1)
+        return; // EAGAIN: all accepted
+      auto &client = clients.emplace_back(std::make_unique<Client>());
+      client->fd = fd;
+      client->buffer.resize(readChunk);
+      watch(*client);
+      ++totals.clients;
+
+      if (Args::verbose() > 0) {
+        std::cerr << std::format("{}:{}: feed client connected\n", __FILE__,
+                                 __LINE__);
+      }
+    }
+  }
+
+  void watch(Client &client) {
+    platform.addEventSource(client.fd, [this, c = &client] { readClient(*c); });
+  }
+
+  void readClient(Client &client) {
+    while (!client.failed) {
+      if (client.buffer.size() - client.filled < readChunk) {
+        if (client.filled >= maxBacklog) {
+          // stop reading until drain() catches up
+          platform.removeEventSource(client.fd);
+          client.watched = false;
+          return;
+        }
+        client.buffer.resize(std::max(client.buffer.size() * 2,
+                                      client.filled + readChunk));
+      }
+
+      auto data = iovec{.iov_base = client.buffer.data() + client.filled,
+                        .iov_len = client.buffer.size() - client.filled};
+      alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxPassedFds)];
+      auto header = msghdr{};
+      header.msg_iov = &data;
+      header.msg_iovlen = 1;
+      header.msg_control = control;
+      header.msg_controllen = sizeof(control);
+
+      auto const got = recvmsg(client.fd, &header, MSG_CMSG_CLOEXEC);
+      if (got < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+      if (got <= 0) {
+        // hung up (or failed): what arrived is still drained
+        client.hungUp = true;
+        platform.removeEventSource(client.fd);
+        client.watched = false;
+        return;
+      }
+
+      for (auto *cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+           cmsg = CMSG_NXTHDR(&header, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+          continue;
+        auto const count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (auto i = size_t{0}; i < count; ++i) {
+          auto fd = 0;
+          std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+          client.passedFds.push_back(fd);
+        }
+      }
+      if (header.msg_flags & MSG_CTRUNC)
+        reject(client, "too many file descriptors in one message");
+      client.filled += static_cast<size_t>(got);
+    }
+  }
+
+  template <typename Fn>
+  bool deliver(Client &client, FeedMessage const &message,
+               std::span<std::byte const> const bytes, Fn const &fn) {
+    auto const table_end =
+        sizeof(FeedMessageHeader) + message.columns.size_bytes();
+    auto const payload_bytes = message.header.payload_bytes;
+
+    columns.clear();
+    if (!message.usesMemfd()) {
+      message.splitColumns(bytes.subspan(table_end, payload_bytes), columns);
+      fn(Update{message.header.stream, message.header.row_count, columns});
+      totals.inline_bytes += payload_bytes;
+      ++totals.updates;
+      return true;
+    }
+
+    if (client.passedFds.empty()) {
+      reject(client, "memfd message without a file descriptor");
+      return false;
+    }
+    auto const fd = client.passedFds.front();
+    client.passedFds.pop_front();
+
+    struct stat status {};
+    auto const seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1 || !(seals & F_SEAL_SHRINK) || fstat(fd, &status) == -1 ||
+        static_cast<uint64_t>(status.st_size) < payload_bytes) {
+      close(fd);
+      reject(client, "memfd not sealed against shrinking or too small");
+      return false;
+    }
+
+    if (payload_bytes > 0) {
+      auto *mapped = mmap(nullptr, payload_bytes, PROT_READ, MAP_SHARED, fd, 0);
+      if (mapped == MAP_FAILED) {
+        close(fd);
+        reject(client, std::format("mmap failed: {}", strerror(errno)));
+        return false;
+      }
+      message.splitColumns(
+          {static_cast<std::byte const *>(mapped), payload_bytes}, columns);
+      fn(Update{message.header.stream, message.header.row_count, columns});
+      munmap(mapped, payload_bytes);
+    } else {
+      fn(Update{message.header.stream, message.header.row_count, columns});
+    }
+    close(fd);
+    totals.memfd_bytes += payload_bytes;
+    ++totals.updates;
+    return true;
+  }
+
+  void reject(Client &client, std::string_view const reason) {
+    if (Args::verbose() > 0) {
+      std::cerr << std::format("{}:{}: feed client dropped: {}\n", __FILE__,
+                               __LINE__, reason);
+    }
+    if (client.watched)
+      platform.removeEventSource(client.fd);
+    client.watched = false;
+    client.failed = true;
+    ++totals.rejected;
+  }
+
+  void dropClient(Client &client) {
+    if (client.watched)
+      platform.removeEventSource(client.fd);
+    client.watched = false;
+    for (auto const fd : client.passedFds)
+      close(fd);
+    client.passedFds.clear();
+    close(client.fd);
+  }
+};
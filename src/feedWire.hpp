@@ -0,0 +1,211 @@
+#pragma once
+
+static_assert(__cplusplus >= 202002L, "Needs C++20");
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Columnar update from a producer process, as sent over FeedServer's Unix
+ * socket (native byte order: producers are local). A message is
+ *
+ *   FeedMessageHeader
+ *   FeedColumnInfo[column_count]
+ *   payload: column_count blocks of row_count values, each padded to 8
+ *            bytes; inline after the table, or with FLAG_MEMFD in a memfd
+ *            passed with SCM_RIGHTS alongside the header
+ *
+ * Message sizes are multiples of 8, so every column block is naturally
+ * aligned wherever a message lands in the receive buffer. A memfd must be
+ * sealed against shrinking (F_SEAL_SHRINK) so the mapping cannot fault.
+ */
+struct FeedMessageHeader {
+  static constexpr auto MAGIC = std::array<char, 4>{'H', 'A', 'F', 'D'};
+  static constexpr uint16_t VERSION = 1;
+  static constexpr uint16_t FLAG_MEMFD = 1;
+  static constexpr uint32_t MAX_COLUMNS = 256;
+  static constexpr uint64_t MAX_INLINE_PAYLOAD = uint64_t{64} << 20;
+
+  std::array<char, 4> magic = MAGIC;
+  uint16_t version = VERSION;
+  uint16_t flags = 0;
+  uint32_t stream = 0; // producer-chosen series / table id
+  uint32_t row_count = 0;
+  uint32_t column_count = 0;
+  uint32_t reserved = 0;
+  uint64_t payload_bytes = 0;
+};
+static_assert(sizeof(FeedMessageHeader) == 32);
+
+enum class FeedType : uint32_t { F32 = 1, F64 = 2, I64 = 3 };
+
+struct FeedColumnInfo {
+  uint32_t id = 0; // producer-chosen column id
+  FeedType type = FeedType::F64;
+};
+static_assert(sizeof(FeedColumnInfo) == 8);
+
+[[nodiscard]] constexpr uint32_t feedTypeSize(FeedType const type) {
+  return type == FeedType::F32 ? 4 : 8;
+}
+
+[[nodiscard]] constexpr uint64_t feedPad(uint64_t const bytes) {
+  return (bytes + 7) & ~uint64_t{7};
+}
+
+/**
+ * One column of a received update, viewing the receive buffer or memfd
+ * mapping it arrived in
+ */
+struct FeedColumn {
+  uint32_t id = 0;
+  FeedType type = FeedType::F64;
+  std::span<std::byte const> bytes;
+
+  /**
+   * Values as T; empty if T is not the column's type
+   */
+  template <typename T> [[nodiscard]] std::span<T const> values() const {
+    constexpr auto wanted = std::is_same_v<T, float>    ? FeedType::F32
+                            : std::is_same_v<T, double> ? FeedType::F64
+                                                        : FeedType::I64;
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double> ||
+                  std::is_same_v<T, int64_t>);
+    if (type != wanted)
+      return {};
+    return {reinterpret_cast<T const *>(bytes.data()), bytes.size() / sizeof(T)};
+  }
+};
+
+/**
+ * Parsed header and column table of one message
+ */
+struct FeedMessage {
+  FeedMessageHeader header;
+  std::span<FeedColumnInfo const> columns;
+
+  /**
+   * Bytes the message occupies in the stream
+   */
+  [[nodiscard]] uint64_t size() const {
+    return sizeof(FeedMessageHeader) + columns.size_bytes() +
+           ((header.flags & FeedMessageHeader::FLAG_MEMFD)
+                ? 0
+                : header.payload_bytes);
+  }
+
+  [[nodiscard]] bool usesMemfd() const {
+    return (header.flags & FeedMessageHeader::FLAG_MEMFD) != 0;
+  }
+
+  /**
+   * Payload bytes the columns need
+   */
+  [[nodiscard]] uint64_t expectedPayload() const {
+    auto bytes = uint64_t{0};
+    for (auto const &column : columns)
+      bytes += feedPad(uint64_t{header.row_count} * feedTypeSize(column.type));
+    return bytes;
+  }
+
+  /**
+   * Split payload into columns; payload must hold expectedPayload() bytes
+   */
+  void splitColumns(std::span<std::byte const> const payload,
+                    std::vector<FeedColumn> &out) const {
+    auto offset = uint64_t{0};
+    for (auto const &column : columns) {
+      auto const bytes = uint64_t{header.row_count} * feedTypeSize(column.type);
+      out.push_back({column.id, column.type, payload.subspan(offset, bytes)});
+      offset += feedPad(bytes);
+    }
+  }
+};
+
+/**
+ * Header and column table at the start of buffer. Empty while more bytes
+ * are needed; error is set (and the stream should be dropped) when the
+ * bytes cannot be a valid message. buffer must be 8-byte aligned.
+ */
+[[nodiscard]] inline std::optional<FeedMessage>
+parseFeedMessage(std::span<std::byte const> const buffer, std::string &error) {
+  if (buffer.size() < sizeof(FeedMessageHeader))
+    return std::nullopt;
+
+  auto message = FeedMessage();
+  std::memcpy(&message.header, buffer.data(), sizeof(FeedMessageHeader));
+  auto const &header = message.header;
+
+  if (header.magic != FeedMessageHeader::MAGIC) {
+    error = "bad magic";
+    return std::nullopt;
+  }
+  if (header.version != FeedMessageHeader::VERSION) {
+    error = std::format("unsupported version {}", header.version);
+    return std::nullopt;
+  }
+  if (header.column_count > FeedMessageHeader::MAX_COLUMNS) {
+    error = std::format("{} columns (at most {})", header.column_count,
+                        FeedMessageHeader::MAX_COLUMNS);
+    return std::nullopt;
+  }
+  if (!(header.flags & FeedMessageHeader::FLAG_MEMFD) &&
+      header.payload_bytes > FeedMessageHeader::MAX_INLINE_PAYLOAD) {
+    error = std::format("inline payload of {} bytes, use a memfd",
+                        header.payload_bytes);
+    return std::nullopt;
+  }
+
+  auto const table_bytes = sizeof(FeedColumnInfo) * header.column_count;
+  if (buffer.size() < sizeof(FeedMessageHeader) + table_bytes)
+    return std::nullopt;
+  message.columns = {reinterpret_cast<FeedColumnInfo const *>(
+                         buffer.data() + sizeof(FeedMessageHeader)),
+                     header.column_count};
+
+  for (auto const &column : message.columns) {
+    if (column.type != FeedType::F32 && column.type != FeedType::F64 &&
+        column.type != FeedType::I64) {
+      error = std::format("column {} has unknown type {}", column.id,
+                          static_cast<uint32_t>(column.type));
+      return std::nullopt;
+    }
+  }
+  if (message.expectedPayload() != header.payload_bytes) {
+    error = std::format("payload of {} bytes, columns need {}",
+                        header.payload_bytes, message.expectedPayload());
+    return std::nullopt;
+  }
+  return message;
+}
+
+/**
+ * Header and column table for an update; the producer side of the format.
+ * Append the padded column blocks (or send them in a memfd) after it.
+ */
+inline std::vector<std::byte>
+encodeFeedMessage(uint32_t const stream, uint32_t const row_count,
+                  std::span<FeedColumnInfo const> const columns,
+                  bool const memfd = false) {
+  auto header = FeedMessageHeader{.stream = stream,
+                                  .row_count = row_count,
+                                  .column_count =
+                                      static_cast<uint32_t>(columns.size())};
+  header.flags = memfd ? FeedMessageHeader::FLAG_MEMFD : 0;
+  for (auto const &column : columns)
+    header.payload_bytes +=
+        feedPad(uint64_t{row_count} * feedTypeSize(column.type));
+
+  auto bytes = std::vector<std::byte>(sizeof(header) + columns.size_bytes());
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  std::memcpy(bytes.data() + sizeof(header), columns.data(),
+              columns.size_bytes());
+  return bytes;
+}
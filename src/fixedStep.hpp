@@ -0,0 +1,179 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/**
+ * Accumulator that turns variable frame times into a whole number of fixed
+ * simulation steps. Time beyond maxSteps per frame is dropped rather than
+ * carried over, so a stalled frame slows the simulation down instead of
+ * sending it into a spiral of ever longer catch-up frames.
+ */
+struct FixedStep {
+private:
+  double stepSeconds;
+  uint32_t maxSteps;
+  double accumulator = 0.0;
+  uint64_t droppedSteps = 0;
+
+public:
+  explicit FixedStep(double const step_seconds,
+                     uint32_t const max_steps_per_frame = 8)
+      : stepSeconds{step_seconds}, maxSteps{std::max(max_steps_per_frame, 1U)} {
+  }
+
+  [[nodiscard]] double step() const { return stepSeconds; }
+  [[nodiscard]] uint64_t dropped() const { return droppedSteps; }
+
+  /**
+   * Add a frame's elapsed time; returns the steps now due
+   */
+  uint32_t accumulate(double const elapsed_seconds) {
+    accumulator += std::max(elapsed_seconds, 0.0);
+    auto const due = std::floor(accumulator / stepSeconds);
+    accumulator -= due * stepSeconds;
+    if (due > maxSteps) {
+      droppedSteps += static_cast<uint64_t>(due) - maxSteps;
+      return maxSteps;
+    }
+    return static_cast<uint32_t>(due);
+  }
+
+  /**
+   * How far the frame is into the next step, 0..1: the weight of the next
+   * state when interpolating
+   */
+  [[nodiscard]] float alpha() const {
+    return std::clamp(static_cast<float>(accumulator / stepSeconds), 0.0f,
+                      1.0f);
+  }
+};
+
+/**
+ * Drives a fixed-step simulation from the frame loop, optionally on its own
+ * thread. advance() runs one step and capture() copies the state rendering
+ * needs into a Snapshot; both run only on the simulation thread, which owns
+ * the simulation while the runner exists.
+ *
+ * frame() moves the target step on by the steps due and returns the
+ * snapshots either side of the frame's time with the weight to interpolate
+ * them by. A worker runs up to runAhead steps beyond the target, so the
+ * later snapshot is normally ready before the frame asks for it and the
+ * frame waits only when the simulation falls behind. Without a worker
+ * frame() steps inline, which is what headless runs use. Either way the
+ * sequence of states depends only on the step count, never on frame rate.
+ */
+template <typename Snapshot> struct FixedStepRunner {
+  struct Frame {
+    Snapshot const &from; // state at step
+    Snapshot const &to;   // state at step + 1
+    float alpha;          // weight of to
+    uint64_t step;
+  };
+
+private:
+  FixedStep clock;
+  std::function<void()> advance;
+  std::function<void(Snapshot &)> capture;
+  uint32_t runAhead;
+
+  /*
+   * snapshot of step n lives in slots[n % slots.size()]; the worker stays
+   * within runAhead of target, so it never overwrites target or target + 1
+   */
+  std::vector<Snapshot> slots;
+  std::atomic<uint64_t> target{0};    // written by frame()
+  std::atomic<uint64_t> completed{0}; // written by the simulation thread
+
+  std::jthread worker; // last: stopped and joined before the rest goes
+
+public:
+  FixedStepRunner(FixedStep fixed_step, std::function<void()> advance_fn,
+                  std::function<void(Snapshot &)> capture_fn,
+                  bool const threaded = true, uint32_t const run_ahead = 2)
+      : clock{fixed_step}, advance{std::move(advance_fn)},
+        capture{std::move(capture_fn)}, runAhead{std::max(run_ahead, 1U)},
+        slots(runAhead + 2) {
+    capture(slots[0]);
+    if (threaded) {
+      worker = std::jthread(
+          [this](std::stop_token const &stop) { workerLoop(stop); });
+    }
+  }
+
+  FixedStepRunner(FixedStepRunner const &) = delete;
+  FixedStepRunner &operator=(FixedStepRunner const &) = delete;
+  FixedStepRunner(FixedStepRunner &&) = delete;
+  FixedStepRunner &operator=(FixedStepRunner &&) = delete;
+
+  ~FixedStepRunner() {
+    if (worker.joinable()) {
+      worker.request_stop();
+      target.fetch_add(1, std::memory_order_release);
+      target.notify_one();
+    }
+  }
+
+  [[nodiscard]] FixedStep const &fixedStep() const { return clock; }
+
+  /**
+   * Steps the simulation has completed, run-ahead included
+   */
+  [[nodiscard]] uint64_t completedSteps() const {
+    return completed.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Account for elapsed_seconds of wall time. The returned snapshots stay
+   * valid until the next call.
+   */
+  Frame frame(double const elapsed_seconds) {
+    auto const step =
+        target.load(std::memory_order_relaxed) + clock.accumulate(elapsed_seconds);
+    target.store(step, std::memory_order_release);
+
+    if (worker.joinable()) {
+      target.notify_one();
+      for (auto done = completed.load(std::memory_order_acquire); done < step;
+           done = completed.load(std::memory_order_acquire))
+        completed.wait(done, std::memory_order_acquire);
+    } else {
+      while (completed.load(std::memory_order_relaxed) < step + 1)
+        stepOnce();
+    }
+
+    auto const &from = slots[step % slots.size()];
+    if (completed.load(std::memory_order_acquire) <= step) {
+      // the worker is behind: hold the last state rather than wait for it
+      return {from, from, 0.0f, step};
+    }
+    return {from, slots[(step + 1) % slots.size()], clock.alpha(), step};
+  }
+
+private:
+  void stepOnce() {
+    auto const next = completed.load(std::memory_order_relaxed) + 1;
+    advance();
+    capture(slots[next % slots.size()]);
+    completed.store(next, std::memory_order_release);
+  }
+
+  void workerLoop(std::stop_token const &stop) {
+    while (!stop.stop_requested()) {
+      auto const goal = target.load(std::memory_order_acquire);
+      if (completed.load(std::memory_order_relaxed) >= goal + runAhead) {
+        target.wait(goal, std::memory_order_acquire);
+        continue;
+      }
+      stepOnce();
+      completed.notify_one();
+    }
+  }
+};
@@ -0,0 +1,141 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * Paces frames to a rate cap. wait() sleeps with clock_nanosleep on an
+ * absolute CLOCK_MONOTONIC deadline until shortly before the frame is due
+ * and spins through the rest, which the scheduler's wake-up latency would
+ * otherwise overshoot by tens to hundreds of microseconds. The spin margin
+ * follows the measured wake-up latency, so a quiet machine spins for a few
+ * microseconds and a loaded one for longer, rather than always burning a
+ * fixed slice of a core.
+ *
+ * Deadlines advance by whole periods from the previous deadline, not from
+ * when wait() returned, so overshoot does not accumulate into drift; a
+ * frame later than a whole period restarts the schedule from now instead
+ * of hurrying to catch up.
+ */
+struct FrameLimiter {
+  using Nanoseconds = std::chrono::nanoseconds;
+
+  static constexpr auto minSpin = Nanoseconds{20'000};
+  static constexpr auto maxSpin = Nanoseconds{2'000'000};
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t late = 0;        // frames that arrived after their deadline
+    Nanoseconds overshoot{};  // mean, paced frames only
+    Nanoseconds worst{};      // largest overshoot
+    Nanoseconds spin{};       // current spin margin
+  };
+
+private:
+  Nanoseconds period{0};
+  timespec deadline{};
+  bool scheduled = false;
+
+  Nanoseconds spinMargin{200'000};
+  Nanoseconds overshootSum{0};
+  uint64_t paced = 0;
+  Stats totals;
+
+public:
+  /**
+   * fps of 0 (or less) leaves frames uncapped
+   */
+  explicit FrameLimiter(double const fps = 0.0) { setCap(fps); }
+
+  [[nodiscard]] bool capped() const { return period.count() > 0; }
+
+  void setCap(double const fps) {
+    auto const next =
+        fps > 0.0 ? Nanoseconds{static_cast<int64_t>(1e9 / fps)} : Nanoseconds{0};
+    if (next != period)
+      scheduled = false; // restart the schedule at the new rate
+    period = next;
+  }
+
+  /**
+   * Statistics since the last call
+   */
+  Stats takeStats() {
+    auto stats = totals;
+    stats.overshoot = paced > 0 ? overshootSum / static_cast<int64_t>(paced)
+                                : Nanoseconds{0};
+    stats.spin = spinMargin;
+    totals = {};
+    overshootSum = Nanoseconds{0};
+    paced = 0;
+    return stats;
+  }
+
+  /**
+   * Block until the next frame is due
+   */
+  void wait() {
+    ++totals.frames;
+    if (!capped())
+      return;
+
+    auto now = monotonicNow();
+    if (!scheduled) {
+      deadline = now;
+      scheduled = true;
+    }
+    deadline = add(deadline, period);
+
+    auto const ahead = difference(deadline, now);
+    if (ahead < Nanoseconds{0}) {
+      ++totals.late;
+      if (-ahead > period)
+        deadline = now; // too far behind to catch up
+      return;
+    }
+
+    if (ahead > spinMargin) {
+      auto const wake = add(deadline, -spinMargin);
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) ==
+             EINTR) {
+      }
+      // how late the sleep woke steers the margin: double the latency,
+      // decaying slowly when the machine is quiet
+      auto const latency = difference(monotonicNow(), wake);
+      spinMargin = std::clamp(std::max(latency * 2, spinMargin * 15 / 16),
+                              minSpin, maxSpin);
+    }
+
+    do {
+      now = monotonicNow();
+    } while (difference(deadline, now) > Nanoseconds{0});
+
+    auto const overshoot = difference(now, deadline);
+    overshootSum += overshoot;
+    totals.worst = std::max(totals.worst, overshoot);
+    ++paced;
+  }
+
+private:
+  static timespec monotonicNow() {
+    auto now = timespec{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+  }
+
+  static timespec add(timespec const t, Nanoseconds const d) {
+    auto const ns = int64_t{t.tv_nsec} + d.count();
+    auto const carry = ns >= 0 ? ns / 1'000'000'000 : (ns + 1) / 1'000'000'000 - 1;
+    return {.tv_sec = t.tv_sec + static_cast<time_t>(carry),
+            .tv_nsec = static_cast<long>(ns - carry * 1'000'000'000)};
+  }
+
+  static Nanoseconds difference(timespec const a, timespec const b) {
+    return Nanoseconds{(int64_t{a.tv_sec} - b.tv_sec) * 1'000'000'000 +
+                       (a.tv_nsec - b.tv_nsec)};
+  }
+};
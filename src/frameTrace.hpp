@@ -0,0 +1,91 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Captures timed spans while running and writes them as Chrome trace event
+ * JSON (chrome://tracing, Perfetto) on stop(). Recording is an append to a
+ * preallocated vector; once maxEvents are held further spans are counted
+ * but dropped.
+ */
+struct FrameTrace {
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t maxEvents = size_t{1} << 20;
+
+private:
+  struct Event {
+    char const *name; // static string
+    Clock::time_point begin;
+    Clock::time_point end;
+  };
+
+  std::vector<Event> events;
+  std::filesystem::path outputPath;
+  Clock::time_point origin;
+  bool running = false;
+  uint64_t droppedEvents = 0;
+
+public:
+  [[nodiscard]] bool active() const { return running; }
+  [[nodiscard]] size_t size() const { return events.size(); }
+
+  void start(std::filesystem::path path) {
+    events.clear();
+    events.reserve(maxEvents);
+    outputPath = std::move(path);
+    origin = Clock::now();
+    droppedEvents = 0;
+    running = true;
+  }
+
+  void record(char const *name, Clock::time_point const begin,
+              Clock::time_point const end) {
+    if (!running)
+      return;
+    if (events.size() == maxEvents) {
+      ++droppedEvents;
+      return;
+    }
+    events.push_back({name, begin, end});
+  }
+
+  /**
+   * Write the capture; returns the number of events written
+   */
+  size_t stop() {
+    if (!running)
+      return 0;
+    running = false;
+
+    auto out = std::ofstream(outputPath);
+    if (!out)
+      throw std::runtime_error(std::format("{}:{}: cannot write trace {}",
+                                           __FILE__, __LINE__,
+                                           outputPath.native()));
+    auto const micros = [this](Clock::time_point const t) {
+      return std::chrono::duration<double, std::micro>(t - origin).count();
+    };
+    out << "{\"traceEvents\":[";
+    for (auto i = size_t{0}; i < events.size(); ++i) {
+      auto const &event = events[i];
+      out << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << event.name
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+          << std::format("\"ts\":{:.3f},\"dur\":{:.3f}", micros(event.begin),
+                         micros(event.end) - micros(event.begin))
+          << '}';
+    }
+    out << "\n],\"otherData\":{\"dropped\":" << droppedEvents << "}}\n";
+    auto const written = events.size();
+    events = {};
+    return written;
+  }
+};
@@ -0,0 +1,122 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "meshFormat.hpp"
+#include "uploadRing.hpp"
+#include "vulkanBuffer.hpp"
+
+/**
+ * Device buffers of a mesh file. The vertex format is MeshVertex:
+ * R16G16B16A16_UNORM position (scale/bias by the header's position_min /
+ * position_scale), R16G16_SNORM octahedral normal, R16G16_SFLOAT uv.
+ */
+struct GpuMesh {
+  GpuBuffer vertices;
+  GpuBuffer indices;
+  GpuBuffer meshlets;
+  GpuBuffer meshletVertices;
+  GpuBuffer meshletTriangles;
+
+  vk::IndexType indexType = vk::IndexType::eUint16;
+  uint32_t indexCount = 0;
+  uint32_t meshletCount = 0;
+  std::array<float, 3> positionMin{};
+  std::array<float, 3> positionScale{};
+
+  /* index / meshlet ranges per level, pick one with selectMeshLod() */
+  std::vector<MeshLod> lods;
+
+  static constexpr auto vertexBinding = vk::VertexInputBindingDescription(
+      0, sizeof(MeshVertex), vk::VertexInputRate::eVertex);
+
+  static constexpr auto vertexAttributes =
+      std::array<vk::VertexInputAttributeDescription, 3>{
+          vk::VertexInputAttributeDescription(
+              0, 0, vk::Format::eR16G16B16A16Unorm,
+              offsetof(MeshVertex, position)),
+          vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm,
+                                              offsetof(MeshVertex, normal)),
+          vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Sfloat,
+                                              offsetof(MeshVertex, uv))};
+
+  void destroy(GpuContext const &context) {
+    for (auto *buffer : {&vertices, &indices, &meshlets, &meshletVertices,
+                         &meshletTriangles}) {
+      destroyBuffer(context, *buffer);
+    }
+  }
+};
+
+/**
+ * Upload a mapped mesh file. Where device-local memory is host visible
+ * (UMA, resizable BAR) sections are copied straight from the mapped pages
+ * into the final buffers; otherwise they go through the transfer queue via
+ * ring. Either way the spans are read in place, so only the pages actually
+ * touched are faulted in. Blocks until the data is on the device.
+ */
+inline GpuMesh uploadMesh(GpuContext const &context, UploadRing &ring,
+                          MeshView const &mesh) {
+  auto const direct = hasHostVisibleDeviceMemory(context.physical_device);
+  auto const memory =
+      direct ? vk::MemoryPropertyFlagBits::eDeviceLocal |
+                   vk::MemoryPropertyFlagBits::eHostVisible |
+                   vk::MemoryPropertyFlagBits::eHostCoherent
+             : vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eDeviceLocal};
+
+  auto upload = [&](std::span<std::byte const> bytes,
+                    vk::BufferUsageFlags const usage) {
+    // zero-sized buffers are invalid; keep a minimal one for empty sections
+    auto buffer = createBuffer(
+        context, std::max<vk::DeviceSize>(bytes.size(), 16),
+        usage | (direct ? vk::BufferUsageFlags{}
+                        : vk::BufferUsageFlags{
+                              vk::BufferUsageFlagBits::eTransferDst}),
+        memory);
+
+    if (bytes.empty())
+      return buffer;
+
+    if (direct) {
+      std::memcpy(buffer.mapped, bytes.data(), bytes.size());
+    } else {
+      ring.copyToBuffer(buffer.buffer, 0, bytes);
+    }
+    return buffer;
+  };
+
+  auto result = GpuMesh();
+  result.vertices = upload(mesh.vertexBytes(),
+                           vk::BufferUsageFlagBits::eVertexBuffer |
+                               vk::BufferUsageFlagBits::eStorageBuffer);
+  result.indices = upload(mesh.indexBytes(),
+                          vk::BufferUsageFlagBits::eIndexBuffer |
+                              vk::BufferUsageFlagBits::eStorageBuffer);
+  result.meshlets = upload(std::as_bytes(mesh.meshlets()),
+                           vk::BufferUsageFlagBits::eStorageBuffer);
+  result.meshletVertices = upload(mesh.meshletVertexBytes(),
+                                  vk::BufferUsageFlagBits::eStorageBuffer);
+  result.meshletTriangles = upload(mesh.meshletTriangleBytes(),
+                                   vk::BufferUsageFlagBits::eStorageBuffer);
+
+  if (!direct) {
+    ring.waitIdle();
+  }
+
+  result.indexType = mesh.header->index_size == 2 ? vk::IndexType::eUint16
+                                                  : vk::IndexType::eUint32;
+  result.indexCount = mesh.header->index_count;
+  result.meshletCount = mesh.header->meshlet_count;
+  result.positionMin = mesh.header->position_min;
+  result.positionScale = mesh.header->position_scale;
+  result.lods.assign(mesh.lods().begin(), mesh.lods().end());
+
+  if (Args::verbose() > 0) {
+    std::cerr << std::format(
+        "{}:{}: uploaded mesh ({} vertices, {} indices, {} meshlets, {} "
+        "LODs, {})\n",
+        __FILE__, __LINE__, mesh.header->vertex_count, result.indexCount,
+        result.meshletCount, result.lods.size(), direct ? "direct" : "staged");
+  }
+
+  return result;
+}
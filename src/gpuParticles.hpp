@@ -0,0 +1,471 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "vulkanCommon.hpp"
+
+/**
+ * Particle system simulated entirely on the compute queue.
+ *
+ * Particles live in structure-of-arrays storage buffers (shaders/
+ * particles.glsl) with a dead list of free indices and two alive lists
+ * that swap every step. step() records emission, integration, lifetime
+ * and compaction as compute passes; the alive count is turned into an
+ * indirect dispatch for the simulation and an indirect draw for record(),
+ * so the CPU never sees per-particle data or counts. Only core features
+ * are used (storage buffer atomics, indirect dispatch / draw), so it runs
+ * on lavapipe too.
+ */
+struct GpuParticles {
+  /**
+   * Must match PASS_* in shaders/particles.comp
+   */
+  enum class Pass : int32_t {
+    INIT = 0,
+    EMIT = 1,
+    PREPARE = 2,
+    SIMULATE = 3,
+    FINALIZE = 4,
+  };
+
+  /**
+   * Emitter and integration settings. Must match SimParams in
+   * shaders/particles.comp
+   */
+  struct SimParams {
+    std::array<float, 4> emitter_position{0.0f, 0.0f, 0.0f, 0.5f}; // w: radius
+    std::array<float, 4> emitter_velocity{0.0f, 4.0f, 0.0f, 1.5f}; // w: spread
+    std::array<float, 4> gravity{0.0f, -9.81f, 0.0f, 0.1f};        // w: drag
+    float dt = 0.0f;
+    float lifetime_min = 1.0f;
+    float lifetime_max = 3.0f;
+    float size = 0.05f;
+    uint32_t emit_count = 0;
+    uint32_t capacity = 0;
+    uint32_t current = 0;
+    uint32_t seed = 0;
+  };
+
+  /**
+   * Must match DrawParams in shaders/particle.vert
+   */
+  struct DrawParams {
+    std::array<float, 16> view_proj{}; // column major
+    std::array<float, 4> camera_right{1.0f, 0.0f, 0.0f, 0.0f};
+    std::array<float, 4> camera_up{0.0f, 1.0f, 0.0f, 0.0f};
+    uint32_t capacity = 0;
+    uint32_t current = 0;
+  };
+
+  /* byte offsets of the indirect commands in the counters buffer */
+  static constexpr vk::DeviceSize dispatchArgsOffset = 16;
+  static constexpr vk::DeviceSize drawArgsOffset = 32;
+  static constexpr vk::DeviceSize countersSize = 48;
+
+private:
+  GpuContext context;
+  uint32_t capacity;
+
+  /* SoA attributes, then alive (2 x capacity), dead, counters */
+  GpuBuffer positions;
+  GpuBuffer velocities;
+  GpuBuffer lifetimes;
+  GpuBuffer aliveList;
+  GpuBuffer deadList;
+  GpuBuffer counters;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+  vk::PipelineLayout computeLayout;
+  vk::PipelineLayout drawLayout;
+  std::array<vk::Pipeline, 5> computePipelines; // indexed by Pass
+  vk::Pipeline drawPipeline;
+
+  vk::CommandPool commandPool;
+  vk::CommandBuffer cmd;
+  vk::Fence stepDone;
+  vk::Semaphore stepSignal;
+
+  bool initialized = false;
+  uint32_t current = 0; // alive list the next step reads
+  uint32_t seed = 0;
+
+public:
+  GpuParticles(GpuContext const &gpu_context, uint32_t const particle_capacity,
+               VulkanGfxBase::PassTarget const &target,
+               vk::PipelineDepthStencilStateCreateInfo const &depth_state)
+      : context{gpu_context}, capacity{std::max(particle_capacity, 1U)} {
+    auto const storage = vk::BufferUsageFlagBits::eStorageBuffer;
+    auto const device_local =
+        vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eDeviceLocal};
+
+    positions = createBuffer(context, vk::DeviceSize{capacity} * 16, storage,
+                             device_local);
+    velocities = createBuffer(context, vk::DeviceSize{capacity} * 16, storage,
+                              device_local);
+    lifetimes = createBuffer(context, vk::DeviceSize{capacity} * 8, storage,
+                             device_local);
+    aliveList = createBuffer(context, vk::DeviceSize{capacity} * 2 * 4,
+                             storage, device_local);
+    deadList = createBuffer(context, vk::DeviceSize{capacity} * 4, storage,
+                            device_local);
+    counters = createBuffer(context, countersSize,
+                            storage | vk::BufferUsageFlagBits::eIndirectBuffer,
+                            device_local);
+
+    createDescriptors();
+    createComputePipelines();
+    createDrawPipeline(target, depth_state);
+
+    auto pool_info = vk::CommandPoolCreateInfo();
+    pool_info.queueFamilyIndex = context.compute_family;
+    pool_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    commandPool = context.device.createCommandPool(pool_info);
+    if (!commandPool) {
+      throw std::runtime_error(std::format(
+          "{}:{}: failed to create particle command pool", __FILE__, __LINE__));
+    }
+    cmd = context.device
+              .allocateCommandBuffers(vk::CommandBufferAllocateInfo(
+                  commandPool, vk::CommandBufferLevel::ePrimary, 1))
+              .front();
+    stepDone = context.device.createFence(
+        vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+    stepSignal = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format(
+          "{}:{}: {} particles ({} MiB of particle buffers)\n", __FILE__,
+          __LINE__, capacity,
+          (positions.size + velocities.size + lifetimes.size + aliveList.size +
+           deadList.size) >>
+              20U);
+    }
+  }
+
+  GpuParticles(GpuParticles const &) = delete;
+  GpuParticles &operator=(GpuParticles const &) = delete;
+  GpuParticles(GpuParticles &&) = delete;
+  GpuParticles &operator=(GpuParticles &&) = delete;
+
+  ~GpuParticles() {
+    auto const &device = context.device;
+    if (device.waitForFences(stepDone, vk::Bool32{true}, UINT64_MAX) !=
+        vk::Result::eSuccess) {
+      std::cerr << std::format("{}:{}: failed to wait for particle step\n",
+                               __FILE__, __LINE__);
+    }
+
+    device.destroySemaphore(stepSignal);
+    device.destroyFence(stepDone);
+    device.destroyCommandPool(commandPool);
+
+    device.destroyPipeline(drawPipeline);
+    for (auto &pipeline : computePipelines)
+      device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(drawLayout);
+    device.destroyPipelineLayout(computeLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+
+    for (auto *buffer : {&positions, &velocities, &lifetimes, &aliveList,
+                         &deadList, &counters}) {
+      destroyBuffer(context, *buffer);
+    }
+  }
+
+  /**
+   * Advance the simulation by params.dt, emitting params.emit_count new
+   * particles (fewer if the pool is full). capacity, current and seed are
+   * filled in here. Call from the frame-begin hook and hand the returned
+   * semaphore to VulkanGfxBase::waitBeforeNextFrame at the draw indirect
+   * stage; record() then draws the result.
+   */
+  vk::Semaphore step(SimParams params) {
+    auto const &device = context.device;
+    if (device.waitForFences(stepDone, vk::Bool32{true}, UINT64_MAX) !=
+        vk::Result::eSuccess) {
+      throw std::runtime_error(std::format(
+          "{}:{}: failed to wait for particle step", __FILE__, __LINE__));
+    }
+    device.resetFences(stepDone);
+
+    params.capacity = capacity;
+    params.current = current;
+    params.seed = seed++;
+
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo(
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computeLayout, 0,
+                           descriptorSet, nullptr);
+    cmd.pushConstants(computeLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                      sizeof(SimParams), &params);
+
+    // the previous step's writes; its draw (graphics queue) has finished by
+    // the time the frame-begin hook runs, with one frame in flight
+    barrier();
+
+    auto const groups = [](uint32_t const n) { return (n + 63) / 64; };
+
+    if (!initialized) {
+      dispatch(Pass::INIT, groups(capacity));
+      barrier();
+      initialized = true;
+    }
+    if (params.emit_count > 0) {
+      dispatch(Pass::EMIT, groups(params.emit_count));
+      barrier();
+    }
+    dispatch(Pass::PREPARE, 1);
+    barrier();
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute,
+                     computePipelines[static_cast<size_t>(Pass::SIMULATE)]);
+    cmd.dispatchIndirect(counters.buffer, dispatchArgsOffset);
+    barrier();
+
+    dispatch(Pass::FINALIZE, 1);
+    cmd.end();
+
+    auto submit_info = vk::SubmitInfo();
+    submit_info.setCommandBuffers(cmd);
+    submit_info.setSignalSemaphores(stepSignal);
+    context.compute_queue.submit(submit_info, stepDone);
+
+    current = 1 - current;
+    return stepSignal;
+  }
+
+  /**
+   * Draw the particles alive after the last step, as additive billboards
+   * facing the camera. Viewport and scissor are dynamic and must already
+   * be set; capacity and current in params are filled in here.
+   */
+  void record(vk::CommandBuffer const draw_cmd, DrawParams params) const {
+    if (!initialized)
+      return;
+
+    params.capacity = capacity;
+    params.current = current;
+
+    draw_cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, drawPipeline);
+    draw_cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawLayout,
+                                0, descriptorSet, nullptr);
+    draw_cmd.pushConstants(drawLayout, vk::ShaderStageFlagBits::eVertex, 0,
+                           sizeof(DrawParams), &params);
+    draw_cmd.drawIndirect(counters.buffer, drawArgsOffset, 1,
+                          sizeof(vk::DrawIndirectCommand));
+  }
+
+  [[nodiscard]] uint32_t particleCapacity() const { return capacity; }
+
+  /**
+   * Rebuild the draw pipeline for a new scene target; the compute pipelines
+   * and the particle state do not depend on it
+   */
+  void recreatePipeline(
+      VulkanGfxBase::PassTarget const &target,
+      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    context.device.destroyPipeline(drawPipeline);
+    drawPipeline = nullptr;
+    createDrawPipeline(target, depth_state);
+  }
+
+private:
+  void dispatch(Pass const pass, uint32_t const groups) {
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute,
+                     computePipelines[static_cast<size_t>(pass)]);
+    cmd.dispatch(groups, 1, 1);
+  }
+
+  /**
+   * Make compute writes visible to the following passes, including their
+   * indirect argument reads
+   */
+  void barrier() {
+    auto const memory_barrier = vk::MemoryBarrier(
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite |
+            vk::AccessFlagBits::eIndirectCommandRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eComputeShader |
+                            vk::PipelineStageFlagBits::eDrawIndirect,
+                        {}, memory_barrier, nullptr, nullptr);
+  }
+
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto bindings = std::array<vk::DescriptorSetLayoutBinding, 6>{};
+    for (auto i = 0U; i < bindings.size(); ++i) {
+      bindings[i] = vk::DescriptorSetLayoutBinding(
+          i, vk::DescriptorType::eStorageBuffer, 1,
+          vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex);
+    }
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, bindings));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create particle descriptor set layout");
+    }
+
+    auto const pool_size = vk::DescriptorPoolSize(
+        vk::DescriptorType::eStorageBuffer, bindings.size());
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 1, pool_size));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create particle descriptor pool");
+    }
+    descriptorSet = device
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo(
+                            descriptorPool, setLayout))
+                        .front();
+
+    auto const buffers = std::array{&positions, &velocities, &lifetimes,
+                                    &aliveList, &deadList, &counters};
+    auto infos = std::array<vk::DescriptorBufferInfo, 6>{};
+    auto writes = std::array<vk::WriteDescriptorSet, 6>{};
+    for (auto i = 0U; i < buffers.size(); ++i) {
+      infos[i] = vk::DescriptorBufferInfo(buffers[i]->buffer, 0, VK_WHOLE_SIZE);
+      writes[i] = vk::WriteDescriptorSet(descriptorSet, i, 0,
+                                         vk::DescriptorType::eStorageBuffer, {},
+                                         infos[i]);
+    }
+    device.updateDescriptorSets(writes, nullptr);
+
+    auto const compute_push = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eCompute, 0, sizeof(SimParams));
+    computeLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, compute_push));
+    auto const draw_push = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawParams));
+    drawLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, draw_push));
+    if (!computeLayout || !drawLayout) {
+      throw std::runtime_error("failed to create particle pipeline layouts");
+    }
+  }
+
+  void createComputePipelines() {
+    static auto const comp_code = std::vector<uint32_t>{
+#include "shaders/particles.comp.spv"
+    };
+
+    auto const module = createShaderModule(context, comp_code);
+    auto const spec_entry = vk::SpecializationMapEntry(0, 0, sizeof(int32_t));
+
+    for (auto i = 0U; i < computePipelines.size(); ++i) {
+      auto const pass_value = static_cast<int32_t>(i);
+      auto const spec_info = vk::SpecializationInfo(
+          1, &spec_entry, sizeof(int32_t), &pass_value);
+
+      auto const pipeline_info = vk::ComputePipelineCreateInfo(
+          {},
+          vk::PipelineShaderStageCreateInfo(
+              {}, vk::ShaderStageFlagBits::eCompute, module, "main",
+              &spec_info),
+          computeLayout);
+
+      auto pipeline_result =
+          context.device.createComputePipeline(nullptr, pipeline_info);
+      if (pipeline_result.result != vk::Result::eSuccess) {
+        context.device.destroyShaderModule(module);
+        throw std::runtime_error(
+            std::format("failed to create particle compute pipeline: {}\n",
+                        vk::to_string(pipeline_result.result)));
+      }
+      computePipelines[i] = pipeline_result.value;
+    }
+
+    context.device.destroyShaderModule(module);
+  }
+
+  void createDrawPipeline(
+      VulkanGfxBase::PassTarget const &target,
+      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/particle.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/particle.frag.spv"
+    };
+
+    auto const &device = context.device;
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo();
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f;
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    // blended particles test against the scene but never write depth
+    auto depth = depth_state;
+    depth.depthWriteEnable = vk::Bool32{false};
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.blendEnable = vk::Bool32{true};
+    color_blend_attachment.srcColorBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.dstColorBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.colorBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.srcAlphaBlendFactor = vk::BlendFactor::eZero;
+    color_blend_attachment.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = drawLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create particle pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    drawPipeline = pipeline_result.value;
+  }
+};
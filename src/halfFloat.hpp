@@ -0,0 +1,66 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <bit>
+#include <cstdint>
+
+/**
+ * float to IEEE 754 binary16, round to nearest even
+ */
+[[nodiscard]] constexpr uint16_t floatToHalf(float const value) {
+  auto const bits = std::bit_cast<uint32_t>(value);
+  auto const sign = static_cast<uint16_t>((bits >> 16U) & 0x8000U);
+  auto const exponent = static_cast<int32_t>((bits >> 23U) & 0xffU);
+  auto mantissa = bits & 0x7fffffU;
+
+  if (exponent == 0xff) // inf / nan
+    return sign | 0x7c00U | (mantissa ? 0x200U : 0U);
+
+  auto const half_exponent = exponent - 127 + 15;
+  if (half_exponent >= 0x1f)
+    return sign | 0x7c00U;
+
+  if (half_exponent <= 0) {
+    if (half_exponent < -10)
+      return sign;
+    mantissa |= 0x800000U;
+    auto const shift = static_cast<uint32_t>(14 - half_exponent);
+    auto half_mantissa = mantissa >> shift;
+    auto const remainder = mantissa & ((1U << shift) - 1U);
+    auto const halfway = 1U << (shift - 1U);
+    if (remainder > halfway || (remainder == halfway && (half_mantissa & 1U)))
+      ++half_mantissa;
+    return sign | static_cast<uint16_t>(half_mantissa);
+  }
+
+  auto half = static_cast<uint32_t>(half_exponent << 10) | (mantissa >> 13U);
+  auto const remainder = mantissa & 0x1fffU;
+  if (remainder > 0x1000U || (remainder == 0x1000U && (half & 1U)))
+    ++half; // may carry into the exponent, which is still correct
+  return sign | static_cast<uint16_t>(half);
+}
+
+/**
+ * IEEE 754 binary16 to float, subnormals, infinities and NaN included
+ */
+[[nodiscard]] constexpr float halfToFloat(uint16_t const half) {
+  auto const sign = static_cast<uint32_t>(half & 0x8000U) << 16U;
+  auto exponent = static_cast<uint32_t>(half >> 10U) & 0x1fU;
+  auto mantissa = static_cast<uint32_t>(half) & 0x3ffU;
+
+  if (exponent == 0x1fU) // inf / NaN
+    return std::bit_cast<float>(sign | 0x7f800000U | (mantissa << 13U));
+  if (exponent == 0) {
+    if (mantissa == 0)
+      return std::bit_cast<float>(sign);
+    // subnormal: normalize into the float range
+    exponent = 1;
+    while ((mantissa & 0x400U) == 0) {
+      mantissa <<= 1U;
+      --exponent;
+    }
+    mantissa &= 0x3ffU;
+  }
+  return std::bit_cast<float>(sign | ((exponent + 112U) << 23U) |
+                              (mantissa << 13U));
+}
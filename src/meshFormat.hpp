@@ -0,0 +1,837 @@
+#pragma once
+
+static_assert(__cplusplus >= 202002L, "Needs C++20");
+
+#include "halfFloat.hpp"
+#include "mmappedFile.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * GPU-ready vertex, 16 bytes.
+ * position: unorm16 inside the mesh bounds (w is padding, kept at 0)
+ * normal:   octahedral encoded, snorm16
+ * uv:       IEEE half floats
+ */
+struct MeshVertex {
+  std::array<uint16_t, 4> position;
+  std::array<int16_t, 2> normal;
+  std::array<uint16_t, 2> uv;
+};
+static_assert(sizeof(MeshVertex) == 16);
+
+/**
+ * A cluster of at most meshletMaxVertices vertices / meshletMaxTriangles
+ * triangles. Vertices index the mesh's meshlet vertex table, triangles are
+ * byte triples of local indices. bounds is a sphere (center, radius) in
+ * mesh space for cluster culling.
+ */
+struct Meshlet {
+  uint32_t vertex_offset;
+  uint32_t triangle_offset; // in bytes, 3 per triangle
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+  std::array<float, 4> bounds;
+};
+static_assert(sizeof(Meshlet) == 32);
+
+static constexpr auto meshletMaxVertices = 64U;
+static constexpr auto meshletMaxTriangles = 124U;
+
+/**
+ * One level of detail: a range of the shared index buffer and the meshlets
+ * built from it. All levels index the same vertex array. error is the
+ * largest mesh-space distance any LOD 0 vertex moved to reach this level.
+ */
+struct MeshLod {
+  uint32_t index_offset = 0;
+  uint32_t index_count = 0;
+  uint32_t meshlet_offset = 0;
+  uint32_t meshlet_count = 0;
+  float error = 0.0f;
+};
+
+static constexpr auto meshMaxLods = 6U;
+
+/**
+ * On-disk layout, written by tools/meshImport and mmapped as-is at runtime.
+ * Every section is 16-byte aligned so it can be read in place.
+ */
+struct MeshFileHeader {
+  static constexpr auto MAGIC = std::array<char, 4>{'H', 'A', 'M', 'S'};
+  static constexpr uint32_t VERSION = 2;
+
+  std::array<char, 4> magic = MAGIC;
+  uint32_t version = VERSION;
+
+  /* dequantized position = position_min + position * position_scale */
+  std::array<float, 3> position_min{};
+  std::array<float, 3> position_scale{};
+
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+  uint32_t index_size = 0; // 2 or 4 bytes
+  uint32_t meshlet_count = 0;
+  uint32_t meshlet_vertex_count = 0;
+  uint32_t meshlet_triangle_bytes = 0;
+
+  uint64_t vertices_offset = 0;
+  uint64_t indices_offset = 0;
+  uint64_t meshlets_offset = 0;
+  uint64_t meshlet_vertices_offset = 0;
+  uint64_t meshlet_triangles_offset = 0;
+
+  /* LOD 0 is the full mesh, coarser levels follow */
+  uint32_t lod_count = 0;
+  std::array<MeshLod, meshMaxLods> lods{};
+};
+
+/**
+ * Unquantized input, as read by the importer
+ */
+struct MeshSource {
+  std::vector<std::array<float, 3>> positions;
+  std::vector<std::array<float, 3>> normals; // may be empty
+  std::vector<std::array<float, 2>> uvs;     // may be empty
+  std::vector<uint32_t> indices;             // triangle list
+};
+
+/* quantization */
+
+inline int16_t floatToSnorm16(float const value) {
+  return static_cast<int16_t>(
+      std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+/**
+ * Unit vector to octahedral snorm16 pair (decode in shaders with the
+ * usual oct_decode)
+ */
+inline std::array<int16_t, 2> octEncode(std::array<float, 3> const &n) {
+  auto const l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+  if (l1 == 0.0f)
+    return {0, 0};
+
+  auto x = n[0] / l1;
+  auto y = n[1] / l1;
+  if (n[2] < 0.0f) {
+    auto const ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    auto const oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = ox;
+    y = oy;
+  }
+  return {floatToSnorm16(x), floatToSnorm16(y)};
+}
+
+inline std::array<float, 3> octDecode(std::array<int16_t, 2> const &e) {
+  auto const x = std::max(static_cast<float>(e[0]) / 32767.0f, -1.0f);
+  auto const y = std::max(static_cast<float>(e[1]) / 32767.0f, -1.0f);
+  auto n = std::array<float, 3>{x, y, 1.0f - std::abs(x) - std::abs(y)};
+  auto const t = std::max(-n[2], 0.0f);
+  n[0] += n[0] >= 0.0f ? -t : t;
+  n[1] += n[1] >= 0.0f ? -t : t;
+  auto const length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  return {n[0] / length, n[1] / length, n[2] / length};
+}
+
+/* index / vertex order optimization */
+
+/**
+ * Reorder triangles for post-transform vertex cache reuse
+ * (Forsyth, "Linear-Speed Vertex Cache Optimisation"). Returns the new
+ * index list; the triangle set is unchanged.
+ */
+inline std::vector<uint32_t>
+optimizeVertexCache(std::span<uint32_t const> indices,
+                    uint32_t const vertex_count) {
+  static constexpr auto cache_size = 32U;
+  static constexpr auto cache_decay_power = 1.5f;
+  static constexpr auto last_triangle_score = 0.75f;
+  static constexpr auto valence_boost_scale = 2.0f;
+  static constexpr auto valence_boost_power = -0.5f;
+
+  auto const triangle_count = indices.size() / 3;
+
+  // vertex -> triangles adjacency, CSR style
+  auto adjacency_offsets = std::vector<uint32_t>(vertex_count + 1, 0);
+  for (auto const index : indices)
+    ++adjacency_offsets[index + 1];
+  std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(),
+                   adjacency_offsets.begin());
+  auto adjacency = std::vector<uint32_t>(indices.size());
+  {
+    auto fill = std::vector<uint32_t>(adjacency_offsets.begin(),
+                                      adjacency_offsets.end() - 1);
+    for (auto t = 0U; t < triangle_count; ++t)
+      for (auto k = 0U; k < 3; ++k)
+        adjacency[fill[indices[t * 3 + k]]++] = t;
+  }
+
+  auto remaining = std::vector<uint32_t>(vertex_count);
+  for (auto v = 0U; v < vertex_count; ++v)
+    remaining[v] = adjacency_offsets[v + 1] - adjacency_offsets[v];
+
+  auto cache_position = std::vector<int32_t>(vertex_count, -1);
+
+  auto vertex_score = [&](uint32_t const v) {
+    if (remaining[v] == 0)
+      return -1.0f;
+
+    auto score = 0.0f;
+    if (auto const position = cache_position[v]; position >= 0) {
+      if (position < 3) {
+        score = last_triangle_score;
+      } else {
+        auto const scaler = 1.0f / static_cast<float>(cache_size - 3);
+        score = std::pow(1.0f - static_cast<float>(position - 3) * scaler,
+                         cache_decay_power);
+      }
+    }
+    return score +
+           valence_boost_scale *
+               std::pow(static_cast<float>(remaining[v]), valence_boost_power);
+  };
+
+  auto scores = std::vector<float>(vertex_count);
+  for (auto v = 0U; v < vertex_count; ++v)
+    scores[v] = vertex_score(v);
+
+  auto emitted = std::vector<bool>(triangle_count, false);
+  auto triangle_score = [&](uint32_t const t) {
+    return scores[indices[t * 3]] + scores[indices[t * 3 + 1]] +
+           scores[indices[t * 3 + 2]];
+  };
+
+  auto cache = std::vector<uint32_t>();
+  cache.reserve(cache_size + 3);
+
+  auto result = std::vector<uint32_t>();
+  result.reserve(indices.size());
+
+  auto scan_cursor = 0U;
+  auto best = triangle_count > 0 ? 0U : std::numeric_limits<uint32_t>::max();
+
+  while (best != std::numeric_limits<uint32_t>::max()) {
+    emitted[best] = true;
+    std::array<uint32_t, 3> const tri{indices[best * 3], indices[best * 3 + 1],
+                                      indices[best * 3 + 2]};
+    result.insert(result.end(), tri.begin(), tri.end());
+
+    // pull the triangle's vertices to the front of the LRU cache
+    for (auto const v : tri) {
+      --remaining[v];
+      if (auto it = std::ranges::find(cache, v); it != cache.end())
+        cache.erase(it);
+    }
+    cache.insert(cache.begin(), tri.begin(), tri.end());
+
+    for (auto i = 0U; i < cache.size(); ++i)
+      cache_position[cache[i]] = i < cache_size ? static_cast<int32_t>(i) : -1;
+    for (auto i = cache_size; i < cache.size(); ++i)
+      scores[cache[i]] = vertex_score(cache[i]);
+    if (cache.size() > cache_size)
+      cache.resize(cache_size);
+
+    // only triangles touching cached vertices changed score
+    best = std::numeric_limits<uint32_t>::max();
+    auto best_score = -1.0f;
+    for (auto const v : cache) {
+      scores[v] = vertex_score(v);
+    }
+    for (auto const v : cache) {
+      for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; ++a) {
+        auto const t = adjacency[a];
+        if (emitted[t])
+          continue;
+        if (auto const score = triangle_score(t); score > best_score) {
+          best_score = score;
+          best = t;
+        }
+      }
+    }
+
+    // dead end: continue with the next unemitted triangle in input order
+    if (best == std::numeric_limits<uint32_t>::max()) {
+      while (scan_cursor < triangle_count && emitted[scan_cursor])
+        ++scan_cursor;
+      if (scan_cursor < triangle_count)
+        best = scan_cursor;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Vertex remap so vertices are stored in first-use order of indices,
+ * which makes vertex fetch sequential. Returns old -> new; unused vertices
+ * map to UINT32_MAX. Rewrites indices in place.
+ */
+inline std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices,
+                                                 uint32_t const vertex_count) {
+  auto remap = std::vector<uint32_t>(vertex_count,
+                                     std::numeric_limits<uint32_t>::max());
+  auto next = 0U;
+  for (auto &index : indices) {
+    if (remap[index] == std::numeric_limits<uint32_t>::max())
+      remap[index] = next++;
+    index = remap[index];
+  }
+  return remap;
+}
+
+/* meshlets */
+
+struct MeshletBuild {
+  std::vector<Meshlet> meshlets;
+  std::vector<uint32_t> vertices;
+  std::vector<uint8_t> triangles;
+};
+
+/**
+ * Greedy clustering in index order; run after optimizeVertexCache so
+ * consecutive triangles are spatially coherent.
+ */
+inline MeshletBuild
+buildMeshlets(std::span<uint32_t const> indices,
+              std::span<std::array<float, 3> const> positions) {
+  auto build = MeshletBuild();
+
+  static constexpr auto unassigned = std::numeric_limits<uint32_t>::max();
+  auto local_index = std::vector<uint32_t>(positions.size(), unassigned);
+  auto current = Meshlet{};
+
+  auto finish = [&] {
+    if (current.triangle_count == 0)
+      return;
+
+    auto center = std::array<float, 3>{};
+    for (auto i = 0U; i < current.vertex_count; ++i) {
+      auto const &p = positions[build.vertices[current.vertex_offset + i]];
+      for (auto k = 0U; k < 3; ++k)
+        center[k] += p[k] / static_cast<float>(current.vertex_count);
+    }
+    auto radius = 0.0f;
+    for (auto i = 0U; i < current.vertex_count; ++i) {
+      auto const v = build.vertices[current.vertex_offset + i];
+      auto const &p = positions[v];
+      auto const dx = p[0] - center[0];
+      auto const dy = p[1] - center[1];
+      auto const dz = p[2] - center[2];
+      radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+      local_index[v] = unassigned;
+    }
+    current.bounds = {center[0], center[1], center[2], radius};
+
+    build.meshlets.push_back(current);
+    current = Meshlet{.vertex_offset = static_cast<uint32_t>(build.vertices.size()),
+                      .triangle_offset =
+                          static_cast<uint32_t>(build.triangles.size()),
+                      .vertex_count = 0,
+                      .triangle_count = 0,
+                      .bounds = {}};
+  };
+
+  for (auto t = 0U; t + 2 < indices.size(); t += 3) {
+    auto const new_vertices =
+        static_cast<uint32_t>(local_index[indices[t]] == unassigned) +
+        static_cast<uint32_t>(local_index[indices[t + 1]] == unassigned &&
+                              indices[t + 1] != indices[t]) +
+        static_cast<uint32_t>(local_index[indices[t + 2]] == unassigned &&
+                              indices[t + 2] != indices[t] &&
+                              indices[t + 2] != indices[t + 1]);
+
+    if (current.vertex_count + new_vertices > meshletMaxVertices ||
+        current.triangle_count + 1 > meshletMaxTriangles) {
+      finish();
+    }
+
+    for (auto k = 0U; k < 3; ++k) {
+      auto const v = indices[t + k];
+      if (local_index[v] == unassigned) {
+        local_index[v] = current.vertex_count++;
+        build.vertices.push_back(v);
+      }
+      build.triangles.push_back(static_cast<uint8_t>(local_index[v]));
+    }
+    ++current.triangle_count;
+  }
+  finish();
+
+  return build;
+}
+
+/* simplification */
+
+struct SimplifiedLod {
+  std::vector<uint32_t> indices;
+  float error = 0.0f;
+};
+
+/**
+ * Vertex-clustering simplification (Lindstrom, "Out-of-Core Simplification
+ * of Large Polygonal Models"): vertices are snapped to a uniform grid and
+ * each occupied cell collapses onto the member vertex with the least
+ * quadric error. Only existing vertices are kept, so every LOD shares the
+ * vertex array. The grid is refined by bisection until the result is at
+ * or just under target_triangles.
+ *
+ * collapse maps each original vertex to the vertex it currently renders as
+ * and is updated in place, so error accumulates across successive calls.
+ */
+inline SimplifiedLod
+simplifyClustered(std::span<uint32_t const> indices,
+                  std::span<std::array<float, 3> const> positions,
+                  size_t const target_triangles,
+                  std::vector<uint32_t> &collapse) {
+  using Quadric = std::array<double, 10>; // symmetric 4x4, upper triangle
+
+  auto quadrics = std::vector<Quadric>(positions.size(), Quadric{});
+  auto bounds_min = std::array<float, 3>{std::numeric_limits<float>::max(),
+                                         std::numeric_limits<float>::max(),
+                                         std::numeric_limits<float>::max()};
+  auto bounds_max = std::array<float, 3>{std::numeric_limits<float>::lowest(),
+                                         std::numeric_limits<float>::lowest(),
+                                         std::numeric_limits<float>::lowest()};
+
+  for (auto t = 0U; t + 2 < indices.size(); t += 3) {
+    auto const &p0 = positions[indices[t]];
+    auto const &p1 = positions[indices[t + 1]];
+    auto const &p2 = positions[indices[t + 2]];
+    auto const e1 = std::array<double, 3>{p1[0] - p0[0], p1[1] - p0[1],
+                                          p1[2] - p0[2]};
+    auto const e2 = std::array<double, 3>{p2[0] - p0[0], p2[1] - p0[1],
+                                          p2[2] - p0[2]};
+    auto n = std::array<double, 3>{e1[1] * e2[2] - e1[2] * e2[1],
+                                   e1[2] * e2[0] - e1[0] * e2[2],
+                                   e1[0] * e2[1] - e1[1] * e2[0]};
+    auto const area2 = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (area2 == 0.0)
+      continue;
+    for (auto &c : n)
+      c /= area2;
+    auto const d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+    // plane quadric, weighted by area
+    auto const plane = std::array<double, 4>{n[0], n[1], n[2], d};
+    auto q = Quadric{};
+    for (auto i = 0U, k = 0U; i < 4; ++i)
+      for (auto j = i; j < 4; ++j)
+        q[k++] = plane[i] * plane[j] * area2 * 0.5;
+
+    for (auto k = 0U; k < 3; ++k) {
+      auto &vq = quadrics[indices[t + k]];
+      for (auto i = 0U; i < q.size(); ++i)
+        vq[i] += q[i];
+      for (auto a = 0U; a < 3; ++a) {
+        bounds_min[a] = std::min(bounds_min[a], positions[indices[t + k]][a]);
+        bounds_max[a] = std::max(bounds_max[a], positions[indices[t + k]][a]);
+      }
+    }
+  }
+
+  auto quadric_error = [](Quadric const &q, std::array<float, 3> const &p) {
+    auto const x = double{p[0]};
+    auto const y = double{p[1]};
+    auto const z = double{p[2]};
+    return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+           q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z +
+           2 * q[8] * z + q[9];
+  };
+
+  auto extent = 0.0f;
+  for (auto a = 0U; a < 3; ++a)
+    extent = std::max(extent, bounds_max[a] - bounds_min[a]);
+
+  // simplified indices and the vertex each input vertex collapsed onto
+  auto cluster = [&](uint32_t const resolution) {
+    auto const cell = extent / static_cast<float>(resolution);
+    auto cell_of = [&](uint32_t const v) {
+      auto key = uint64_t{0};
+      for (auto a = 0U; a < 3; ++a) {
+        auto const c = cell > 0.0f
+                           ? std::min(static_cast<uint64_t>((positions[v][a] -
+                                                             bounds_min[a]) /
+                                                            cell),
+                                      uint64_t{resolution - 1})
+                           : uint64_t{0};
+        key = key * resolution + c;
+      }
+      return key;
+    };
+
+    // representative per cell: member with least quadric error
+    auto best = std::unordered_map<uint64_t, std::pair<uint32_t, double>>();
+    for (auto const v : indices) {
+      auto const error = quadric_error(quadrics[v], positions[v]);
+      auto [it, inserted] = best.try_emplace(cell_of(v), v, error);
+      if (!inserted && error < it->second.second)
+        it->second = {v, error};
+    }
+
+    auto representative = std::vector<uint32_t>(positions.size());
+    std::iota(representative.begin(), representative.end(), 0U);
+    for (auto const v : indices)
+      representative[v] = best.at(cell_of(v)).first;
+
+    auto result = std::vector<uint32_t>();
+    auto seen = std::set<std::array<uint32_t, 3>>();
+    for (auto t = 0U; t + 2 < indices.size(); t += 3) {
+      auto tri = std::array<uint32_t, 3>{representative[indices[t]],
+                                         representative[indices[t + 1]],
+                                         representative[indices[t + 2]]};
+      if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+        continue;
+
+      // drop duplicates; rotation keeps the winding
+      auto canonical = tri;
+      std::ranges::rotate(canonical, std::ranges::min_element(canonical));
+      if (!seen.insert(canonical).second)
+        continue;
+      result.insert(result.end(), tri.begin(), tri.end());
+    }
+    return std::pair{std::move(result), std::move(representative)};
+  };
+
+  // bisect the grid resolution: coarser grid, fewer triangles
+  auto low = 1U;
+  auto high = 1024U;
+  auto chosen = cluster(low);
+  while (low + 1 < high) {
+    auto const mid = (low + high) / 2;
+    auto attempt = cluster(mid);
+    if (attempt.first.size() / 3 <= target_triangles) {
+      low = mid;
+      chosen = std::move(attempt);
+    } else {
+      high = mid;
+    }
+  }
+  auto const &representative = chosen.second;
+
+  auto lod = SimplifiedLod{.indices = std::move(chosen.first), .error = 0.0f};
+  for (auto v = 0U; v < collapse.size(); ++v) {
+    collapse[v] = representative[collapse[v]];
+    auto const &a = positions[v];
+    auto const &b = positions[collapse[v]];
+    auto const dx = a[0] - b[0];
+    auto const dy = a[1] - b[1];
+    auto const dz = a[2] - b[2];
+    lod.error = std::max(lod.error, std::sqrt(dx * dx + dy * dy + dz * dz));
+  }
+  return lod;
+}
+
+/**
+ * Index lists for LOD 0 (the input) and up to meshMaxLods - 1 coarser
+ * levels, each targeting half the triangles of the previous. Stops early
+ * once a level no longer shrinks meaningfully.
+ */
+inline std::vector<SimplifiedLod>
+buildLodChain(std::span<uint32_t const> indices,
+              std::span<std::array<float, 3> const> positions) {
+  static constexpr auto min_triangles = size_t{64};
+
+  auto chain = std::vector<SimplifiedLod>();
+  chain.push_back(
+      {.indices = std::vector<uint32_t>(indices.begin(), indices.end()),
+       .error = 0.0f});
+
+  auto collapse = std::vector<uint32_t>(positions.size());
+  std::iota(collapse.begin(), collapse.end(), 0U);
+
+  while (chain.size() < meshMaxLods) {
+    auto const previous = chain.back().indices.size() / 3;
+    if (previous <= min_triangles)
+      break;
+
+    auto lod = simplifyClustered(chain.back().indices, positions, previous / 2,
+                                 collapse);
+    auto const triangles = lod.indices.size() / 3;
+    if (triangles == 0 || triangles > previous * 9 / 10)
+      break;
+
+    lod.error = std::max(lod.error, chain.back().error);
+    chain.push_back(std::move(lod));
+  }
+  return chain;
+}
+
+/**
+ * Coarsest level whose error, projected to the screen, stays within
+ * threshold_pixels. distance is from the eye to the instance's bounding
+ * sphere in mesh units (divide by the instance scale), projection_scale is
+ * viewport_height / (2 * tan(fovy / 2)).
+ */
+inline uint32_t selectMeshLod(std::span<MeshLod const> lods,
+                              float const distance,
+                              float const projection_scale,
+                              float const threshold_pixels = 1.0f) {
+  auto const d = std::max(distance, std::numeric_limits<float>::epsilon());
+  auto selected = 0U;
+  for (auto i = 1U; i < lods.size(); ++i) {
+    if (lods[i].error * projection_scale / d > threshold_pixels)
+      break;
+    selected = i;
+  }
+  return selected;
+}
+
+/* file */
+
+/**
+ * Quantize, optimize and cluster source, returning the complete file image
+ */
+inline std::vector<std::byte> buildMeshFile(MeshSource source) {
+  if (source.indices.size() % 3 != 0)
+    throw std::runtime_error(std::format(
+        "{}:{}: index count {} is not a triangle list", __FILE__, __LINE__,
+        source.indices.size()));
+
+  auto const source_vertex_count =
+      static_cast<uint32_t>(source.positions.size());
+  for (auto const index : source.indices) {
+    if (index >= source_vertex_count)
+      throw std::runtime_error(std::format("{}:{}: index {} out of range ({})",
+                                           __FILE__, __LINE__, index,
+                                           source_vertex_count));
+  }
+
+  // every level indexes the same vertices; LOD 0 comes first so it decides
+  // the vertex fetch order
+  auto lods = buildLodChain(source.indices, source.positions);
+  auto indices = std::vector<uint32_t>();
+  for (auto &lod : lods) {
+    lod.indices = optimizeVertexCache(lod.indices, source_vertex_count);
+    indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+  }
+  auto const remap = optimizeVertexFetch(indices, source_vertex_count);
+  auto const vertex_count = static_cast<uint32_t>(
+      std::ranges::count_if(remap, [](uint32_t const r) {
+        return r != std::numeric_limits<uint32_t>::max();
+      }));
+
+  auto positions = std::vector<std::array<float, 3>>(vertex_count);
+  for (auto v = 0U; v < source_vertex_count; ++v) {
+    if (remap[v] != std::numeric_limits<uint32_t>::max())
+      positions[remap[v]] = source.positions[v];
+  }
+
+  auto header = MeshFileHeader();
+  auto position_max = std::array<float, 3>{};
+  if (vertex_count > 0) {
+    header.position_min = positions.front();
+    position_max = positions.front();
+  }
+  for (auto const &p : positions) {
+    for (auto k = 0U; k < 3; ++k) {
+      header.position_min[k] = std::min(header.position_min[k], p[k]);
+      position_max[k] = std::max(position_max[k], p[k]);
+    }
+  }
+  for (auto k = 0U; k < 3; ++k)
+    header.position_scale[k] = (position_max[k] - header.position_min[k]) /
+                               std::numeric_limits<uint16_t>::max();
+
+  auto vertices = std::vector<MeshVertex>(vertex_count);
+  for (auto v = 0U; v < source_vertex_count; ++v) {
+    auto const r = remap[v];
+    if (r == std::numeric_limits<uint32_t>::max())
+      continue;
+
+    auto &vertex = vertices[r];
+    for (auto k = 0U; k < 3; ++k) {
+      vertex.position[k] =
+          header.position_scale[k] > 0.0f
+              ? static_cast<uint16_t>(std::lround(
+                    (source.positions[v][k] - header.position_min[k]) /
+                    header.position_scale[k]))
+              : 0;
+    }
+    vertex.position[3] = 0;
+    vertex.normal = source.normals.empty()
+                        ? std::array<int16_t, 2>{0, 0}
+                        : octEncode(source.normals.at(v));
+    vertex.uv = source.uvs.empty()
+                    ? std::array<uint16_t, 2>{0, 0}
+                    : std::array<uint16_t, 2>{floatToHalf(source.uvs.at(v)[0]),
+                                              floatToHalf(source.uvs.at(v)[1])};
+  }
+
+  auto meshlets = MeshletBuild();
+  header.lod_count = static_cast<uint32_t>(lods.size());
+  for (auto l = 0U, index_offset = 0U; l < lods.size(); ++l) {
+    auto const index_count = static_cast<uint32_t>(lods[l].indices.size());
+    auto lod_meshlets = buildMeshlets(
+        std::span{indices}.subspan(index_offset, index_count), positions);
+
+    header.lods[l] = MeshLod{
+        .index_offset = index_offset,
+        .index_count = index_count,
+        .meshlet_offset = static_cast<uint32_t>(meshlets.meshlets.size()),
+        .meshlet_count = static_cast<uint32_t>(lod_meshlets.meshlets.size()),
+        .error = lods[l].error};
+
+    for (auto &meshlet : lod_meshlets.meshlets) {
+      meshlet.vertex_offset += static_cast<uint32_t>(meshlets.vertices.size());
+      meshlet.triangle_offset +=
+          static_cast<uint32_t>(meshlets.triangles.size());
+    }
+    meshlets.meshlets.insert(meshlets.meshlets.end(),
+                             lod_meshlets.meshlets.begin(),
+                             lod_meshlets.meshlets.end());
+    meshlets.vertices.insert(meshlets.vertices.end(),
+                             lod_meshlets.vertices.begin(),
+                             lod_meshlets.vertices.end());
+    meshlets.triangles.insert(meshlets.triangles.end(),
+                              lod_meshlets.triangles.begin(),
+                              lod_meshlets.triangles.end());
+    index_offset += index_count;
+  }
+
+  header.vertex_count = vertex_count;
+  header.index_count = static_cast<uint32_t>(indices.size());
+  header.index_size =
+      vertex_count <= std::numeric_limits<uint16_t>::max() ? 2 : 4;
+  header.meshlet_count = static_cast<uint32_t>(meshlets.meshlets.size());
+  header.meshlet_vertex_count = static_cast<uint32_t>(meshlets.vertices.size());
+  header.meshlet_triangle_bytes =
+      static_cast<uint32_t>(meshlets.triangles.size());
+
+  auto file = std::vector<std::byte>();
+  auto append = [&file](void const *data, size_t const size) {
+    file.resize((file.size() + 15U) & ~size_t{15U});
+    auto const offset = file.size();
+    file.resize(offset + size);
+    if (size > 0)
+      std::memcpy(file.data() + offset, data, size);
+    return static_cast<uint64_t>(offset);
+  };
+
+  append(&header, sizeof(header)); // patched below with the offsets
+  header.vertices_offset =
+      append(vertices.data(), vertices.size() * sizeof(MeshVertex));
+  if (header.index_size == 2) {
+    auto narrow = std::vector<uint16_t>(indices.begin(), indices.end());
+    header.indices_offset =
+        append(narrow.data(), narrow.size() * sizeof(uint16_t));
+  } else {
+    header.indices_offset =
+        append(indices.data(), indices.size() * sizeof(uint32_t));
+  }
+  header.meshlets_offset =
+      append(meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+  header.meshlet_vertices_offset =
+      append(meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+  header.meshlet_triangles_offset =
+      append(meshlets.triangles.data(), meshlets.triangles.size());
+  file.resize((file.size() + 15U) & ~size_t{15U});
+
+  std::memcpy(file.data(), &header, sizeof(header));
+  return file;
+}
+
+inline void writeMeshFile(std::filesystem::path const &path,
+                          std::span<std::byte const> file) {
+  auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error(
+        std::format("{}:{}: cannot open {}", __FILE__, __LINE__, path.string()));
+  out.write(reinterpret_cast<char const *>(file.data()),
+            static_cast<std::streamsize>(file.size()));
+  if (!out)
+    throw std::runtime_error(std::format("{}:{}: failed writing {}", __FILE__,
+                                         __LINE__, path.string()));
+}
+
+/**
+ * Read-only view of a mesh file mapped with MMapped; the spans point into
+ * the mapping, nothing is copied.
+ */
+struct MeshView {
+  MMapped<std::byte> file;
+  MeshFileHeader const *header = nullptr;
+
+  explicit MeshView(std::filesystem::path const &path) : file{path} {
+    if (file.size() < sizeof(MeshFileHeader))
+      throw std::runtime_error(std::format("{}:{}: {} is too small for a mesh",
+                                           __FILE__, __LINE__, path.string()));
+
+    header = reinterpret_cast<MeshFileHeader const *>(file.data().get());
+    if (header->magic != MeshFileHeader::MAGIC ||
+        header->version != MeshFileHeader::VERSION)
+      throw std::runtime_error(std::format(
+          "{}:{}: {} is not a version {} mesh file", __FILE__, __LINE__,
+          path.string(), MeshFileHeader::VERSION));
+
+    auto const in_bounds = [this](uint64_t const offset, uint64_t const size) {
+      return offset % 16 == 0 && offset + size <= file.size();
+    };
+    if (!in_bounds(header->vertices_offset, vertexBytes().size()) ||
+        !in_bounds(header->indices_offset, indexBytes().size()) ||
+        !in_bounds(header->meshlets_offset,
+                   uint64_t{header->meshlet_count} * sizeof(Meshlet)) ||
+        !in_bounds(header->meshlet_vertices_offset,
+                   uint64_t{header->meshlet_vertex_count} * sizeof(uint32_t)) ||
+        !in_bounds(header->meshlet_triangles_offset,
+                   header->meshlet_triangle_bytes) ||
+        header->lod_count == 0 || header->lod_count > meshMaxLods)
+      throw std::runtime_error(std::format(
+          "{}:{}: {} has sections out of bounds", __FILE__, __LINE__,
+          path.string()));
+
+    for (auto const &lod : lods()) {
+      if (uint64_t{lod.index_offset} + lod.index_count > header->index_count ||
+          uint64_t{lod.meshlet_offset} + lod.meshlet_count >
+              header->meshlet_count)
+        throw std::runtime_error(std::format(
+            "{}:{}: {} has LOD ranges out of bounds", __FILE__, __LINE__,
+            path.string()));
+    }
+  }
+
+  [[nodiscard]] std::span<std::byte const> vertexBytes() const {
+    return {file.data().get() + header->vertices_offset,
+            size_t{header->vertex_count} * sizeof(MeshVertex)};
+  }
+
+  [[nodiscard]] std::span<std::byte const> indexBytes() const {
+    return {file.data().get() + header->indices_offset,
+            size_t{header->index_count} * header->index_size};
+  }
+
+  [[nodiscard]] std::span<Meshlet const> meshlets() const {
+    return {reinterpret_cast<Meshlet const *>(file.data().get() +
+                                              header->meshlets_offset),
+            header->meshlet_count};
+  }
+
+  [[nodiscard]] std::span<MeshLod const> lods() const {
+    return {header->lods.data(), header->lod_count};
+  }
+
+  [[nodiscard]] std::span<std::byte const> meshletVertexBytes() const {
+    return {file.data().get() + header->meshlet_vertices_offset,
+            size_t{header->meshlet_vertex_count} * sizeof(uint32_t)};
+  }
+
+  [[nodiscard]] std::span<std::byte const> meshletTriangleBytes() const {
+    return {file.data().get() + header->meshlet_triangles_offset,
+            header->meshlet_triangle_bytes};
+  }
+};
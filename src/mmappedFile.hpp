@@ -2,13 +2,16 @@
 
 static_assert(__cplusplus >= 202002L, "Needs C++20");
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <filesystem>
 #include <format>
+#include <memory>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <vector>
 
 template <typename T = void> struct MMapped {
 private:
@@ -69,8 +72,8 @@ public:
       data_len_ = fsize;
 
       if (auto *ptr = mmap(nullptr, static_cast<size_t>(fsize), PROT_READ,
-                           MAP_PRIVATE, 1, 1);
-          ptr) {
+                           MAP_PRIVATE, file_descriptor, 0);
+          ptr != MAP_FAILED) {
         // data_ = ptr;
         data_ = std::shared_ptr<T[]>{
             static_cast<T *>(ptr), [fsize](void *ptr) {
@@ -81,8 +84,10 @@ public:
             }};
 
       } else {
+        auto const mmap_errno = errno;
+        close(file_descriptor);
         throw std::runtime_error{std::format("{}:{}: mmap failed: {}", __FILE__,
-                                             __LINE__, strerror(errno))};
+                                             __LINE__, strerror(mmap_errno))};
       }
 
       close(file_descriptor);
@@ -91,4 +96,99 @@ public:
                                            __LINE__, strerror(errno))};
     }
   }
-};
\ No newline at end of file
+};
+/**
+ * Maps page-aligned windows of a file on demand rather than the whole file,
+ * for datasets too large to sensibly map at once. Up to max_windows
+ * mappings are kept; the least recently used one is unmapped first.
+ */
+struct MMappedWindow {
+private:
+  std::filesystem::path fpath_;
+  int file_descriptor_ = -1;
+  uintmax_t file_len_ = 0;
+  size_t window_len_;
+  size_t max_windows_;
+
+  struct Window {
+    uintmax_t offset;
+    size_t length;
+    std::byte *data;
+    uint64_t last_use;
+  };
+  std::vector<Window> windows_;
+  uint64_t use_counter_ = 0;
+
+public:
+  MMappedWindow(std::filesystem::path const &path,
+                size_t window_len = size_t{64} << 20U,
+                size_t max_windows = 8)
+      : fpath_{path}, window_len_{window_len}, max_windows_{max_windows} {
+    if (!std::filesystem::is_regular_file(fpath_))
+      throw std::runtime_error{
+          std::format("only supports mmapping regular files")};
+
+    file_descriptor_ = open(fpath_.c_str(), O_RDONLY);
+    if (file_descriptor_ == -1)
+      throw std::runtime_error{std::format("{}:{}: open failed: {}", __FILE__,
+                                           __LINE__, strerror(errno))};
+
+    file_len_ = std::filesystem::file_size(fpath_);
+
+    auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    window_len_ = std::max((window_len_ + page - 1) / page * page, page);
+  }
+
+  MMappedWindow(MMappedWindow const &) = delete;
+  MMappedWindow &operator=(MMappedWindow const &) = delete;
+
+  ~MMappedWindow() {
+    for (auto const &window : windows_)
+      munmap(window.data, window.length);
+    if (file_descriptor_ != -1)
+      close(file_descriptor_);
+  }
+
+  auto size() const -> uintmax_t { return file_len_; }
+
+  /**
+   * Bytes [offset, offset + length) of the file. The pointer stays valid
+   * until a later view() evicts its window.
+   */
+  auto view(uintmax_t offset, size_t length) -> std::byte const * {
+    if (offset + length > file_len_)
+      throw std::runtime_error{std::format(
+          "{}:{}: view [{}, {}) past end of {} ({} bytes)", __FILE__, __LINE__,
+          offset, offset + length, fpath_.string(), file_len_)};
+
+    for (auto &window : windows_) {
+      if (offset >= window.offset &&
+          offset + length <= window.offset + window.length) {
+        window.last_use = ++use_counter_;
+        return window.data + (offset - window.offset);
+      }
+    }
+
+    auto const page = static_cast<uintmax_t>(sysconf(_SC_PAGESIZE));
+    auto const window_offset = offset / page * page;
+    auto const window_length = static_cast<size_t>(std::min<uintmax_t>(
+        std::max<uintmax_t>(window_len_, offset + length - window_offset),
+        file_len_ - window_offset));
+
+    if (windows_.size() >= max_windows_) {
+      auto oldest = std::ranges::min_element(windows_, {}, &Window::last_use);
+      munmap(oldest->data, oldest->length);
+      windows_.erase(oldest);
+    }
+
+    auto *ptr = mmap(nullptr, window_length, PROT_READ, MAP_PRIVATE,
+                     file_descriptor_, static_cast<off_t>(window_offset));
+    if (ptr == MAP_FAILED)
+      throw std::runtime_error{std::format("{}:{}: mmap failed: {}", __FILE__,
+                                           __LINE__, strerror(errno))};
+
+    windows_.push_back({window_offset, window_length,
+                        static_cast<std::byte *>(ptr), ++use_counter_});
+    return windows_.back().data + (offset - window_offset);
+  }
+};
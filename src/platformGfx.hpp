@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <functional>
+#include <string>
 
 /**
  * Abstract over platform-specific graphics code.
@@ -10,6 +11,9 @@
  *      - Geometry of display/window and accessor
  *      - Prescribes an init() method
  *      - event loop with user-supplied callbacks
+ *      - extra file descriptors watched by the event loop
+ *      - runtime present mode switches
+ *      - runtime quality changes and frame cost, for QualityGovernor
  */
 struct PlatformGfx {
   virtual ~PlatformGfx() = default;
@@ -31,4 +35,48 @@ struct PlatformGfx {
    * Halts when on_tick returns false.
    */
   virtual void platformEventLoop(std::function<bool()> &&on_tick) = 0;
+
+  /**
+   * Have the event loop call on_readable whenever fd is readable (or hung
+   * up), until removeEventSource(fd). Handlers may add and remove sources.
+   */
+  virtual void addEventSource(int fd, std::function<void()> &&on_readable) = 0;
+
+  virtual void removeEventSource(int fd) = 0;
+
+  /**
+   * Switch the present mode ("FIFO", "FIFO_RELAXED", "MAILBOX" or
+   * "IMMEDIATE") from the next frame on; false if the platform or surface
+   * does not support it.
+   */
+  virtual bool requestPresentMode(std::string const & /*mode*/) {
+    return false;
+  }
+
+  /**
+   * Quality settings that may change at runtime, over their Config values
+   * (which are left as they are)
+   */
+  struct Quality {
+    std::string msaa; // Config GFX_MSAA tier
+    bool post_chain;  // Config GFX_POST_CHAIN
+  };
+
+  /**
+   * Rebuild render targets for quality before the next frame, if it differs
+   * from what is in use
+   */
+  virtual void requestQuality(Quality const & /*quality*/) {}
+
+  /**
+   * Render thread time spent recording and submitting the last frame (not
+   * waiting for it) and the GPU time of the last completed frame, in ms;
+   * zero where the platform can't tell
+   */
+  struct FrameCost {
+    double cpu_ms = 0.0;
+    double gpu_ms = 0.0;
+  };
+
+  [[nodiscard]] virtual FrameCost frameCost() const { return {}; }
 };
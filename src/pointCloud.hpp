@@ -0,0 +1,480 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "pointCloudFormat.hpp"
+#include "uploadRing.hpp"
+#include "vulkanCommon.hpp"
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stop_token>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * Out-of-core point cloud over an octree file (pointCloudFormat.hpp).
+ *
+ * The file is mapped whole and never read explicitly: each frame the
+ * selection walks the mapped node array, an io thread faults in the pages
+ * of newly wanted nodes (madvise + touch) so the render thread never blocks
+ * on the disk, and prefetched nodes are copied straight from the mapping
+ * into the upload ring and on to a fixed pool of device slots through the
+ * transfer queue. Slots of nodes that dropped out of the selection are
+ * reused least recently used first. Resident nodes are drawn as point
+ * lists, one instance per node, by a single multi-draw indirect call (one
+ * draw per node on devices without multiDrawIndirect).
+ */
+struct StreamedPointCloud {
+  /**
+   * Must match PointParams in shaders/pointcloud.vert
+   */
+  struct PointParams {
+    std::array<float, 16> view_proj{}; // column major
+  };
+
+  using NodeInstance = std::array<float, 4>; // cube min xyz, edge
+
+private:
+  enum class NodeState : uint8_t { ABSENT, REQUESTED, PREFETCHED, RESIDENT };
+
+  GpuContext context;
+  UploadRing &ring;
+  PointCloudView view;
+
+  uint64_t pointBudget;
+  vk::DeviceSize uploadLimit; // bytes per update()
+  float thresholdPixels;
+
+  /* per node */
+  std::vector<NodeState> state;
+  std::vector<uint32_t> slotOf;
+  std::vector<uint64_t> lastWanted;
+
+  /* device pool of slotCount slots of max_node_points points */
+  GpuBuffer pool;
+  GpuBuffer instances; // host visible, rewritten by update()
+  GpuBuffer commands;  // host visible, draws mirrored for drawIndirect
+  uint32_t slotPoints = 0;
+  std::vector<uint32_t> freeSlots;
+  std::vector<uint32_t> slotNode;
+
+  std::vector<uint32_t> prefetched; // waiting for a slot / upload budget
+  std::vector<vk::DrawIndirectCommand> draws; // one per resident node
+  uint64_t frame = 0;
+
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline pipeline;
+
+  vk::Semaphore uploaded;
+
+  static constexpr auto maxRequestsPerUpdate = 256U;
+  // the least maxDrawIndirectCount a device with multiDrawIndirect has
+  static constexpr auto maxDrawsPerCall = uint32_t{(1U << 16U) - 1};
+
+  /* io thread */
+  std::mutex ioMutex;
+  std::condition_variable_any ioWake;
+  std::deque<uint32_t> ioRequests;
+  std::vector<uint32_t> ioDone;
+  std::jthread ioThread; // last: stopped and joined before the rest goes
+
+public:
+  /**
+   * point_budget bounds the points drawn per frame; the device pool holds
+   * twice that (nodes are rarely full) so refinement has room to stream in
+   * while the old selection is still drawn.
+   */
+  StreamedPointCloud(GpuContext const &gpu_context, UploadRing &upload_ring,
+                     std::filesystem::path const &path,
+                     VulkanGfxBase::PassTarget const &target,
+                     vk::PipelineDepthStencilStateCreateInfo const &depth_state,
+                     uint64_t const point_budget = 8'000'000,
+                     vk::DeviceSize const upload_limit = 16U << 20U,
+                     float const threshold_pixels = 1.0f)
+      : context{gpu_context}, ring{upload_ring}, view{path},
+        pointBudget{point_budget}, uploadLimit{upload_limit},
+        thresholdPixels{threshold_pixels} {
+    auto const node_count = view.header->node_count;
+    state.assign(node_count, NodeState::ABSENT);
+    slotOf.assign(node_count, 0);
+    lastWanted.assign(node_count, 0);
+
+    slotPoints = std::max(view.header->max_node_points, 1U);
+    if (pointBudget < slotPoints) {
+      throw std::runtime_error(std::format(
+          "{}:{}: point budget {} is below the largest node ({} points)",
+          __FILE__, __LINE__, pointBudget, slotPoints));
+    }
+    auto const slot_count =
+        static_cast<uint32_t>(std::min<uint64_t>(2 * pointBudget / slotPoints,
+                                                 node_count));
+    freeSlots.resize(slot_count);
+    std::iota(freeSlots.rbegin(), freeSlots.rend(), 0U);
+    slotNode.assign(slot_count, 0);
+
+    pool = createBuffer(context,
+                        vk::DeviceSize{slot_count} * slotPoints *
+                            sizeof(PointVertex),
+                        vk::BufferUsageFlagBits::eVertexBuffer |
+                            vk::BufferUsageFlagBits::eTransferDst,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    instances = createBuffer(context,
+                             std::max<vk::DeviceSize>(slot_count, 1) *
+                                 sizeof(NodeInstance),
+                             vk::BufferUsageFlagBits::eVertexBuffer,
+                             vk::MemoryPropertyFlagBits::eHostVisible |
+                                 vk::MemoryPropertyFlagBits::eHostCoherent);
+    if (context.multi_draw_indirect) {
+      commands = createBuffer(context,
+                              std::max<vk::DeviceSize>(slot_count, 1) *
+                                  sizeof(vk::DrawIndirectCommand),
+                              vk::BufferUsageFlagBits::eIndirectBuffer,
+                              vk::MemoryPropertyFlagBits::eHostVisible |
+                                  vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    createPipelineLayout();
+    createPipeline(target, depth_state);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+
+    ioThread = std::jthread([this](std::stop_token const &stop) { ioLoop(stop); });
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format(
+          "{}:{}: point cloud {} points in {} nodes, {} slots of {} points "
+          "({} MiB)\n",
+          __FILE__, __LINE__, view.header->point_count, node_count, slot_count,
+          slotPoints, pool.size >> 20U);
+    }
+  }
+
+  StreamedPointCloud(StreamedPointCloud const &) = delete;
+  StreamedPointCloud &operator=(StreamedPointCloud const &) = delete;
+  StreamedPointCloud(StreamedPointCloud &&) = delete;
+  StreamedPointCloud &operator=(StreamedPointCloud &&) = delete;
+
+  ~StreamedPointCloud() {
+    ioThread.request_stop();
+    ioThread.join();
+    ring.waitIdle();
+
+    context.device.destroySemaphore(uploaded);
+    context.device.destroyPipeline(pipeline);
+    context.device.destroyPipelineLayout(pipelineLayout);
+    destroyBuffer(context, commands);
+    destroyBuffer(context, instances);
+    destroyBuffer(context, pool);
+  }
+
+  /**
+   * Select nodes for the camera, queue missing ones for prefetch and upload
+   * what the io thread has ready, up to the per-update byte limit. Call
+   * from the frame-begin hook; projection_scale and planes are as for
+   * selectPointNodes. Returns a semaphore for
+   * VulkanGfxBase::waitBeforeNextFrame (vertex input stage) when points
+   * were uploaded, or a null handle.
+   */
+  vk::Semaphore update(std::array<float, 3> const &eye,
+                       float const projection_scale,
+                       std::span<std::array<float, 4> const> planes = {}) {
+    ++frame;
+    auto const nodes = view.nodes();
+    auto const wanted = selectPointNodes(nodes, eye, projection_scale,
+                                         pointBudget, thresholdPixels, planes);
+
+    auto requests = std::vector<uint32_t>();
+    for (auto const node : wanted) {
+      lastWanted[node] = frame;
+      if (state[node] == NodeState::ABSENT &&
+          requests.size() < maxRequestsPerUpdate) {
+        state[node] = NodeState::REQUESTED;
+        requests.push_back(node);
+      }
+    }
+
+    {
+      auto const lock = std::scoped_lock(ioMutex);
+      ioRequests.insert(ioRequests.end(), requests.begin(), requests.end());
+      prefetched.insert(prefetched.end(), ioDone.begin(), ioDone.end());
+      ioDone.clear();
+    }
+    if (!requests.empty())
+      ioWake.notify_one();
+
+    for (auto const node : prefetched)
+      state[node] = NodeState::PREFETCHED;
+
+    // nodes that dropped out of the selection before they got a slot
+    std::erase_if(prefetched, [&](uint32_t const node) {
+      if (lastWanted[node] == frame)
+        return false;
+      state[node] = NodeState::ABSENT;
+      return true;
+    });
+
+    auto uploaded_bytes = vk::DeviceSize{0};
+    auto consumed = size_t{0};
+    for (; consumed < prefetched.size(); ++consumed) {
+      auto const node = prefetched[consumed];
+      auto const bytes = view.pointBytes(nodes[node]);
+      if (uploaded_bytes > 0 && uploaded_bytes + bytes.size() > uploadLimit)
+        break;
+      auto const slot = acquireSlot();
+      if (!slot)
+        break;
+
+      ring.copyToBuffer(pool.buffer,
+                        vk::DeviceSize{*slot} * slotPoints * sizeof(PointVertex),
+                        bytes);
+      uploaded_bytes += bytes.size();
+      state[node] = NodeState::RESIDENT;
+      slotOf[node] = *slot;
+      slotNode[*slot] = node;
+    }
+    prefetched.erase(prefetched.begin(),
+                     prefetched.begin() + static_cast<ptrdiff_t>(consumed));
+
+    // draw what is resident; missing detail falls back to the ancestors
+    draws.clear();
+    auto *out = static_cast<NodeInstance *>(instances.mapped);
+    for (auto const node : wanted) {
+      if (state[node] != NodeState::RESIDENT)
+        continue;
+      auto const &n = nodes[node];
+      out[draws.size()] = {n.min[0], n.min[1], n.min[2], n.size};
+      draws.push_back(vk::DrawIndirectCommand(
+          n.point_count, 1, slotOf[node] * slotPoints,
+          static_cast<uint32_t>(draws.size())));
+    }
+    if (commands.mapped && !draws.empty()) {
+      std::memcpy(commands.mapped, draws.data(),
+                  draws.size() * sizeof(vk::DrawIndirectCommand));
+    }
+
+    if (Args::verbose() > 1) {
+      std::cerr << std::format(
+          "{}:{}: point cloud {} wanted, {} drawn, {} KiB uploaded, {} "
+          "prefetched\n",
+          __FILE__, __LINE__, wanted.size(), draws.size(),
+          uploaded_bytes >> 10U, prefetched.size());
+    }
+
+    if (uploaded_bytes == 0)
+      return {};
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  /**
+   * Record the resident nodes into the target subpass. Viewport and scissor
+   * are dynamic and must already be set.
+   */
+  void record(vk::CommandBuffer const cmd, PointParams const &params) const {
+    if (draws.empty())
+      return;
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
+                      sizeof(PointParams), &params);
+    cmd.bindVertexBuffers(0, {pool.buffer, instances.buffer},
+                          {vk::DeviceSize{0}, vk::DeviceSize{0}});
+
+    if (!commands.mapped) {
+      for (auto const &draw : draws) {
+        cmd.draw(draw.vertexCount, draw.instanceCount, draw.firstVertex,
+                 draw.firstInstance);
+      }
+      return;
+    }
+
+    auto const stride = uint32_t{sizeof(vk::DrawIndirectCommand)};
+    for (auto first = size_t{0}; first < draws.size();
+         first += maxDrawsPerCall) {
+      cmd.drawIndirect(commands.buffer, first * stride,
+                       static_cast<uint32_t>(std::min<size_t>(
+                           draws.size() - first, maxDrawsPerCall)),
+                       stride);
+    }
+  }
+
+  /**
+   * Rebuild the pipeline after the scene target was rebuilt (MSAA or
+   * post chain change); the caller makes sure the GPU is idle
+   */
+  void recreatePipeline(
+      VulkanGfxBase::PassTarget const &target,
+      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    context.device.destroyPipeline(pipeline);
+    pipeline = nullptr;
+    createPipeline(target, depth_state);
+  }
+
+private:
+  /**
+   * A free slot, or the one of the least recently wanted resident node
+   * that is not wanted this frame
+   */
+  std::optional<uint32_t> acquireSlot() {
+    if (!freeSlots.empty()) {
+      auto const slot = freeSlots.back();
+      freeSlots.pop_back();
+      return slot;
+    }
+
+    auto victim = std::optional<uint32_t>();
+    for (auto slot = 0U; slot < slotNode.size(); ++slot) {
+      auto const node = slotNode[slot];
+      if (lastWanted[node] == frame)
+        continue;
+      if (!victim || lastWanted[node] < lastWanted[slotNode[*victim]])
+        victim = slot;
+    }
+    if (victim) {
+      // single frame in flight: the previous frame finished before the hook
+      state[slotNode[*victim]] = NodeState::ABSENT;
+    }
+    return victim;
+  }
+
+  /**
+   * Fault in the pages of requested nodes so the copies in update() never
+   * wait for the disk
+   */
+  void ioLoop(std::stop_token const &stop) {
+    auto const page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto const nodes = view.nodes();
+
+    while (!stop.stop_requested()) {
+      auto node = uint32_t{0};
+      {
+        auto lock = std::unique_lock(ioMutex);
+        if (!ioWake.wait(lock, stop, [&] { return !ioRequests.empty(); }))
+          return;
+        node = ioRequests.front();
+        ioRequests.pop_front();
+      }
+
+      auto const bytes = view.pointBytes(nodes[node]);
+      if (!bytes.empty()) {
+        auto const begin = reinterpret_cast<uintptr_t>(bytes.data()) & ~(page - 1);
+        auto const end = reinterpret_cast<uintptr_t>(bytes.data() + bytes.size());
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+
+        auto sink = uint8_t{0};
+        for (auto p = begin; p < end; p += page)
+          sink ^= *reinterpret_cast<uint8_t const volatile *>(std::max(
+              p, reinterpret_cast<uintptr_t>(bytes.data())));
+        static_cast<void>(sink);
+      }
+
+      auto const lock = std::scoped_lock(ioMutex);
+      ioDone.push_back(node);
+    }
+  }
+
+  void createPipelineLayout() {
+    auto const &device = context.device;
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex, 0, sizeof(PointParams));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, nullptr, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create point cloud pipeline layout");
+    }
+  }
+
+  void createPipeline(VulkanGfxBase::PassTarget const &target,
+                      vk::PipelineDepthStencilStateCreateInfo const &depth_state) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/pointcloud.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/pointcloud.frag.spv"
+    };
+
+    auto const &device = context.device;
+
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    auto const vertex_bindings = std::array{
+        vk::VertexInputBindingDescription(0, sizeof(PointVertex),
+                                          vk::VertexInputRate::eVertex),
+        vk::VertexInputBindingDescription(1, sizeof(NodeInstance),
+                                          vk::VertexInputRate::eInstance)};
+    auto const vertex_attributes = std::array{
+        vk::VertexInputAttributeDescription(0, 0,
+                                            vk::Format::eR16G16B16A16Unorm,
+                                            offsetof(PointVertex, position)),
+        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR8G8B8A8Unorm,
+                                            offsetof(PointVertex, colour)),
+        vk::VertexInputAttributeDescription(
+            2, 1, vk::Format::eR32G32B32A32Sfloat, 0)};
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo(
+        {}, vertex_bindings, vertex_attributes);
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::ePointList;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f;
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth_state;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipelineLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create point cloud pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    pipeline = pipeline_result.value;
+  }
+};
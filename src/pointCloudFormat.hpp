@@ -0,0 +1,394 @@
+#pragma once
+
+static_assert(__cplusplus >= 202002L, "Needs C++20");
+
+#include "mmappedFile.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * GPU-ready point, 12 bytes.
+ * position: unorm16 inside the owning node's cube (w is padding, kept at 0)
+ * colour:   rgba8
+ */
+struct PointVertex {
+  std::array<uint16_t, 4> position;
+  std::array<uint8_t, 4> colour;
+};
+static_assert(sizeof(PointVertex) == 12);
+
+/**
+ * Octree node. Each node holds a grid-subsampled share of the points in its
+ * cube (at most one per cell of a pointCloudGrid^3 grid) and leaves the rest
+ * to its children, so drawing a node and its ancestors shows the cube at
+ * roughly size / pointCloudGrid spacing. Children are contiguous and always
+ * follow their parent, root first.
+ */
+struct PointNode {
+  std::array<float, 3> min{};
+  float size = 0.0f; // cube edge
+  uint64_t point_offset = 0; // in points
+  uint32_t point_count = 0;
+  uint32_t first_child = 0;
+  uint32_t child_count = 0;
+  uint32_t depth = 0;
+};
+static_assert(sizeof(PointNode) == 40);
+
+static constexpr auto pointCloudGrid = 128U;
+static constexpr auto pointCloudMaxDepth = 24U;
+
+/**
+ * Largest distance between neighbouring points of a node, i.e. the error of
+ * stopping the refinement at it
+ */
+[[nodiscard]] inline float pointNodeSpacing(PointNode const &node) {
+  return node.size / static_cast<float>(pointCloudGrid);
+}
+
+/**
+ * On-disk layout, written by tools/pointCloudBuild and mmapped as-is at
+ * runtime. The node array follows the header; points start on a page so
+ * node ranges can be prefetched with madvise.
+ */
+struct PointCloudFileHeader {
+  static constexpr auto MAGIC = std::array<char, 4>{'H', 'A', 'P', 'C'};
+  static constexpr uint32_t VERSION = 1;
+
+  std::array<char, 4> magic = MAGIC;
+  uint32_t version = VERSION;
+
+  uint32_t node_count = 0;
+  uint32_t max_node_points = 0; // largest point_count of any node
+  uint64_t point_count = 0;
+  uint64_t nodes_offset = 0;
+  uint64_t points_offset = 0;
+};
+
+/**
+ * Unquantized input, as read by the builder
+ */
+struct PointSource {
+  std::array<float, 3> position;
+  std::array<uint8_t, 4> colour;
+};
+
+struct PointOctree {
+  std::vector<PointNode> nodes;
+  std::vector<PointVertex> points;
+  uint64_t dropped = 0; // duplicates beyond pointCloudMaxDepth
+};
+
+/* build */
+
+/**
+ * Build the octree in place: every node's points are moved to the front of
+ * its range and the remainder is partitioned among its octants, so the
+ * source is reordered rather than copied. Nodes are numbered breadth first.
+ */
+inline PointOctree buildPointOctree(std::vector<PointSource> source,
+                                    uint32_t const max_node_points = 16384) {
+  if (max_node_points == 0)
+    throw std::runtime_error(
+        std::format("{}:{}: max_node_points must be positive", __FILE__,
+                    __LINE__));
+
+  auto octree = PointOctree();
+  if (source.empty())
+    return octree;
+
+  // root cube around the bounding box
+  auto lo = source.front().position;
+  auto hi = lo;
+  for (auto const &point : source) {
+    for (auto k = 0U; k < 3; ++k) {
+      lo[k] = std::min(lo[k], point.position[k]);
+      hi[k] = std::max(hi[k], point.position[k]);
+    }
+  }
+  auto const extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+  auto root = PointNode();
+  root.min = lo;
+  root.size = std::max(extent * 1.0001f, std::numeric_limits<float>::min());
+
+  struct Pending {
+    uint32_t node;
+    size_t begin;
+    size_t end;
+  };
+  auto queue = std::deque<Pending>{{0, 0, source.size()}};
+  octree.nodes.push_back(root);
+
+  auto cell_of = [](PointNode const &node, std::array<float, 3> const &p,
+                    uint32_t const cells) {
+    auto index = std::array<uint32_t, 3>{};
+    for (auto k = 0U; k < 3; ++k) {
+      auto const t = (p[k] - node.min[k]) / node.size;
+      index[k] = std::min(static_cast<uint32_t>(std::max(t, 0.0f) * cells),
+                          cells - 1);
+    }
+    return index;
+  };
+
+  auto scratch = std::vector<PointSource>();
+  while (!queue.empty()) {
+    auto const [index, begin, end] = queue.front();
+    queue.pop_front();
+    auto const range = std::span(source).subspan(begin, end - begin);
+
+    auto node = octree.nodes[index];
+    node.point_offset = begin;
+
+    auto split = range.size();
+    if (range.size() > max_node_points) {
+      // one point per occupied grid cell, up to the node capacity
+      auto occupied = std::unordered_set<uint32_t>();
+      auto const front = std::stable_partition(
+          range.begin(), range.end(), [&](PointSource const &p) {
+            if (occupied.size() >= max_node_points)
+              return false;
+            auto const [x, y, z] = cell_of(node, p.position, pointCloudGrid);
+            return occupied
+                .insert((z * pointCloudGrid + y) * pointCloudGrid + x)
+                .second;
+          });
+      split = static_cast<size_t>(front - range.begin());
+
+      if (node.depth + 1 >= pointCloudMaxDepth) {
+        // only coincident points get this deep; the rest stay unreferenced
+        octree.dropped += range.size() - split;
+      }
+    }
+    node.point_count = static_cast<uint32_t>(split);
+
+    if (split < range.size() && node.depth + 1 < pointCloudMaxDepth) {
+      auto const rest = range.subspan(split);
+      auto octant = [&](PointSource const &p) {
+        auto const [x, y, z] = cell_of(node, p.position, 2);
+        return x | (y << 1U) | (z << 2U);
+      };
+
+      // counting sort of the remainder by octant
+      auto counts = std::array<size_t, 8>{};
+      for (auto const &p : rest)
+        ++counts[octant(p)];
+      auto starts = std::array<size_t, 9>{};
+      for (auto o = 0U; o < 8; ++o)
+        starts[o + 1] = starts[o] + counts[o];
+
+      scratch.assign(rest.begin(), rest.end());
+      auto cursor = starts;
+      for (auto const &p : scratch)
+        rest[cursor[octant(p)]++] = p;
+
+      node.first_child = static_cast<uint32_t>(octree.nodes.size());
+      for (auto o = 0U; o < 8; ++o) {
+        if (counts[o] == 0)
+          continue;
+        auto child = PointNode();
+        child.size = node.size / 2;
+        child.min = {node.min[0] + static_cast<float>(o & 1U) * child.size,
+                     node.min[1] + static_cast<float>((o >> 1U) & 1U) * child.size,
+                     node.min[2] + static_cast<float>((o >> 2U) & 1U) * child.size};
+        child.depth = node.depth + 1;
+        queue.push_back({static_cast<uint32_t>(octree.nodes.size()),
+                         begin + split + starts[o],
+                         begin + split + starts[o + 1]});
+        octree.nodes.push_back(child);
+        ++node.child_count;
+      }
+    }
+    octree.nodes[index] = node;
+  }
+
+  // quantize relative to each node's cube
+  octree.points.resize(source.size());
+  for (auto const &node : octree.nodes) {
+    for (auto i = node.point_offset; i < node.point_offset + node.point_count;
+         ++i) {
+      auto &out = octree.points[i];
+      for (auto k = 0U; k < 3; ++k) {
+        auto const t = std::clamp(
+            (source[i].position[k] - node.min[k]) / node.size, 0.0f, 1.0f);
+        out.position[k] = static_cast<uint16_t>(std::lround(t * 65535.0f));
+      }
+      out.position[3] = 0;
+      out.colour = source[i].colour;
+    }
+  }
+
+  return octree;
+}
+
+/* selection */
+
+/**
+ * Nodes to draw for a camera at eye, coarse to fine, within point_budget.
+ * A node is refined into its children while its spacing, projected to the
+ * screen, exceeds threshold_pixels; candidates are taken largest projected
+ * error first, so when the budget runs out it is the least visible detail
+ * that is missing. projection_scale is viewport_height / (2 * tan(fovy /
+ * 2)). Nodes entirely behind one of planes (ax + by + cz + d < 0 inside)
+ * are culled.
+ */
+inline std::vector<uint32_t>
+selectPointNodes(std::span<PointNode const> nodes,
+                 std::array<float, 3> const &eye, float const projection_scale,
+                 uint64_t const point_budget,
+                 float const threshold_pixels = 1.0f,
+                 std::span<std::array<float, 4> const> planes = {}) {
+  auto selected = std::vector<uint32_t>();
+  if (nodes.empty())
+    return selected;
+
+  auto projected_error = [&](PointNode const &node) {
+    auto const half = node.size / 2;
+    auto distance_sq = 0.0f;
+    for (auto k = 0U; k < 3; ++k) {
+      auto const d = eye[k] - (node.min[k] + half);
+      distance_sq += d * d;
+    }
+    auto const distance =
+        std::max(std::sqrt(distance_sq) - half * std::sqrt(3.0f),
+                 std::numeric_limits<float>::epsilon());
+    return pointNodeSpacing(node) * projection_scale / distance;
+  };
+
+  auto visible = [&](PointNode const &node) {
+    auto const half = node.size / 2;
+    auto const radius = half * std::sqrt(3.0f);
+    return std::ranges::all_of(planes, [&](std::array<float, 4> const &p) {
+      return p[0] * (node.min[0] + half) + p[1] * (node.min[1] + half) +
+                 p[2] * (node.min[2] + half) + p[3] >=
+             -radius;
+    });
+  };
+
+  using Candidate = std::pair<float, uint32_t>;
+  auto candidates = std::priority_queue<Candidate>();
+  if (visible(nodes[0]))
+    candidates.emplace(projected_error(nodes[0]), 0);
+
+  auto total = uint64_t{0};
+  while (!candidates.empty()) {
+    auto const [error, index] = candidates.top();
+    candidates.pop();
+
+    auto const &node = nodes[index];
+    if (total + node.point_count > point_budget)
+      break;
+    total += node.point_count;
+    selected.push_back(index);
+
+    if (error <= threshold_pixels)
+      continue;
+    for (auto c = node.first_child; c < node.first_child + node.child_count;
+         ++c) {
+      if (visible(nodes[c]))
+        candidates.emplace(projected_error(nodes[c]), c);
+    }
+  }
+  return selected;
+}
+
+/* file */
+
+inline void writePointCloudFile(std::filesystem::path const &path,
+                                PointOctree const &octree) {
+  auto header = PointCloudFileHeader();
+  header.node_count = static_cast<uint32_t>(octree.nodes.size());
+  header.point_count = octree.points.size();
+  for (auto const &node : octree.nodes)
+    header.max_node_points = std::max(header.max_node_points, node.point_count);
+  header.nodes_offset = (sizeof(PointCloudFileHeader) + 15U) / 16U * 16U;
+  header.points_offset =
+      (header.nodes_offset + octree.nodes.size() * sizeof(PointNode) + 4095U) /
+      4096U * 4096U;
+
+  auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error(
+        std::format("{}:{}: cannot open {}", __FILE__, __LINE__, path.string()));
+
+  out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  out.seekp(static_cast<std::streamoff>(header.nodes_offset));
+  out.write(reinterpret_cast<char const *>(octree.nodes.data()),
+            static_cast<std::streamsize>(octree.nodes.size() *
+                                         sizeof(PointNode)));
+  out.seekp(static_cast<std::streamoff>(header.points_offset));
+  out.write(reinterpret_cast<char const *>(octree.points.data()),
+            static_cast<std::streamsize>(octree.points.size() *
+                                         sizeof(PointVertex)));
+  if (!out)
+    throw std::runtime_error(std::format("{}:{}: failed writing {}", __FILE__,
+                                         __LINE__, path.string()));
+}
+
+/**
+ * Read-only view of a point cloud file mapped with MMapped; the spans point
+ * into the mapping, nothing is copied and only touched pages are read.
+ */
+struct PointCloudView {
+  MMapped<std::byte> file;
+  PointCloudFileHeader const *header = nullptr;
+
+  explicit PointCloudView(std::filesystem::path const &path) : file{path} {
+    if (file.size() < sizeof(PointCloudFileHeader))
+      throw std::runtime_error(
+          std::format("{}:{}: {} is too small for a point cloud", __FILE__,
+                      __LINE__, path.string()));
+
+    header = reinterpret_cast<PointCloudFileHeader const *>(file.data().get());
+    if (header->magic != PointCloudFileHeader::MAGIC ||
+        header->version != PointCloudFileHeader::VERSION)
+      throw std::runtime_error(std::format(
+          "{}:{}: {} is not a version {} point cloud file", __FILE__, __LINE__,
+          path.string(), PointCloudFileHeader::VERSION));
+
+    if (header->nodes_offset % 16 != 0 ||
+        header->nodes_offset + uint64_t{header->node_count} * sizeof(PointNode) >
+            file.size() ||
+        header->points_offset % 16 != 0 ||
+        header->points_offset + header->point_count * sizeof(PointVertex) >
+            file.size())
+      throw std::runtime_error(std::format(
+          "{}:{}: {} has sections out of bounds", __FILE__, __LINE__,
+          path.string()));
+
+    for (auto const &node : nodes()) {
+      if (node.point_offset + node.point_count > header->point_count ||
+          node.point_count > header->max_node_points ||
+          uint64_t{node.first_child} + node.child_count > header->node_count)
+        throw std::runtime_error(std::format(
+            "{}:{}: {} has node ranges out of bounds", __FILE__, __LINE__,
+            path.string()));
+    }
+  }
+
+  [[nodiscard]] std::span<PointNode const> nodes() const {
+    return {reinterpret_cast<PointNode const *>(file.data().get() +
+                                                header->nodes_offset),
+            header->node_count};
+  }
+
+  [[nodiscard]] std::span<std::byte const> pointBytes(PointNode const &node) const {
+    return {file.data().get() + header->points_offset +
+                node.point_offset * sizeof(PointVertex),
+            size_t{node.point_count} * sizeof(PointVertex)};
+  }
+};
@@ -0,0 +1,241 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "../args.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Keeps frame time within a budget by stepping quality knobs (internal
+ * resolution, MSAA tier, particle budget, LOD bias, post-processing, ...)
+ * down when frames run long and back up when there is headroom.
+ *
+ * Frames are judged by the 90th percentile of the slower of CPU and GPU
+ * time over a window, so single hitches don't trigger changes. Hysteresis:
+ * lowering needs a full window over budget, raising needs a longer stretch
+ * under headroom * budget, and every change is followed by a cooldown for
+ * its effect to show. A knob that has to come back down right after being
+ * raised doubles the wait before the next raise, which stops the governor
+ * from oscillating at a boundary.
+ *
+ * Knobs are lowered in the order they were added (cheapest visual loss
+ * first), only those that relieve the bound side (CPU or GPU), and raised
+ * again in the reverse order of lowering. The last Settings::history changes
+ * are kept in decisions() and every change is logged at verbosity 1.
+ */
+struct QualityGovernor {
+  enum class Relieves { Cpu, Gpu, Both };
+
+  struct Knob {
+    std::string name;
+    std::vector<std::string> levels; // low to high quality
+    size_t level = 0;                // current, index into levels
+    Relieves relieves = Relieves::Gpu;
+    std::function<void(size_t level)> apply;
+  };
+
+  struct Settings {
+    double budget_ms = 1000.0 / 60.0;
+    double headroom = 0.8;    // raise only below headroom * budget
+    size_t window = 30;       // frames per percentile
+    size_t raise_after = 180; // frames under headroom before raising
+    size_t cooldown = 60;     // frames after a change
+    size_t history = 32;      // decisions() kept
+  };
+
+  struct Decision {
+    uint64_t frame = 0;
+    size_t knob = 0;
+    size_t from = 0;
+    size_t to = 0;
+    double frame_ms = 0.0; // the percentile that triggered it
+    bool gpu_bound = false;
+    bool manual = false; // setLevel(), not the governor
+  };
+
+private:
+  Settings settings;
+  std::vector<Knob> knobs;
+  std::vector<size_t> lowered; // knob indices, most recent last
+
+  struct Sample {
+    double cpu_ms;
+    double gpu_ms;
+  };
+  std::vector<Sample> samples; // ring of the last window frames
+  size_t nextSample = 0;
+  std::vector<double> scratch;
+  uint64_t frameCount = 0;
+  uint64_t quietUntil = 0;  // cooldown end
+  size_t underHeadroom = 0; // consecutive frames
+  size_t raiseDelay;        // raise_after, doubled on oscillation
+  int64_t lastRaised = -1;  // knob raised by the last change, if any
+
+  std::vector<Decision> history; // oldest first
+  uint64_t decisionTotal = 0;
+
+public:
+  explicit QualityGovernor(Settings const &governor_settings)
+      : settings{governor_settings}, raiseDelay{governor_settings.raise_after} {
+    settings.window = std::max<size_t>(settings.window, 1);
+    samples.reserve(settings.window);
+  }
+
+  /**
+   * Register a knob; its apply is called with the current level right away.
+   * Returns the knob's index.
+   */
+  size_t addKnob(Knob knob) {
+    if (knob.levels.empty() || knob.level >= knob.levels.size())
+      throw std::runtime_error(
+          std::format("{}:{}: knob {} has no level {}", __FILE__, __LINE__,
+                      knob.name, knob.level));
+    if (knob.apply)
+      knob.apply(knob.level);
+    knobs.push_back(std::move(knob));
+    return knobs.size() - 1;
+  }
+
+  [[nodiscard]] Knob const &knob(size_t const i) const { return knobs[i]; }
+  [[nodiscard]] size_t knobCount() const { return knobs.size(); }
+
+  /**
+   * The most recent changes, oldest first; at most Settings::history
+   */
+  [[nodiscard]] std::vector<Decision> const &decisions() const {
+    return history;
+  }
+
+  /**
+   * Changes since start, including those dropped from decisions()
+   */
+  [[nodiscard]] uint64_t decisionCount() const { return decisionTotal; }
+
+  void setBudget(double const budget_ms) { settings.budget_ms = budget_ms; }
+
+  /**
+   * Force a knob to a level (e.g. from the control socket); the governor
+   * carries on from there and will not raise it back on its own. False for
+   * an unknown knob or level.
+   */
+  bool setLevel(std::string_view const name, size_t const level) {
+    auto const it = std::ranges::find(knobs, name, &Knob::name);
+    if (it == knobs.end() || level >= it->levels.size())
+      return false;
+    auto const i = static_cast<size_t>(it - knobs.begin());
+    std::erase(lowered, i);
+    lastRaised = -1;
+    change(i, level, 0.0, false, true);
+    return true;
+  }
+
+  /**
+   * Feed one frame's CPU and GPU time; returns true when a knob changed
+   */
+  bool frame(double const cpu_ms, double const gpu_ms) {
+    ++frameCount;
+    if (samples.size() < settings.window) {
+      samples.push_back({cpu_ms, gpu_ms});
+    } else {
+      samples[nextSample] = {cpu_ms, gpu_ms};
+    }
+    nextSample = (nextSample + 1) % settings.window;
+    if (frameCount < quietUntil || samples.size() < settings.window)
+      return false;
+
+    auto const cpu = percentile(&Sample::cpu_ms);
+    auto const gpu = percentile(&Sample::gpu_ms);
+    auto const worst = std::max(cpu, gpu);
+    auto const gpu_bound = gpu >= cpu;
+
+    if (worst > settings.budget_ms) {
+      underHeadroom = 0;
+      return lower(worst, gpu_bound);
+    }
+
+    underHeadroom =
+        worst < settings.headroom * settings.budget_ms ? underHeadroom + 1 : 0;
+    if (underHeadroom >= raiseDelay)
+      return raise(worst, gpu_bound);
+    return false;
+  }
+
+private:
+  double percentile(double Sample::*const field) {
+    scratch.clear();
+    for (auto const &sample : samples)
+      scratch.push_back(sample.*field);
+    auto const nth = scratch.begin() + (scratch.size() - 1) * 9 / 10;
+    std::ranges::nth_element(scratch, nth);
+    return *nth;
+  }
+
+  bool lower(double const frame_ms, bool const gpu_bound) {
+    auto const wanted = gpu_bound ? Relieves::Gpu : Relieves::Cpu;
+    for (auto i = size_t{0}; i < knobs.size(); ++i) {
+      auto const &candidate = knobs[i];
+      if (candidate.level == 0 ||
+          (candidate.relieves != wanted && candidate.relieves != Relieves::Both))
+        continue;
+      // the knob just raised went too far: wait longer before trying again
+      if (static_cast<int64_t>(i) == lastRaised)
+        raiseDelay = std::min(raiseDelay * 2, settings.raise_after * 16);
+      change(i, candidate.level - 1, frame_ms, gpu_bound);
+      lowered.push_back(i);
+      lastRaised = -1;
+      return true;
+    }
+    return false; // nothing left to give
+  }
+
+  bool raise(double const frame_ms, bool const gpu_bound) {
+    underHeadroom = 0;
+    if (lowered.empty()) {
+      raiseDelay = settings.raise_after; // at full quality and stable
+      return false;
+    }
+    auto const i = lowered.back();
+    lowered.pop_back();
+    change(i, knobs[i].level + 1, frame_ms, gpu_bound);
+    lastRaised = static_cast<int64_t>(i);
+    return true;
+  }
+
+  void change(size_t const i, size_t const level, double const frame_ms,
+              bool const gpu_bound, bool const manual = false) {
+    auto &target = knobs[i];
+    if (history.size() >= settings.history && !history.empty())
+      history.erase(history.begin());
+    ++decisionTotal;
+    history.push_back(
+        {frameCount, i, target.level, level, frame_ms, gpu_bound, manual});
+    if (manual && Args::verbose() > 0) {
+      std::cerr << std::format("{}:{}: quality: {} {} -> {} (set)\n", __FILE__,
+                               __LINE__, target.name,
+                               target.levels[target.level],
+                               target.levels[level]);
+    } else if (Args::verbose() > 0) {
+      std::cerr << std::format(
+          "{}:{}: quality: {} {} -> {} (p90 {:.2f} ms, {} bound, budget {:.2f} "
+          "ms)\n",
+          __FILE__, __LINE__, target.name, target.levels[target.level],
+          target.levels[level], frame_ms, gpu_bound ? "GPU" : "CPU",
+          settings.budget_ms);
+    }
+    target.level = level;
+    if (target.apply)
+      target.apply(level);
+    quietUntil = frameCount + settings.cooldown;
+    // judge the new level by its own frames only
+    samples.clear();
+    nextSample = 0;
+  }
+};
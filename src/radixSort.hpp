@@ -0,0 +1,87 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "workerPool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Stable LSD radix sort, 11 bits per pass, parallel over blocks on a
+ * WorkerPool (or inline without one). Each pass builds per-block digit
+ * histograms, takes an exclusive prefix over (digit, block) and scatters
+ * every block into its slots, so equal keys keep their order. Passes whose
+ * digit is the same for every item are skipped, which makes keys with
+ * mostly constant high bits cheap. Keeps its scratch memory between sorts.
+ */
+template <typename T> struct RadixSorter {
+  static constexpr uint32_t digitBits = 11;
+  static constexpr uint32_t digits = 1U << digitBits;
+
+private:
+  std::vector<T> scratch;
+  std::vector<uint32_t> histograms; // block x digit
+
+public:
+  /**
+   * Sort items by the low key_bits bits of key(item), a uint64_t
+   */
+  template <typename KeyFn>
+  void sort(std::vector<T> &items, uint32_t const key_bits, KeyFn const &key,
+            WorkerPool *pool = nullptr) {
+    auto const n = items.size();
+    if (n < 2)
+      return;
+    scratch.resize(n);
+
+    auto const width = pool ? pool->width() : size_t{1};
+    auto const blocks = std::clamp<size_t>(n / 4096, 1, 4 * width);
+    auto const block_size = (n + blocks - 1) / blocks;
+    auto const for_blocks = [&](auto const &fn) {
+      auto const run = [&](size_t const begin, size_t const end) {
+        for (auto block = begin; block < end; ++block)
+          fn(block, block * block_size, std::min(n, (block + 1) * block_size));
+      };
+      if (pool) {
+        pool->parallelFor(blocks, 1, run);
+      } else {
+        run(0, blocks);
+      }
+    };
+
+    for (auto shift = 0U; shift < key_bits; shift += digitBits) {
+      auto const digit = [&](T const &item) {
+        return static_cast<uint32_t>(key(item) >> shift) & (digits - 1);
+      };
+
+      histograms.assign(blocks * digits, 0);
+      for_blocks([&](size_t const block, size_t const begin, size_t const end) {
+        auto *histogram = histograms.data() + block * digits;
+        for (auto i = begin; i < end; ++i)
+          ++histogram[digit(items[i])];
+      });
+
+      auto offset = uint32_t{0};
+      auto constant = false;
+      for (auto d = 0U; d < digits; ++d) {
+        auto const start = offset;
+        for (auto block = size_t{0}; block < blocks; ++block) {
+          auto &slot = histograms[block * digits + d];
+          auto const count = slot;
+          slot = offset;
+          offset += count;
+        }
+        constant = constant || (offset - start == n);
+      }
+      if (constant)
+        continue;
+
+      for_blocks([&](size_t const block, size_t const begin, size_t const end) {
+        auto *next = histograms.data() + block * digits;
+        for (auto i = begin; i < end; ++i)
+          scratch[next[digit(items[i])]++] = items[i];
+      });
+      items.swap(scratch);
+    }
+  }
+};
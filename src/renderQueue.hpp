@@ -0,0 +1,199 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "radixSort.hpp"
+#include <bit>
+#include <functional>
+#include <span>
+
+/**
+ * Draws from every renderer (sprites, meshes, text, ...) as 64-bit sort
+ * keys plus a payload index into the renderer's own draw data.
+ *
+ * Producers push into one bucket per thread without locking; sort() merges
+ * the buckets and radix sorts them on a WorkerPool, and submit() walks the
+ * result calling the bind callbacks only when pipeline, material or
+ * geometry actually change. Key fields, most significant first:
+ *
+ *   pass:4 | pipeline:10 | material:14 | geometry:12 | depth:24
+ *
+ * so a frame is ordered by pass, then grouped by pipeline, descriptor set
+ * and vertex buffers, then by depth within a group.
+ */
+struct RenderQueue {
+  struct Fields {
+    uint32_t pass = 0;     // e.g. opaque, transparent, overlay
+    uint32_t pipeline = 0; // ids are the renderer's, not Vulkan handles
+    uint32_t material = 0; // descriptor set
+    uint32_t geometry = 0; // vertex / index buffers
+    uint32_t depth = 0;    // see depthFrontToBack / depthBackToFront
+  };
+
+  struct Item {
+    uint64_t key = 0;
+    uint32_t payload = 0;
+  };
+
+  /**
+   * Called by submit(); a bind is only called when its field changes. A new
+   * pass (e.g. a render pass or subpass boundary) comes first and is
+   * followed by a full rebind.
+   */
+  struct Binds {
+    std::function<void(uint32_t pass)> pass;
+    std::function<void(uint32_t pipeline)> pipeline;
+    std::function<void(uint32_t material)> material;
+    std::function<void(uint32_t geometry)> geometry;
+    std::function<void(Item const &item)> draw;
+  };
+
+  struct Stats {
+    size_t draws = 0;
+    size_t passes = 0;
+    size_t pipeline_binds = 0;
+    size_t material_binds = 0;
+    size_t geometry_binds = 0;
+  };
+
+  static constexpr uint32_t passBits = 4;
+  static constexpr uint32_t pipelineBits = 10;
+  static constexpr uint32_t materialBits = 14;
+  static constexpr uint32_t geometryBits = 12;
+  static constexpr uint32_t depthBits = 24;
+
+  static constexpr uint32_t depthShift = 0;
+  static constexpr uint32_t geometryShift = depthShift + depthBits;
+  static constexpr uint32_t materialShift = geometryShift + geometryBits;
+  static constexpr uint32_t pipelineShift = materialShift + materialBits;
+  static constexpr uint32_t passShift = pipelineShift + pipelineBits;
+  static_assert(passShift + passBits == 64);
+
+private:
+  std::vector<std::vector<Item>> buckets;
+  std::vector<Item> items;
+  RadixSorter<Item> sorter;
+
+public:
+  /**
+   * One bucket per thread that pushes draws, e.g. WorkerPool::width()
+   */
+  explicit RenderQueue(size_t const threads = 1)
+      : buckets(std::max<size_t>(threads, 1)) {}
+
+  /**
+   * Fields are truncated to their widths
+   */
+  [[nodiscard]] static constexpr uint64_t key(Fields const &fields) {
+    auto const field = [](uint32_t const value, uint32_t const bits,
+                          uint32_t const shift) {
+      return (uint64_t{value} & ((uint64_t{1} << bits) - 1)) << shift;
+    };
+    return field(fields.pass, passBits, passShift) |
+           field(fields.pipeline, pipelineBits, pipelineShift) |
+           field(fields.material, materialBits, materialShift) |
+           field(fields.geometry, geometryBits, geometryShift) |
+           field(fields.depth, depthBits, depthShift);
+  }
+
+  [[nodiscard]] static constexpr Fields fields(uint64_t const key) {
+    auto const field = [key](uint32_t const bits, uint32_t const shift) {
+      return static_cast<uint32_t>((key >> shift) &
+                                   ((uint64_t{1} << bits) - 1));
+    };
+    return {.pass = field(passBits, passShift),
+            .pipeline = field(pipelineBits, pipelineShift),
+            .material = field(materialBits, materialShift),
+            .geometry = field(geometryBits, geometryShift),
+            .depth = field(depthBits, depthShift)};
+  }
+
+  /**
+   * Depth field for a non-negative view depth, nearest first (opaque
+   * draws, to help early depth rejection). Non-negative floats order like
+   * their bit patterns, so the top bits keep the order.
+   */
+  [[nodiscard]] static constexpr uint32_t depthFrontToBack(float const depth) {
+    return std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (32 - depthBits);
+  }
+
+  /**
+   * Farthest first, for blending
+   */
+  [[nodiscard]] static constexpr uint32_t depthBackToFront(float const depth) {
+    return ((1U << depthBits) - 1) - depthFrontToBack(depth);
+  }
+
+  /**
+   * Bucket of producer thread (0 .. threads - 1); only that thread may
+   * touch it until the next sort()
+   */
+  [[nodiscard]] std::vector<Item> &bucket(size_t const thread) {
+    return buckets[thread];
+  }
+
+  void push(size_t const thread, Fields const &fields, uint32_t const payload) {
+    buckets[thread].push_back({key(fields), payload});
+  }
+
+  /**
+   * Merge every bucket into key order (stable per bucket) and empty the
+   * buckets
+   */
+  void sort(WorkerPool *pool = nullptr) {
+    auto total = size_t{0};
+    for (auto const &b : buckets)
+      total += b.size();
+    items.resize(total);
+
+    auto offset = size_t{0};
+    for (auto &b : buckets) {
+      std::ranges::copy(b, items.begin() + static_cast<ptrdiff_t>(offset));
+      offset += b.size();
+      b.clear();
+    }
+
+    sorter.sort(items, 64, [](Item const &item) { return item.key; }, pool);
+  }
+
+  /**
+   * Sorted draws of the last sort()
+   */
+  [[nodiscard]] std::span<Item const> sorted() const { return items; }
+
+  Stats submit(Binds const &binds) const {
+    auto stats = Stats();
+    auto first = true;
+    auto last = Fields();
+
+    for (auto const &item : items) {
+      auto const f = fields(item.key);
+      // pipelines may not survive a pass boundary, so start over
+      auto const new_pass = first || f.pass != last.pass;
+      if (new_pass) {
+        binds.pass(f.pass);
+        ++stats.passes;
+      }
+      // a new pipeline invalidates nothing else in Vulkan, but materials
+      // and geometry are per-pipeline ids here, so rebind them too
+      auto const new_pipeline = new_pass || f.pipeline != last.pipeline;
+      if (new_pipeline) {
+        binds.pipeline(f.pipeline);
+        ++stats.pipeline_binds;
+      }
+      if (new_pipeline || f.material != last.material) {
+        binds.material(f.material);
+        ++stats.material_binds;
+      }
+      if (new_pipeline || f.geometry != last.geometry) {
+        binds.geometry(f.geometry);
+        ++stats.geometry_binds;
+      }
+      binds.draw(item);
+      ++stats.draws;
+
+      first = false;
+      last = f;
+    }
+    return stats;
+  }
+};
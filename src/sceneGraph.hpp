@@ -0,0 +1,130 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <array>
+#include <cstdint>
+#include <experimental/simd>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace stdx = std::experimental;
+
+using Mat4 = std::array<float, 16>; // column major, as the shaders use
+
+inline constexpr auto mat4Identity =
+    Mat4{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+         0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+/**
+ * a * b, one 4-wide vector per column
+ */
+[[nodiscard]] inline Mat4 multiply(Mat4 const &a, Mat4 const &b) {
+  using V4 = stdx::fixed_size_simd<float, 4>;
+  auto const aligned = stdx::element_aligned;
+  auto const a0 = V4(a.data(), aligned);
+  auto const a1 = V4(a.data() + 4, aligned);
+  auto const a2 = V4(a.data() + 8, aligned);
+  auto const a3 = V4(a.data() + 12, aligned);
+
+  auto result = Mat4();
+  for (auto column = 0U; column < 4; ++column) {
+    auto const *b_column = b.data() + 4 * column;
+    auto const r = a0 * b_column[0] + a1 * b_column[1] + a2 * b_column[2] +
+                   a3 * b_column[3];
+    r.copy_to(result.data() + 4 * column, aligned);
+  }
+  return result;
+}
+
+/**
+ * Transform hierarchy in flat arrays (parent, depth, local, world) where
+ * every parent precedes its children, so one forward pass sees each world
+ * matrix final before anything derived from it.
+ *
+ * setLocal() only marks a node dirty; update() walks forward from the first
+ * dirty node, recomputes the dirty nodes and everything below them, and
+ * reports which world matrices changed so they can be uploaded sparsely
+ * (see SceneTransforms). Untouched subtrees cost one flag test per node.
+ */
+struct SceneGraph {
+  static constexpr uint32_t noParent = UINT32_MAX;
+
+private:
+  std::vector<uint32_t> parents;
+  std::vector<uint16_t> depths;
+  std::vector<Mat4> locals;
+  std::vector<Mat4> worlds;
+  std::vector<uint8_t> dirty;
+  std::vector<uint32_t> changed;
+  size_t firstDirty = SIZE_MAX;
+
+public:
+  /**
+   * Append a node below parent (or a root for noParent) and return its
+   * index, which stays valid for the graph's lifetime
+   */
+  uint32_t add(uint32_t const parent, Mat4 const &local = mat4Identity) {
+    auto const index = static_cast<uint32_t>(parents.size());
+    if (parent != noParent && parent >= index)
+      throw std::runtime_error(std::format(
+          "{}:{}: parent {} of scene node {} does not exist", __FILE__,
+          __LINE__, parent, index));
+
+    parents.push_back(parent);
+    depths.push_back(parent == noParent ? 0 : depths[parent] + 1);
+    locals.push_back(local);
+    worlds.push_back(mat4Identity);
+    dirty.push_back(1);
+    firstDirty = std::min<size_t>(firstDirty, index);
+    return index;
+  }
+
+  void setLocal(uint32_t const i, Mat4 const &local) {
+    locals[i] = local;
+    dirty[i] = 1;
+    firstDirty = std::min<size_t>(firstDirty, i);
+  }
+
+  [[nodiscard]] size_t size() const { return parents.size(); }
+  [[nodiscard]] uint32_t parent(uint32_t const i) const { return parents[i]; }
+  [[nodiscard]] uint16_t depth(uint32_t const i) const { return depths[i]; }
+  [[nodiscard]] Mat4 const &local(uint32_t const i) const { return locals[i]; }
+
+  /**
+   * As of the last update()
+   */
+  [[nodiscard]] Mat4 const &world(uint32_t const i) const { return worlds[i]; }
+  [[nodiscard]] std::span<Mat4 const> worldMatrices() const { return worlds; }
+
+  /**
+   * Recompute the world matrices of dirty nodes and their descendants and
+   * return their indices, ascending. Valid until the next update().
+   */
+  std::span<uint32_t const> update() {
+    changed.clear();
+    if (firstDirty >= parents.size())
+      return changed;
+
+    for (auto i = firstDirty; i < parents.size(); ++i) {
+      auto const p = parents[i];
+      if (p == noParent) {
+        if (!dirty[i])
+          continue;
+        worlds[i] = locals[i];
+      } else {
+        if (!dirty[i] && !dirty[p])
+          continue;
+        dirty[i] = 1; // for its own children
+        worlds[i] = multiply(worlds[p], locals[i]);
+      }
+      changed.push_back(static_cast<uint32_t>(i));
+    }
+
+    for (auto const i : changed)
+      dirty[i] = 0;
+    firstDirty = SIZE_MAX;
+    return changed;
+  }
+};
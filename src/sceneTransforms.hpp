@@ -0,0 +1,88 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "sceneGraph.hpp"
+#include "uploadRing.hpp"
+
+/**
+ * Device-local storage buffer mirroring SceneGraph::worldMatrices(),
+ * indexed by node. upload() copies only the matrices update() reported as
+ * changed, merging nearby ones into one copy each.
+ */
+struct SceneTransforms {
+  /* changed matrices at most this many apart share one copy */
+  static constexpr uint32_t mergeGap = 4;
+
+private:
+  GpuContext context;
+  UploadRing &ring;
+  GpuBuffer matrices;
+  uint32_t capacity;
+  vk::Semaphore uploaded;
+
+public:
+  SceneTransforms(GpuContext const &gpu_context, UploadRing &upload_ring,
+                  uint32_t const node_capacity)
+      : context{gpu_context}, ring{upload_ring},
+        capacity{std::max(node_capacity, 1U)} {
+    matrices = createBuffer(context, vk::DeviceSize{capacity} * sizeof(Mat4),
+                            vk::BufferUsageFlagBits::eStorageBuffer |
+                                vk::BufferUsageFlagBits::eTransferDst,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+  }
+
+  SceneTransforms(SceneTransforms const &) = delete;
+  SceneTransforms &operator=(SceneTransforms const &) = delete;
+  SceneTransforms(SceneTransforms &&) = delete;
+  SceneTransforms &operator=(SceneTransforms &&) = delete;
+
+  ~SceneTransforms() {
+    ring.waitIdle();
+    context.device.destroySemaphore(uploaded);
+    destroyBuffer(context, matrices);
+  }
+
+  /**
+   * Stage the changed world matrices of graph (as returned by its last
+   * update()) and submit them. Returns a semaphore for
+   * VulkanGfxBase::waitBeforeNextFrame at the vertex stage, or a null
+   * handle when nothing changed.
+   */
+  vk::Semaphore upload(SceneGraph const &graph,
+                       std::span<uint32_t const> const changed) {
+    if (changed.empty())
+      return {};
+    if (graph.size() > capacity)
+      throw std::runtime_error(std::format(
+          "{}:{}: scene has {} nodes, transform buffer holds {}", __FILE__,
+          __LINE__, graph.size(), capacity));
+
+    auto const worlds = graph.worldMatrices();
+    auto copies = size_t{0};
+    for (auto run = size_t{0}; run < changed.size();) {
+      // extend while the next change is close enough that copying the
+      // unchanged matrices in between is cheaper than another region
+      auto end = run + 1;
+      while (end < changed.size() &&
+             changed[end] - changed[end - 1] <= mergeGap)
+        ++end;
+
+      auto const first = changed[run];
+      auto const last = changed[end - 1];
+      ring.copyToBuffer(matrices.buffer, vk::DeviceSize{first} * sizeof(Mat4),
+                        std::as_bytes(worlds.subspan(first, last - first + 1)));
+      ++copies;
+      run = end;
+    }
+
+    if (Args::verbose() > 1) {
+      std::cerr << std::format("{}:{}: {} transforms in {} copies\n", __FILE__,
+                               __LINE__, changed.size(), copies);
+    }
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  [[nodiscard]] vk::Buffer buffer() const { return matrices.buffer; }
+  [[nodiscard]] uint32_t nodeCapacity() const { return capacity; }
+};
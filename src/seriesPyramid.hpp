@@ -0,0 +1,163 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+/**
+ * Min/max pyramid over a uniformly sampled series: level 0 holds the
+ * samples, every bucket of level k the extremes of 2^k consecutive samples.
+ * All levels live in one flat array laid out for the sample capacity, so
+ * the GPU copy is the same array and appends only touch the tail bucket of
+ * each level (see takeDirty()).
+ *
+ * window() picks the finest level whose buckets over a sample range fit in
+ * a number of pixel columns, so drawing costs at most two vertices per
+ * column however many samples the range spans, and no extreme is lost.
+ */
+struct SeriesPyramid {
+  struct MinMax {
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+  };
+
+  /**
+   * Buckets [first_bucket, first_bucket + buckets) of level
+   */
+  struct Window {
+    uint32_t level = 0;
+    uint32_t first_bucket = 0;
+    uint32_t buckets = 0;
+  };
+
+private:
+  uint32_t capacity;
+  uint32_t count = 0;
+  std::vector<uint32_t> levelOffsets; // into nodes
+  std::vector<MinMax> nodes;
+  std::vector<uint32_t> dirtyFrom; // per level; UINT32_MAX: clean
+
+public:
+  explicit SeriesPyramid(uint32_t const sample_capacity)
+      : capacity{std::max(sample_capacity, 1U)} {
+    auto const levels = static_cast<uint32_t>(std::bit_width(capacity - 1)) + 1;
+    auto offset = uint32_t{0};
+    for (auto level = 0U; level < levels; ++level) {
+      levelOffsets.push_back(offset);
+      offset += bucketCount(capacity, level);
+    }
+    nodes.resize(offset);
+    dirtyFrom.assign(levels, UINT32_MAX);
+  }
+
+  [[nodiscard]] uint32_t size() const { return count; }
+  [[nodiscard]] uint32_t sampleCapacity() const { return capacity; }
+  [[nodiscard]] uint32_t levels() const {
+    return static_cast<uint32_t>(levelOffsets.size());
+  }
+  [[nodiscard]] uint32_t levelOffset(uint32_t const level) const {
+    return levelOffsets[level];
+  }
+
+  /**
+   * Every level at its capacity offset, filled buckets first
+   */
+  [[nodiscard]] std::span<MinMax const> data() const { return nodes; }
+
+  [[nodiscard]] std::span<MinMax const> level(uint32_t const level) const {
+    return std::span(nodes).subspan(levelOffsets[level],
+                                    bucketCount(count, level));
+  }
+
+  /**
+   * Append samples until the capacity is reached; returns how many were
+   * taken
+   */
+  size_t append(std::span<float const> const samples) {
+    auto const taken =
+        std::min<size_t>(samples.size(), capacity - count);
+    if (taken == 0)
+      return 0;
+
+    auto const first = count;
+    for (auto const value : samples.first(taken)) {
+      auto *node = nodes.data();
+      for (auto level = 0U; level < levels(); ++level) {
+        auto &bucket = node[levelOffsets[level] + (count >> level)];
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+      }
+      ++count;
+    }
+    for (auto level = 0U; level < levels(); ++level)
+      dirtyFrom[level] = std::min(dirtyFrom[level], first >> level);
+    return taken;
+  }
+
+  void clear() {
+    count = 0;
+    std::ranges::fill(nodes, MinMax());
+    std::ranges::fill(dirtyFrom, UINT32_MAX);
+  }
+
+  /**
+   * Call fn(first_node, node_count) for the nodes changed since the last
+   * call, one contiguous run per level, and mark them clean
+   */
+  template <typename Fn> void takeDirty(Fn const &fn) {
+    for (auto level = 0U; level < levels(); ++level) {
+      auto const from = dirtyFrom[level];
+      auto const to = bucketCount(count, level);
+      if (from < to)
+        fn(levelOffsets[level] + from, to - from);
+      dirtyFrom[level] = UINT32_MAX;
+    }
+  }
+
+  /**
+   * Finest level covering samples [first, first + samples) in at most
+   * columns buckets
+   */
+  [[nodiscard]] Window window(uint32_t const first, uint32_t const samples,
+                              uint32_t const columns) const {
+    if (first >= count || samples == 0)
+      return {};
+    auto const last = static_cast<uint32_t>(
+        std::min<uint64_t>(uint64_t{first} + samples, count) - 1);
+    auto const limit = std::max(columns, 1U);
+
+    auto level = 0U;
+    while (level + 1 < levels() &&
+           (last >> level) - (first >> level) + 1 > limit)
+      ++level;
+    return {.level = level,
+            .first_bucket = first >> level,
+            .buckets = (last >> level) - (first >> level) + 1};
+  }
+
+  /**
+   * Extremes over a window, e.g. to autoscale the value axis
+   */
+  [[nodiscard]] MinMax range(Window const &w) const {
+    auto result = MinMax();
+    auto const buckets = level(w.level).subspan(
+        std::min<size_t>(w.first_bucket, bucketCount(count, w.level)));
+    for (auto const &bucket : buckets.first(std::min<size_t>(
+             w.buckets, buckets.size()))) {
+      result.min = std::min(result.min, bucket.min);
+      result.max = std::max(result.max, bucket.max);
+    }
+    return result;
+  }
+
+private:
+  [[nodiscard]] static uint32_t bucketCount(uint32_t const samples,
+                                            uint32_t const level) {
+    return static_cast<uint32_t>(
+        (uint64_t{samples} + (uint64_t{1} << level) - 1) >> level);
+  }
+};
@@ -0,0 +1,33 @@
+#version 450
+
+// Line strip through a SeriesPyramid window: vertex 2i is the min, 2i + 1
+// the max of bucket i. Must match ChartRenderer::Params.
+
+layout(std430, set = 0, binding = 0) readonly buffer Nodes {
+  vec2 nodes[]; // min, max
+};
+
+layout(push_constant) uniform Params {
+  vec4 rect;    // x y width height, pixels
+  vec4 colour;
+  vec4 mapping; // value min, value max, x0, dx
+  vec2 scale;   // 2 / screen size
+  uint first_node;
+}
+params;
+
+layout(location = 0) out vec4 tint;
+
+void main() {
+  uint bucket = uint(gl_VertexIndex) / 2u;
+  vec2 node = nodes[params.first_node + bucket];
+  float value = (gl_VertexIndex & 1) == 0 ? node.x : node.y;
+
+  float x = params.mapping.z + float(bucket) * params.mapping.w;
+  float t = (value - params.mapping.x) / (params.mapping.y - params.mapping.x);
+  vec2 pixel = params.rect.xy + vec2(clamp(x, 0.0, params.rect.z),
+                                     (1.0 - clamp(t, 0.0, 1.0)) * params.rect.w);
+
+  tint = params.colour;
+  gl_Position = vec4(pixel * params.scale - 1.0, 0.0, 1.0);
+}
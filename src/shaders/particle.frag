@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) in vec2 uv;
+layout(location = 1) in vec4 colour;
+
+layout(location = 0) out vec4 out_colour;
+
+void main() {
+  float falloff = max(1.0 - dot(uv, uv), 0.0);
+  // premultiplied, blended additively
+  out_colour = vec4(colour.rgb * colour.a * falloff * falloff, 0.0);
+}
@@ -0,0 +1,42 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Camera-facing quad per alive particle: instance i is alive[i] of the list
+// the last step wrote, vertex 0..5 a corner of the quad.
+// Must match GpuParticles::DrawParams.
+
+#define PARTICLE_ACCESS readonly
+#include "particles.glsl"
+
+layout(push_constant) uniform DrawParams {
+  mat4 view_proj;
+  vec4 camera_right; // world space, xyz
+  vec4 camera_up;
+  uint capacity;
+  uint current; // alive list holding the survivors
+}
+params;
+
+layout(location = 0) out vec2 uv;
+layout(location = 1) out vec4 colour;
+
+const vec2 CORNERS[6] = vec2[](vec2(-1, -1), vec2(1, -1), vec2(1, 1),
+                               vec2(-1, -1), vec2(1, 1), vec2(-1, 1));
+
+void main() {
+  uint p = alive[params.current * params.capacity + gl_InstanceIndex];
+  vec4 ps = position_size[p];
+  vec2 life = age_lifetime[p];
+  float t = clamp(life.x / life.y, 0.0, 1.0);
+
+  vec2 corner = CORNERS[gl_VertexIndex];
+  vec3 world = ps.xyz + (corner.x * params.camera_right.xyz +
+                         corner.y * params.camera_up.xyz) *
+                            (ps.w * 0.5);
+  gl_Position = params.view_proj * vec4(world, 1.0);
+
+  uv = corner;
+  // hot and bright when young, fading to a dim ember
+  colour = vec4(mix(vec3(1.0, 0.8, 0.4), vec3(0.6, 0.15, 0.05), t),
+                1.0 - t);
+}
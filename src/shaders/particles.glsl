@@ -0,0 +1,38 @@
+// Particle storage shared by the simulation passes and the renderer.
+// Structure of arrays: each attribute is its own tightly packed buffer, so a
+// pass only pulls the attributes it touches through the cache.
+// Must match GpuParticles (gpuParticles.hpp).
+
+// the renderer includes this read-only (no vertex stage stores)
+#ifndef PARTICLE_ACCESS
+#define PARTICLE_ACCESS
+#endif
+
+layout(std430, set = 0, binding = 0) PARTICLE_ACCESS buffer Positions {
+  vec4 position_size[]; // xyz, billboard size
+};
+layout(std430, set = 0, binding = 1) PARTICLE_ACCESS buffer Velocities {
+  vec4 velocity[]; // xyz, -
+};
+layout(std430, set = 0, binding = 2) PARTICLE_ACCESS buffer Lifetimes {
+  vec2 age_lifetime[];
+};
+
+// alive[current * capacity ..] is read this step, the other half written
+layout(std430, set = 0, binding = 3) PARTICLE_ACCESS buffer AliveList {
+  uint alive[];
+};
+layout(std430, set = 0, binding = 4) PARTICLE_ACCESS buffer DeadList {
+  uint dead[];
+};
+
+// the indirect commands live in here too; offsets match
+// GpuParticles::dispatchArgsOffset / drawArgsOffset
+layout(std430, set = 0, binding = 5) PARTICLE_ACCESS buffer Counters {
+  int alive_count[2];
+  int dead_count;
+  uint emitted;
+  uvec4 dispatch_args; // x, y, z, -
+  uvec4 draw_args;     // vertex count, instance count, first vertex, first instance
+}
+counters;
@@ -0,0 +1,23 @@
+#version 450
+
+// Octree point cloud. Each instance is one resident node: positions are
+// unorm16 inside the node's cube. Must match StreamedPointCloud::PointParams.
+
+layout(location = 0) in vec4 in_position; // unorm16, w unused
+layout(location = 1) in vec4 in_colour;   // unorm8
+layout(location = 2) in vec4 in_node;     // cube min xyz, edge
+
+layout(push_constant) uniform PointParams {
+  mat4 view_proj;
+}
+params;
+
+layout(location = 0) out vec3 colour;
+
+void main() {
+  vec3 world_position = in_node.xyz + in_position.xyz * in_node.w;
+  gl_Position = params.view_proj * vec4(world_position, 1.0);
+  // 1 is the only size guaranteed without the largePoints feature
+  gl_PointSize = 1.0;
+  colour = in_colour.rgb;
+}
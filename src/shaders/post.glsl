@@ -0,0 +1,52 @@
+// Post-processing stage functions shared by the subpass, compute and sampled
+// drivers. STAGE is a specialization constant so each pipeline only keeps
+// its own stage after constant folding.
+// Must match VulkanGfxBase::PostStage and VulkanGfxBase::PostParams.
+
+#define STAGE_TONEMAP 0
+#define STAGE_COLOUR_GRADE 1
+#define STAGE_VIGNETTE 2
+#define STAGE_UI_COMPOSITE 3
+
+layout(constant_id = 0) const int STAGE = STAGE_TONEMAP;
+
+layout(push_constant) uniform PostParams {
+  vec2 inv_extent;
+  float exposure;
+  float saturation;
+  float contrast;
+  float vignette_strength;
+  float vignette_radius;
+}
+params;
+
+// ACES filmic fit (Narkowicz 2015)
+vec3 tonemap(vec3 c) {
+  c *= params.exposure;
+  return clamp((c * (2.51 * c + 0.03)) / (c * (2.43 * c + 0.59) + 0.14), 0.0,
+               1.0);
+}
+
+vec3 colourGrade(vec3 c) {
+  float luma = dot(c, vec3(0.2126, 0.7152, 0.0722));
+  c = mix(vec3(luma), c, params.saturation);
+  return clamp((c - 0.5) * params.contrast + 0.5, 0.0, 1.0);
+}
+
+vec3 vignette(vec3 c, vec2 uv) {
+  float d = length(uv - 0.5) * 1.41421356;
+  return c * (1.0 - params.vignette_strength *
+                        smoothstep(params.vignette_radius, 1.0, d));
+}
+
+vec4 postStage(vec4 c, vec2 uv) {
+  if (STAGE == STAGE_TONEMAP)
+    return vec4(tonemap(c.rgb), c.a);
+  if (STAGE == STAGE_COLOUR_GRADE)
+    return vec4(colourGrade(c.rgb), c.a);
+  if (STAGE == STAGE_VIGNETTE)
+    return vec4(vignette(c.rgb, uv), c.a);
+
+  // STAGE_UI_COMPOSITE: pass-through, overlay geometry is drawn on top
+  return c;
+}
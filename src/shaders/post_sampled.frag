@@ -0,0 +1,14 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Final post stage of the compute fallback path, run inside the composite
+// render pass so overlays can be drawn on top.
+
+#include "post.glsl"
+
+layout(set = 0, binding = 0) uniform sampler2D src;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 colour;
+
+void main() { colour = postStage(texture(src, uv), uv); }
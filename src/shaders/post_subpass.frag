@@ -0,0 +1,14 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// On-tile post stage: reads the previous subpass' output as an input
+// attachment so intermediate results never leave tile memory.
+
+#include "post.glsl"
+
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput src;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 colour;
+
+void main() { colour = postStage(subpassLoad(src), uv); }
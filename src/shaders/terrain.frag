@@ -0,0 +1,34 @@
+#version 450
+
+layout(push_constant) uniform TerrainParams {
+  mat4 view_proj;
+  vec4 camera;
+  vec4 heights;
+}
+params;
+
+layout(location = 0) in vec3 world_position;
+layout(location = 1) in vec3 normal;
+
+layout(location = 0) out vec4 colour;
+
+const vec3 SUN = normalize(vec3(0.4, 0.8, 0.3));
+const vec3 SKY = vec3(0.55, 0.7, 0.9);
+
+void main() {
+  vec3 n = normalize(normal);
+  float relative_height =
+      clamp((world_position.y - params.heights.x) / params.heights.y, 0.0, 1.0);
+
+  vec3 grass = vec3(0.22, 0.36, 0.14);
+  vec3 rock = vec3(0.4, 0.37, 0.33);
+  vec3 snow = vec3(0.9, 0.92, 0.95);
+  vec3 albedo = mix(grass, rock, smoothstep(0.6, 0.8, 1.0 - n.y));
+  albedo = mix(albedo, snow, smoothstep(0.7, 0.85, relative_height) * n.y);
+
+  vec3 lit = albedo * (0.25 * SKY + max(dot(n, SUN), 0.0));
+
+  float eye_distance = length(world_position - params.camera.xyz);
+  float fog = 1.0 - exp(-eye_distance * 0.00015);
+  colour = vec4(mix(lit, SKY, fog), 1.0);
+}
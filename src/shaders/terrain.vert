@@ -0,0 +1,78 @@
+#version 450
+
+// Geometry clipmap patch. Each instance is one clipmapPatch^2 quad patch of
+// one level; heights come from that level's toroidal layer of the height
+// array. Vertices beyond MORPH_START samples from the camera (Chebyshev)
+// slide onto the next coarser grid, so at the level's edge they match the
+// coarser level exactly and no seams open up.
+// Must match ClipmapTerrain::TerrainParams and terrainFormat.hpp.
+
+layout(constant_id = 0) const int CLIPMAP_SIZE = 256;
+layout(constant_id = 1) const int CLIPMAP_SNAP = 32;
+layout(constant_id = 2) const int LEVEL_COUNT = 8;
+
+const float MORPH_WIDTH = 16.0;
+const float MORPH_START = float(CLIPMAP_SIZE / 2 - CLIPMAP_SNAP) - MORPH_WIDTH;
+
+layout(location = 0) in uvec2 in_grid; // vertex within the patch
+layout(location = 1) in ivec4 in_patch; // level, origin x, origin y, -
+
+layout(set = 0, binding = 0) uniform usampler2DArray height_layers;
+layout(set = 0, binding = 1) uniform Regions {
+  ivec4 origin[16]; // per level region origin, level samples
+}
+regions;
+
+layout(push_constant) uniform TerrainParams {
+  mat4 view_proj;
+  vec4 camera;  // world xyz, w: level 0 sample spacing
+  vec4 heights; // x: offset, y: scale
+}
+params;
+
+layout(location = 0) out vec3 world_position;
+layout(location = 1) out vec3 normal;
+
+float texel(int level, ivec2 g) {
+  ivec2 origin = regions.origin[level].xy;
+  g = clamp(g, origin, origin + CLIPMAP_SIZE - 1);
+  ivec2 t = ((g % CLIPMAP_SIZE) + CLIPMAP_SIZE) % CLIPMAP_SIZE;
+  return float(texelFetch(height_layers, ivec3(t, level), 0).r) / 65535.0;
+}
+
+float heightAt(int level, vec2 g) {
+  ivec2 i = ivec2(floor(g));
+  vec2 f = g - vec2(i);
+  return mix(mix(texel(level, i), texel(level, i + ivec2(1, 0)), f.x),
+             mix(texel(level, i + ivec2(0, 1)), texel(level, i + ivec2(1, 1)),
+                 f.x),
+             f.y);
+}
+
+void main() {
+  int level = in_patch.x;
+  float spacing = params.camera.w * exp2(float(level));
+
+  vec2 g = vec2(in_patch.yz + ivec2(in_grid));
+  vec2 d = abs(g - params.camera.xz / spacing);
+  float morph = level + 1 < LEVEL_COUNT
+                    ? clamp((max(d.x, d.y) - MORPH_START) / MORPH_WIDTH, 0.0,
+                            1.0)
+                    : 0.0;
+
+  // odd samples slide onto their even neighbour
+  vec2 gm = g - mod(g, 2.0) * morph;
+  float h = heightAt(level, gm);
+  if (morph > 0.0)
+    h = mix(h, heightAt(level + 1, gm * 0.5), morph);
+
+  float dx = heightAt(level, gm + vec2(1, 0)) - heightAt(level, gm - vec2(1, 0));
+  float dz = heightAt(level, gm + vec2(0, 1)) - heightAt(level, gm - vec2(0, 1));
+  normal = normalize(vec3(-dx * params.heights.y, 2.0 * spacing,
+                          -dz * params.heights.y));
+
+  world_position =
+      vec3(gm.x * spacing, params.heights.x + params.heights.y * h,
+           gm.y * spacing);
+  gl_Position = params.view_proj * vec4(world_position, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D atlas;
+
+layout(location = 0) in vec2 uv;
+layout(location = 1) in vec4 tint;
+
+layout(location = 0) out vec4 colour;
+
+void main() {
+  // atlas holds coverage; solid shapes point at a fully covered cell
+  colour = vec4(tint.rgb, tint.a * texture(atlas, uv).r);
+}
@@ -0,0 +1,23 @@
+#version 450
+
+// Pixel-space UI vertices, origin top left (Vulkan clip space is y-down too).
+// Must match UiRenderer::Params and UiVertex.
+
+layout(push_constant) uniform Params {
+  vec2 scale;     // 2 / screen size
+  vec2 inv_atlas; // 1 / atlas size
+}
+params;
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texel; // atlas texels
+layout(location = 2) in vec4 colour;
+
+layout(location = 0) out vec2 uv;
+layout(location = 1) out vec4 tint;
+
+void main() {
+  uv = texel * params.inv_atlas;
+  tint = colour;
+  gl_Position = vec4(position * params.scale - 1.0, 0.0, 1.0);
+}
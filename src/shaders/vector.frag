@@ -0,0 +1,23 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "vector.glsl"
+
+layout(location = 0) in vec2 local;
+layout(location = 1) flat in uint path;
+
+layout(location = 0) out vec4 colour;
+
+void main() {
+  Instance instance = instances[path];
+  vec4 g = instance.gradient;
+
+  float t = 0.0;
+  if (instance.kind.x == 1u) {
+    vec2 d = g.zw - g.xy;
+    t = dot(local - g.xy, d) / max(dot(d, d), 1e-12);
+  } else if (instance.kind.x == 2u) {
+    t = length(local - g.xy) / max(g.z, 1e-6);
+  }
+  colour = mix(instance.colour0, instance.colour1, clamp(t, 0.0, 1.0));
+}
@@ -0,0 +1,14 @@
+// Per-path record. Must match VectorRenderer::Instance.
+
+struct Instance {
+  vec4 row0; // xx xy tx -
+  vec4 row1; // yx yy ty -
+  vec4 colour0;
+  vec4 colour1;
+  vec4 gradient; // linear: x0 y0 x1 y1, radial: cx cy r -
+  uvec4 kind;    // x: 0 solid, 1 linear, 2 radial
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Path-space vertex placed by its path's transform; gl_InstanceIndex is the
+// path id (firstInstance). Must match VectorRenderer::Params.
+
+#include "vector.glsl"
+
+layout(push_constant) uniform Params {
+  vec2 scale; // 2 / screen size
+}
+params;
+
+layout(location = 0) in vec2 position;
+
+layout(location = 0) out vec2 local;
+layout(location = 1) flat out uint path;
+
+void main() {
+  Instance instance = instances[gl_InstanceIndex];
+  vec3 p = vec3(position, 1.0);
+  vec2 screen = vec2(dot(instance.row0.xyz, p), dot(instance.row1.xyz, p));
+
+  local = position;
+  path = gl_InstanceIndex;
+  gl_Position = vec4(screen * params.scale - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,242 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "radixSort.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Broadphase for proximity queries over point entities, rebuilt from
+ * scratch every frame.
+ *
+ * build() hashes every position's grid cell into a key, radix sorts the
+ * (key, index) pairs on a WorkerPool and copies the positions into key
+ * order, so all entities of a cell sit in one contiguous range found by
+ * binary search. Distinct cells can share a key; queries check distances,
+ * so that only costs a little scanning.
+ */
+struct SpatialHash {
+  /**
+   * Batched query results, CSR style: the hits of query q are
+   * indices[offsets[q] .. offsets[q + 1])
+   */
+  struct Hits {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> indices;
+
+    [[nodiscard]] std::span<uint32_t const> of(size_t const query) const {
+      return std::span(indices).subspan(offsets[query],
+                                        offsets[query + 1] - offsets[query]);
+    }
+  };
+
+  static constexpr uint32_t maxKeyBits = 22; // two radix passes at most
+
+private:
+  WorkerPool *pool;
+  float inverseCellSize = 1.0f;
+  uint32_t keyBits = 0;
+
+  /* key order, rebuilt by build() */
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> indices;
+  std::vector<float> sortedX, sortedY, sortedZ;
+
+  /* radix sorted as key << 32 | index, so a scatter moves one word */
+  std::vector<uint64_t> entries;
+  RadixSorter<uint64_t> sorter;
+
+public:
+  /**
+   * pool may be null to build and query single threaded
+   */
+  explicit SpatialHash(WorkerPool *worker_pool = nullptr)
+      : pool{worker_pool} {}
+
+  /**
+   * Index positions (SoA, equal lengths) on a grid of cell_size. Pick a
+   * cell size around the typical query radius.
+   */
+  void build(std::span<float const> const x, std::span<float const> const y,
+             std::span<float const> const z, float const cell_size) {
+    auto const n = x.size();
+    inverseCellSize = 1.0f / cell_size;
+    // about two buckets per entity keeps collisions rare
+    keyBits = std::clamp<uint32_t>(std::bit_width(2 * n), 1, maxKeyBits);
+
+    keys.resize(n);
+    indices.resize(n);
+    entries.resize(n);
+    sortedX.resize(n);
+    sortedY.resize(n);
+    sortedZ.resize(n);
+
+    parallel(n, [&](size_t const begin, size_t const end) {
+      for (auto i = begin; i < end; ++i) {
+        entries[i] = uint64_t{key(cell(x[i]), cell(y[i]), cell(z[i]))} << 32U |
+                     i;
+      }
+    });
+
+    sorter.sort(entries, keyBits,
+                [](uint64_t const entry) { return entry >> 32U; }, pool);
+
+    parallel(n, [&](size_t const begin, size_t const end) {
+      for (auto i = begin; i < end; ++i) {
+        auto const index = static_cast<uint32_t>(entries[i]);
+        keys[i] = static_cast<uint32_t>(entries[i] >> 32U);
+        indices[i] = index;
+        sortedX[i] = x[index];
+        sortedY[i] = y[index];
+        sortedZ[i] = z[index];
+      }
+    });
+  }
+
+  [[nodiscard]] size_t size() const { return keys.size(); }
+
+  /**
+   * Entities within radius of each point (inclusive), in key order per
+   * point. Queries run in parallel on the pool.
+   */
+  void queryRadius(std::span<std::array<float, 3> const> const points,
+                   float const radius, Hits &hits) const {
+    auto const blocks = blockCount(points.size());
+    auto const block_size = (points.size() + blocks - 1) / blocks;
+    auto block_hits = std::vector<std::vector<uint32_t>>(blocks);
+    auto counts = std::vector<uint32_t>(points.size());
+
+    forBlocks(blocks, [&](size_t const block) {
+      auto &out = block_hits[block];
+      auto const end = std::min(points.size(), (block + 1) * block_size);
+      for (auto q = block * block_size; q < end; ++q) {
+        auto const before = out.size();
+        forEachWithin(points[q], radius,
+                      [&](uint32_t const index) { out.push_back(index); });
+        counts[q] = static_cast<uint32_t>(out.size() - before);
+      }
+    });
+
+    hits.offsets.resize(points.size() + 1);
+    hits.offsets[0] = 0;
+    for (auto q = size_t{0}; q < points.size(); ++q)
+      hits.offsets[q + 1] = hits.offsets[q] + counts[q];
+    hits.indices.clear();
+    hits.indices.reserve(hits.offsets.back());
+    for (auto const &block : block_hits)
+      hits.indices.insert(hits.indices.end(), block.begin(), block.end());
+  }
+
+  /**
+   * Call fn(index) for every entity within radius of point
+   */
+  template <typename Fn>
+  void forEachWithin(std::array<float, 3> const &point, float const radius,
+                     Fn &&fn) const {
+    if (keys.empty())
+      return;
+
+    auto const r2 = radius * radius;
+    auto const lo = std::array{cell(point[0] - radius), cell(point[1] - radius),
+                               cell(point[2] - radius)};
+    auto const hi = std::array{cell(point[0] + radius), cell(point[1] + radius),
+                               cell(point[2] + radius)};
+
+    // cells sharing a key must be scanned once only
+    auto visited = std::array<uint32_t, 64>{};
+    auto visited_count = size_t{0};
+    auto seen = [&](uint32_t const k) {
+      if (std::find(visited.begin(), visited.begin() + visited_count, k) !=
+          visited.begin() + visited_count)
+        return true;
+      if (visited_count < visited.size())
+        visited[visited_count++] = k;
+      return false;
+    };
+
+    // a radius much larger than the cells degenerates into a full scan
+    auto const cells_covered = int64_t{hi[0] - lo[0] + 1} *
+                               (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+    if (cells_covered > static_cast<int64_t>(visited.size())) {
+      scan(0, keys.size(), point, r2, fn);
+      return;
+    }
+
+    for (auto cz = lo[2]; cz <= hi[2]; ++cz) {
+      for (auto cy = lo[1]; cy <= hi[1]; ++cy) {
+        for (auto cx = lo[0]; cx <= hi[0]; ++cx) {
+          auto const k = key(cx, cy, cz);
+          if (seen(k))
+            continue;
+          auto const range = std::equal_range(keys.begin(), keys.end(), k);
+          scan(static_cast<size_t>(range.first - keys.begin()),
+               static_cast<size_t>(range.second - keys.begin()), point, r2, fn);
+        }
+      }
+    }
+  }
+
+private:
+  [[nodiscard]] int32_t cell(float const v) const {
+    // floor without the libm call std::floor becomes before SSE4.1
+    auto const scaled = v * inverseCellSize;
+    auto const truncated = static_cast<int32_t>(scaled);
+    return truncated - (scaled < static_cast<float>(truncated) ? 1 : 0);
+  }
+
+  /**
+   * Teschner et al. 2003, folded to keyBits
+   */
+  [[nodiscard]] uint32_t key(int32_t const cx, int32_t const cy,
+                             int32_t const cz) const {
+    auto const h = (static_cast<uint32_t>(cx) * 73856093U) ^
+                   (static_cast<uint32_t>(cy) * 19349663U) ^
+                   (static_cast<uint32_t>(cz) * 83492791U);
+    return (h ^ (h >> keyBits)) & ((1U << keyBits) - 1);
+  }
+
+  template <typename Fn>
+  void scan(size_t const begin, size_t const end,
+            std::array<float, 3> const &point, float const r2, Fn &fn) const {
+    for (auto i = begin; i < end; ++i) {
+      auto const dx = sortedX[i] - point[0];
+      auto const dy = sortedY[i] - point[1];
+      auto const dz = sortedZ[i] - point[2];
+      if (dx * dx + dy * dy + dz * dz <= r2)
+        fn(indices[i]);
+    }
+  }
+
+  /**
+   * Blocks of at least a few thousand queries, a few per thread
+   */
+  [[nodiscard]] size_t blockCount(size_t const n) const {
+    auto const width = pool ? pool->width() : size_t{1};
+    return std::clamp<size_t>(n / 4096, 1, 4 * width);
+  }
+
+  template <typename Fn> void forBlocks(size_t const blocks, Fn &&fn) const {
+    auto const run = [&](size_t const begin, size_t const end) {
+      for (auto block = begin; block < end; ++block)
+        fn(block);
+    };
+    if (pool) {
+      pool->parallelFor(blocks, 1, run);
+    } else {
+      run(0, blocks);
+    }
+  }
+
+  template <typename Fn> void parallel(size_t const n, Fn &&fn) const {
+    if (pool) {
+      pool->parallelFor(n, 8192, fn);
+    } else {
+      fn(0, n);
+    }
+  }
+};
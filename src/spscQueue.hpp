@@ -0,0 +1,77 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <vector>
+
+/**
+ * Bounded lock-free queue for exactly one producer and one consumer thread.
+ * The capacity is rounded up to a power of two. head and tail sit on their
+ * own cache lines, and each side caches the other's index so the common
+ * case touches no shared line at all.
+ */
+template <typename T> struct SpscQueue {
+private:
+  static constexpr size_t cacheLine = 64;
+
+  std::vector<T> slots;
+  size_t mask;
+
+  alignas(cacheLine) std::atomic<size_t> head{0}; // next pop, consumer owned
+  size_t cachedTail = 0;
+  alignas(cacheLine) std::atomic<size_t> tail{0}; // next push, producer owned
+  size_t cachedHead = 0;
+
+public:
+  explicit SpscQueue(size_t const capacity)
+      : slots(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        mask{slots.size() - 1} {}
+
+  SpscQueue(SpscQueue const &) = delete;
+  SpscQueue &operator=(SpscQueue const &) = delete;
+
+  [[nodiscard]] size_t capacity() const { return slots.size(); }
+
+  /**
+   * Producer only; false when full
+   */
+  bool tryPush(T value) {
+    auto const t = tail.load(std::memory_order_relaxed);
+    if (t - cachedHead == slots.size()) {
+      cachedHead = head.load(std::memory_order_acquire);
+      if (t - cachedHead == slots.size())
+        return false;
+    }
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer only; empty when there is nothing queued
+   */
+  std::optional<T> tryPop() {
+    auto const h = head.load(std::memory_order_relaxed);
+    if (h == cachedTail) {
+      cachedTail = tail.load(std::memory_order_acquire);
+      if (h == cachedTail)
+        return std::nullopt;
+    }
+    auto value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    return value;
+  }
+
+  /**
+   * Approximate from either side
+   */
+  [[nodiscard]] size_t size() const {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+  }
+};
@@ -0,0 +1,343 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * One quality governor change as published in StatsSample
+ */
+struct StatsQualityDecision {
+  uint64_t frame = 0;    // governor frames seen when it was made
+  float frame_ms = 0.0f; // the p90 that triggered it, 0 when set by hand
+  uint8_t knob = 0;      // index into statsQualityKnobs
+  uint8_t from = 0;      // knob levels, 0 is lowest
+  uint8_t to = 0;
+  uint8_t flags = 0;     // statsQualityGpuBound | statsQualityManual
+};
+
+inline constexpr uint8_t statsQualityGpuBound = 1;
+inline constexpr uint8_t statsQualityManual = 2;
+inline constexpr size_t statsQualityRecent = 4;
+
+/* the governor's knobs, in the order main adds them */
+inline constexpr auto statsQualityKnobs =
+    std::array<char const *, 2>{"msaa", "post_chain"};
+
+/**
+ * Live counters published into a POSIX shared memory page for external
+ * monitors (hotair-top, or any agent that can shm_open and follow this
+ * layout). One writer, any number of readers; a seqlock means readers never
+ * block or slow the writer, they retry when they catch it mid-update.
+ *
+ * Fields are only ever appended; statsPageVersion changes when a field's
+ * meaning or position does.
+ */
+struct StatsSample {
+  uint64_t published_ns = 0; // steady clock (CLOCK_MONOTONIC)
+  uint64_t frames = 0;       // since start
+  double fps = 0.0;          // over the last whole second
+  double frame_ms_p50 = 0.0; // frame times over the last FrameTimeWindow
+  double frame_ms_p90 = 0.0;
+  double frame_ms_p99 = 0.0;
+  double frame_ms_max = 0.0;
+  double frame_cap = 0.0;        // 0: uncapped
+  uint64_t late_frames = 0;      // missed the frame cap deadline, since start
+  uint64_t control_queued = 0;   // control commands waiting for the frame
+  uint64_t feed_batch = 0;       // feed updates drained by the last frame
+  uint64_t feed_clients = 0;     // connected now
+  uint64_t feed_updates = 0;     // since start
+  uint64_t feed_bytes = 0;       // inline and memfd, since start
+  uint64_t feed_rejected = 0;    // clients dropped for protocol errors
+  uint64_t rss_bytes = 0;        // resident now
+  uint64_t peak_rss_bytes = 0;
+  uint64_t quality_governed = 0; // 1 while the quality governor runs
+  uint64_t quality_msaa = 0;     // knob levels, 0 is lowest
+  uint64_t quality_post_chain = 0;
+  uint64_t quality_changes = 0;  // since start
+  // the last min(quality_changes, statsQualityRecent), most recent first
+  std::array<StatsQualityDecision, statsQualityRecent> quality_recent{};
+};
+
+static_assert(sizeof(StatsQualityDecision) == 2 * sizeof(uint64_t));
+static_assert(std::is_trivially_copyable_v<StatsSample>);
+static_assert(sizeof(StatsSample) % sizeof(uint64_t) == 0);
+
+inline constexpr uint32_t statsPageMagic = 0x50534148; // "HASP"
+inline constexpr uint32_t statsPageVersion = 1;
+inline constexpr size_t statsSampleWords =
+    sizeof(StatsSample) / sizeof(uint64_t);
+
+/**
+ * The shared page. sequence is odd while the writer is between its two
+ * stores; the sample is copied word by word with relaxed atomics so a torn
+ * read is detected, never undefined.
+ */
+struct StatsPageLayout {
+  std::atomic<uint32_t> magic; // stored last, once the header is valid
+  uint32_t version;
+  uint32_t sample_words;
+  uint32_t pid;
+  std::atomic<uint64_t> sequence;
+  std::array<std::atomic<uint64_t>, statsSampleWords> sample;
+};
+
+static_assert(offsetof(StatsPageLayout, pid) == 3 * sizeof(uint32_t));
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "seqlock words must be lock free to be shared across processes");
+
+/**
+ * Writer side; creates the named page, or takes over one whose writer is
+ * gone, and unlinks it on destruction. A page another running writer
+ * publishes is refused.
+ */
+struct StatsPage {
+private:
+  std::string pageName;
+  StatsPageLayout *page = nullptr;
+
+public:
+  /**
+   * name is a shm_open name, "/hotair-stats" appears as
+   * /dev/shm/hotair-stats
+   */
+  explicit StatsPage(std::string name) : pageName{std::move(name)} {
+    auto const fd = shm_open(pageName.c_str(), O_CREAT | O_RDWR | O_CLOEXEC,
+                             S_IRUSR | S_IWUSR);
+    if (fd == -1)
+      throw std::runtime_error(std::format("{}:{}: shm_open {}: {}", __FILE__,
+                                           __LINE__, pageName,
+                                           strerror(errno)));
+    // checked before ftruncate, which would pull the page from under it
+    if (auto const owner = liveWriter(fd); owner != 0) {
+      close(fd);
+      throw std::runtime_error(std::format("{}:{}: {} is in use by pid {}",
+                                           __FILE__, __LINE__, pageName,
+                                           owner));
+    }
+    auto mapped = MAP_FAILED;
+    if (ftruncate(fd, sizeof(StatsPageLayout)) == 0)
+      mapped = mmap(nullptr, sizeof(StatsPageLayout), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    auto const error = errno;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      shm_unlink(pageName.c_str());
+      throw std::runtime_error(std::format("{}:{}: map {}: {}", __FILE__,
+                                           __LINE__, pageName,
+                                           strerror(error)));
+    }
+
+    page = static_cast<StatsPageLayout *>(mapped);
+    // a page left by an earlier run is invalid until the header is rewritten
+    page->magic.store(0, std::memory_order_relaxed);
+    page->version = statsPageVersion;
+    page->sample_words = statsSampleWords;
+    page->pid = static_cast<uint32_t>(getpid());
+    page->sequence.store(0, std::memory_order_relaxed);
+    publish({});
+    page->magic.store(statsPageMagic, std::memory_order_release);
+  }
+
+  StatsPage(StatsPage const &) = delete;
+  StatsPage &operator=(StatsPage const &) = delete;
+  StatsPage(StatsPage &&) = delete;
+  StatsPage &operator=(StatsPage &&) = delete;
+
+  ~StatsPage() {
+    page->magic.store(0, std::memory_order_relaxed);
+    munmap(page, sizeof(StatsPageLayout));
+    shm_unlink(pageName.c_str());
+  }
+
+  [[nodiscard]] std::string const &name() const { return pageName; }
+
+  void publish(StatsSample const &sample) {
+    auto const words =
+        std::bit_cast<std::array<uint64_t, statsSampleWords>>(sample);
+    auto const sequence = page->sequence.load(std::memory_order_relaxed);
+    page->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto i = size_t{0}; i < words.size(); ++i)
+      page->sample[i].store(words[i], std::memory_order_relaxed);
+    page->sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+private:
+  /**
+   * The pid publishing into the open page, 0 if it is new, left behind by a
+   * writer that is gone, or ours
+   */
+  static pid_t liveWriter(int const fd) {
+    auto header = std::array<uint32_t, 4>(); // magic, version, words, pid
+    if (pread(fd, header.data(), sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        header[0] != statsPageMagic)
+      return 0;
+    auto const owner = static_cast<pid_t>(header[3]);
+    if (owner <= 0 || owner == getpid() ||
+        (kill(owner, 0) != 0 && errno != EPERM))
+      return 0;
+    return owner;
+  }
+};
+
+/**
+ * Reader side, mapped read only
+ */
+struct StatsPageReader {
+private:
+  StatsPageLayout const *page = nullptr;
+
+public:
+  explicit StatsPageReader(std::string const &name) {
+    auto const fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1)
+      throw std::runtime_error(std::format("{}:{}: shm_open {}: {}", __FILE__,
+                                           __LINE__, name, strerror(errno)));
+    struct stat status {};
+    auto mapped = MAP_FAILED;
+    if (fstat(fd, &status) == 0 &&
+        static_cast<size_t>(status.st_size) >= sizeof(StatsPageLayout))
+      mapped = mmap(nullptr, sizeof(StatsPageLayout), PROT_READ, MAP_SHARED,
+                    fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+      throw std::runtime_error(std::format("{}:{}: {} is not a stats page",
+                                           __FILE__, __LINE__, name));
+    page = static_cast<StatsPageLayout const *>(mapped);
+  }
+
+  StatsPageReader(StatsPageReader const &) = delete;
+  StatsPageReader &operator=(StatsPageReader const &) = delete;
+  StatsPageReader(StatsPageReader &&) = delete;
+  StatsPageReader &operator=(StatsPageReader &&) = delete;
+
+  ~StatsPageReader() {
+    munmap(const_cast<StatsPageLayout *>(page), sizeof(StatsPageLayout));
+  }
+
+  /**
+   * Header valid and of a layout this build understands; a newer writer
+   * with more fields appended still is
+   */
+  [[nodiscard]] bool valid() const {
+    return page->magic.load(std::memory_order_acquire) == statsPageMagic &&
+           page->version == statsPageVersion &&
+           page->sample_words >= statsSampleWords;
+  }
+
+  [[nodiscard]] uint32_t pid() const { return page->pid; }
+
+  /**
+   * A consistent copy of the sample; empty if the page is invalid or the
+   * writer kept it busy for every attempt
+   */
+  [[nodiscard]] std::optional<StatsSample> read(int attempts = 64) const {
+    if (!valid())
+      return {};
+    auto words = std::array<uint64_t, statsSampleWords>();
+    for (; attempts > 0; --attempts) {
+      auto const before = page->sequence.load(std::memory_order_acquire);
+      if (before & 1)
+        continue;
+      for (auto i = size_t{0}; i < words.size(); ++i)
+        words[i] = page->sample[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (page->sequence.load(std::memory_order_relaxed) == before)
+        return std::bit_cast<StatsSample>(words);
+    }
+    return {};
+  }
+};
+
+/**
+ * The last capacity frame times, for the published percentiles
+ */
+struct FrameTimeWindow {
+  struct Percentiles {
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+  };
+
+private:
+  std::vector<float> times;
+  std::vector<float> scratch;
+  size_t next = 0;
+
+public:
+  explicit FrameTimeWindow(size_t const capacity = 512) {
+    times.reserve(capacity);
+    scratch.reserve(capacity);
+  }
+
+  void add(float const frame_ms) {
+    if (times.size() < times.capacity()) {
+      times.push_back(frame_ms);
+      return;
+    }
+    times[next] = frame_ms;
+    next = (next + 1) % times.size();
+  }
+
+  [[nodiscard]] size_t size() const { return times.size(); }
+
+  /**
+   * Nearest-rank percentiles; zeros while empty
+   */
+  [[nodiscard]] Percentiles percentiles() {
+    if (times.empty())
+      return {};
+    scratch.assign(times.begin(), times.end());
+    auto const rank = [this](size_t const percent) {
+      auto const nth = scratch.begin() +
+                       static_cast<ptrdiff_t>((scratch.size() - 1) * percent /
+                                              100);
+      std::nth_element(scratch.begin(), nth, scratch.end());
+      return static_cast<double>(*nth);
+    };
+    auto result = Percentiles();
+    result.p50 = rank(50);
+    result.p90 = rank(90);
+    result.p99 = rank(99);
+    result.max = *std::max_element(scratch.begin(), scratch.end());
+    return result;
+  }
+};
+
+/**
+ * Resident and peak resident set size of this process, in bytes
+ */
+[[nodiscard]] inline std::pair<uint64_t, uint64_t> residentBytes() {
+  auto pages = uint64_t{0};
+  auto resident = uint64_t{0};
+  if (auto statm = std::ifstream("/proc/self/statm"); statm)
+    statm >> pages >> resident;
+  auto usage = rusage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return {resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)),
+          static_cast<uint64_t>(usage.ru_maxrss) * 1024};
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+static_assert(__cplusplus >= 202002L, "Needs C++20");
+
+#include "mmappedFile.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Tiled heightmap pyramid, written by tools/terrainTiler.
+ *
+ * Level 0 is the full-resolution grid, each further level halves it. Every
+ * level is stored as a row-major grid of tile_size x tile_size uint16
+ * tiles (edge tiles padded by repeating the border), so any rectangle is
+ * read from a handful of contiguous runs. height = height_offset +
+ * height_scale * sample / 65535.
+ */
+struct TerrainFileHeader {
+  static constexpr auto MAGIC = std::array<char, 4>{'H', 'A', 'T', 'R'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr auto MAX_LEVELS = 16U;
+
+  std::array<char, 4> magic = MAGIC;
+  uint32_t version = VERSION;
+
+  uint32_t tile_size = 256;
+  uint32_t level_count = 0;
+  uint32_t width = 0; // level 0 samples
+  uint32_t height = 0;
+
+  float sample_spacing = 1.0f; // level 0, world units
+  float height_offset = 0.0f;
+  float height_scale = 1.0f;
+  uint32_t reserved = 0;
+
+  std::array<uint64_t, MAX_LEVELS> level_offsets{};
+
+  [[nodiscard]] uint32_t levelWidth(uint32_t const level) const {
+    return std::max(width >> level, 1U);
+  }
+
+  [[nodiscard]] uint32_t levelHeight(uint32_t const level) const {
+    return std::max(height >> level, 1U);
+  }
+
+  [[nodiscard]] uint32_t tilesX(uint32_t const level) const {
+    return (levelWidth(level) + tile_size - 1) / tile_size;
+  }
+
+  [[nodiscard]] uint32_t tilesY(uint32_t const level) const {
+    return (levelHeight(level) + tile_size - 1) / tile_size;
+  }
+
+  [[nodiscard]] uint64_t tileBytes() const {
+    return uint64_t{tile_size} * tile_size * sizeof(uint16_t);
+  }
+};
+
+/**
+ * Next pyramid level: [1 2 1] tent around every even sample, so coarse
+ * sample i sits exactly on fine sample 2i (clipmap levels stay aligned).
+ */
+inline std::vector<uint16_t> downsampleHeights(std::span<uint16_t const> fine,
+                                               uint32_t const width,
+                                               uint32_t const height) {
+  auto const coarse_width = std::max(width / 2, 1U);
+  auto const coarse_height = std::max(height / 2, 1U);
+  auto at = [&](int64_t x, int64_t y) {
+    x = std::clamp<int64_t>(x, 0, width - 1);
+    y = std::clamp<int64_t>(y, 0, height - 1);
+    return uint32_t{fine[static_cast<size_t>(y) * width + static_cast<size_t>(x)]};
+  };
+
+  static constexpr auto weights = std::array<uint32_t, 3>{1, 2, 1};
+  auto coarse = std::vector<uint16_t>(size_t{coarse_width} * coarse_height);
+  for (auto y = 0U; y < coarse_height; ++y) {
+    for (auto x = 0U; x < coarse_width; ++x) {
+      auto sum = 0U;
+      for (auto j = 0; j < 3; ++j)
+        for (auto i = 0; i < 3; ++i)
+          sum += weights[i] * weights[j] *
+                 at(int64_t{x} * 2 + i - 1, int64_t{y} * 2 + j - 1);
+      coarse[size_t{y} * coarse_width + x] = static_cast<uint16_t>((sum + 8) / 16);
+    }
+  }
+  return coarse;
+}
+
+/**
+ * Build the pyramid from level 0 samples and write it to path, streaming
+ * one level at a time.
+ */
+inline void writeTerrainFile(std::filesystem::path const &path,
+                             TerrainFileHeader header,
+                             std::vector<uint16_t> samples) {
+  if (samples.size() != size_t{header.width} * header.height)
+    throw std::runtime_error(std::format(
+        "{}:{}: {} samples for a {}x{} terrain", __FILE__, __LINE__,
+        samples.size(), header.width, header.height));
+
+  auto const levels = std::min(
+      header.level_count ? header.level_count : TerrainFileHeader::MAX_LEVELS,
+      TerrainFileHeader::MAX_LEVELS);
+  header.level_count = 1;
+  while (header.level_count < levels &&
+         (header.width >> header.level_count) > 0 &&
+         (header.height >> header.level_count) > 0)
+    ++header.level_count;
+
+  auto out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error(
+        std::format("{}:{}: cannot open {}", __FILE__, __LINE__, path.string()));
+
+  auto offset = (sizeof(TerrainFileHeader) + 4095U) / 4096U * 4096U;
+  for (auto level = 0U; level < header.level_count; ++level) {
+    header.level_offsets[level] = offset;
+    offset += header.tileBytes() * header.tilesX(level) * header.tilesY(level);
+  }
+  out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+  auto tile = std::vector<uint16_t>(size_t{header.tile_size} * header.tile_size);
+  for (auto level = 0U; level < header.level_count; ++level) {
+    auto const width = header.levelWidth(level);
+    auto const height = header.levelHeight(level);
+    if (level > 0)
+      samples = downsampleHeights(samples, header.levelWidth(level - 1),
+                                  header.levelHeight(level - 1));
+
+    out.seekp(static_cast<std::streamoff>(header.level_offsets[level]));
+    for (auto ty = 0U; ty < header.tilesY(level); ++ty) {
+      for (auto tx = 0U; tx < header.tilesX(level); ++tx) {
+        for (auto y = 0U; y < header.tile_size; ++y) {
+          auto const sy = std::min(ty * header.tile_size + y, height - 1);
+          for (auto x = 0U; x < header.tile_size; ++x) {
+            auto const sx = std::min(tx * header.tile_size + x, width - 1);
+            tile[size_t{y} * header.tile_size + x] =
+                samples[size_t{sy} * width + sx];
+          }
+        }
+        out.write(reinterpret_cast<char const *>(tile.data()),
+                  static_cast<std::streamsize>(tile.size() * sizeof(uint16_t)));
+      }
+    }
+  }
+
+  if (!out)
+    throw std::runtime_error(std::format("{}:{}: failed writing {}", __FILE__,
+                                         __LINE__, path.string()));
+}
+
+/**
+ * Read access to a terrain file. Files up to wholeMapLimit are mapped
+ * whole with MMapped; larger ones go through an MMappedWindow so only the
+ * neighbourhood of the camera is ever mapped.
+ */
+struct TerrainTiles {
+  static constexpr uintmax_t wholeMapLimit = uintmax_t{4} << 30U;
+
+private:
+  std::optional<MMapped<std::byte>> whole;
+  std::optional<MMappedWindow> windowed;
+
+  std::byte const *bytes(uint64_t const offset, size_t const length) {
+    if (whole)
+      return whole->data().get() + offset;
+    return windowed->view(offset, length);
+  }
+
+public:
+  TerrainFileHeader header;
+
+  explicit TerrainTiles(std::filesystem::path const &path) {
+    auto const file_size = std::filesystem::file_size(path);
+    if (file_size <= wholeMapLimit) {
+      whole.emplace(path);
+    } else {
+      windowed.emplace(path);
+    }
+
+    if (file_size < sizeof(TerrainFileHeader))
+      throw std::runtime_error(std::format(
+          "{}:{}: {} is too small for a terrain", __FILE__, __LINE__,
+          path.string()));
+    std::memcpy(&header, bytes(0, sizeof(header)), sizeof(header));
+
+    if (header.magic != TerrainFileHeader::MAGIC ||
+        header.version != TerrainFileHeader::VERSION ||
+        header.level_count == 0 ||
+        header.level_count > TerrainFileHeader::MAX_LEVELS ||
+        header.tile_size == 0)
+      throw std::runtime_error(std::format(
+          "{}:{}: {} is not a version {} terrain file", __FILE__, __LINE__,
+          path.string(), TerrainFileHeader::VERSION));
+
+    for (auto level = 0U; level < header.level_count; ++level) {
+      if (header.level_offsets[level] + header.tileBytes() *
+                                            header.tilesX(level) *
+                                            header.tilesY(level) >
+          file_size)
+        throw std::runtime_error(std::format("{}:{}: {} level {} is truncated",
+                                             __FILE__, __LINE__, path.string(),
+                                             level));
+    }
+  }
+
+  /**
+   * Copy the width x height rectangle at (x, y) of a level into out (row
+   * major). Samples outside the terrain repeat its border.
+   */
+  void readRect(uint32_t const level, int64_t const x, int64_t const y,
+                uint32_t const width, uint32_t const height,
+                std::span<uint16_t> out) {
+    auto const level_width = int64_t{header.levelWidth(level)};
+    auto const level_height = int64_t{header.levelHeight(level)};
+    auto const tile_size = int64_t{header.tile_size};
+    auto const tiles_x = int64_t{header.tilesX(level)};
+
+    for (auto row = 0U; row < height; ++row) {
+      auto const sy = std::clamp<int64_t>(y + row, 0, level_height - 1);
+      auto *dst = out.data() + size_t{row} * width;
+
+      for (auto col = 0U; col < width;) {
+        auto const sx = std::clamp<int64_t>(x + col, 0, level_width - 1);
+        auto const tx = sx / tile_size;
+        auto const in_tile_x = sx % tile_size;
+
+        // contiguous run inside one tile row (1 sample when clamping)
+        auto run = int64_t{1};
+        if (x + col >= 0 && x + col < level_width)
+          run = std::min({tile_size - in_tile_x, int64_t{width - col},
+                          level_width - sx});
+
+        auto const tile_offset =
+            header.level_offsets[level] +
+            static_cast<uint64_t>((sy / tile_size) * tiles_x + tx) *
+                header.tileBytes();
+        auto const sample_offset =
+            static_cast<uint64_t>((sy % tile_size) * tile_size + in_tile_x) *
+            sizeof(uint16_t);
+        auto const run_bytes = static_cast<size_t>(run) * sizeof(uint16_t);
+        std::memcpy(dst + col, bytes(tile_offset + sample_offset, run_bytes),
+                    run_bytes);
+        col += static_cast<uint32_t>(run);
+      }
+    }
+  }
+};
+
+/* clipmap region bookkeeping */
+
+/**
+ * Clipmap levels hold clipmapSize^2 samples of their pyramid level in a
+ * toroidally addressed texture. Origins move in clipmapSnap steps, so a
+ * finer level always lands on the coarser level's patch grid and the
+ * camera stays at least clipmapSize / 2 - clipmapSnap samples from any
+ * edge.
+ */
+static constexpr auto clipmapSize = 256;
+static constexpr auto clipmapSnap = 32;
+static constexpr auto clipmapPatch = 16; // quads per patch edge
+
+struct ClipRect {
+  int64_t x;
+  int64_t y;
+  uint32_t width;
+  uint32_t height;
+
+  auto operator<=>(ClipRect const &) const = default;
+};
+
+/**
+ * Origin (lowest sample) of a level's region for a camera at the given
+ * level-space sample position
+ */
+inline std::array<int64_t, 2> clipmapOrigin(double const camera_x,
+                                            double const camera_y) {
+  auto snap = [](double const v) {
+    return static_cast<int64_t>(std::floor(v / clipmapSnap)) * clipmapSnap -
+           clipmapSize / 2;
+  };
+  return {snap(camera_x), snap(camera_y)};
+}
+
+/**
+ * Parts of the region at next that are not covered by the region at
+ * previous (nothing resident yet when previous is empty). At most two
+ * rectangles: a band of columns and a band of rows.
+ */
+inline std::vector<ClipRect>
+clipmapDelta(std::optional<std::array<int64_t, 2>> const &previous,
+             std::array<int64_t, 2> const &next) {
+  auto const full = ClipRect{next[0], next[1], clipmapSize, clipmapSize};
+  if (!previous)
+    return {full};
+
+  auto const dx = next[0] - (*previous)[0];
+  auto const dy = next[1] - (*previous)[1];
+  if (std::abs(dx) >= clipmapSize || std::abs(dy) >= clipmapSize)
+    return {full};
+
+  auto rects = std::vector<ClipRect>();
+  if (dx != 0) {
+    rects.push_back({dx > 0 ? next[0] + clipmapSize - dx : next[0], next[1],
+                     static_cast<uint32_t>(std::abs(dx)), clipmapSize});
+  }
+  if (dy != 0) {
+    // columns already covered above are skipped
+    auto const x = dx > 0 ? next[0] : next[0] + std::abs(dx);
+    rects.push_back({x, dy > 0 ? next[1] + clipmapSize - dy : next[1],
+                     static_cast<uint32_t>(clipmapSize - std::abs(dx)),
+                     static_cast<uint32_t>(std::abs(dy))});
+  }
+  return rects;
+}
+
+/**
+ * Split a level-space rectangle at the texture's wrap lines. Each piece
+ * keeps its level-space position; its texel position is the same modulo
+ * clipmapSize.
+ */
+inline std::vector<ClipRect> clipmapWrap(ClipRect const &rect) {
+  auto wrap = [](int64_t const v) {
+    return ((v % clipmapSize) + clipmapSize) % clipmapSize;
+  };
+
+  auto pieces = std::vector<ClipRect>();
+  for (auto y = rect.y; y < rect.y + rect.height;) {
+    auto const h = std::min<int64_t>(clipmapSize - wrap(y),
+                                     rect.y + rect.height - y);
+    for (auto x = rect.x; x < rect.x + rect.width;) {
+      auto const w = std::min<int64_t>(clipmapSize - wrap(x),
+                                       rect.x + rect.width - x);
+      pieces.push_back(
+          {x, y, static_cast<uint32_t>(w), static_cast<uint32_t>(h)});
+      x += w;
+    }
+    y += h;
+  }
+  return pieces;
+}
@@ -0,0 +1,476 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Built-in 5x7 bitmap font for printable ASCII, one byte per column with
+ * the top row in bit 0. Glyphs sit in 6x8 cells of a 16x6 cell R8 atlas;
+ * the last cell is solid and used for untextured rectangles.
+ */
+struct UiFont {
+  static constexpr uint32_t glyphWidth = 5;
+  static constexpr uint32_t glyphHeight = 7;
+  static constexpr uint32_t cellWidth = 6;
+  static constexpr uint32_t cellHeight = 8;
+  static constexpr uint32_t columns = 16;
+  static constexpr uint32_t rows = 6;
+  static constexpr uint32_t atlasWidth = columns * cellWidth;
+  static constexpr uint32_t atlasHeight = rows * cellHeight;
+  static constexpr char first = ' ';
+  static constexpr char last = '~';
+  static constexpr uint32_t solidCell = columns * rows - 1;
+
+  static constexpr std::array<std::array<uint8_t, 5>, last - first + 1>
+      glyphs = {{
+          {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5f, 0x00, 0x00},
+          {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7f, 0x14, 0x7f, 0x14},
+          {0x24, 0x2a, 0x7f, 0x2a, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+          {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+          {0x00, 0x1c, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1c, 0x00},
+          {0x08, 0x2a, 0x1c, 0x2a, 0x08}, {0x08, 0x08, 0x3e, 0x08, 0x08},
+          {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08},
+          {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+          {0x3e, 0x51, 0x49, 0x45, 0x3e}, {0x00, 0x42, 0x7f, 0x40, 0x00},
+          {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4b, 0x31},
+          {0x18, 0x14, 0x12, 0x7f, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39},
+          {0x3c, 0x4a, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+          {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1e},
+          {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+          {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+          {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+          {0x32, 0x49, 0x79, 0x41, 0x3e}, {0x7e, 0x11, 0x11, 0x11, 0x7e},
+          {0x7f, 0x49, 0x49, 0x49, 0x36}, {0x3e, 0x41, 0x41, 0x41, 0x22},
+          {0x7f, 0x41, 0x41, 0x22, 0x1c}, {0x7f, 0x49, 0x49, 0x49, 0x41},
+          {0x7f, 0x09, 0x09, 0x01, 0x01}, {0x3e, 0x41, 0x41, 0x51, 0x32},
+          {0x7f, 0x08, 0x08, 0x08, 0x7f}, {0x00, 0x41, 0x7f, 0x41, 0x00},
+          {0x20, 0x40, 0x41, 0x3f, 0x01}, {0x7f, 0x08, 0x14, 0x22, 0x41},
+          {0x7f, 0x40, 0x40, 0x40, 0x40}, {0x7f, 0x02, 0x04, 0x02, 0x7f},
+          {0x7f, 0x04, 0x08, 0x10, 0x7f}, {0x3e, 0x41, 0x41, 0x41, 0x3e},
+          {0x7f, 0x09, 0x09, 0x09, 0x06}, {0x3e, 0x41, 0x51, 0x21, 0x5e},
+          {0x7f, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+          {0x01, 0x01, 0x7f, 0x01, 0x01}, {0x3f, 0x40, 0x40, 0x40, 0x3f},
+          {0x1f, 0x20, 0x40, 0x20, 0x1f}, {0x7f, 0x20, 0x18, 0x20, 0x7f},
+          {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03},
+          {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7f, 0x41, 0x41, 0x00},
+          {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7f, 0x00},
+          {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+          {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+          {0x7f, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+          {0x38, 0x44, 0x44, 0x48, 0x7f}, {0x38, 0x54, 0x54, 0x54, 0x18},
+          {0x08, 0x7e, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3c},
+          {0x7f, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7d, 0x40, 0x00},
+          {0x20, 0x40, 0x44, 0x3d, 0x00}, {0x00, 0x7f, 0x10, 0x28, 0x44},
+          {0x00, 0x41, 0x7f, 0x40, 0x00}, {0x7c, 0x04, 0x18, 0x04, 0x78},
+          {0x7c, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+          {0x7c, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7c},
+          {0x7c, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+          {0x04, 0x3f, 0x44, 0x40, 0x20}, {0x3c, 0x40, 0x40, 0x20, 0x7c},
+          {0x1c, 0x20, 0x40, 0x20, 0x1c}, {0x3c, 0x40, 0x30, 0x40, 0x3c},
+          {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0c, 0x50, 0x50, 0x50, 0x3c},
+          {0x44, 0x64, 0x54, 0x4c, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+          {0x00, 0x00, 0x7f, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00},
+          {0x02, 0x01, 0x02, 0x04, 0x02},
+      }};
+
+  /**
+   * R8 coverage, atlasWidth x atlasHeight, rows top down
+   */
+  [[nodiscard]] static std::vector<uint8_t> atlas() {
+    auto texels = std::vector<uint8_t>(atlasWidth * atlasHeight, 0);
+    auto const cell_origin = [](uint32_t const cell) {
+      return (cell / columns) * cellHeight * atlasWidth +
+             (cell % columns) * cellWidth;
+    };
+
+    for (auto g = 0U; g < glyphs.size(); ++g) {
+      auto const origin = cell_origin(g);
+      for (auto x = 0U; x < glyphWidth; ++x)
+        for (auto y = 0U; y < glyphHeight; ++y)
+          if ((glyphs[g][x] >> y) & 1U)
+            texels[origin + y * atlasWidth + x] = 0xff;
+    }
+
+    auto const solid = cell_origin(solidCell);
+    for (auto y = 0U; y < cellHeight; ++y)
+      std::fill_n(texels.begin() + solid + y * atlasWidth, cellWidth, 0xff);
+    return texels;
+  }
+};
+
+struct UiRect {
+  float x = 0.0f, y = 0.0f, width = 0.0f, height = 0.0f; // pixels, y down
+
+  [[nodiscard]] bool contains(std::array<float, 2> const &p) const {
+    return p[0] >= x && p[0] < x + width && p[1] >= y && p[1] < y + height;
+  }
+};
+
+struct UiInput {
+  std::array<float, 2> screen{};
+  std::array<float, 2> mouse{};
+  bool mouse_down = false;
+};
+
+/**
+ * Must match the vertex inputs of shaders/ui.vert
+ */
+struct UiVertex {
+  std::array<float, 2> position; // pixels
+  std::array<float, 2> uv;       // atlas texels
+  uint32_t color;                // RGBA8, R in the low byte
+};
+
+/**
+ * One scissored indexed draw
+ */
+struct UiDraw {
+  UiRect clip;
+  uint32_t first_index = 0;
+  uint32_t index_count = 0;
+};
+
+/**
+ * Immediate-mode UI for operator panels.
+ *
+ * Widgets are called every frame between begin() and end() and answer
+ * interaction (clicks, drags) right away, but only record what to draw as
+ * compact shapes. end() hashes the shapes: when the hash matches the
+ * previous frame the vertex and index streams are left alone and
+ * geometryChanged() is false, so neither tessellation nor upload happens.
+ * Otherwise all panels are tessellated into one vertex / index stream with
+ * one draw per clip rectangle.
+ *
+ * Everything lives in buffers sized at construction; a frame that needs
+ * more drops the excess shapes and sets overflowed() instead of
+ * allocating.
+ */
+struct Ui {
+  struct Style {
+    float padding = 6.0f;
+    float spacing = 4.0f;
+    float scale = 2.0f; // font pixels per atlas texel
+    uint32_t panel = 0xe0202020;
+    uint32_t title = 0xff3a3a3a;
+    uint32_t widget = 0xff444444;
+    uint32_t hot = 0xff5a5a5a;
+    uint32_t active = 0xff2f6fb0;
+    uint32_t text = 0xffe6e6e6;
+  };
+
+  static constexpr size_t maxShapes = 4096;
+  static constexpr size_t maxText = 64 * 1024;
+  static constexpr size_t maxClips = 64;
+  static constexpr size_t maxVertices = 65536; // 16-bit indices
+  static constexpr size_t maxIndices = maxVertices / 4 * 6;
+
+private:
+  struct Shape {
+    UiRect rect;
+    uint32_t color = 0;
+    uint32_t text_offset = 0;
+    uint32_t text_length = 0; // 0: solid rectangle
+    uint32_t clip = 0;
+  };
+
+  UiInput input;
+  bool pressed = false; // mouse went down this frame
+  bool wasDown = false;
+  uint64_t hotId = 0;
+  uint64_t activeId = 0; // widget holding the mouse
+
+  std::vector<Shape> shapes;
+  std::vector<char> text;
+  std::vector<UiRect> clips;
+  uint32_t currentClip = 0;
+  std::array<float, 2> cursor{};
+  float rowWidth = 0.0f;
+  uint64_t panelId = 0;
+
+  std::vector<UiVertex> vertexStream;
+  std::vector<uint16_t> indexStream;
+  std::vector<UiDraw> drawList;
+
+  uint64_t lastHash = 0;
+  bool changed = true;
+  bool overflow = false;
+
+public:
+  Style style;
+
+  Ui() {
+    shapes.reserve(maxShapes);
+    text.reserve(maxText);
+    clips.reserve(maxClips);
+    vertexStream.reserve(maxVertices);
+    indexStream.reserve(maxIndices);
+    drawList.reserve(maxShapes);
+  }
+
+  void begin(UiInput const &frame_input) {
+    input = frame_input;
+    pressed = input.mouse_down && !wasDown;
+    if (!input.mouse_down)
+      activeId = 0;
+    wasDown = input.mouse_down;
+    hotId = 0;
+
+    shapes.clear();
+    text.clear();
+    clips.clear();
+    clips.push_back({0.0f, 0.0f, input.screen[0], input.screen[1]});
+    currentClip = 0;
+    overflow = false;
+  }
+
+  /**
+   * Start a panel: background, title bar and a column layout clipped to
+   * rect. Widgets until endPanel() stack below the title.
+   */
+  void beginPanel(std::string_view const title, UiRect const &rect) {
+    panelId = hash(title, 0x9e3779b97f4a7c15ULL);
+    if (clips.size() < maxClips) {
+      clips.push_back(rect);
+      currentClip = static_cast<uint32_t>(clips.size() - 1);
+    }
+
+    auto const line = lineHeight();
+    addShape(rect, style.panel, {});
+    addShape({rect.x, rect.y, rect.width, line + 2 * style.padding},
+             style.title, {});
+    addShape({rect.x + style.padding, rect.y + style.padding, 0.0f, line},
+             style.text, title);
+
+    cursor = {rect.x + style.padding,
+              rect.y + line + 2 * style.padding + style.spacing};
+    rowWidth = rect.width - 2 * style.padding;
+  }
+
+  void endPanel() { currentClip = 0; }
+
+  void label(std::string_view const content) {
+    auto const line = lineHeight();
+    addShape({cursor[0], cursor[1], 0.0f, line}, style.text, content);
+    advance(line);
+  }
+
+  /**
+   * True on the frame the button is clicked
+   */
+  bool button(std::string_view const caption) {
+    auto const rect = nextRow();
+    auto const id = hash(caption, panelId);
+    auto const state = interact(id, rect);
+
+    addShape(rect, widgetColor(id), {});
+    addShape(inset(rect), style.text, caption);
+    return state.clicked;
+  }
+
+  /**
+   * Drag to set value in [lo, hi]; true when value changed
+   */
+  bool slider(std::string_view const caption, float &value, float const lo,
+              float const hi) {
+    auto const rect = nextRow();
+    auto const id = hash(caption, panelId);
+    interact(id, rect);
+
+    auto const before = value;
+    if (activeId == id && rect.width > 0.0f) {
+      auto const t = std::clamp((input.mouse[0] - rect.x) / rect.width, 0.0f,
+                                1.0f);
+      value = lo + t * (hi - lo);
+    }
+    auto const t = hi > lo ? std::clamp((value - lo) / (hi - lo), 0.0f, 1.0f)
+                           : 0.0f;
+
+    addShape(rect, style.widget, {});
+    addShape({rect.x, rect.y, rect.width * t, rect.height}, widgetColor(id),
+             {});
+    addShape(inset(rect), style.text, caption);
+    return value != before;
+  }
+
+  /**
+   * Tessellate the frame's shapes unless they hash the same as last frame
+   */
+  void end() {
+    auto h = hash({}, 0xcbf29ce484222325ULL);
+    h = mix(h, std::as_bytes(std::span(input.screen)));
+    h = mix(h, std::as_bytes(std::span(shapes)));
+    h = mix(h, std::as_bytes(std::span(text)));
+    h = mix(h, std::as_bytes(std::span(clips)));
+
+    changed = h != lastHash || vertexStream.empty();
+    lastHash = h;
+    if (changed)
+      tessellate();
+  }
+
+  [[nodiscard]] bool geometryChanged() const { return changed; }
+  [[nodiscard]] bool overflowed() const { return overflow; }
+  [[nodiscard]] bool wantsMouse() const { return hotId != 0 || activeId != 0; }
+
+  [[nodiscard]] std::span<UiVertex const> vertices() const {
+    return vertexStream;
+  }
+  [[nodiscard]] std::span<uint16_t const> indices() const {
+    return indexStream;
+  }
+  [[nodiscard]] std::span<UiDraw const> draws() const { return drawList; }
+
+  /**
+   * Width in pixels text takes up at the current style
+   */
+  [[nodiscard]] float textWidth(std::string_view const content) const {
+    return static_cast<float>(content.size() * UiFont::cellWidth) *
+           style.scale;
+  }
+
+private:
+  struct Interaction {
+    bool hovered = false;
+    bool clicked = false;
+  };
+
+  [[nodiscard]] float lineHeight() const {
+    return static_cast<float>(UiFont::cellHeight) * style.scale;
+  }
+
+  [[nodiscard]] UiRect nextRow() {
+    auto const height = lineHeight() + 2 * style.padding;
+    auto const rect = UiRect{cursor[0], cursor[1], rowWidth, height};
+    advance(height);
+    return rect;
+  }
+
+  void advance(float const height) { cursor[1] += height + style.spacing; }
+
+  [[nodiscard]] UiRect inset(UiRect const &rect) const {
+    return {rect.x + style.padding, rect.y + style.padding, 0.0f,
+            lineHeight()};
+  }
+
+  Interaction interact(uint64_t const id, UiRect const &rect) {
+    auto const visible = rect.contains(input.mouse) &&
+                         clips[currentClip].contains(input.mouse);
+    if (visible && (activeId == 0 || activeId == id))
+      hotId = id;
+    auto const clicked = visible && pressed && activeId == 0;
+    if (clicked)
+      activeId = id;
+    return {visible, clicked};
+  }
+
+  [[nodiscard]] uint32_t widgetColor(uint64_t const id) const {
+    if (activeId == id)
+      return style.active;
+    return hotId == id ? style.hot : style.widget;
+  }
+
+  void addShape(UiRect const &rect, uint32_t const color,
+                std::string_view const content) {
+    if (shapes.size() == maxShapes ||
+        text.size() + content.size() > maxText) {
+      overflow = true;
+      return;
+    }
+    shapes.push_back({.rect = rect,
+                      .color = color,
+                      .text_offset = static_cast<uint32_t>(text.size()),
+                      .text_length = static_cast<uint32_t>(content.size()),
+                      .clip = currentClip});
+    text.insert(text.end(), content.begin(), content.end());
+  }
+
+  void tessellate() {
+    vertexStream.clear();
+    indexStream.clear();
+    drawList.clear();
+
+    auto const solid_uv = std::array{
+        static_cast<float>((UiFont::solidCell % UiFont::columns) *
+                           UiFont::cellWidth) + 0.5f * UiFont::cellWidth,
+        static_cast<float>((UiFont::solidCell / UiFont::columns) *
+                           UiFont::cellHeight) + 0.5f * UiFont::cellHeight};
+
+    auto quad = [&](UiRect const &r, std::array<float, 2> const &uv0,
+                    std::array<float, 2> const &uv1, uint32_t const color) {
+      if (vertexStream.size() + 4 > maxVertices) {
+        overflow = true;
+        return;
+      }
+      auto const base = static_cast<uint16_t>(vertexStream.size());
+      vertexStream.push_back({{r.x, r.y}, uv0, color});
+      vertexStream.push_back({{r.x + r.width, r.y}, {uv1[0], uv0[1]}, color});
+      vertexStream.push_back(
+          {{r.x + r.width, r.y + r.height}, uv1, color});
+      vertexStream.push_back({{r.x, r.y + r.height}, {uv0[0], uv1[1]}, color});
+      for (auto const corner : {0, 1, 2, 0, 2, 3})
+        indexStream.push_back(static_cast<uint16_t>(base + corner));
+    };
+
+    for (auto const &shape : shapes) {
+      auto const first_index = static_cast<uint32_t>(indexStream.size());
+
+      if (shape.text_length == 0) {
+        quad(shape.rect, solid_uv, solid_uv, shape.color);
+      } else {
+        auto const advance = static_cast<float>(UiFont::cellWidth) * style.scale;
+        auto x = shape.rect.x;
+        for (auto i = 0U; i < shape.text_length; ++i) {
+          auto const c = text[shape.text_offset + i];
+          if (c > UiFont::first && c <= UiFont::last) {
+            auto const cell = static_cast<uint32_t>(c - UiFont::first);
+            auto const u = static_cast<float>((cell % UiFont::columns) *
+                                              UiFont::cellWidth);
+            auto const v = static_cast<float>((cell / UiFont::columns) *
+                                              UiFont::cellHeight);
+            quad({x, shape.rect.y, advance, lineHeight()}, {u, v},
+                 {u + UiFont::cellWidth, v + UiFont::cellHeight}, shape.color);
+          }
+          x += advance;
+        }
+      }
+
+      // consecutive shapes under the same clip share a draw
+      auto const count = static_cast<uint32_t>(indexStream.size()) - first_index;
+      if (count == 0)
+        continue;
+      if (!drawList.empty() && sameClip(drawList.back(), shape.clip)) {
+        drawList.back().index_count += count;
+      } else {
+        drawList.push_back({clips[shape.clip], first_index, count});
+      }
+    }
+  }
+
+  [[nodiscard]] bool sameClip(UiDraw const &draw, uint32_t const clip) const {
+    auto const &c = clips[clip];
+    return draw.clip.x == c.x && draw.clip.y == c.y &&
+           draw.clip.width == c.width && draw.clip.height == c.height;
+  }
+
+  /**
+   * FNV-1a
+   */
+  [[nodiscard]] static uint64_t mix(uint64_t h,
+                                    std::span<std::byte const> const bytes) {
+    for (auto const b : bytes) {
+      h ^= static_cast<uint64_t>(b);
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  [[nodiscard]] static uint64_t hash(std::string_view const s,
+                                     uint64_t const seed) {
+    return mix(seed, std::as_bytes(std::span(s)));
+  }
+};
@@ -0,0 +1,385 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "uiBatch.hpp"
+#include "uploadRing.hpp"
+#include "vulkanCommon.hpp"
+
+/**
+ * Draws a Ui in the overlay: one vertex and one index buffer holding the
+ * whole frame's UI, a single pipeline and descriptor set (the font atlas),
+ * and one scissored drawIndexed per UiDraw. Buffers are sized for
+ * Ui::maxVertices up front and only re-uploaded through the UploadRing on
+ * frames where the UI geometry changed.
+ */
+struct UiRenderer {
+  /**
+   * Must match Params in shaders/ui.vert
+   */
+  struct Params {
+    std::array<float, 2> scale;     // 2 / screen size
+    std::array<float, 2> inv_atlas; // 1 / atlas size
+  };
+
+private:
+  GpuContext context;
+  UploadRing &ring;
+
+  GpuBuffer vertices;
+  GpuBuffer indices;
+
+  vk::Image atlasImage;
+  vk::DeviceMemory atlasMemory;
+  vk::ImageView atlasView;
+  vk::Sampler sampler;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline pipeline;
+
+  vk::Semaphore uploaded;
+
+public:
+  UiRenderer(GpuContext const &gpu_context, UploadRing &upload_ring,
+             VulkanGfxBase::PassTarget const &target)
+      : context{gpu_context}, ring{upload_ring} {
+    auto const device_local =
+        vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eDeviceLocal};
+    vertices = createBuffer(context, Ui::maxVertices * sizeof(UiVertex),
+                            vk::BufferUsageFlagBits::eVertexBuffer |
+                                vk::BufferUsageFlagBits::eTransferDst,
+                            device_local);
+    indices = createBuffer(context, Ui::maxIndices * sizeof(uint16_t),
+                           vk::BufferUsageFlagBits::eIndexBuffer |
+                               vk::BufferUsageFlagBits::eTransferDst,
+                           device_local);
+
+    createAtlas();
+    createDescriptors();
+    createPipeline(target);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+  }
+
+  UiRenderer(UiRenderer const &) = delete;
+  UiRenderer &operator=(UiRenderer const &) = delete;
+  UiRenderer(UiRenderer &&) = delete;
+  UiRenderer &operator=(UiRenderer &&) = delete;
+
+  ~UiRenderer() {
+    ring.waitIdle();
+
+    auto const &device = context.device;
+    device.destroySemaphore(uploaded);
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+    device.destroySampler(sampler);
+    device.destroyImageView(atlasView);
+    device.destroyImage(atlasImage);
+    device.freeMemory(atlasMemory);
+    destroyBuffer(context, vertices);
+    destroyBuffer(context, indices);
+  }
+
+  /**
+   * Upload ui's geometry if it changed since the last frame. Call from the
+   * frame-begin hook after Ui::end(); returns a semaphore for
+   * VulkanGfxBase::waitBeforeNextFrame (vertex input stage) or a null
+   * handle when the previous upload is still current.
+   */
+  vk::Semaphore upload(Ui const &ui) {
+    if (!ui.geometryChanged() || ui.indices().empty())
+      return {};
+
+    ring.copyToBuffer(vertices.buffer, 0, std::as_bytes(ui.vertices()));
+    ring.copyToBuffer(indices.buffer, 0, std::as_bytes(ui.indices()));
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  /**
+   * Draw ui's last uploaded geometry. Viewport must already be set; the
+   * scissor is left covering extent.
+   */
+  void record(vk::CommandBuffer const cmd, Ui const &ui,
+              vk::Extent2D const extent) const {
+    if (ui.draws().empty())
+      return;
+
+    auto const params = Params{
+        .scale = {2.0f / static_cast<float>(extent.width),
+                  2.0f / static_cast<float>(extent.height)},
+        .inv_atlas = {1.0f / UiFont::atlasWidth, 1.0f / UiFont::atlasHeight}};
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+                           descriptorSet, nullptr);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
+                      sizeof(Params), &params);
+    cmd.bindVertexBuffers(0, vertices.buffer, vk::DeviceSize{0});
+    cmd.bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint16);
+
+    auto const to_scissor = [&](UiRect const &clip) {
+      auto const x0 = std::clamp(clip.x, 0.0f, static_cast<float>(extent.width));
+      auto const y0 =
+          std::clamp(clip.y, 0.0f, static_cast<float>(extent.height));
+      auto const x1 = std::clamp(clip.x + clip.width, x0,
+                                 static_cast<float>(extent.width));
+      auto const y1 = std::clamp(clip.y + clip.height, y0,
+                                 static_cast<float>(extent.height));
+      return vk::Rect2D(
+          vk::Offset2D(static_cast<int32_t>(x0), static_cast<int32_t>(y0)),
+          vk::Extent2D(static_cast<uint32_t>(x1 - x0),
+                       static_cast<uint32_t>(y1 - y0)));
+    };
+
+    for (auto const &draw : ui.draws()) {
+      cmd.setScissor(0, to_scissor(draw.clip));
+      cmd.drawIndexed(draw.index_count, 1, draw.first_index, 0, 0);
+    }
+    cmd.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+  }
+
+  /**
+   * Rebuild the pipeline against a new overlay target, see
+   * VulkanGfxBase::setTargetsRebuiltHook
+   */
+  void recreatePipeline(VulkanGfxBase::PassTarget const &target) {
+    context.device.destroyPipeline(pipeline);
+    pipeline = nullptr;
+    createPipeline(target);
+  }
+
+private:
+  void createAtlas() {
+    auto const &device = context.device;
+
+    auto families = std::vector<uint32_t>{context.graphics_family};
+    if (context.transfer_family != context.graphics_family)
+      families.push_back(context.transfer_family);
+
+    auto image_info = vk::ImageCreateInfo();
+    image_info.imageType = vk::ImageType::e2D;
+    image_info.format = vk::Format::eR8Unorm;
+    image_info.extent = vk::Extent3D(UiFont::atlasWidth, UiFont::atlasHeight, 1);
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = vk::SampleCountFlagBits::e1;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage =
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    if (families.size() > 1) {
+      image_info.sharingMode = vk::SharingMode::eConcurrent;
+      image_info.setQueueFamilyIndices(families);
+    } else {
+      image_info.sharingMode = vk::SharingMode::eExclusive;
+    }
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+
+    atlasImage = device.createImage(image_info);
+    if (!atlasImage) {
+      throw std::runtime_error("failed to create UI atlas image");
+    }
+
+    auto const requirements = device.getImageMemoryRequirements(atlasImage);
+    atlasMemory = device.allocateMemory(vk::MemoryAllocateInfo(
+        requirements.size,
+        findMemoryType(context.physical_device, requirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    if (!atlasMemory) {
+      throw std::runtime_error("failed to allocate UI atlas memory");
+    }
+    device.bindImageMemory(atlasImage, atlasMemory, 0);
+
+    auto const range =
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    auto view_info = vk::ImageViewCreateInfo();
+    view_info.image = atlasImage;
+    view_info.viewType = vk::ImageViewType::e2D;
+    view_info.format = vk::Format::eR8Unorm;
+    view_info.subresourceRange = range;
+    atlasView = device.createImageView(view_info);
+    if (!atlasView) {
+      throw std::runtime_error("failed to create UI atlas view");
+    }
+
+    // texel-exact pixel font; uvs are in texels
+    auto sampler_info = vk::SamplerCreateInfo(
+        {}, vk::Filter::eNearest, vk::Filter::eNearest,
+        vk::SamplerMipmapMode::eNearest, vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge);
+    sampler = device.createSampler(sampler_info);
+    if (!sampler) {
+      throw std::runtime_error("failed to create UI sampler");
+    }
+
+    // the atlas stays in GENERAL: written once by a copy, then sampled
+    auto barrier = vk::ImageMemoryBarrier();
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eGeneral;
+    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.image = atlasImage;
+    barrier.subresourceRange = range;
+    ring.batch().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                 vk::PipelineStageFlagBits::eTransfer, {},
+                                 nullptr, nullptr, barrier);
+
+    auto const texels = UiFont::atlas();
+    auto const staged = ring.writeImage(
+        atlasImage, vk::ImageLayout::eGeneral,
+        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+        vk::Offset3D(0, 0, 0),
+        vk::Extent3D(UiFont::atlasWidth, UiFont::atlasHeight, 1),
+        sizeof(uint8_t));
+    std::memcpy(staged.data(), texels.data(), texels.size());
+
+    ring.waitIdle();
+  }
+
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto const binding = vk::DescriptorSetLayoutBinding(
+        0, vk::DescriptorType::eCombinedImageSampler, 1,
+        vk::ShaderStageFlagBits::eFragment);
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, binding));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create UI descriptor set layout");
+    }
+
+    auto const pool_size =
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1);
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 1, pool_size));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create UI descriptor pool");
+    }
+    descriptorSet = device
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo(
+                            descriptorPool, setLayout))
+                        .front();
+
+    auto const image_info = vk::DescriptorImageInfo(
+        sampler, atlasView, vk::ImageLayout::eGeneral);
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet(descriptorSet, 0, 0,
+                               vk::DescriptorType::eCombinedImageSampler,
+                               image_info),
+        nullptr);
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex, 0, sizeof(Params));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create UI pipeline layout");
+    }
+  }
+
+  void createPipeline(VulkanGfxBase::PassTarget const &target) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/ui.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/ui.frag.spv"
+    };
+
+    auto const &device = context.device;
+
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    auto const vertex_binding = vk::VertexInputBindingDescription(
+        0, sizeof(UiVertex), vk::VertexInputRate::eVertex);
+    auto const vertex_attributes = std::array{
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat,
+                                            offsetof(UiVertex, position)),
+        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat,
+                                            offsetof(UiVertex, uv)),
+        vk::VertexInputAttributeDescription(2, 0, vk::Format::eR8G8B8A8Unorm,
+                                            offsetof(UiVertex, color))};
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo(
+        {}, vertex_binding, vertex_attributes);
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f;
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    // overlay: no depth
+    auto const depth = vk::PipelineDepthStencilStateCreateInfo();
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.blendEnable = vk::Bool32{true};
+    color_blend_attachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+    color_blend_attachment.dstColorBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.colorBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.dstAlphaBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipelineLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create UI pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    pipeline = pipeline_result.value;
+  }
+};
@@ -0,0 +1,42 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Non-blocking listening Unix stream socket at path, readable by the user
+ * only. A socket file left behind by an earlier run is replaced.
+ */
+[[nodiscard]] inline int listenUnixSocket(std::filesystem::path const &path) {
+  auto address = sockaddr_un{.sun_family = AF_UNIX, .sun_path = {}};
+  if (path.native().size() >= sizeof(address.sun_path))
+    throw std::runtime_error(std::format("{}:{}: socket path too long: {}",
+                                         __FILE__, __LINE__, path.native()));
+  std::ranges::copy(path.native(), address.sun_path);
+
+  if (std::filesystem::is_socket(path))
+    std::filesystem::remove(path);
+
+  auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1 ||
+      bind(fd, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) ==
+          -1 ||
+      chmod(path.c_str(), S_IRUSR | S_IWUSR) == -1 || listen(fd, 16) == -1) {
+    auto const error = errno;
+    if (fd != -1)
+      close(fd);
+    throw std::runtime_error(std::format("{}:{}: socket {}: {}", __FILE__,
+                                         __LINE__, path.native(),
+                                         strerror(error)));
+  }
+  return fd;
+}
@@ -0,0 +1,261 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "../args.hpp"
+#include "vulkanBuffer.hpp"
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <span>
+
+/**
+ * Persistently mapped staging ring for copies through the transfer queue.
+ * copyToBuffer() / writeImage() stage data and record the copy into the
+ * open batch; flush() submits the batch. Ring space is reclaimed in submission order
+ * as each batch's fence signals, so uploads larger than the ring simply
+ * stall until earlier batches retire.
+ */
+struct UploadRing {
+private:
+  GpuContext context;
+  GpuBuffer staging;
+  vk::DeviceSize chunkLimit; // largest single copy
+  vk::CommandPool commandPool;
+
+  vk::DeviceSize head = 0; // next free byte
+  vk::DeviceSize used = 0; // staged bytes not yet retired, incl. wrap gaps
+
+  struct Batch {
+    vk::CommandBuffer cmd;
+    vk::Fence fence;
+    vk::DeviceSize bytes = 0;
+  };
+  Batch open;                  // recording, not yet submitted
+  std::deque<Batch> inFlight;  // submitted, oldest first
+  std::vector<Batch> spare;    // retired, ready for reuse
+
+public:
+  /**
+   * max_chunk bounds the copies copyToBuffer() splits data into (e.g. the
+   * autotuned DeviceTuning::upload_chunk); 0 or more than half the ring
+   * means half the ring
+   */
+  UploadRing(GpuContext const &gpu_context, vk::DeviceSize const capacity,
+             vk::DeviceSize const max_chunk = 0)
+      : context{gpu_context},
+        chunkLimit{max_chunk > 0 ? std::min(max_chunk, capacity / 2)
+                                 : capacity / 2} {
+    staging = createBuffer(context, capacity,
+                           vk::BufferUsageFlagBits::eTransferSrc,
+                           vk::MemoryPropertyFlagBits::eHostVisible |
+                               vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    auto pool_info = vk::CommandPoolCreateInfo();
+    pool_info.queueFamilyIndex = context.transfer_family;
+    pool_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer |
+                      vk::CommandPoolCreateFlagBits::eTransient;
+    commandPool = context.device.createCommandPool(pool_info);
+    if (!commandPool) {
+      throw std::runtime_error(std::format(
+          "{}:{}: failed to create upload command pool", __FILE__, __LINE__));
+    }
+  }
+
+  UploadRing(UploadRing const &) = delete;
+  UploadRing &operator=(UploadRing const &) = delete;
+  UploadRing(UploadRing &&) = delete;
+  UploadRing &operator=(UploadRing &&) = delete;
+
+  ~UploadRing() {
+    waitIdle();
+
+    for (auto &batch : spare) {
+      context.device.destroyFence(batch.fence);
+    }
+    if (open.fence) {
+      context.device.destroyFence(open.fence);
+    }
+    context.device.destroyCommandPool(commandPool);
+    destroyBuffer(context, staging);
+  }
+
+  [[nodiscard]] vk::DeviceSize capacity() const { return staging.size; }
+
+  /**
+   * Stage data and record a copy into dst at dst_offset. data may be larger
+   * than the ring; it is split and the ring is cycled as needed.
+   */
+  void copyToBuffer(vk::Buffer const dst, vk::DeviceSize const dst_offset,
+                    std::span<std::byte const> data) {
+    for (auto done = vk::DeviceSize{0}; done < data.size();) {
+      auto const chunk = std::min<vk::DeviceSize>(data.size() - done,
+                                                  chunkLimit);
+      auto const offset = allocate(chunk, 4);
+      std::memcpy(static_cast<std::byte *>(staging.mapped) + offset,
+                  data.data() + done, chunk);
+
+      openBatch().copyBuffer(staging.buffer, dst,
+                             vk::BufferCopy(offset, dst_offset + done, chunk));
+      done += chunk;
+    }
+  }
+
+  /**
+   * Stage a width x height x texel_size region for a copy into image at
+   * offset (layer given by subresource) and return the staging memory to
+   * fill. The copy reads it at submission, so it must be filled before the
+   * next flush().
+   */
+  std::span<std::byte> writeImage(vk::Image const image,
+                                  vk::ImageLayout const layout,
+                                  vk::ImageSubresourceLayers const &subresource,
+                                  vk::Offset3D const offset,
+                                  vk::Extent3D const extent,
+                                  uint32_t const texel_size) {
+    auto const size = vk::DeviceSize{extent.width} * extent.height *
+                      extent.depth * texel_size;
+    auto const staging_offset = allocate(size, 16);
+
+    auto region = vk::BufferImageCopy();
+    region.bufferOffset = staging_offset;
+    region.imageSubresource = subresource;
+    region.imageOffset = offset;
+    region.imageExtent = extent;
+    openBatch().copyBufferToImage(staging.buffer, image, layout, region);
+
+    return {static_cast<std::byte *>(staging.mapped) + staging_offset,
+            static_cast<size_t>(size)};
+  }
+
+  /**
+   * The open batch's command buffer, for barriers around the copies
+   */
+  vk::CommandBuffer batch() { return openBatch(); }
+
+  /**
+   * Submit the open batch, if any, without waiting for it. With signal,
+   * the semaphore is signalled when the batch completes (hand it to
+   * VulkanGfxBase::waitBeforeNextFrame); returns whether anything was
+   * submitted, i.e. whether signal will be signalled.
+   */
+  bool flush(vk::Semaphore signal = {}) {
+    if (!open.cmd)
+      return false;
+
+    open.cmd.end();
+
+    auto submit_info = vk::SubmitInfo();
+    submit_info.setCommandBuffers(open.cmd);
+    if (signal) {
+      submit_info.setSignalSemaphores(signal);
+    }
+    context.transfer_queue.submit(submit_info, open.fence);
+
+    inFlight.push_back(open);
+    open = Batch{};
+    return true;
+  }
+
+  /**
+   * Flush and block until every submitted copy has completed
+   */
+  void waitIdle() {
+    flush();
+    while (!inFlight.empty()) {
+      retireOldest();
+    }
+  }
+
+private:
+  void retireOldest() {
+    auto &batch = inFlight.front();
+    if (context.device.waitForFences(batch.fence, vk::Bool32{true},
+                                     UINT64_MAX) != vk::Result::eSuccess) {
+      throw std::runtime_error(std::format(
+          "{}:{}: failed to wait for upload fence", __FILE__, __LINE__));
+    }
+    context.device.resetFences(batch.fence);
+
+    used -= batch.bytes;
+    batch.bytes = 0;
+    spare.push_back(batch);
+    inFlight.pop_front();
+
+    if (used == 0)
+      head = 0;
+  }
+
+  vk::CommandBuffer openBatch() {
+    if (open.cmd)
+      return open.cmd;
+
+    // allocate() has already charged the staged bytes to the open batch
+    auto const bytes = open.bytes;
+    if (!spare.empty()) {
+      open = spare.back();
+      spare.pop_back();
+      open.cmd.reset();
+    } else {
+      auto alloc_info = vk::CommandBufferAllocateInfo();
+      alloc_info.commandPool = commandPool;
+      alloc_info.level = vk::CommandBufferLevel::ePrimary;
+      alloc_info.commandBufferCount = 1;
+      open.cmd = context.device.allocateCommandBuffers(alloc_info).front();
+      open.fence = context.device.createFence(vk::FenceCreateInfo());
+    }
+    open.bytes = bytes;
+
+    open.cmd.begin(vk::CommandBufferBeginInfo(
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    return open.cmd;
+  }
+
+  /**
+   * Reserve size bytes of the ring, wrapping to the start when the tail end
+   * is too short. Retires (or flushes) earlier batches until there is room.
+   */
+  vk::DeviceSize allocate(vk::DeviceSize const size,
+                          vk::DeviceSize const alignment) {
+    if (size > staging.size) {
+      throw std::runtime_error(std::format(
+          "{}:{}: {} bytes do not fit the {} byte upload ring", __FILE__,
+          __LINE__, size, staging.size));
+    }
+
+    // retire whatever already finished without blocking
+    while (!inFlight.empty() &&
+           context.device.getFenceStatus(inFlight.front().fence) ==
+               vk::Result::eSuccess) {
+      retireOldest();
+    }
+
+    for (;;) {
+      auto const aligned = (head + alignment - 1) / alignment * alignment;
+      auto const wraps = aligned + size > staging.size;
+      auto const offset = wraps ? vk::DeviceSize{0} : aligned;
+      auto const needed = wraps ? staging.size - head + size
+                                : aligned - head + size;
+
+      if (staging.size - used >= needed) {
+        head = offset + size;
+        used += needed;
+        open.bytes += needed;
+        return offset;
+      }
+
+      if (!inFlight.empty()) {
+        retireOldest();
+      } else if (open.cmd) {
+        if (Args::verbose() > 0) {
+          std::cerr << std::format("{}:{}: upload ring full, flushing\n",
+                                   __FILE__, __LINE__);
+        }
+        flush();
+      } else {
+        // nothing outstanding: the ring is empty
+        head = 0;
+        used = 0;
+      }
+    }
+  }
+};
@@ -0,0 +1,468 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using PathPoint = std::array<float, 2>;
+
+/**
+ * 2D affine transform: x' = xx x + xy y + tx, y' = yx x + yy y + ty
+ */
+struct Affine2 {
+  float xx = 1.0f;
+  float xy = 0.0f;
+  float yx = 0.0f;
+  float yy = 1.0f;
+  float tx = 0.0f;
+  float ty = 0.0f;
+
+  [[nodiscard]] static constexpr Affine2 translation(float const x,
+                                                     float const y) {
+    return {.tx = x, .ty = y};
+  }
+
+  [[nodiscard]] static Affine2 rotationScale(float const radians,
+                                             float const scale) {
+    auto const c = std::cos(radians) * scale;
+    auto const s = std::sin(radians) * scale;
+    return {.xx = c, .xy = -s, .yx = s, .yy = c};
+  }
+
+  [[nodiscard]] constexpr PathPoint apply(PathPoint const &p) const {
+    return {xx * p[0] + xy * p[1] + tx, yx * p[0] + yy * p[1] + ty};
+  }
+
+  /**
+   * this after other
+   */
+  [[nodiscard]] constexpr Affine2 operator*(Affine2 const &other) const {
+    return {.xx = xx * other.xx + xy * other.yx,
+            .xy = xx * other.xy + xy * other.yy,
+            .yx = yx * other.xx + yy * other.yx,
+            .yy = yx * other.xy + yy * other.yy,
+            .tx = xx * other.tx + xy * other.ty + tx,
+            .ty = yx * other.tx + yy * other.ty + ty};
+  }
+};
+
+/**
+ * Triangles in path space, ready for VectorRenderer::add()
+ */
+struct VectorMesh {
+  std::vector<PathPoint> vertices;
+  std::vector<uint32_t> indices;
+
+  void clear() {
+    vertices.clear();
+    indices.clear();
+  }
+};
+
+/**
+ * A path of contours built from lines and quadratic / cubic Béziers, and
+ * its tessellation into triangles. Tessellation is meant to run once per
+ * path (at load time, or when the path itself changes): the result is
+ * uploaded once and placed each frame by a transform only.
+ *
+ * Curves are flattened with Wang's formula to within a tolerance in path
+ * units. Fills are tessellated by sweeping horizontal bands between vertex
+ * heights and emitting one trapezoid per inside span, which handles holes,
+ * self-intersections and both fill rules without a stencil buffer.
+ */
+struct VectorPath {
+  enum class FillRule : uint8_t { NonZero, EvenOdd };
+  enum class Cap : uint8_t { Butt, Square };
+
+  struct Contour {
+    uint32_t first = 0;
+    uint32_t count = 0;
+    bool closed = false;
+  };
+
+  /**
+   * Flattened contours; every contour is a run of points
+   */
+  struct Polyline {
+    std::vector<PathPoint> points;
+    std::vector<Contour> contours;
+  };
+
+  struct Stroke {
+    float width = 1.0f;
+    Cap cap = Cap::Butt;
+    float miter_limit = 4.0f; // miter length / width beyond which to bevel
+  };
+
+private:
+  enum class Verb : uint8_t { Move, Line, Quad, Cubic, Close };
+
+  std::vector<Verb> verbs;
+  std::vector<PathPoint> points;
+
+  static constexpr uint32_t maxCurveSegments = 256;
+  /* band splits to resolve crossing edges, and the height they stop at */
+  static constexpr uint32_t maxBandDepth = 12;
+  static constexpr float minBandHeight = 1e-4f;
+  /* edges meeting at a band corner may disagree by rounding this much */
+  static constexpr float crossingSlack = 1e-4f;
+
+public:
+  VectorPath &moveTo(float const x, float const y) {
+    verbs.push_back(Verb::Move);
+    points.push_back({x, y});
+    return *this;
+  }
+
+  VectorPath &lineTo(float const x, float const y) {
+    verbs.push_back(Verb::Line);
+    points.push_back({x, y});
+    return *this;
+  }
+
+  VectorPath &quadTo(float const cx, float const cy, float const x,
+                     float const y) {
+    verbs.push_back(Verb::Quad);
+    points.push_back({cx, cy});
+    points.push_back({x, y});
+    return *this;
+  }
+
+  VectorPath &cubicTo(float const c1x, float const c1y, float const c2x,
+                      float const c2y, float const x, float const y) {
+    verbs.push_back(Verb::Cubic);
+    points.push_back({c1x, c1y});
+    points.push_back({c2x, c2y});
+    points.push_back({x, y});
+    return *this;
+  }
+
+  VectorPath &close() {
+    verbs.push_back(Verb::Close);
+    return *this;
+  }
+
+  VectorPath &rect(float const x, float const y, float const width,
+                   float const height) {
+    return moveTo(x, y)
+        .lineTo(x + width, y)
+        .lineTo(x + width, y + height)
+        .lineTo(x, y + height)
+        .close();
+  }
+
+  /**
+   * Circle from four cubics (radial error ~0.03%)
+   */
+  VectorPath &circle(float const cx, float const cy, float const r) {
+    auto const k = 0.5522847498f * r;
+    return moveTo(cx + r, cy)
+        .cubicTo(cx + r, cy + k, cx + k, cy + r, cx, cy + r)
+        .cubicTo(cx - k, cy + r, cx - r, cy + k, cx - r, cy)
+        .cubicTo(cx - r, cy - k, cx - k, cy - r, cx, cy - r)
+        .cubicTo(cx + k, cy - r, cx + r, cy - k, cx + r, cy)
+        .close();
+  }
+
+  [[nodiscard]] bool empty() const { return verbs.empty(); }
+
+  /**
+   * Curves become line segments deviating at most tolerance from them
+   */
+  [[nodiscard]] Polyline flatten(float const tolerance) const {
+    auto result = Polyline();
+    auto const begin_contour = [&](PathPoint const &p) {
+      result.contours.push_back(
+          {static_cast<uint32_t>(result.points.size()), 0, false});
+      result.points.push_back(p);
+    };
+    auto const add = [&](PathPoint const &p) {
+      if (result.contours.empty())
+        begin_contour({0.0f, 0.0f});
+      result.points.push_back(p);
+    };
+    auto const current = [&] {
+      return result.points.empty() ? PathPoint{} : result.points.back();
+    };
+    auto const segments = [&](float const second_difference,
+                              float const degree_factor) {
+      auto const n = std::ceil(
+          std::sqrt(degree_factor * second_difference / tolerance));
+      return std::clamp(static_cast<uint32_t>(n), 1U, maxCurveSegments);
+    };
+
+    auto p = points.begin();
+    for (auto const verb : verbs) {
+      switch (verb) {
+      case Verb::Move:
+        begin_contour(*p++);
+        break;
+      case Verb::Line:
+        add(*p++);
+        break;
+      case Verb::Quad: {
+        auto const p0 = current();
+        auto const p1 = *p++;
+        auto const p2 = *p++;
+        auto const n = segments(
+            length(p0[0] - 2 * p1[0] + p2[0], p0[1] - 2 * p1[1] + p2[1]),
+            0.25f);
+        for (auto i = 1U; i <= n; ++i) {
+          auto const t = static_cast<float>(i) / static_cast<float>(n);
+          auto const u = 1.0f - t;
+          add({u * u * p0[0] + 2 * u * t * p1[0] + t * t * p2[0],
+               u * u * p0[1] + 2 * u * t * p1[1] + t * t * p2[1]});
+        }
+        break;
+      }
+      case Verb::Cubic: {
+        auto const p0 = current();
+        auto const p1 = *p++;
+        auto const p2 = *p++;
+        auto const p3 = *p++;
+        auto const dd = std::max(
+            length(p0[0] - 2 * p1[0] + p2[0], p0[1] - 2 * p1[1] + p2[1]),
+            length(p1[0] - 2 * p2[0] + p3[0], p1[1] - 2 * p2[1] + p3[1]));
+        auto const n = segments(dd, 0.75f);
+        for (auto i = 1U; i <= n; ++i) {
+          auto const t = static_cast<float>(i) / static_cast<float>(n);
+          auto const u = 1.0f - t;
+          auto const b0 = u * u * u;
+          auto const b1 = 3 * u * u * t;
+          auto const b2 = 3 * u * t * t;
+          auto const b3 = t * t * t;
+          add({b0 * p0[0] + b1 * p1[0] + b2 * p2[0] + b3 * p3[0],
+               b0 * p0[1] + b1 * p1[1] + b2 * p2[1] + b3 * p3[1]});
+        }
+        break;
+      }
+      case Verb::Close:
+        if (!result.contours.empty()) {
+          auto &contour = result.contours.back();
+          contour.closed = true;
+          // a later segment without moveTo starts where this one began
+          auto const start = result.points[contour.first];
+          contour.count =
+              static_cast<uint32_t>(result.points.size()) - contour.first;
+          begin_contour(start);
+        }
+        break;
+      }
+      if (!result.contours.empty()) {
+        auto &contour = result.contours.back();
+        contour.count =
+            static_cast<uint32_t>(result.points.size()) - contour.first;
+      }
+    }
+
+    // drop lone points (moveTo without segments, the tail after close)
+    std::erase_if(result.contours,
+                  [](Contour const &contour) { return contour.count < 2; });
+    return result;
+  }
+
+  /**
+   * Append the interior of the path (contours implicitly closed) to mesh
+   */
+  void fill(VectorMesh &mesh, FillRule const rule = FillRule::NonZero,
+            float const tolerance = 0.25f) const {
+    fillPolyline(flatten(tolerance), mesh, rule);
+  }
+
+  /**
+   * Append the outline of the path, width wide, to mesh
+   */
+  void stroke(VectorMesh &mesh, Stroke const &style,
+              float const tolerance = 0.25f) const {
+    strokePolyline(flatten(tolerance), mesh, style);
+  }
+
+  static void fillPolyline(Polyline const &polyline, VectorMesh &mesh,
+                           FillRule const rule) {
+    struct Edge {
+      float x0, y0, x1, y1; // y0 < y1
+      int winding;
+    };
+
+    auto edges = std::vector<Edge>();
+    auto heights = std::vector<float>();
+    for (auto const &contour : polyline.contours) {
+      for (auto i = 0U; i < contour.count; ++i) {
+        auto const &a = polyline.points[contour.first + i];
+        auto const &b =
+            polyline.points[contour.first + (i + 1) % contour.count];
+        heights.push_back(a[1]);
+        if (a[1] == b[1])
+          continue; // horizontal edges bound no span
+        if (a[1] < b[1]) {
+          edges.push_back({a[0], a[1], b[0], b[1], 1});
+        } else {
+          edges.push_back({b[0], b[1], a[0], a[1], -1});
+        }
+      }
+    }
+    if (edges.empty())
+      return;
+
+    std::ranges::sort(heights);
+    heights.erase(std::unique(heights.begin(), heights.end()), heights.end());
+    std::ranges::sort(edges, {}, &Edge::y0);
+
+    struct Crossing {
+      float top, bottom, middle;
+      int winding;
+    };
+    auto crossings = std::vector<Crossing>();
+    auto active = std::vector<Edge const *>();
+
+    auto const inside = [rule](int const winding) {
+      return rule == FillRule::NonZero ? winding != 0 : (winding & 1) != 0;
+    };
+    auto const x_at = [](Edge const &e, float const y) {
+      return e.x0 + (e.x1 - e.x0) * (y - e.y0) / (e.y1 - e.y0);
+    };
+
+    // spans of one band, split further while edges cross inside it
+    auto const band = [&](auto const &self, float const top,
+                          float const bottom, uint32_t const depth) -> void {
+      auto const middle = 0.5f * (top + bottom);
+      crossings.clear();
+      for (auto const *e : active)
+        crossings.push_back(
+            {x_at(*e, top), x_at(*e, bottom), x_at(*e, middle), e->winding});
+      std::ranges::sort(crossings, {}, &Crossing::middle);
+
+      auto crossed = false;
+      for (auto i = size_t{1}; i < crossings.size(); ++i)
+        crossed = crossed ||
+                  crossings[i].top < crossings[i - 1].top - crossingSlack ||
+                  crossings[i].bottom < crossings[i - 1].bottom - crossingSlack;
+      if (crossed && depth < maxBandDepth &&
+          bottom - top > minBandHeight) {
+        self(self, top, middle, depth + 1);
+        self(self, middle, bottom, depth + 1);
+        return;
+      }
+
+      auto winding = 0;
+      auto left = Crossing();
+      for (auto const &c : crossings) {
+        auto const was_inside = inside(winding);
+        winding += c.winding;
+        if (!was_inside && inside(winding)) {
+          left = c;
+        } else if (was_inside && !inside(winding)) {
+          auto const base = static_cast<uint32_t>(mesh.vertices.size());
+          mesh.vertices.push_back({left.top, top});
+          mesh.vertices.push_back({c.top, top});
+          mesh.vertices.push_back({c.bottom, bottom});
+          mesh.vertices.push_back({left.bottom, bottom});
+          for (auto const index : {0U, 1U, 2U, 0U, 2U, 3U})
+            mesh.indices.push_back(base + index);
+        }
+      }
+    };
+
+    auto next = size_t{0};
+    for (auto h = size_t{1}; h < heights.size(); ++h) {
+      auto const top = heights[h - 1];
+      auto const bottom = heights[h];
+      std::erase_if(active, [top](Edge const *e) { return e->y1 <= top; });
+      while (next < edges.size() && edges[next].y0 <= top)
+        active.push_back(&edges[next++]);
+      if (!active.empty())
+        band(band, top, bottom, 0);
+    }
+  }
+
+  static void strokePolyline(Polyline const &polyline, VectorMesh &mesh,
+                             Stroke const &style) {
+    auto const half = 0.5f * style.width;
+    auto const add_vertex = [&](float const x, float const y) {
+      mesh.vertices.push_back({x, y});
+      return static_cast<uint32_t>(mesh.vertices.size() - 1);
+    };
+    auto const add_triangle = [&](uint32_t const a, uint32_t const b,
+                                  uint32_t const c) {
+      mesh.indices.insert(mesh.indices.end(), {a, b, c});
+    };
+
+    for (auto const &contour : polyline.contours) {
+      auto const *p = polyline.points.data() + contour.first;
+      auto count = contour.count;
+      // a closed contour that repeats its start needs no closing segment
+      if (contour.closed && count > 2 && p[0] == p[count - 1])
+        --count;
+      auto const segments = contour.closed ? count : count - 1;
+
+      auto const direction = [&](uint32_t const i) {
+        auto const &a = p[i % count];
+        auto const &b = p[(i + 1) % count];
+        auto const dx = b[0] - a[0];
+        auto const dy = b[1] - a[1];
+        auto const len = length(dx, dy);
+        return len > 0.0f ? PathPoint{dx / len, dy / len} : PathPoint{};
+      };
+
+      for (auto i = 0U; i < segments; ++i) {
+        auto a = p[i];
+        auto b = p[(i + 1) % count];
+        auto const d = direction(i);
+        if (d == PathPoint{})
+          continue;
+        if (!contour.closed && style.cap == Cap::Square) {
+          if (i == 0)
+            a = {a[0] - d[0] * half, a[1] - d[1] * half};
+          if (i + 1 == segments)
+            b = {b[0] + d[0] * half, b[1] + d[1] * half};
+        }
+        auto const nx = -d[1] * half;
+        auto const ny = d[0] * half;
+        auto const a0 = add_vertex(a[0] + nx, a[1] + ny);
+        auto const a1 = add_vertex(a[0] - nx, a[1] - ny);
+        auto const b0 = add_vertex(b[0] + nx, b[1] + ny);
+        auto const b1 = add_vertex(b[0] - nx, b[1] - ny);
+        add_triangle(a0, b0, b1);
+        add_triangle(a0, b1, a1);
+      }
+
+      // joins: fill the wedge on the outside of each turn
+      auto const first_join = contour.closed ? 0U : 1U;
+      auto const joins = contour.closed ? count : count - 1;
+      for (auto j = first_join; j < joins; ++j) {
+        auto const in = direction((j + count - 1) % count);
+        auto const out = direction(j);
+        auto const turn = in[0] * out[1] - in[1] * out[0];
+        if (turn == 0.0f || in == PathPoint{} || out == PathPoint{})
+          continue;
+        // the outside of a turn is the side it turns away from
+        auto const side = turn > 0.0f ? -half : half;
+        auto const &c = p[j];
+        auto const center = add_vertex(c[0], c[1]);
+        auto const from = add_vertex(c[0] - in[1] * side, c[1] + in[0] * side);
+        auto const to = add_vertex(c[0] - out[1] * side, c[1] + out[0] * side);
+        add_triangle(center, from, to);
+
+        // miter tip where the two offset edges meet
+        auto const cos_turn = in[0] * out[0] + in[1] * out[1];
+        auto const miter = 1.0f / std::sqrt(0.5f * (1.0f + cos_turn));
+        if (miter <= style.miter_limit) {
+          auto const mx = -(in[1] + out[1]);
+          auto const my = in[0] + out[0];
+          auto const scale = side * miter / length(mx, my);
+          auto const tip = add_vertex(c[0] + mx * scale, c[1] + my * scale);
+          add_triangle(from, tip, to);
+        }
+      }
+    }
+  }
+
+private:
+  [[nodiscard]] static float length(float const x, float const y) {
+    return std::sqrt(x * x + y * y);
+  }
+};
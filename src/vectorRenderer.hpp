@@ -0,0 +1,440 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "uploadRing.hpp"
+#include "vectorPath.hpp"
+#include "vulkanCommon.hpp"
+
+/**
+ * Fill for a path: a solid colour or a linear / radial gradient between
+ * two colours, in path space. Colours are straight-alpha RGBA.
+ */
+struct VectorPaint {
+  enum class Kind : uint32_t { Solid, Linear, Radial };
+
+  Kind kind = Kind::Solid;
+  std::array<float, 4> color0{1.0f, 1.0f, 1.0f, 1.0f};
+  std::array<float, 4> color1{1.0f, 1.0f, 1.0f, 1.0f};
+  std::array<float, 4> gradient{}; // linear: x0 y0 x1 y1, radial: cx cy r
+
+  [[nodiscard]] static VectorPaint solid(std::array<float, 4> const &color) {
+    return {.kind = Kind::Solid, .color0 = color, .color1 = color};
+  }
+
+  [[nodiscard]] static VectorPaint linear(PathPoint const &from,
+                                          std::array<float, 4> const &from_color,
+                                          PathPoint const &to,
+                                          std::array<float, 4> const &to_color) {
+    return {.kind = Kind::Linear,
+            .color0 = from_color,
+            .color1 = to_color,
+            .gradient = {from[0], from[1], to[0], to[1]}};
+  }
+
+  [[nodiscard]] static VectorPaint radial(PathPoint const &center,
+                                          float const radius,
+                                          std::array<float, 4> const &inner,
+                                          std::array<float, 4> const &outer) {
+    return {.kind = Kind::Radial,
+            .color0 = inner,
+            .color1 = outer,
+            .gradient = {center[0], center[1], radius, 0.0f}};
+  }
+};
+
+/**
+ * Resolution-independent 2D vector graphics in the overlay, in pixels
+ * with the origin top left.
+ *
+ * Each path's triangles (from VectorPath::fill() / stroke()) are uploaded
+ * once into shared device-local vertex and index arenas by add(). Per frame
+ * only the per-path instance records (transform and paint) that changed are
+ * copied, and record() issues one drawIndexed per visible path whose
+ * firstInstance selects its record. Edges are antialiased by the target's
+ * MSAA.
+ */
+struct VectorRenderer {
+  /**
+   * Must match Params in shaders/vector.vert
+   */
+  struct Params {
+    std::array<float, 2> scale; // 2 / screen size
+  };
+
+  /**
+   * Must match Instance in shaders/vector.vert / vector.frag (std430)
+   */
+  struct Instance {
+    std::array<float, 4> row0; // xx xy tx -
+    std::array<float, 4> row1; // yx yy ty -
+    std::array<float, 4> color0;
+    std::array<float, 4> color1;
+    std::array<float, 4> gradient;
+    std::array<uint32_t, 4> kind; // x: VectorPaint::Kind
+  };
+  static_assert(sizeof(Instance) == 96);
+
+  struct Capacity {
+    uint32_t vertices = 1 << 20;
+    uint32_t indices = 3 << 20;
+    uint32_t paths = 16384;
+  };
+
+private:
+  struct Draw {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    int32_t vertex_offset = 0;
+    bool visible = true;
+  };
+
+  GpuContext context;
+  UploadRing &ring;
+  Capacity capacity;
+
+  GpuBuffer vertices;
+  GpuBuffer indices;
+  GpuBuffer instances;
+
+  std::vector<Draw> draws;
+  std::vector<Instance> records;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  /* instance records to copy on the next upload(), [first, last) */
+  uint32_t dirtyFirst = UINT32_MAX;
+  uint32_t dirtyLast = 0;
+  bool geometryStaged = false;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline pipeline;
+
+  vk::Semaphore uploaded;
+
+public:
+  /* Capacity's member initializers are not usable in a default argument
+   * inside VectorRenderer, hence the delegating overload */
+  VectorRenderer(GpuContext const &gpu_context, UploadRing &upload_ring,
+                 VulkanGfxBase::PassTarget const &target)
+      : VectorRenderer(gpu_context, upload_ring, target, Capacity{}) {}
+
+  VectorRenderer(GpuContext const &gpu_context, UploadRing &upload_ring,
+                 VulkanGfxBase::PassTarget const &target,
+                 Capacity const &limits)
+      : context{gpu_context}, ring{upload_ring}, capacity{limits} {
+    auto const device_local =
+        vk::MemoryPropertyFlags{vk::MemoryPropertyFlagBits::eDeviceLocal};
+    auto const transfer_dst = vk::BufferUsageFlagBits::eTransferDst;
+    vertices = createBuffer(
+        context, vk::DeviceSize{capacity.vertices} * sizeof(PathPoint),
+        vk::BufferUsageFlagBits::eVertexBuffer | transfer_dst, device_local);
+    indices = createBuffer(
+        context, vk::DeviceSize{capacity.indices} * sizeof(uint32_t),
+        vk::BufferUsageFlagBits::eIndexBuffer | transfer_dst, device_local);
+    instances = createBuffer(
+        context, vk::DeviceSize{capacity.paths} * sizeof(Instance),
+        vk::BufferUsageFlagBits::eStorageBuffer | transfer_dst, device_local);
+
+    draws.reserve(capacity.paths);
+    records.reserve(capacity.paths);
+
+    createDescriptors();
+
+    createPipeline(target);
+    uploaded = context.device.createSemaphore(vk::SemaphoreCreateInfo());
+  }
+
+  VectorRenderer(VectorRenderer const &) = delete;
+  VectorRenderer &operator=(VectorRenderer const &) = delete;
+  VectorRenderer(VectorRenderer &&) = delete;
+  VectorRenderer &operator=(VectorRenderer &&) = delete;
+
+  ~VectorRenderer() {
+    ring.waitIdle();
+
+    auto const &device = context.device;
+    device.destroySemaphore(uploaded);
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+    destroyBuffer(context, vertices);
+    destroyBuffer(context, indices);
+    destroyBuffer(context, instances);
+  }
+
+  /**
+   * Stage mesh into the arenas (submitted by the next upload()) and return
+   * the path's id for setTransform() / setPaint() / setVisible()
+   */
+  uint32_t add(VectorMesh const &mesh, VectorPaint const &paint,
+               Affine2 const &transform = {}) {
+    auto const mesh_vertices = static_cast<uint32_t>(mesh.vertices.size());
+    auto const mesh_indices = static_cast<uint32_t>(mesh.indices.size());
+    if (draws.size() >= capacity.paths ||
+        mesh_vertices > capacity.vertices - vertexCount ||
+        mesh_indices > capacity.indices - indexCount) {
+      throw std::runtime_error(std::format(
+          "{}:{}: vector path of {} vertices / {} indices does not fit "
+          "({} paths, {} vertices, {} indices in use)",
+          __FILE__, __LINE__, mesh_vertices, mesh_indices, draws.size(),
+          vertexCount, indexCount));
+    }
+
+    if (mesh_indices > 0) {
+      ring.copyToBuffer(vertices.buffer,
+                        vk::DeviceSize{vertexCount} * sizeof(PathPoint),
+                        std::as_bytes(std::span(mesh.vertices)));
+      ring.copyToBuffer(indices.buffer,
+                        vk::DeviceSize{indexCount} * sizeof(uint32_t),
+                        std::as_bytes(std::span(mesh.indices)));
+      geometryStaged = true;
+    }
+
+    auto const id = static_cast<uint32_t>(draws.size());
+    draws.push_back({indexCount, mesh_indices,
+                     static_cast<int32_t>(vertexCount), true});
+    records.emplace_back();
+    vertexCount += mesh_vertices;
+    indexCount += mesh_indices;
+
+    setPaint(id, paint);
+    setTransform(id, transform);
+    return id;
+  }
+
+  void setTransform(uint32_t const id, Affine2 const &t) {
+    auto &record = records[id];
+    record.row0 = {t.xx, t.xy, t.tx, 0.0f};
+    record.row1 = {t.yx, t.yy, t.ty, 0.0f};
+    markDirty(id);
+  }
+
+  void setPaint(uint32_t const id, VectorPaint const &paint) {
+    auto &record = records[id];
+    record.color0 = paint.color0;
+    record.color1 = paint.color1;
+    record.gradient = paint.gradient;
+    record.kind = {static_cast<uint32_t>(paint.kind), 0, 0, 0};
+    markDirty(id);
+  }
+
+  /**
+   * Hidden paths keep their geometry and are skipped by record()
+   */
+  void setVisible(uint32_t const id, bool const visible) {
+    draws[id].visible = visible;
+  }
+
+  [[nodiscard]] size_t pathCount() const { return draws.size(); }
+
+  /**
+   * Submit geometry staged by add() and the instance records changed since
+   * the last call, as one contiguous copy. Returns a semaphore for
+   * VulkanGfxBase::waitBeforeNextFrame (vertex input stage) or a null
+   * handle when nothing changed.
+   */
+  vk::Semaphore upload() {
+    if (dirtyFirst < dirtyLast) {
+      ring.copyToBuffer(
+          instances.buffer, vk::DeviceSize{dirtyFirst} * sizeof(Instance),
+          std::as_bytes(std::span(records).subspan(dirtyFirst,
+                                                   dirtyLast - dirtyFirst)));
+    } else if (!geometryStaged) {
+      return {};
+    }
+
+    if (Args::verbose() > 1) {
+      std::cerr << std::format("{}:{}: vector paths: {} instance records\n",
+                               __FILE__, __LINE__,
+                               dirtyLast > dirtyFirst ? dirtyLast - dirtyFirst
+                                                      : 0);
+    }
+    dirtyFirst = UINT32_MAX;
+    dirtyLast = 0;
+    geometryStaged = false;
+    return ring.flush(uploaded) ? uploaded : vk::Semaphore{};
+  }
+
+  /**
+   * Draw every visible path, in add() order. Viewport and scissor must
+   * already be set.
+   */
+  void record(vk::CommandBuffer const cmd, vk::Extent2D const extent) const {
+    if (indexCount == 0)
+      return;
+
+    auto const params =
+        Params{.scale = {2.0f / static_cast<float>(extent.width),
+                         2.0f / static_cast<float>(extent.height)}};
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+                           descriptorSet, nullptr);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
+                      sizeof(Params), &params);
+    cmd.bindVertexBuffers(0, vertices.buffer, vk::DeviceSize{0});
+    cmd.bindIndexBuffer(indices.buffer, 0, vk::IndexType::eUint32);
+
+    for (auto id = 0U; id < draws.size(); ++id) {
+      auto const &draw = draws[id];
+      if (draw.visible && draw.index_count > 0)
+        cmd.drawIndexed(draw.index_count, 1, draw.first_index,
+                        draw.vertex_offset, id);
+    }
+  }
+
+  /**
+   * Rebuild the pipeline for a new target; layers and their instances are
+   * kept
+   */
+  void recreatePipeline(VulkanGfxBase::PassTarget const &target) {
+    context.device.destroyPipeline(pipeline);
+    pipeline = nullptr;
+    createPipeline(target);
+  }
+
+private:
+  void markDirty(uint32_t const id) {
+    dirtyFirst = std::min(dirtyFirst, id);
+    dirtyLast = std::max(dirtyLast, id + 1);
+  }
+
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto const binding = vk::DescriptorSetLayoutBinding(
+        0, vk::DescriptorType::eStorageBuffer, 1,
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, binding));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create vector descriptor set layout");
+    }
+
+    auto const pool_size =
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1);
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 1, pool_size));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create vector descriptor pool");
+    }
+    descriptorSet = device
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo(
+                            descriptorPool, setLayout))
+                        .front();
+
+    auto const buffer_info =
+        vk::DescriptorBufferInfo(instances.buffer, 0, VK_WHOLE_SIZE);
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet(descriptorSet, 0, 0,
+                               vk::DescriptorType::eStorageBuffer, {},
+                               buffer_info),
+        nullptr);
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eVertex, 0, sizeof(Params));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create vector pipeline layout");
+    }
+  }
+
+  void createPipeline(VulkanGfxBase::PassTarget const &target) {
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/vector.vert.spv"
+    };
+    static auto const frag_code = std::vector<uint32_t>{
+#include "shaders/vector.frag.spv"
+    };
+
+    auto const &device = context.device;
+
+    auto const vert_module = createShaderModule(context, vert_code);
+    auto const frag_module = createShaderModule(context, frag_code);
+
+    auto const shader_stages = std::array{
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+        vk::PipelineShaderStageCreateInfo(
+            {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main")};
+
+    auto const vertex_binding = vk::VertexInputBindingDescription(
+        0, sizeof(PathPoint), vk::VertexInputRate::eVertex);
+    auto const vertex_attribute = vk::VertexInputAttributeDescription(
+        0, 0, vk::Format::eR32G32Sfloat, 0);
+    auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo(
+        {}, vertex_binding, vertex_attribute);
+
+    auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+    input_assembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+    auto viewport_state = vk::PipelineViewportStateCreateInfo();
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    auto const dynamic_states = std::array{vk::DynamicState::eViewport,
+                                           vk::DynamicState::eScissor};
+    auto const dynamic_state =
+        vk::PipelineDynamicStateCreateInfo({}, dynamic_states);
+
+    // tessellation winding follows the path, so no culling
+    auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.lineWidth = 1.0f;
+
+    auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+    multisampling.rasterizationSamples = target.samples;
+
+    // overlay: no depth
+    auto const depth = vk::PipelineDepthStencilStateCreateInfo();
+
+    auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+    color_blend_attachment.blendEnable = vk::Bool32{true};
+    color_blend_attachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+    color_blend_attachment.dstColorBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.colorBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    color_blend_attachment.dstAlphaBlendFactor =
+        vk::BlendFactor::eOneMinusSrcAlpha;
+    color_blend_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+    color_blend_attachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+    auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+        {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+    auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+    pipeline_info.stageCount = shader_stages.size();
+    pipeline_info.pStages = shader_stages.data();
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipelineLayout;
+    pipeline_info.renderPass = target.render_pass;
+    pipeline_info.subpass = target.subpass;
+
+    auto pipeline_result = device.createGraphicsPipeline(nullptr, pipeline_info);
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+
+    if (pipeline_result.result != vk::Result::eSuccess) {
+      throw std::runtime_error(
+          std::format("failed to create vector pipeline: {}\n",
+                      vk::to_string(pipeline_result.result)));
+    }
+    pipeline = pipeline_result.value;
+  }
+};
@@ -0,0 +1,163 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * What subsystems outside VulkanGfxBase (mesh upload, streaming, ...) need
+ * to create their own resources and submit work. Handed out by
+ * VulkanGfxBase::gpuContext(); valid until the base is destroyed.
+ */
+struct GpuContext {
+  vk::PhysicalDevice physical_device;
+  vk::Device device;
+  vk::Queue graphics_queue;
+  vk::Queue transfer_queue;
+  vk::Queue compute_queue;
+  uint32_t graphics_family = 0;
+  uint32_t transfer_family = 0;
+  uint32_t compute_family = 0;
+  // multiDrawIndirect and drawIndirectFirstInstance are both enabled
+  bool multi_draw_indirect = false;
+};
+
+/**
+ * Find a memory type index satisfying both the resource's type bits and the
+ * requested property flags. Throws if there is none.
+ */
+[[nodiscard]] inline uint32_t
+findMemoryType(vk::PhysicalDevice const physical_device, uint32_t type_bits,
+               vk::MemoryPropertyFlags const properties) {
+  auto const memory_properties = physical_device.getMemoryProperties();
+
+  for (auto i = 0U; i < memory_properties.memoryTypeCount; ++i) {
+    if ((type_bits & (1U << i)) &&
+        (memory_properties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+
+  throw std::runtime_error{
+      std::format("{}:{}: no memory type for properties {}", __FILE__,
+                  __LINE__, vk::to_string(properties))};
+}
+
+struct GpuBuffer {
+  vk::Buffer buffer;
+  vk::DeviceMemory memory;
+  vk::DeviceSize size = 0;
+  void *mapped = nullptr; // persistently mapped when host visible
+};
+
+/**
+ * Buffers are shared concurrently between the graphics, transfer and
+ * compute families, so uploads on the transfer queue need no ownership
+ * transfer before use.
+ */
+[[nodiscard]] inline GpuBuffer
+createBuffer(GpuContext const &context, vk::DeviceSize const size,
+             vk::BufferUsageFlags const usage,
+             vk::MemoryPropertyFlags const properties) {
+  auto families = std::vector<uint32_t>{context.graphics_family};
+  for (auto const family : {context.transfer_family, context.compute_family}) {
+    if (std::ranges::find(families, family) == families.end())
+      families.push_back(family);
+  }
+
+  auto buffer_info = vk::BufferCreateInfo();
+  buffer_info.size = size;
+  buffer_info.usage = usage;
+  if (families.size() > 1) {
+    buffer_info.sharingMode = vk::SharingMode::eConcurrent;
+    buffer_info.setQueueFamilyIndices(families);
+  } else {
+    buffer_info.sharingMode = vk::SharingMode::eExclusive;
+  }
+
+  auto result = GpuBuffer();
+  result.size = size;
+  result.buffer = context.device.createBuffer(buffer_info);
+  if (!result.buffer) {
+    throw std::runtime_error(
+        std::format("{}:{}: failed to create buffer", __FILE__, __LINE__));
+  }
+
+  auto const requirements =
+      context.device.getBufferMemoryRequirements(result.buffer);
+  result.memory = context.device.allocateMemory(vk::MemoryAllocateInfo(
+      requirements.size,
+      findMemoryType(context.physical_device, requirements.memoryTypeBits,
+                     properties)));
+  if (!result.memory) {
+    context.device.destroyBuffer(result.buffer);
+    throw std::runtime_error(
+        std::format("{}:{}: failed to allocate buffer memory", __FILE__,
+                    __LINE__));
+  }
+  context.device.bindBufferMemory(result.buffer, result.memory, 0);
+
+  if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+    result.mapped = context.device.mapMemory(result.memory, 0, VK_WHOLE_SIZE);
+  }
+
+  return result;
+}
+
+inline void destroyBuffer(GpuContext const &context, GpuBuffer &buffer) {
+  if (buffer.mapped) {
+    context.device.unmapMemory(buffer.memory);
+    buffer.mapped = nullptr;
+  }
+  if (buffer.buffer) {
+    context.device.destroyBuffer(buffer.buffer);
+    buffer.buffer = nullptr;
+  }
+  if (buffer.memory) {
+    context.device.freeMemory(buffer.memory);
+    buffer.memory = nullptr;
+  }
+  buffer.size = 0;
+}
+
+/**
+ * True when some memory type is both device local and host visible
+ * (integrated GPUs, resizable BAR). Such buffers can be filled with a plain
+ * memcpy instead of a staged copy.
+ */
+[[nodiscard]] inline bool hasHostVisibleDeviceMemory(
+    vk::PhysicalDevice const physical_device) {
+  auto const wanted = vk::MemoryPropertyFlagBits::eDeviceLocal |
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                      vk::MemoryPropertyFlagBits::eHostCoherent;
+  auto const memory_properties = physical_device.getMemoryProperties();
+
+  for (auto i = 0U; i < memory_properties.memoryTypeCount; ++i) {
+    auto const &type = memory_properties.memoryTypes[i];
+    if ((type.propertyFlags & wanted) == wanted &&
+        // a small BAR window (typically 256MiB) is not worth spending on
+        // static geometry
+        memory_properties.memoryHeaps[type.heapIndex].size > (1ULL << 30U)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+[[nodiscard]] inline vk::ShaderModule
+createShaderModule(GpuContext const &context, std::span<uint32_t const> code) {
+  auto create_info = vk::ShaderModuleCreateInfo();
+  create_info.codeSize = code.size_bytes();
+  create_info.pCode = code.data();
+
+  auto module = context.device.createShaderModule(create_info);
+  if (!module) {
+    throw std::runtime_error("failed to create shader module");
+  }
+  return module;
+}
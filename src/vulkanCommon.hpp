@@ -2,9 +2,17 @@
 static_assert(__cplusplus >= 202002L, "C++20 required");
 
 #include "../args.hpp"
+#include "deviceTuning.hpp"
 #include "platformGfx.hpp"
+#include "uploadRing.hpp"
+#include "vulkanBuffer.hpp"
+#include <array>
 #include <functional>
 #include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vulkan/vulkan.hpp>
 
 /**
@@ -28,6 +36,7 @@ protected:
   vk::Queue transferQueue;
   vk::Queue presentQueue;
   vk::Queue computeQueue;
+  bool multiDrawIndirect{false}; // and drawIndirectFirstInstance
 
   /**
    * filled (and consumed) by createDevice
@@ -55,12 +64,43 @@ protected:
   vk::Format format;
   vk::Extent2D extent;
   std::vector<vk::Image> images;
+  bool computePresent{false}; // images are written by compute (eStorage)
 
   /* createImageViews */
   std::vector<vk::ImageView> imageViews;
 
+  /**
+   * An image + memory + view triple for render targets owned by us (as
+   * opposed to swapchain images)
+   */
+  struct AttachmentImage {
+    vk::Image image;
+    vk::DeviceMemory memory;
+    vk::ImageView view;
+    bool lazy = false; // backed by lazily allocated (tile) memory
+  };
+
+  /* createPostTargets */
+  bool postChain{false}; // Config GFX_POST_CHAIN
+  bool postOnTile{false}; // subpass/input attachment path vs compute fallback
+  std::array<AttachmentImage, 2> postTargets; // HDR ping-pong
+  static constexpr auto postTargetFormat = vk::Format::eR16G16B16A16Sfloat;
+
+  /* createMultisampleTargets */
+  vk::SampleCountFlagBits msaaSamples{vk::SampleCountFlagBits::e1};
+  AttachmentImage msaaColor; // transient, resolved at the end of the subpass
+
+  /* createDepthTarget */
+  vk::Format depthFormat{vk::Format::eUndefined}; // eUndefined: no depth
+  AttachmentImage depthTarget;   // transient, same sample count as the scene
+  bool depthPrepass{false};      // depth-only subpass before the scene
+  uint32_t sceneSubpass{0};      // 1 with a depth pre-pass
+
   /* createRenderPass */
-  vk::RenderPass renderPass;
+  vk::RenderPass renderPass; // the pass that writes the swapchain images
+  vk::RenderPass scenePass;  // compute post path only: scene -> postTargets[0]
+  std::vector<vk::ClearValue> renderPassClearValues; // one per attachment
+  std::vector<vk::ClearValue> scenePassClearValues;
 
   /* createGraphicsPipeline */
   vk::PipelineLayout pipelineLayout;
@@ -68,6 +108,17 @@ protected:
 
   /* createFramebuffers */
   std::vector<vk::Framebuffer> framebuffers; // as many as there are images
+  vk::Framebuffer sceneFramebuffer;          // compute post path only
+
+  /* createPostPipelines */
+  vk::DescriptorSetLayout postSetLayout;
+  vk::DescriptorSetLayout postComputeSetLayout;
+  vk::PipelineLayout postPipelineLayout;
+  vk::PipelineLayout postComputePipelineLayout;
+  vk::DescriptorPool postDescriptorPool;
+  vk::Sampler postSampler;
+  std::vector<vk::Pipeline> postPipelines;        // one per PostStage
+  std::vector<vk::DescriptorSet> postDescriptorSets; // one per PostStage
 
   /* createCommandPools */
   // vk::CommandPool commandPool;
@@ -90,13 +141,248 @@ protected:
   /* createSyncObjects */
   vk::Semaphore imageAvailableSemaphore;
   vk::Semaphore renderFinishedSemaphore;
-  vk::Fence inFlightFence;
+  vk::Semaphore computeReleaseSemaphore; // compute->present ownership handoff
+  vk::Fence inFlightFence; // one frame in flight, FrameHook relies on it
+
+  /* createFrameQueries */
+  vk::QueryPool frameQueries;   // timestamps around each frame's commands
+  double timestampPeriod = 0.0; // ns per tick
+  uint64_t timestampMask = 0;   // timestampValidBits of the graphics family
+  bool frameQueriesWritten = false;
+  double gpuFrameTime = 0.0; // ms, last completed frame
+
+  /* runtime quality over Config (QualityGovernor); not persisted */
+  std::optional<std::string> msaaTier;
+  std::optional<bool> postChainEnabled;
+
+  /* loadDeviceTuning */
+  std::string tuningKey; // Config /autotune/<key>
+  DeviceTuning tuning;
+  bool tuningStored = false; // the device has been tuned before
+
+public:
+  /**
+   * What a compute writer gets to work with for a single frame when the
+   * swapchain is written directly by compute (Config GFX_COMPUTE_PRESENT).
+   * The image is in eGeneral layout and owned by the compute queue family for
+   * the duration of the callback; layout transitions and ownership transfer to
+   * the present queue are recorded around it.
+   * Note: storage-capable swapchain formats are UNORM, so the writer is
+   * responsible for sRGB encoding.
+   */
+  struct ComputeTarget {
+    vk::CommandBuffer cmd;
+    vk::Image image;
+    vk::ImageView view;
+    vk::Format format;
+    vk::Extent2D extent;
+    uint32_t image_index;
+  };
+
+  using ComputeWriter = std::function<void(ComputeTarget const &)>;
+
+  /**
+   * Records draws into the currently bound subpass.
+   * The scene recorder runs in the scene subpass (HDR target when the post
+   * chain is enabled), the overlay recorder in the final subpass on top of
+   * the post-processed image (UI).
+   */
+  using Recorder = std::function<void(vk::CommandBuffer)>;
+
+  /**
+   * Runs once per frame after the previous frame's fence has signalled and
+   * before anything is recorded, so per-frame uploads cannot race the GPU.
+   */
+  using FrameHook = std::function<void()>;
+
+  /**
+   * What a recorder needs to build compatible pipelines: render pass,
+   * subpass index and rasterization samples. Invalidated by re-init (resize,
+   * tuning or quality changes); see setTargetsRebuiltHook.
+   */
+  struct PassTarget {
+    vk::RenderPass render_pass;
+    uint32_t subpass;
+    vk::SampleCountFlagBits samples;
+    vk::Extent2D extent;
+  };
+
+  /**
+   * Post-processing chain, in order. Each stage is one subpass on the on-tile
+   * path or one compute dispatch on the fallback path; UI_COMPOSITE is always
+   * last and is where the overlay recorder draws.
+   * Must match STAGE_* in shaders/post.glsl
+   */
+  enum class PostStage : int32_t {
+    TONEMAP = 0,
+    COLOUR_GRADE = 1,
+    VIGNETTE = 2,
+    UI_COMPOSITE = 3,
+  };
+
+  static constexpr auto postStages =
+      std::array{PostStage::TONEMAP, PostStage::COLOUR_GRADE,
+                 PostStage::VIGNETTE, PostStage::UI_COMPOSITE};
+
+  /**
+   * Post stage parameters, pushed as push constants.
+   * Must match PostParams in shaders/post.glsl
+   */
+  struct PostParams {
+    std::array<float, 2> inv_extent{};
+    float exposure = 1.0f;
+    float saturation = 1.0f;
+    float contrast = 1.0f;
+    float vignette_strength = 0.35f;
+    float vignette_radius = 0.6f;
+  };
+
+protected:
+  /* user-supplied compute writer; when empty the image is just cleared */
+  ComputeWriter computeWriter;
+
+  /* user-supplied draw recorders */
+  Recorder depthPrepassRecorder;
+  Recorder sceneRecorder;
+  Recorder overlayRecorder;
+
+  PostParams postParams;
+
+  FrameHook frameBeginHook;
+  FrameHook targetsRebuiltHook;
+
+  /* bumped by every init(), see targetsGeneration() */
+  uint64_t targetsGen = 0;
+
+  /* consumed by the next frame submission, see waitBeforeNextFrame */
+  std::vector<vk::Semaphore> frameWaitSemaphores;
+  std::vector<vk::PipelineStageFlags> frameWaitStages;
 
 public:
   // VulkanGfxBase() = default;
   VulkanGfxBase(PlatformGfx *platformGfxImpl)
       : platformVkImpl(platformGfxImpl) {}
 
+  void setComputeWriter(ComputeWriter &&writer) {
+    computeWriter = std::move(writer);
+  }
+
+  void setDepthPrepassRecorder(Recorder &&recorder) {
+    depthPrepassRecorder = std::move(recorder);
+  }
+
+  void setSceneRecorder(Recorder &&recorder) {
+    sceneRecorder = std::move(recorder);
+  }
+
+  void setOverlayRecorder(Recorder &&recorder) {
+    overlayRecorder = std::move(recorder);
+  }
+
+  void setPostParams(PostParams const &params) { postParams = params; }
+
+  void setFrameBeginHook(FrameHook &&hook) { frameBeginHook = std::move(hook); }
+
+  /**
+   * Runs at the end of every init() once the render passes are rebuilt, with
+   * the device idle: the place to recreatePipeline() each renderer against
+   * the new sceneTarget()/overlayTarget().
+   */
+  void setTargetsRebuiltHook(FrameHook &&hook) {
+    targetsRebuiltHook = std::move(hook);
+  }
+
+  /**
+   * Changes whenever the pass targets were rebuilt; pipelines built for an
+   * older generation must not be bound
+   */
+  [[nodiscard]] uint64_t targetsGeneration() const { return targetsGen; }
+
+  /**
+   * Make the next frame submission wait at stage for semaphore, e.g. one
+   * signalled by an UploadRing flush of data the frame reads.
+   */
+  void waitBeforeNextFrame(vk::Semaphore semaphore,
+                           vk::PipelineStageFlags stage) {
+    frameWaitSemaphores.push_back(semaphore);
+    frameWaitStages.push_back(stage);
+  }
+
+  /**
+   * Parameters in effect for this device
+   */
+  [[nodiscard]] DeviceTuning const &deviceTuning() const { return tuning; }
+
+  /**
+   * A staging ring on this device that splits copies at the autotuned
+   * upload_chunk; renderers' UploadRings should come from here
+   */
+  [[nodiscard]] UploadRing
+  createUploadRing(vk::DeviceSize const capacity) const {
+    return UploadRing(gpuContext(), capacity, tuning.upload_chunk);
+  }
+
+  [[nodiscard]] GpuContext gpuContext() const {
+    return {.physical_device = physicalDevice,
+            .device = device,
+            .graphics_queue = queue,
+            .transfer_queue = transferQueue,
+            .compute_queue = computeQueue,
+            .graphics_family = *queueFamilyIndices.graphicsFamily,
+            .transfer_family = *queueFamilyIndices.transferFamily,
+            .compute_family = *queueFamilyIndices.computeFamily,
+            .multi_draw_indirect = multiDrawIndirect};
+  }
+
+  [[nodiscard]] PassTarget sceneTarget() const {
+    return {.render_pass = scenePass ? scenePass : renderPass,
+            .subpass = sceneSubpass,
+            .samples = msaaSamples,
+            .extent = extent};
+  }
+
+  /**
+   * Only meaningful with a depth pre-pass (Config GFX_DEPTH_PREPASS)
+   */
+  [[nodiscard]] PassTarget depthPrepassTarget() const {
+    return {.render_pass = scenePass ? scenePass : renderPass,
+            .subpass = 0,
+            .samples = msaaSamples,
+            .extent = extent};
+  }
+
+  /**
+   * Depth state for pipelines in the scene (or pre-pass) subpass.
+   * Without a pre-pass the scene tests and writes depth; with one the
+   * pre-pass lays down depth and the scene only shades fragments that match
+   * it (less-or-equal, no writes), so each pixel is shaded about once.
+   */
+  [[nodiscard]] vk::PipelineDepthStencilStateCreateInfo
+  depthStencilState(bool for_prepass = false) const {
+    auto state = vk::PipelineDepthStencilStateCreateInfo();
+    if (!depthTarget.view)
+      return state;
+
+    state.depthTestEnable = vk::Bool32{true};
+    state.depthWriteEnable = vk::Bool32{for_prepass || !depthPrepass};
+    state.depthCompareOp = depthPrepass && !for_prepass
+                               ? vk::CompareOp::eLessOrEqual
+                               : vk::CompareOp::eLess;
+    return state;
+  }
+
+  [[nodiscard]] PassTarget overlayTarget() const {
+    if (!postChain)
+      return sceneTarget();
+
+    return {.render_pass = renderPass,
+            .subpass = postOnTile ? sceneSubpass + static_cast<uint32_t>(
+                                                       postStages.size())
+                                  : 0U,
+            .samples = vk::SampleCountFlagBits::e1,
+            .extent = extent};
+  }
+
   virtual ~VulkanGfxBase() {
     auto const verbose = Args::verbose();
 
@@ -128,6 +414,16 @@ public:
       device.waitIdle();
     }
 
+    if (frameQueries) {
+      device.destroyQueryPool(frameQueries);
+      frameQueries = nullptr;
+      frameQueriesWritten = false;
+      if (verbose > 1) {
+        std::cerr << std::format("{}:{}: frameQueries destroyed\n", __FILE__,
+                                 __LINE__);
+      }
+    }
+
     if (inFlightFence) {
       device.destroyFence(inFlightFence);
       inFlightFence = nullptr;
@@ -137,6 +433,15 @@ public:
       }
     }
 
+    if (computeReleaseSemaphore) {
+      device.destroySemaphore(computeReleaseSemaphore);
+      computeReleaseSemaphore = nullptr;
+      if (verbose > 1) {
+        std::cerr << std::format("{}:{}: computeReleaseSemaphore destroyed\n",
+                                 __FILE__, __LINE__);
+      }
+    }
+
     if (renderFinishedSemaphore) {
       device.destroySemaphore(renderFinishedSemaphore);
       renderFinishedSemaphore = nullptr;
@@ -257,6 +562,17 @@ public:
       }
     }
 
+    destroyPostPipelines();
+
+    if (sceneFramebuffer) {
+      device.destroyFramebuffer(sceneFramebuffer);
+      sceneFramebuffer = nullptr;
+      if (verbose > 1) {
+        std::cerr << std::format("{}:{}: scene framebuffer destroyed\n",
+                                 __FILE__, __LINE__);
+      }
+    }
+
     if (!framebuffers.empty()) {
       for (auto &framebuffer : framebuffers) {
         device.destroyFramebuffer(framebuffer);
@@ -277,6 +593,22 @@ public:
       }
     }
 
+    if (scenePass) {
+      device.destroyRenderPass(scenePass);
+      scenePass = nullptr;
+      if (verbose > 1) {
+        std::cerr << std::format("{}:{}: scene render pass destroyed\n",
+                                 __FILE__, __LINE__);
+      }
+    }
+
+    for (auto &target : postTargets)
+      destroyAttachmentImage(target);
+
+    destroyAttachmentImage(msaaColor);
+
+    destroyAttachmentImage(depthTarget);
+
     if (!imageViews.empty()) {
       for (auto &image_view : imageViews) {
         device.destroyImageView(image_view);
@@ -303,6 +635,8 @@ public:
 
     pickPhysicalDevice();
 
+    loadDeviceTuning();
+
     if (surface == nullptr) {
       if (!create_surface_fn)
         throw std::runtime_error{std::format(
@@ -347,17 +681,485 @@ public:
 
     createImageViews();
 
-    createRenderPass();
+    // compute-written swapchain images bypass the render pass entirely
+    if (!computePresent) {
+      createPostTargets();
+
+      createMultisampleTargets();
+
+      createDepthTarget();
 
-    // createGraphicsPipeline();
+      createRenderPass();
 
-    createFramebuffers();
+      // createGraphicsPipeline();
+
+      createFramebuffers();
+
+      createPostPipelines();
+    }
 
     createCommandPools();
 
     createCommandBuffers();
 
     createSyncObjects();
+
+    createFrameQueries();
+
+    ++targetsGen;
+    if (targetsRebuiltHook)
+      targetsRebuiltHook();
+  }
+
+protected:
+  /**
+   * Move the waits queued by waitBeforeNextFrame onto a submission's wait
+   * lists.
+   */
+  void takeFrameWaits(std::vector<vk::Semaphore> &semaphores,
+                      std::vector<vk::PipelineStageFlags> &stages) {
+    semaphores.insert(semaphores.end(), frameWaitSemaphores.begin(),
+                      frameWaitSemaphores.end());
+    stages.insert(stages.end(), frameWaitStages.begin(), frameWaitStages.end());
+    frameWaitSemaphores.clear();
+    frameWaitStages.clear();
+  }
+
+  /**
+   * Bracket a frame's graphics commands with timestamps; no-ops without
+   * timestamp support
+   */
+  void beginFrameQueries(vk::CommandBuffer cmd) {
+    if (!frameQueries)
+      return;
+    cmd.resetQueryPool(frameQueries, 0, 2);
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frameQueries, 0);
+  }
+
+  void endFrameQueries(vk::CommandBuffer cmd) {
+    if (!frameQueries)
+      return;
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frameQueries,
+                       1);
+    frameQueriesWritten = true;
+  }
+
+  /**
+   * Update gpuFrameTime from the last frame's timestamps.
+   * Preconditions: the frame's fence has signalled
+   */
+  void readFrameQueries() {
+    if (!frameQueries || !frameQueriesWritten)
+      return;
+    auto ticks = std::array<uint64_t, 2>{};
+    if (device.getQueryPoolResults(frameQueries, 0, 2, sizeof(ticks),
+                                   ticks.data(), sizeof(uint64_t),
+                                   vk::QueryResultFlagBits::e64) !=
+        vk::Result::eSuccess)
+      return;
+    gpuFrameTime = static_cast<double>((ticks[1] - ticks[0]) & timestampMask) *
+                   timestampPeriod * 1e-6;
+  }
+
+  [[nodiscard]] uint32_t
+  findMemoryType(uint32_t type_bits,
+                 vk::MemoryPropertyFlags const properties) const {
+    return ::findMemoryType(physicalDevice, type_bits, properties);
+  }
+
+  /**
+   * True when the device exposes lazily allocated memory, i.e. transient
+   * attachments can live purely in tile memory (tile-based GPUs).
+   */
+  [[nodiscard]] bool hasLazyMemory() const {
+    auto const memory_properties = physicalDevice.getMemoryProperties();
+
+    for (auto i = 0U; i < memory_properties.memoryTypeCount; ++i) {
+      if (memory_properties.memoryTypes[i].propertyFlags &
+          vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Create a 2D single-mip render target of the swapchain extent.
+   * Transient attachments are placed in lazily allocated memory when the
+   * device has it, so they may never be backed by DRAM at all.
+   */
+  AttachmentImage createAttachmentImage(
+      vk::Format const image_format, vk::ImageUsageFlags const usage,
+      vk::ImageAspectFlags const aspect,
+      vk::SampleCountFlagBits const samples = vk::SampleCountFlagBits::e1) {
+    auto target = AttachmentImage{};
+
+    auto image_info = vk::ImageCreateInfo();
+    image_info.imageType = vk::ImageType::e2D;
+    image_info.format = image_format;
+    image_info.extent = vk::Extent3D(extent.width, extent.height, 1);
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = samples;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage = usage;
+    image_info.sharingMode = vk::SharingMode::eExclusive;
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+
+    target.image = device.createImage(image_info);
+    if (!target.image) {
+      throw std::runtime_error("failed to create attachment image");
+    }
+
+    auto const requirements = device.getImageMemoryRequirements(target.image);
+
+    auto const memory_type = [&]() {
+      if (usage & vk::ImageUsageFlagBits::eTransientAttachment) {
+        try {
+          auto const type = findMemoryType(
+              requirements.memoryTypeBits,
+              vk::MemoryPropertyFlagBits::eDeviceLocal |
+                  vk::MemoryPropertyFlagBits::eLazilyAllocated);
+          target.lazy = true;
+          return type;
+        } catch (std::runtime_error const &) {
+          // no tile memory; plain device-local it is
+        }
+      }
+      return findMemoryType(requirements.memoryTypeBits,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }();
+
+    target.memory = device.allocateMemory(
+        vk::MemoryAllocateInfo(requirements.size, memory_type));
+    if (!target.memory) {
+      throw std::runtime_error("failed to allocate attachment memory");
+    }
+
+    device.bindImageMemory(target.image, target.memory, 0);
+
+    auto view_info = vk::ImageViewCreateInfo();
+    view_info.image = target.image;
+    view_info.viewType = vk::ImageViewType::e2D;
+    view_info.format = image_format;
+    view_info.subresourceRange =
+        vk::ImageSubresourceRange(aspect, 0, 1, 0, 1);
+
+    target.view = device.createImageView(view_info);
+    if (!target.view) {
+      throw std::runtime_error("failed to create attachment image view");
+    }
+
+    if (Args::verbose() > 1)
+      std::cerr << std::format("{}:{}: {} attachment {}x{} created{}\n",
+                               __FILE__, __LINE__, vk::to_string(image_format),
+                               extent.width, extent.height,
+                               target.lazy ? " (lazily allocated)" : "");
+
+    return target;
+  }
+
+  void destroyAttachmentImage(AttachmentImage &target) {
+    if (target.view) {
+      device.destroyImageView(target.view);
+      target.view = nullptr;
+    }
+    if (target.image) {
+      device.destroyImage(target.image);
+      target.image = nullptr;
+    }
+    if (target.memory) {
+      device.freeMemory(target.memory);
+      target.memory = nullptr;
+    }
+    target.lazy = false;
+  }
+
+  vk::ShaderModule createShaderModule(std::span<uint32_t const> code) {
+    auto create_info = vk::ShaderModuleCreateInfo();
+    create_info.codeSize = code.size_bytes();
+    create_info.pCode = code.data();
+
+    auto module = device.createShaderModule(create_info);
+    if (!module) {
+      throw std::runtime_error("failed to create shader module");
+    }
+    return module;
+  }
+
+  /**
+   * Record the frame's render pass(es) for a swapchain image: scene, post
+   * chain (subpasses or compute dispatches) and overlay.
+   * Preconditions: !computePresent, cmd in recording state
+   */
+  void recordFrame(vk::CommandBuffer cmd, uint32_t image_index) {
+    auto render_pass_info = vk::RenderPassBeginInfo();
+    render_pass_info.renderPass = renderPass;
+    render_pass_info.framebuffer = framebuffers[image_index];
+    render_pass_info.renderArea.offset = vk::Offset2D{0, 0};
+    render_pass_info.renderArea.extent = extent;
+    render_pass_info.clearValueCount = renderPassClearValues.size();
+    render_pass_info.pClearValues = renderPassClearValues.data();
+
+    auto params = postParams;
+    params.inv_extent = {1.0f / static_cast<float>(extent.width),
+                         1.0f / static_cast<float>(extent.height)};
+
+    auto const push_params = [&](vk::PipelineLayout layout,
+                                 vk::ShaderStageFlags stages) {
+      cmd.pushConstants(layout, stages, 0, sizeof(PostParams), &params);
+    };
+
+    // depth pre-pass subpass (if any) followed by the scene subpass
+    auto const record_scene = [&]() {
+      if (depthPrepass) {
+        if (depthPrepassRecorder)
+          depthPrepassRecorder(cmd);
+        cmd.nextSubpass(vk::SubpassContents::eInline);
+      }
+      if (sceneRecorder)
+        sceneRecorder(cmd);
+    };
+
+    if (!postChain) {
+      cmd.beginRenderPass(render_pass_info, vk::SubpassContents::eInline);
+      record_scene();
+      if (overlayRecorder)
+        overlayRecorder(cmd);
+      cmd.endRenderPass();
+      return;
+    }
+
+    if (postOnTile) {
+      cmd.beginRenderPass(render_pass_info, vk::SubpassContents::eInline);
+      record_scene();
+
+      for (auto k = 0U; k < postStages.size(); ++k) {
+        cmd.nextSubpass(vk::SubpassContents::eInline);
+        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, postPipelines[k]);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                               postPipelineLayout, 0, postDescriptorSets[k],
+                               nullptr);
+        push_params(postPipelineLayout, vk::ShaderStageFlagBits::eFragment);
+        cmd.draw(3, 1, 0, 0);
+      }
+
+      if (overlayRecorder)
+        overlayRecorder(cmd);
+      cmd.endRenderPass();
+      return;
+    }
+
+    // compute fallback: scene -> postTargets[0], stages ping-pong through
+    // storage images, last stage samples into the composite pass
+    auto scene_pass_info = render_pass_info;
+    scene_pass_info.renderPass = scenePass;
+    scene_pass_info.framebuffer = sceneFramebuffer;
+    scene_pass_info.clearValueCount = scenePassClearValues.size();
+    scene_pass_info.pClearValues = scenePassClearValues.data();
+
+    cmd.beginRenderPass(scene_pass_info, vk::SubpassContents::eInline);
+    record_scene();
+    cmd.endRenderPass();
+
+    auto scratch_to_general = vk::ImageMemoryBarrier();
+    scratch_to_general.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+    scratch_to_general.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+    scratch_to_general.oldLayout = vk::ImageLayout::eUndefined;
+    scratch_to_general.newLayout = vk::ImageLayout::eGeneral;
+    scratch_to_general.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    scratch_to_general.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    scratch_to_general.image = postTargets[1].image;
+    scratch_to_general.subresourceRange = vk::ImageSubresourceRange(
+        vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    auto const scene_written = vk::MemoryBarrier(
+        vk::AccessFlagBits::eColorAttachmentWrite,
+        vk::AccessFlagBits::eShaderRead);
+
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::PipelineStageFlagBits::eComputeShader, {},
+                        scene_written, nullptr, scratch_to_general);
+
+    auto const stage_written = vk::MemoryBarrier(
+        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+
+    auto const groups_x = (extent.width + 7) / 8;
+    auto const groups_y = (extent.height + 7) / 8;
+
+    for (auto k = 0U; k + 1 < postStages.size(); ++k) {
+      cmd.bindPipeline(vk::PipelineBindPoint::eCompute, postPipelines[k]);
+      cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                             postComputePipelineLayout, 0,
+                             postDescriptorSets[k], nullptr);
+      push_params(postComputePipelineLayout,
+                  vk::ShaderStageFlagBits::eCompute);
+      cmd.dispatch(groups_x, groups_y, 1);
+
+      auto const is_last_dispatch = k + 2 == postStages.size();
+      cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                          is_last_dispatch
+                              ? vk::PipelineStageFlagBits::eFragmentShader
+                              : vk::PipelineStageFlagBits::eComputeShader,
+                          {}, stage_written, nullptr, nullptr);
+    }
+
+    cmd.beginRenderPass(render_pass_info, vk::SubpassContents::eInline);
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, postPipelines.back());
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                           postPipelineLayout, 0, postDescriptorSets.back(),
+                           nullptr);
+    push_params(postPipelineLayout, vk::ShaderStageFlagBits::eFragment);
+    cmd.draw(3, 1, 0, 0);
+
+    if (overlayRecorder)
+      overlayRecorder(cmd);
+    cmd.endRenderPass();
+  }
+
+  /**
+   * Record and submit a frame for a compute-written swapchain image.
+   * The image is transitioned to eGeneral, handed to computeWriter (or
+   * cleared), then released to the present queue family. When compute and
+   * present live in different families the matching acquire is submitted on
+   * the present queue, otherwise a single compute submission suffices.
+   * Signals renderFinishedSemaphore and inFlightFence either way.
+   * Preconditions: computePresent, image acquired with imageAvailableSemaphore
+   */
+  void submitComputeFrame(uint32_t image_index) {
+    assert(computePresent);
+
+    auto const compute_family = *queueFamilyIndices.computeFamily;
+    auto const present_family = *queueFamilyIndices.presentFamily;
+    auto const needs_transfer = compute_family != present_family;
+
+    auto const color_range = vk::ImageSubresourceRange(
+        vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    auto &cmd = commandBuffers.compute[image_index];
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    auto to_general = vk::ImageMemoryBarrier();
+    to_general.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+    to_general.dstAccessMask =
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+    to_general.oldLayout = vk::ImageLayout::eUndefined;
+    to_general.newLayout = vk::ImageLayout::eGeneral;
+    to_general.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_general.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_general.image = images[image_index];
+    to_general.subresourceRange = color_range;
+
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eComputeShader |
+                            vk::PipelineStageFlagBits::eTransfer,
+                        {}, nullptr, nullptr, to_general);
+
+    if (computeWriter) {
+      computeWriter(ComputeTarget{.cmd = cmd,
+                                  .image = images[image_index],
+                                  .view = imageViews[image_index],
+                                  .format = format,
+                                  .extent = extent,
+                                  .image_index = image_index});
+    } else {
+      cmd.clearColorImage(
+          images[image_index], vk::ImageLayout::eGeneral,
+          vk::ClearColorValue(std::array{1.0f, 0.3f, 0.0f, 1.0f}),
+          color_range);
+    }
+
+    // release (or plain transition when the families match)
+    auto release = vk::ImageMemoryBarrier();
+    release.srcAccessMask =
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+    release.dstAccessMask = vk::AccessFlagBits::eNoneKHR;
+    release.oldLayout = vk::ImageLayout::eGeneral;
+    release.newLayout = vk::ImageLayout::ePresentSrcKHR;
+    release.srcQueueFamilyIndex =
+        needs_transfer ? compute_family : VK_QUEUE_FAMILY_IGNORED;
+    release.dstQueueFamilyIndex =
+        needs_transfer ? present_family : VK_QUEUE_FAMILY_IGNORED;
+    release.image = images[image_index];
+    release.subresourceRange = color_range;
+
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader |
+                            vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr,
+                        nullptr, release);
+    cmd.end();
+
+    auto wait_semaphores = std::vector<vk::Semaphore>{imageAvailableSemaphore};
+    auto wait_stages = std::vector<vk::PipelineStageFlags>{
+        vk::PipelineStageFlagBits::eComputeShader};
+    takeFrameWaits(wait_semaphores, wait_stages);
+
+    auto compute_submit = vk::SubmitInfo();
+    compute_submit.setWaitSemaphores(wait_semaphores);
+    compute_submit.setWaitDstStageMask(wait_stages);
+    compute_submit.commandBufferCount = 1;
+    compute_submit.pCommandBuffers = &cmd;
+    compute_submit.signalSemaphoreCount = 1;
+    compute_submit.pSignalSemaphores =
+        needs_transfer ? &computeReleaseSemaphore : &renderFinishedSemaphore;
+
+    if (computeQueue.submit(1, &compute_submit,
+                            needs_transfer ? vk::Fence{} : inFlightFence) !=
+        vk::Result::eSuccess) {
+      throw std::runtime_error{std::format(
+          "{}:{}: compute vkQueue.submit erred out", __FILE__, __LINE__)};
+    }
+
+    if (!needs_transfer)
+      return;
+
+    // matching acquire on the present family
+    auto &acquire_cmd = commandBuffers.present[image_index];
+    acquire_cmd.reset();
+    acquire_cmd.begin(vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    auto acquire = release;
+    acquire.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+
+    acquire_cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                                vk::PipelineStageFlagBits::eAllCommands, {},
+                                nullptr, nullptr, acquire);
+    acquire_cmd.end();
+
+    auto const present_wait_stage =
+        vk::PipelineStageFlags{vk::PipelineStageFlagBits::eAllCommands};
+
+    auto present_submit = vk::SubmitInfo();
+    present_submit.waitSemaphoreCount = 1;
+    present_submit.pWaitSemaphores = &computeReleaseSemaphore;
+    present_submit.pWaitDstStageMask = &present_wait_stage;
+    present_submit.commandBufferCount = 1;
+    present_submit.pCommandBuffers = &acquire_cmd;
+    present_submit.signalSemaphoreCount = 1;
+    present_submit.pSignalSemaphores = &renderFinishedSemaphore;
+
+    if (presentQueue.submit(1, &present_submit, inFlightFence) !=
+        vk::Result::eSuccess) {
+      throw std::runtime_error{std::format(
+          "{}:{}: present-acquire vkQueue.submit erred out", __FILE__,
+          __LINE__)};
+    }
+  }
+
+  /**
+   * Tuning and control names for present modes; anything unknown is FIFO
+   */
+  static vk::PresentModeKHR presentModeByName(std::string_view const name) {
+    if (name == "MAILBOX")
+      return vk::PresentModeKHR::eMailbox;
+    if (name == "FIFO_RELAXED")
+      return vk::PresentModeKHR::eFifoRelaxed;
+    if (name == "IMMEDIATE")
+      return vk::PresentModeKHR::eImmediate;
+    return vk::PresentModeKHR::eFifo;
   }
 
 private:
@@ -516,51 +1318,286 @@ private:
                                __FILE__, __LINE__, images.size());
   }
 
+  /**
+   * Create the render pass(es). Three shapes:
+   *  - no post chain: scene drawn straight to the swapchain
+   *  - on-tile post chain: scene subpass into an HDR transient attachment,
+   *    then one subpass per PostStage reading the previous one as an input
+   *    attachment (ping-pong), the last one writing the swapchain. Nothing
+   *    but the final image needs to leave tile memory.
+   *  - compute post chain: scenePass renders into postTargets[0], the stages
+   *    run as compute dispatches in between, and renderPass is a single
+   *    composite subpass writing the swapchain.
+   * With MSAA the scene subpass renders into a transient multisampled
+   * attachment appended after the others, resolved into the scene target at
+   * the end of the same subpass. The depth attachment, if any, comes last;
+   * with a depth pre-pass a depth-only subpass precedes the scene subpass.
+   */
   void createRenderPass() {
-    auto color_attachment = vk::AttachmentDescription();
-    color_attachment.format = format;
-    color_attachment.samples = vk::SampleCountFlagBits::e1;
-    color_attachment.loadOp = vk::AttachmentLoadOp::eClear;
-    color_attachment.storeOp = vk::AttachmentStoreOp::eStore;
-    color_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-    color_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-    color_attachment.initialLayout = vk::ImageLayout::eUndefined;
-    color_attachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
-
-    auto color_attachment_ref = vk::AttachmentReference();
-    color_attachment_ref.attachment = 0;
-    color_attachment_ref.layout = vk::ImageLayout::eColorAttachmentOptimal;
-
-    auto subpass = vk::SubpassDescription();
-    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment_ref;
-
-    auto dependency = vk::SubpassDependency();
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead |
-                               vk::AccessFlagBits::eColorAttachmentWrite;
-
-    auto render_pass_info = vk::RenderPassCreateInfo();
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
-
-    renderPass = device.createRenderPass(render_pass_info);
-    if (!renderPass) {
-      throw std::runtime_error("failed to create render pass");
+    auto swapchain_attachment = vk::AttachmentDescription();
+    swapchain_attachment.format = format;
+    swapchain_attachment.samples = vk::SampleCountFlagBits::e1;
+    swapchain_attachment.loadOp = postChain ? vk::AttachmentLoadOp::eDontCare
+                                            : vk::AttachmentLoadOp::eClear;
+    swapchain_attachment.storeOp = vk::AttachmentStoreOp::eStore;
+    swapchain_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    swapchain_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    swapchain_attachment.initialLayout = vk::ImageLayout::eUndefined;
+    swapchain_attachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+
+    auto hdr_attachment = vk::AttachmentDescription();
+    hdr_attachment.format = postTargetFormat;
+    hdr_attachment.samples = vk::SampleCountFlagBits::e1;
+    hdr_attachment.loadOp = vk::AttachmentLoadOp::eDontCare;
+    hdr_attachment.storeOp = postOnTile ? vk::AttachmentStoreOp::eDontCare
+                                        : vk::AttachmentStoreOp::eStore;
+    hdr_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    hdr_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    hdr_attachment.initialLayout = vk::ImageLayout::eUndefined;
+    hdr_attachment.finalLayout = postOnTile
+                                     ? vk::ImageLayout::eColorAttachmentOptimal
+                                     : vk::ImageLayout::eGeneral;
+
+    // also orders this frame's depth clear after last frame's depth tests
+    auto external_dependency = vk::SubpassDependency();
+    external_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    external_dependency.dstSubpass = 0;
+    external_dependency.srcStageMask =
+        vk::PipelineStageFlagBits::eColorAttachmentOutput |
+        vk::PipelineStageFlagBits::eLateFragmentTests;
+    external_dependency.srcAccessMask =
+        vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    external_dependency.dstStageMask =
+        vk::PipelineStageFlagBits::eColorAttachmentOutput |
+        vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    external_dependency.dstAccessMask =
+        vk::AccessFlagBits::eColorAttachmentRead |
+        vk::AccessFlagBits::eColorAttachmentWrite |
+        vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    auto const create_pass =
+        [this](std::span<vk::AttachmentDescription const> attachments,
+               std::span<vk::SubpassDescription const> subpasses,
+               std::span<vk::SubpassDependency const> dependencies) {
+          auto render_pass_info = vk::RenderPassCreateInfo();
+          render_pass_info.attachmentCount = attachments.size();
+          render_pass_info.pAttachments = attachments.data();
+          render_pass_info.subpassCount = subpasses.size();
+          render_pass_info.pSubpasses = subpasses.data();
+          render_pass_info.dependencyCount = dependencies.size();
+          render_pass_info.pDependencies = dependencies.data();
+
+          auto pass = device.createRenderPass(render_pass_info);
+          if (!pass) {
+            throw std::runtime_error("failed to create render pass");
+          }
+          return pass;
+        };
+
+    auto const single_subpass = [](vk::AttachmentReference const *color_ref) {
+      auto subpass = vk::SubpassDescription();
+      subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+      subpass.colorAttachmentCount = color_ref != nullptr ? 1 : 0;
+      subpass.pColorAttachments = color_ref;
+      return subpass;
+    };
+
+    auto const color_ref = [](uint32_t attachment) {
+      return vk::AttachmentReference(attachment,
+                                     vk::ImageLayout::eColorAttachmentOptimal);
+    };
+
+    // references must outlive pass creation
+    struct SceneRefs {
+      vk::AttachmentReference color;
+      vk::AttachmentReference resolve;
+      vk::AttachmentReference depth;
+    };
+
+    // (optional depth pre-pass +) scene subpass writing attachments[target],
+    // through an appended multisampled attachment when MSAA is on
+    auto const scene_subpasses =
+        [&](std::vector<vk::AttachmentDescription> &attachments,
+            uint32_t target, SceneRefs &refs,
+            std::vector<vk::SubpassDescription> &subpasses,
+            std::vector<vk::SubpassDependency> &dependencies) {
+          auto const multisampled =
+              msaaSamples != vk::SampleCountFlagBits::e1;
+
+          // the resolve overwrites every pixel, no need to clear the target
+          attachments[target].loadOp = multisampled
+                                           ? vk::AttachmentLoadOp::eDontCare
+                                           : vk::AttachmentLoadOp::eClear;
+          refs.color = color_ref(target);
+
+          if (multisampled) {
+            auto msaa_attachment = vk::AttachmentDescription();
+            msaa_attachment.format = attachments[target].format;
+            msaa_attachment.samples = msaaSamples;
+            msaa_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+            msaa_attachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+            msaa_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+            msaa_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            msaa_attachment.initialLayout = vk::ImageLayout::eUndefined;
+            msaa_attachment.finalLayout =
+                vk::ImageLayout::eColorAttachmentOptimal;
+            attachments.push_back(msaa_attachment);
+
+            refs.resolve = refs.color;
+            refs.color = color_ref(attachments.size() - 1);
+          }
+
+          if (depthTarget.view) {
+            auto depth_attachment = vk::AttachmentDescription();
+            depth_attachment.format = depthFormat;
+            depth_attachment.samples = msaaSamples;
+            depth_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+            depth_attachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+            depth_attachment.stencilLoadOp = vk::AttachmentLoadOp::eClear;
+            depth_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            depth_attachment.initialLayout = vk::ImageLayout::eUndefined;
+            depth_attachment.finalLayout =
+                vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            attachments.push_back(depth_attachment);
+
+            refs.depth = vk::AttachmentReference(
+                attachments.size() - 1,
+                vk::ImageLayout::eDepthStencilAttachmentOptimal);
+          }
+
+          dependencies.push_back(external_dependency);
+
+          if (depthPrepass) {
+            auto prepass = single_subpass(nullptr);
+            prepass.pDepthStencilAttachment = &refs.depth;
+            subpasses.push_back(prepass);
+
+            // scene depth tests must see the complete pre-pass depth
+            auto dependency = vk::SubpassDependency();
+            dependency.srcSubpass = 0;
+            dependency.dstSubpass = 1;
+            dependency.srcStageMask =
+                vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests;
+            dependency.srcAccessMask =
+                vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+            dependency.dstStageMask =
+                vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits::eLateFragmentTests;
+            dependency.dstAccessMask =
+                vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+            dependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+            dependencies.push_back(dependency);
+          }
+
+          auto subpass = single_subpass(&refs.color);
+          if (multisampled)
+            subpass.pResolveAttachments = &refs.resolve;
+          if (depthTarget.view)
+            subpass.pDepthStencilAttachment = &refs.depth;
+          subpasses.push_back(subpass);
+        };
+
+    // one clear value per attachment, indexed like the attachments
+    auto const clear_values_for =
+        [this](std::vector<vk::AttachmentDescription> const &attachments) {
+          auto clear_values = std::vector<vk::ClearValue>();
+          for (auto const &attachment : attachments) {
+            clear_values.push_back(
+                attachment.format == depthFormat
+                    ? vk::ClearValue{vk::ClearDepthStencilValue(1.0f, 0)}
+                    : vk::ClearValue{vk::ClearColorValue(
+                          std::array{1.0f, 0.3f, 0.0f, 1.0f})});
+          }
+          return clear_values;
+        };
+
+    auto scene_refs = SceneRefs{};
+    auto subpasses = std::vector<vk::SubpassDescription>();
+    auto dependencies = std::vector<vk::SubpassDependency>();
+
+    if (!postChain) {
+      auto attachments = std::vector{swapchain_attachment};
+      scene_subpasses(attachments, 0, scene_refs, subpasses, dependencies);
+
+      renderPass = create_pass(attachments, subpasses, dependencies);
+      renderPassClearValues = clear_values_for(attachments);
+    } else if (postOnTile) {
+      // attachments: 0 = swapchain, 1/2 = HDR ping-pong (1 = scene target)
+      auto attachments =
+          std::vector{swapchain_attachment, hdr_attachment, hdr_attachment};
+
+      constexpr auto stage_count = postStages.size();
+      constexpr auto ping = std::array<uint32_t, 2>{1, 2};
+
+      scene_subpasses(attachments, ping[0], scene_refs, subpasses,
+                      dependencies);
+
+      // stage k reads ping[k % 2] and writes ping[(k + 1) % 2], the last
+      // stage writes the swapchain
+      auto color_refs = std::array<vk::AttachmentReference, stage_count>();
+      auto input_refs = std::array<vk::AttachmentReference, stage_count>();
+
+      for (auto k = 0U; k < stage_count; ++k) {
+        auto const is_last = k + 1 == stage_count;
+        auto const subpass_index = sceneSubpass + k + 1;
+
+        input_refs[k] = vk::AttachmentReference(
+            ping[k % 2], vk::ImageLayout::eShaderReadOnlyOptimal);
+        color_refs[k] = color_ref(is_last ? 0 : ping[(k + 1) % 2]);
+
+        auto subpass = single_subpass(&color_refs[k]);
+        subpass.inputAttachmentCount = 1;
+        subpass.pInputAttachments = &input_refs[k];
+        subpasses.push_back(subpass);
+
+        // RAW on the input, WAR on the attachment read by the previous stage;
+        // by-region so tilers can keep everything on chip
+        auto dependency = vk::SubpassDependency();
+        dependency.srcSubpass = subpass_index - 1;
+        dependency.dstSubpass = subpass_index;
+        dependency.srcStageMask =
+            vk::PipelineStageFlagBits::eColorAttachmentOutput |
+            vk::PipelineStageFlagBits::eFragmentShader;
+        dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        dependency.dstStageMask =
+            vk::PipelineStageFlagBits::eFragmentShader |
+            vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        dependency.dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead |
+                                   vk::AccessFlagBits::eColorAttachmentWrite;
+        dependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+        dependencies.push_back(dependency);
+      }
+
+      renderPass = create_pass(attachments, subpasses, dependencies);
+      renderPassClearValues = clear_values_for(attachments);
+    } else {
+      auto scene_attachments = std::vector{hdr_attachment};
+      scene_subpasses(scene_attachments, 0, scene_refs, subpasses,
+                      dependencies);
+
+      scenePass = create_pass(scene_attachments, subpasses, dependencies);
+      scenePassClearValues = clear_values_for(scene_attachments);
+
+      auto const attachments = std::vector{swapchain_attachment};
+      auto const swapchain_ref = color_ref(0);
+      auto const composite_subpass = single_subpass(&swapchain_ref);
+
+      renderPass = create_pass(attachments, std::array{composite_subpass},
+                               std::array{external_dependency});
+      renderPassClearValues = clear_values_for(attachments);
     }
 
     if (Args::verbose() > 0)
-      std::cerr << std::format("{}:{}: Render pass created\n", __FILE__,
-                               __LINE__);
+      std::cerr << std::format(
+          "{}:{}: Render pass created ({}, {}, depth {}{})\n", __FILE__,
+          __LINE__,
+          !postChain   ? "no post chain"
+          : postOnTile ? "on-tile post chain"
+                       : "compute post chain",
+          vk::to_string(msaaSamples), vk::to_string(depthFormat),
+          depthPrepass ? " with pre-pass" : "");
   }
 
   void createGraphicsPipeline() {
@@ -627,7 +1664,9 @@ private:
 
     auto multisampling = vk::PipelineMultisampleStateCreateInfo();
     multisampling.sampleShadingEnable = vk::Bool32{false};
-    multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+    multisampling.rasterizationSamples = msaaSamples;
+
+    auto const depth_stencil = depthStencilState();
 
     auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
     color_blend_attachment.colorWriteMask =
@@ -665,10 +1704,11 @@ private:
     pipeline_info.pViewportState = &viewport_state;
     pipeline_info.pRasterizationState = &rasterizer;
     pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth_stencil;
     pipeline_info.pColorBlendState = &color_blending;
     pipeline_info.layout = pipelineLayout;
-    pipeline_info.renderPass = renderPass;
-    pipeline_info.subpass = 0;
+    pipeline_info.renderPass = sceneTarget().render_pass;
+    pipeline_info.subpass = sceneTarget().subpass;
     pipeline_info.basePipelineHandle = nullptr;
 
     if (auto pipeline_result =
@@ -694,6 +1734,16 @@ private:
 
     for (auto i = 0U; i < imageViews.size(); ++i) {
       auto attachments = std::vector{imageViews[i]};
+      if (postChain && postOnTile) {
+        attachments.push_back(postTargets[0].view);
+        attachments.push_back(postTargets[1].view);
+      }
+      if (msaaColor.view && !scenePass) {
+        attachments.push_back(msaaColor.view);
+      }
+      if (depthTarget.view && !scenePass) {
+        attachments.push_back(depthTarget.view);
+      }
 
       auto framebuffer_info = vk::FramebufferCreateInfo();
       framebuffer_info.renderPass = renderPass;
@@ -709,11 +1759,504 @@ private:
       }
     }
 
+    if (scenePass) {
+      auto attachments = std::vector{postTargets[0].view};
+      if (msaaColor.view) {
+        attachments.push_back(msaaColor.view);
+      }
+      if (depthTarget.view) {
+        attachments.push_back(depthTarget.view);
+      }
+
+      auto framebuffer_info = vk::FramebufferCreateInfo();
+      framebuffer_info.renderPass = scenePass;
+      framebuffer_info.attachmentCount = attachments.size();
+      framebuffer_info.pAttachments = attachments.data();
+      framebuffer_info.width = extent.width;
+      framebuffer_info.height = extent.height;
+      framebuffer_info.layers = 1;
+
+      sceneFramebuffer = device.createFramebuffer(framebuffer_info);
+      if (!sceneFramebuffer) {
+        throw std::runtime_error("failed to create scene framebuffer");
+      }
+    }
+
     if (Args::verbose() > 0)
       std::cerr << std::format("{}:{}: Framebuffers created for {} images\n",
                                __FILE__, __LINE__, imageViews.size());
   }
 
+  /**
+   * Decide whether/how the post chain runs and create its HDR ping-pong
+   * targets. The on-tile path uses transient input attachments (lazily
+   * allocated where possible); the compute path needs real storage images.
+   * "auto" picks on-tile when the device has lazily allocated memory, which
+   * in practice means a tile-based GPU.
+   */
+  void createPostTargets() {
+    postChain = postChainEnabled.value_or(
+        std::get<bool>(Config::get(Config::Key::GFX_POST_CHAIN)));
+    postOnTile = false;
+    if (!postChain)
+      return;
+
+    auto const path =
+        std::get<std::string>(Config::get(Config::Key::GFX_POST_PATH));
+
+    // the compute fallback records dispatches on the graphics queue
+    auto const compute_capable =
+        (physicalDevice.getQueueFamilyProperties()
+             .at(*queueFamilyIndices.graphicsFamily)
+             .queueFlags &
+         vk::QueueFlagBits::eCompute) &&
+        (physicalDevice.getFormatProperties(postTargetFormat)
+             .optimalTilingFeatures &
+         vk::FormatFeatureFlagBits::eStorageImage);
+
+    if (path == "subpass") {
+      postOnTile = true;
+    } else if (path == "compute") {
+      postOnTile = !compute_capable;
+      if (postOnTile)
+        std::cerr << std::format("{}:{}: warning: compute post path not "
+                                 "supported, using subpasses\n",
+                                 __FILE__, __LINE__);
+    } else {
+      if (path != "auto")
+        std::cerr << std::format(
+            "{}:{}: warning: unknown post path '{}', using auto\n", __FILE__,
+            __LINE__, path);
+      postOnTile = hasLazyMemory() || !compute_capable;
+    }
+
+    auto const usage =
+        postOnTile ? vk::ImageUsageFlagBits::eColorAttachment |
+                         vk::ImageUsageFlagBits::eInputAttachment |
+                         vk::ImageUsageFlagBits::eTransientAttachment
+                   : vk::ImageUsageFlagBits::eColorAttachment |
+                         vk::ImageUsageFlagBits::eStorage |
+                         vk::ImageUsageFlagBits::eSampled;
+
+    for (auto &target : postTargets) {
+      target = createAttachmentImage(postTargetFormat, usage,
+                                     vk::ImageAspectFlagBits::eColor);
+    }
+
+    if (Args::verbose() > 0)
+      std::cerr << std::format("{}:{}: Post chain targets created ({})\n",
+                               __FILE__, __LINE__,
+                               postOnTile ? "on-tile" : "compute");
+  }
+
+  /**
+   * Pick the scene sample count from the Config MSAA tier, clamped to what
+   * the device supports for both colour and depth framebuffers, and create
+   * the multisampled colour target. It is only ever resolved, never stored,
+   * so it is transient and lives in lazily allocated memory where available.
+   */
+  void createMultisampleTargets() {
+    auto const tier = msaaTier.value_or(
+        std::get<std::string>(Config::get(Config::Key::GFX_MSAA)));
+
+    static auto const tiers =
+        std::unordered_map<std::string, vk::SampleCountFlagBits>{
+            {"off", vk::SampleCountFlagBits::e1},
+            {"low", vk::SampleCountFlagBits::e2},
+            {"medium", vk::SampleCountFlagBits::e4},
+            {"high", vk::SampleCountFlagBits::e8}};
+
+    auto requested = vk::SampleCountFlagBits::e1;
+    if (auto const found = tiers.find(tier); found != tiers.end()) {
+      requested = found->second;
+    } else {
+      std::cerr << std::format(
+          "{}:{}: warning: unknown MSAA tier '{}', disabling MSAA\n", __FILE__,
+          __LINE__, tier);
+    }
+
+    auto const limits = physicalDevice.getProperties().limits;
+    auto const supported = limits.framebufferColorSampleCounts &
+                           limits.framebufferDepthSampleCounts;
+
+    // highest supported count not above the requested one
+    msaaSamples = vk::SampleCountFlagBits::e1;
+    for (auto const candidate :
+         {vk::SampleCountFlagBits::e8, vk::SampleCountFlagBits::e4,
+          vk::SampleCountFlagBits::e2}) {
+      if (candidate <= requested && (supported & candidate)) {
+        msaaSamples = candidate;
+        break;
+      }
+    }
+
+    if (msaaSamples == vk::SampleCountFlagBits::e1)
+      return;
+
+    msaaColor = createAttachmentImage(
+        postChain ? postTargetFormat : format,
+        vk::ImageUsageFlagBits::eColorAttachment |
+            vk::ImageUsageFlagBits::eTransientAttachment,
+        vk::ImageAspectFlagBits::eColor, msaaSamples);
+
+    if (Args::verbose() > 0)
+      std::cerr << std::format("{}:{}: MSAA {} ({} requested){}\n", __FILE__,
+                               __LINE__, vk::to_string(msaaSamples),
+                               vk::to_string(requested),
+                               msaaColor.lazy ? ", lazily allocated" : "");
+  }
+
+  /**
+   * Pick the best supported depth format (D32_SFLOAT, D24_UNORM_S8_UINT,
+   * D16_UNORM in that order) and create the depth target alongside the
+   * swapchain, so it is recreated with it on resize. Depth is never stored,
+   * so the target is transient (lazily allocated where available).
+   */
+  void createDepthTarget() {
+    depthFormat = vk::Format::eUndefined;
+    depthPrepass = false;
+    sceneSubpass = 0;
+
+    if (!std::get<bool>(Config::get(Config::Key::GFX_DEPTH)))
+      return;
+
+    for (auto const candidate :
+         {vk::Format::eD32Sfloat, vk::Format::eD24UnormS8Uint,
+          vk::Format::eD16Unorm}) {
+      if (physicalDevice.getFormatProperties(candidate).optimalTilingFeatures &
+          vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+        depthFormat = candidate;
+        break;
+      }
+    }
+
+    if (depthFormat == vk::Format::eUndefined) {
+      std::cerr << std::format(
+          "{}:{}: warning: no supported depth format, depth disabled\n",
+          __FILE__, __LINE__);
+      return;
+    }
+
+    auto const aspect =
+        depthFormat == vk::Format::eD24UnormS8Uint
+            ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil
+            : vk::ImageAspectFlags{vk::ImageAspectFlagBits::eDepth};
+
+    depthTarget = createAttachmentImage(
+        depthFormat,
+        vk::ImageUsageFlagBits::eDepthStencilAttachment |
+            vk::ImageUsageFlagBits::eTransientAttachment,
+        aspect, msaaSamples);
+
+    depthPrepass =
+        std::get<bool>(Config::get(Config::Key::GFX_DEPTH_PREPASS));
+    sceneSubpass = depthPrepass ? 1 : 0;
+
+    if (Args::verbose() > 0)
+      std::cerr << std::format("{}:{}: Depth target {} created{}{}\n",
+                               __FILE__, __LINE__, vk::to_string(depthFormat),
+                               depthTarget.lazy ? " (lazily allocated)" : "",
+                               depthPrepass ? ", depth pre-pass on" : "");
+  }
+
+  /**
+   * One pipeline and descriptor set per PostStage: fullscreen subpass
+   * pipelines on the on-tile path, compute pipelines plus a final sampled
+   * composite pipeline on the fallback path.
+   * Preconditions: createPostTargets, createRenderPass
+   */
+  void createPostPipelines() {
+    if (!postChain)
+      return;
+
+    static auto const vert_code = std::vector<uint32_t>{
+#include "shaders/fullscreen.vert.spv"
+    };
+    static auto const subpass_frag_code = std::vector<uint32_t>{
+#include "shaders/post_subpass.frag.spv"
+    };
+    static auto const sampled_frag_code = std::vector<uint32_t>{
+#include "shaders/post_sampled.frag.spv"
+    };
+    static auto const comp_code = std::vector<uint32_t>{
+#include "shaders/post.comp.spv"
+    };
+
+    constexpr auto stage_count = static_cast<uint32_t>(postStages.size());
+
+    // descriptor set layouts
+    auto const graphics_binding = vk::DescriptorSetLayoutBinding(
+        0,
+        postOnTile ? vk::DescriptorType::eInputAttachment
+                   : vk::DescriptorType::eCombinedImageSampler,
+        1, vk::ShaderStageFlagBits::eFragment);
+
+    postSetLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, graphics_binding));
+    if (!postSetLayout) {
+      throw std::runtime_error("failed to create post descriptor set layout");
+    }
+
+    auto const graphics_push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eFragment, 0, sizeof(PostParams));
+
+    postPipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, postSetLayout, graphics_push_range));
+    if (!postPipelineLayout) {
+      throw std::runtime_error("failed to create post pipeline layout");
+    }
+
+    if (!postOnTile) {
+      auto const compute_bindings = std::array{
+          vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage,
+                                         1, vk::ShaderStageFlagBits::eCompute),
+          vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage,
+                                         1, vk::ShaderStageFlagBits::eCompute),
+      };
+
+      postComputeSetLayout = device.createDescriptorSetLayout(
+          vk::DescriptorSetLayoutCreateInfo({}, compute_bindings));
+      if (!postComputeSetLayout) {
+        throw std::runtime_error(
+            "failed to create post compute descriptor set layout");
+      }
+
+      auto const compute_push_range = vk::PushConstantRange(
+          vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostParams));
+
+      postComputePipelineLayout =
+          device.createPipelineLayout(vk::PipelineLayoutCreateInfo(
+              {}, postComputeSetLayout, compute_push_range));
+      if (!postComputePipelineLayout) {
+        throw std::runtime_error(
+            "failed to create post compute pipeline layout");
+      }
+
+      postSampler = device.createSampler(vk::SamplerCreateInfo(
+          {}, vk::Filter::eNearest, vk::Filter::eNearest,
+          vk::SamplerMipmapMode::eNearest,
+          vk::SamplerAddressMode::eClampToEdge,
+          vk::SamplerAddressMode::eClampToEdge,
+          vk::SamplerAddressMode::eClampToEdge));
+      if (!postSampler) {
+        throw std::runtime_error("failed to create post sampler");
+      }
+    }
+
+    // descriptor sets
+    auto const pool_sizes =
+        postOnTile
+            ? std::vector{vk::DescriptorPoolSize(
+                  vk::DescriptorType::eInputAttachment, stage_count)}
+            : std::vector{
+                  vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage,
+                                         2 * (stage_count - 1)),
+                  vk::DescriptorPoolSize(
+                      vk::DescriptorType::eCombinedImageSampler, 1)};
+
+    postDescriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, stage_count, pool_sizes));
+    if (!postDescriptorPool) {
+      throw std::runtime_error("failed to create post descriptor pool");
+    }
+
+    auto set_layouts = std::vector<vk::DescriptorSetLayout>(
+        stage_count, postOnTile ? postSetLayout : postComputeSetLayout);
+    set_layouts.back() = postSetLayout;
+
+    postDescriptorSets = device.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo(postDescriptorPool, set_layouts));
+
+    // stage k reads postTargets[k % 2] and writes postTargets[(k + 1) % 2]
+    for (auto k = 0U; k < stage_count; ++k) {
+      auto const is_last = k + 1 == stage_count;
+      auto const &src = postTargets[k % 2];
+      auto const &dst = postTargets[(k + 1) % 2];
+
+      if (postOnTile) {
+        auto const src_info = vk::DescriptorImageInfo(
+            nullptr, src.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+        device.updateDescriptorSets(
+            vk::WriteDescriptorSet(postDescriptorSets[k], 0, 0,
+                                   vk::DescriptorType::eInputAttachment,
+                                   src_info),
+            nullptr);
+      } else if (is_last) {
+        auto const src_info = vk::DescriptorImageInfo(
+            postSampler, src.view, vk::ImageLayout::eGeneral);
+        device.updateDescriptorSets(
+            vk::WriteDescriptorSet(postDescriptorSets[k], 0, 0,
+                                   vk::DescriptorType::eCombinedImageSampler,
+                                   src_info),
+            nullptr);
+      } else {
+        auto const src_info =
+            vk::DescriptorImageInfo(nullptr, src.view, vk::ImageLayout::eGeneral);
+        auto const dst_info =
+            vk::DescriptorImageInfo(nullptr, dst.view, vk::ImageLayout::eGeneral);
+        device.updateDescriptorSets(
+            std::array{
+                vk::WriteDescriptorSet(postDescriptorSets[k], 0, 0,
+                                       vk::DescriptorType::eStorageImage,
+                                       src_info),
+                vk::WriteDescriptorSet(postDescriptorSets[k], 1, 0,
+                                       vk::DescriptorType::eStorageImage,
+                                       dst_info)},
+            nullptr);
+      }
+    }
+
+    // pipelines
+    auto const vert_module = createShaderModule(vert_code);
+    auto const frag_module = createShaderModule(
+        postOnTile ? subpass_frag_code : sampled_frag_code);
+    auto const comp_module =
+        postOnTile ? vk::ShaderModule{} : createShaderModule(comp_code);
+
+    auto const spec_entry = vk::SpecializationMapEntry(0, 0, sizeof(int32_t));
+
+    auto const create_fullscreen = [&](PostStage stage, uint32_t subpass) {
+      auto const stage_value = static_cast<int32_t>(stage);
+      auto const spec_info = vk::SpecializationInfo(
+          1, &spec_entry, sizeof(int32_t), &stage_value);
+
+      auto const shader_stages = std::array{
+          vk::PipelineShaderStageCreateInfo(
+              {}, vk::ShaderStageFlagBits::eVertex, vert_module, "main"),
+          vk::PipelineShaderStageCreateInfo(
+              {}, vk::ShaderStageFlagBits::eFragment, frag_module, "main",
+              &spec_info)};
+
+      auto const vertex_input_info = vk::PipelineVertexInputStateCreateInfo();
+
+      auto input_assembly = vk::PipelineInputAssemblyStateCreateInfo();
+      input_assembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+      auto const viewport =
+          vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width),
+                       static_cast<float>(extent.height), 0.0f, 1.0f);
+      auto const scissor = vk::Rect2D(vk::Offset2D(0, 0), extent);
+      auto const viewport_state =
+          vk::PipelineViewportStateCreateInfo({}, viewport, scissor);
+
+      auto rasterizer = vk::PipelineRasterizationStateCreateInfo();
+      rasterizer.polygonMode = vk::PolygonMode::eFill;
+      rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+      rasterizer.lineWidth = 1.0f;
+
+      auto multisampling = vk::PipelineMultisampleStateCreateInfo();
+      multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+      auto color_blend_attachment = vk::PipelineColorBlendAttachmentState();
+      color_blend_attachment.colorWriteMask =
+          vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+      auto const color_blending = vk::PipelineColorBlendStateCreateInfo(
+          {}, vk::Bool32{false}, vk::LogicOp::eCopy, color_blend_attachment);
+
+      auto pipeline_info = vk::GraphicsPipelineCreateInfo();
+      pipeline_info.stageCount = shader_stages.size();
+      pipeline_info.pStages = shader_stages.data();
+      pipeline_info.pVertexInputState = &vertex_input_info;
+      pipeline_info.pInputAssemblyState = &input_assembly;
+      pipeline_info.pViewportState = &viewport_state;
+      pipeline_info.pRasterizationState = &rasterizer;
+      pipeline_info.pMultisampleState = &multisampling;
+      pipeline_info.pColorBlendState = &color_blending;
+      pipeline_info.layout = postPipelineLayout;
+      pipeline_info.renderPass = renderPass;
+      pipeline_info.subpass = subpass;
+
+      auto pipeline_result =
+          device.createGraphicsPipeline(nullptr, pipeline_info);
+      if (pipeline_result.result != vk::Result::eSuccess) {
+        throw std::runtime_error(
+            std::format("failed to create post pipeline: {}\n",
+                        vk::to_string(pipeline_result.result)));
+      }
+      return pipeline_result.value;
+    };
+
+    auto const create_compute = [&](PostStage stage) {
+      auto const stage_value = static_cast<int32_t>(stage);
+      auto const spec_info = vk::SpecializationInfo(
+          1, &spec_entry, sizeof(int32_t), &stage_value);
+
+      auto const pipeline_info = vk::ComputePipelineCreateInfo(
+          {},
+          vk::PipelineShaderStageCreateInfo(
+              {}, vk::ShaderStageFlagBits::eCompute, comp_module, "main",
+              &spec_info),
+          postComputePipelineLayout);
+
+      auto pipeline_result =
+          device.createComputePipeline(nullptr, pipeline_info);
+      if (pipeline_result.result != vk::Result::eSuccess) {
+        throw std::runtime_error(
+            std::format("failed to create post compute pipeline: {}\n",
+                        vk::to_string(pipeline_result.result)));
+      }
+      return pipeline_result.value;
+    };
+
+    postPipelines.resize(stage_count);
+    for (auto k = 0U; k < stage_count; ++k) {
+      auto const is_last = k + 1 == stage_count;
+
+      if (postOnTile)
+        postPipelines[k] = create_fullscreen(postStages[k], sceneSubpass + k + 1);
+      else if (is_last)
+        postPipelines[k] = create_fullscreen(postStages[k], 0);
+      else
+        postPipelines[k] = create_compute(postStages[k]);
+    }
+
+    device.destroyShaderModule(vert_module);
+    device.destroyShaderModule(frag_module);
+    if (comp_module)
+      device.destroyShaderModule(comp_module);
+
+    if (Args::verbose() > 0)
+      std::cerr << std::format("{}:{}: {} post pipelines created\n", __FILE__,
+                               __LINE__, postPipelines.size());
+  }
+
+  void destroyPostPipelines() {
+    for (auto &post_pipeline : postPipelines)
+      device.destroyPipeline(post_pipeline);
+    postPipelines.clear();
+
+    if (postDescriptorPool) {
+      device.destroyDescriptorPool(postDescriptorPool); // frees the sets
+      postDescriptorPool = nullptr;
+      postDescriptorSets.clear();
+    }
+
+    if (postSampler) {
+      device.destroySampler(postSampler);
+      postSampler = nullptr;
+    }
+
+    for (auto *layout : {&postPipelineLayout, &postComputePipelineLayout}) {
+      if (*layout) {
+        device.destroyPipelineLayout(*layout);
+        *layout = nullptr;
+      }
+    }
+
+    for (auto *layout : {&postSetLayout, &postComputeSetLayout}) {
+      if (*layout) {
+        device.destroyDescriptorSetLayout(*layout);
+        *layout = nullptr;
+      }
+    }
+
+    if (Args::verbose() > 1)
+      std::cerr << std::format("{}:{}: post pipelines destroyed\n", __FILE__,
+                               __LINE__);
+  }
+
   void createCommandPools() {
     // auto const &queueFamilyIndices = this->queueFamilyIndices;
 
@@ -763,16 +2306,13 @@ private:
   }
 
   void createCommandBuffers() {
-    auto const queue_family_indices = this->queueFamilyIndices;
-    auto const framebuffers = this->framebuffers;
-
     auto graphics_command_buffer_info = vk::CommandBufferAllocateInfo();
     graphics_command_buffer_info.commandPool = commandPools.graphics;
     graphics_command_buffer_info.level = vk::CommandBufferLevel::ePrimary;
-    graphics_command_buffer_info.commandBufferCount = framebuffers.size();
+    graphics_command_buffer_info.commandBufferCount = images.size();
 
     commandBuffers.graphics = device.allocateCommandBuffers(
-        graphics_command_buffer_info); // one for each framebuffer
+        graphics_command_buffer_info); // one for each swapchain image
     if (commandBuffers.graphics.empty()) {
       throw std::runtime_error("failed to allocate graphics command buffers");
     }
@@ -791,10 +2331,10 @@ private:
     auto present_command_buffer_info = vk::CommandBufferAllocateInfo();
     present_command_buffer_info.commandPool = commandPools.present;
     present_command_buffer_info.level = vk::CommandBufferLevel::ePrimary;
-    present_command_buffer_info.commandBufferCount = 1;
+    present_command_buffer_info.commandBufferCount = images.size();
 
     commandBuffers.present = device.allocateCommandBuffers(
-        present_command_buffer_info); // one for each framebuffer
+        present_command_buffer_info); // one for each swapchain image
     if (commandBuffers.present.empty()) {
       throw std::runtime_error("failed to allocate present command buffers");
     }
@@ -802,10 +2342,10 @@ private:
     auto compute_command_buffer_info = vk::CommandBufferAllocateInfo();
     compute_command_buffer_info.commandPool = commandPools.compute;
     compute_command_buffer_info.level = vk::CommandBufferLevel::ePrimary;
-    compute_command_buffer_info.commandBufferCount = 1;
+    compute_command_buffer_info.commandBufferCount = images.size();
 
     commandBuffers.compute = device.allocateCommandBuffers(
-        compute_command_buffer_info); // one for each framebuffer
+        compute_command_buffer_info); // one for each swapchain image
     if (commandBuffers.compute.empty()) {
       throw std::runtime_error("failed to allocate compute command buffers");
     }
@@ -830,6 +2370,13 @@ private:
       throw std::runtime_error("failed to create render finished semaphore");
     }
 
+    auto compute_release_semaphore_info = vk::SemaphoreCreateInfo();
+    computeReleaseSemaphore =
+        device.createSemaphore(compute_release_semaphore_info);
+    if (!computeReleaseSemaphore) {
+      throw std::runtime_error("failed to create compute release semaphore");
+    }
+
     auto in_flight_fence_info = vk::FenceCreateInfo();
     in_flight_fence_info.flags = vk::FenceCreateFlagBits::eSignaled;
     inFlightFence = device.createFence(in_flight_fence_info);
@@ -842,6 +2389,62 @@ private:
                                __LINE__);
   }
 
+  /**
+   * Two timestamp queries for the GPU frame time, when the graphics family
+   * supports timestamps
+   */
+  void createFrameQueries() {
+    auto const families = physicalDevice.getQueueFamilyProperties();
+    auto const valid_bits =
+        families[*queueFamilyIndices.graphicsFamily].timestampValidBits;
+    timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+    if (valid_bits == 0 || timestampPeriod <= 0.0) {
+      if (Args::verbose() > 0)
+        std::cerr << std::format(
+            "{}:{}: no graphics queue timestamps, GPU frame time unknown\n",
+            __FILE__, __LINE__);
+      return;
+    }
+    timestampMask =
+        valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+
+    auto query_pool_info = vk::QueryPoolCreateInfo();
+    query_pool_info.queryType = vk::QueryType::eTimestamp;
+    query_pool_info.queryCount = 2;
+    frameQueries = device.createQueryPool(query_pool_info);
+    frameQueriesWritten = false;
+
+    if (Args::verbose() > 0)
+      std::cerr << std::format("{}:{}: Frame queries created\n", __FILE__,
+                               __LINE__);
+  }
+
+  /**
+   * Look up the stored autotuner results for the selected device, once
+   * Preconditions: physical device selected
+   */
+  void loadDeviceTuning() {
+    if (!tuningKey.empty())
+      return;
+
+    auto const properties = physicalDevice.getProperties();
+    tuningKey = deviceTuningKey(
+        properties.vendorID, properties.deviceID,
+        std::span<uint8_t const, VK_UUID_SIZE>(properties.pipelineCacheUUID),
+        properties.driverVersion);
+
+    auto const stored = Config::section("/autotune/" + tuningKey);
+    tuningStored = !stored.is_null();
+    if (tuningStored)
+      tuning = DeviceTuning::fromJson(stored);
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format("{}:{}: device {}: {}\n", __FILE__, __LINE__,
+                               tuningKey,
+                               tuningStored ? stored.dump() : "not tuned yet");
+    }
+  }
+
   /**
    * Create the Vk swapchain (the chain of images that are presented to screen.
    * Supports separate graphics and present queues.
@@ -886,11 +2489,40 @@ private:
     auto const present_modes =
         physicalDevice.getSurfacePresentModesKHR(*surface);
 
+    // compute-written swapchain: needs eStorage on the surface and a format
+    // that can be bound as a storage image (sRGB formats generally can't)
+    computePresent =
+        std::get<bool>(Config::get(Config::Key::GFX_COMPUTE_PRESENT));
+
+    auto const storage_format = std::ranges::find_if(
+        formats, [this](auto const &format) {
+          return (format.format == vk::Format::eB8G8R8A8Unorm ||
+                  format.format == vk::Format::eR8G8B8A8Unorm) &&
+                 format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear &&
+                 (physicalDevice.getFormatProperties(format.format)
+                      .optimalTilingFeatures &
+                  vk::FormatFeatureFlagBits::eStorageImage);
+        });
+
+    if (computePresent &&
+        (!(capabilities.supportedUsageFlags &
+           vk::ImageUsageFlagBits::eStorage) ||
+         storage_format == formats.end())) {
+      std::cerr << std::format(
+          "{}:{}: warning: surface does not support storage swapchain images; "
+          "falling back to render pass presentation\n",
+          __FILE__, __LINE__);
+      computePresent = false;
+    }
+
     // try to find a suitable format
-    auto const format = std::ranges::find_if(formats, [](auto const &format) {
-      return format.format == vk::Format::eB8G8R8A8Srgb &&
-             format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear;
-    });
+    auto const format =
+        computePresent
+            ? storage_format
+            : std::ranges::find_if(formats, [](auto const &format) {
+                return format.format == vk::Format::eB8G8R8A8Srgb &&
+                       format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear;
+              });
 
     if (format == formats.end()) {
       throw std::runtime_error("failed to find suitable surface format");
@@ -904,19 +2536,26 @@ private:
       }
     }
 
-    auto const present_mode =
-        std::ranges::find_if(present_modes, [](auto const &presentMode) {
-          return presentMode == vk::PresentModeKHR::eFifo; // vsync
-        });
+    // the tuned present mode if the surface has it, else FIFO (vsync)
+    auto const tuned_mode = presentModeByName(tuning.present_mode);
+    auto present_mode = std::ranges::find(present_modes, tuned_mode);
+    if (present_mode == present_modes.end()) {
+      present_mode =
+          std::ranges::find(present_modes, vk::PresentModeKHR::eFifo);
+    }
 
     if (present_mode == present_modes.end()) {
       throw std::runtime_error("failed to find suitable present mode");
     }
 
-    // we need at least one more image than the minimum
+    // we need at least one more image than the minimum, unless tuned
     auto const image_count = std::clamp(
-        capabilities.minImageCount + 1, capabilities.minImageCount,
-        capabilities.maxImageCount == 0 ? 3 : capabilities.maxImageCount);
+        tuning.image_count > 0 ? tuning.image_count
+                               : capabilities.minImageCount + 1,
+        capabilities.minImageCount,
+        capabilities.maxImageCount == 0
+            ? std::max(capabilities.minImageCount + 2, 3U)
+            : capabilities.maxImageCount);
 
     auto create_info = vk::SwapchainCreateInfoKHR{};
     create_info.surface = *surface;
@@ -925,14 +2564,23 @@ private:
     create_info.imageColorSpace = format->colorSpace;
     create_info.imageExtent = extent;
     create_info.imageArrayLayers = 1;
-    create_info.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    create_info.imageUsage = computePresent
+                                 ? vk::ImageUsageFlagBits::eStorage |
+                                       vk::ImageUsageFlagBits::eTransferDst
+                                 : vk::ImageUsageFlagBits::eColorAttachment;
 
     if (!queueFamilyIndices.isComplete()) {
       throw std::runtime_error("queue family indices are not complete");
     }
 
     // we need to specify the queue families that will access the images
-    if (queueFamilyIndices.graphicsFamily != queueFamilyIndices.presentFamily) {
+    if (computePresent) {
+      // compute-written images are owned by one family at a time; ownership
+      // is explicitly transferred to the present family each frame (see
+      // submitComputeFrame)
+      create_info.imageSharingMode = vk::SharingMode::eExclusive;
+    } else if (queueFamilyIndices.graphicsFamily !=
+               queueFamilyIndices.presentFamily) {
       create_info.imageSharingMode = vk::SharingMode::eConcurrent;
       create_info.queueFamilyIndexCount = 2;
       create_info.pQueueFamilyIndices =
@@ -960,8 +2608,9 @@ private:
     }
 
     if (Args::verbose() > 0)
-      std::cerr << std::format("Swapchain created with {} images\n",
-                               images.size());
+      std::cerr << std::format("Swapchain created with {} images, {}{}\n",
+                               images.size(), vk::to_string(*present_mode),
+                               computePresent ? " (compute-written)" : "");
   }
 
   /**
@@ -1074,11 +2723,20 @@ private:
         std::vector{"VK_KHR_swapchain"}; // required extension
                                          // createSwapchain requires it
 
+    // one indirect draw for many instanced ranges (point cloud nodes)
+    auto const supported_features = physicalDevice.getFeatures();
+    multiDrawIndirect = supported_features.multiDrawIndirect &&
+                        supported_features.drawIndirectFirstInstance;
+    auto enabled_features = vk::PhysicalDeviceFeatures();
+    enabled_features.multiDrawIndirect = vk::Bool32{multiDrawIndirect};
+    enabled_features.drawIndirectFirstInstance = vk::Bool32{multiDrawIndirect};
+
     auto device_create_info = vk::DeviceCreateInfo{};
     device_create_info.queueCreateInfoCount = queue_create_infos.size();
     device_create_info.pQueueCreateInfos = queue_create_infos.data();
     device_create_info.setEnabledExtensionCount(exts.size());
     device_create_info.setPpEnabledExtensionNames(exts.data());
+    device_create_info.pEnabledFeatures = &enabled_features;
 
     device = physicalDevice.createDevice(device_create_info);
     if (!device) {
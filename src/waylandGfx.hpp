@@ -11,13 +11,20 @@ static_assert(__cplusplus >= 202002L, "C++20 required");
 #include <wayland-client.h>
 
 #include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <format>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <poll.h>
 #include <stdexcept>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "../args.hpp"
+#include "autotune.hpp"
 #include "platformGfx.hpp"
 #include "vulkanCommon.hpp"
 #include "xdg-decoration-client-protocol.h"
@@ -35,6 +42,26 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
   WaylandGfx &operator=(const WaylandGfx &) = delete;
   WaylandGfx &operator=(WaylandGfx &&) = delete;
 
+  using VulkanGfxBase::ComputeTarget;
+  using VulkanGfxBase::ComputeWriter;
+  using VulkanGfxBase::FrameHook;
+  using VulkanGfxBase::PassTarget;
+  using VulkanGfxBase::PostParams;
+  using VulkanGfxBase::Recorder;
+  using VulkanGfxBase::setComputeWriter;
+  using VulkanGfxBase::setDepthPrepassRecorder;
+  using VulkanGfxBase::setFrameBeginHook;
+  using VulkanGfxBase::setOverlayRecorder;
+  using VulkanGfxBase::setPostParams;
+  using VulkanGfxBase::setSceneRecorder;
+  using VulkanGfxBase::waitBeforeNextFrame;
+
+  using VulkanGfxBase::depthPrepassTarget;
+  using VulkanGfxBase::depthStencilState;
+  using VulkanGfxBase::gpuContext;
+  using VulkanGfxBase::overlayTarget;
+  using VulkanGfxBase::sceneTarget;
+
   struct Window;
 
   struct Display {
@@ -747,6 +774,23 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
   std::atomic<bool> initialized = false;
   std::function<bool()> on_tick = []() { return true; };
 
+  struct EventSource {
+    int fd;
+    std::function<void()> on_readable;
+  };
+  std::vector<EventSource> eventSources;
+  std::vector<pollfd> pollFds;
+
+  // waiting on the frame fence and image acquisition in the last redraw
+  std::chrono::steady_clock::duration lastBlocked{};
+
+  // recording and submitting the last redraw, without lastBlocked
+  std::chrono::steady_clock::duration lastRecorded{};
+
+  // applied at the start of the next redraw
+  std::optional<std::string> pendingPresentMode;
+  std::optional<Quality> pendingQuality;
+
   auto getGeometry() -> Geometry override { return window->geometry; }
 
   void platformEventLoop(std::function<bool()> &&on_tick) override {
@@ -796,12 +840,72 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
       wl_callback_add_listener(cback, &frame_listener, this);
     }
 
-    while (display->dispatchEvents() != -1) {
+    // wl_display_dispatch blocks on the display alone; with extra sources
+    // the loop polls them together with it
+    while ((eventSources.empty() ? display->dispatchEvents()
+                                 : dispatchWithSources()) != -1) {
       if (window->closed)
         break;
     }
   }
 
+  void addEventSource(int fd, std::function<void()> &&on_readable) override {
+    eventSources.push_back({fd, std::move(on_readable)});
+  }
+
+  void removeEventSource(int fd) override {
+    std::erase_if(eventSources,
+                  [fd](EventSource const &source) { return source.fd == fd; });
+  }
+
+  /**
+   * One round of the event loop: wait until the display or an event source
+   * is readable, dispatch the display's events, then call the handlers of
+   * ready sources.
+   */
+  int dispatchWithSources() {
+    auto *wl = display->display;
+    while (wl_display_prepare_read(wl) != 0)
+      wl_display_dispatch_pending(wl);
+    wl_display_flush(wl);
+
+    pollFds.clear();
+    pollFds.push_back({wl_display_get_fd(wl), POLLIN, 0});
+    for (auto const &source : eventSources)
+      pollFds.push_back({source.fd, POLLIN, 0});
+
+    if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+      wl_display_cancel_read(wl);
+      return errno == EINTR ? 0 : -1;
+    }
+
+    if (pollFds[0].revents & POLLIN) {
+      if (wl_display_read_events(wl) == -1)
+        return -1;
+    } else {
+      wl_display_cancel_read(wl);
+    }
+    auto const dispatched = wl_display_dispatch_pending(wl);
+    if (dispatched == -1)
+      return -1;
+    if (display->ld_context != nullptr &&
+        libdecor_dispatch(display->ld_context, 0) < 0)
+      return -1;
+
+    for (auto i = size_t{1}; i < pollFds.size(); ++i) {
+      if (!(pollFds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      auto const source = std::ranges::find(eventSources, pollFds[i].fd,
+                                            &EventSource::fd);
+      if (source == eventSources.end())
+        continue; // removed by an earlier handler
+      // copied: the handler may add or remove sources
+      auto const on_readable = source->on_readable;
+      on_readable();
+    }
+    return dispatched;
+  }
+
   void init() override {
     display = std::make_shared<Display>();
 
@@ -828,14 +932,7 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
                 "{}:{}: re-initializing Vulkan on resize\n", __FILE__,
                 __LINE__);
 
-          this->initialized.store(false);
-          this->initialized.notify_all();
-
-          VulkanGfxBase::destroy();
-          VulkanGfxBase::init(nullptr);
-
-          this->initialized.store(true);
-          this->initialized.notify_all();
+          this->reinitSwapchain();
         });
 
     /* VulkanGfxBase::*/ VulkanGfxBase::init([&]() {
@@ -872,11 +969,57 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
 
     redraw();
 
+    // the trials hold up the first frames for seconds, so a device nobody
+    // tuned yet is only benchmarked when /display/autotune opts in
+    if (Args::autotune() ||
+        (!tuningStored &&
+         std::get<bool>(Config::get(Config::Key::GFX_AUTOTUNE))))
+      autotune();
+
     std::cerr << "WaylandGfx initialized\n";
   }
 
+  bool requestPresentMode(std::string const &mode) override {
+    auto const supported = physicalDevice.getSurfacePresentModesKHR(surface);
+    auto const wanted = presentModeByName(mode);
+    if ((wanted == vk::PresentModeKHR::eFifo && mode != "FIFO") ||
+        std::ranges::find(supported, wanted) == supported.end())
+      return false;
+    pendingPresentMode = mode;
+    return true;
+  }
+
+  void requestQuality(Quality const &quality) override {
+    pendingQuality = quality;
+  }
+
+  [[nodiscard]] FrameCost frameCost() const override {
+    return {.cpu_ms =
+                std::chrono::duration<double, std::milli>(lastRecorded).count(),
+            .gpu_ms = gpuFrameTime};
+  }
+
   void redraw() {
+    if (initialized && pendingPresentMode) {
+      // not persisted: the autotuner's choice stays in Config
+      tuning.present_mode = *std::exchange(pendingPresentMode, std::nullopt);
+      reinitSwapchain();
+    }
+
+    if (initialized && pendingQuality) {
+      auto const quality = *std::exchange(pendingQuality, std::nullopt);
+      auto const msaa = msaaTier.value_or(
+          std::get<std::string>(Config::get(Config::Key::GFX_MSAA)));
+      auto const post_chain = postChainEnabled.value_or(
+          std::get<bool>(Config::get(Config::Key::GFX_POST_CHAIN)));
+      msaaTier = quality.msaa;
+      postChainEnabled = quality.post_chain;
+      if (quality.msaa != msaa || quality.post_chain != post_chain)
+        reinitSwapchain();
+    }
+
     if (initialized) {
+      auto const blocked_since = std::chrono::steady_clock::now();
       if (device.waitForFences(1, &inFlightFence, vk::Bool32{true},
                                UINT64_MAX) != vk::Result::eSuccess) {
         throw std::runtime_error{std::format("{}:{}: vkWaitForFences erred out",
@@ -888,6 +1031,12 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
             std::format("{}:{}: vkResetFences erred out", __FILE__, __LINE__)};
       }
 
+      readFrameQueries();
+
+      if (frameBeginHook) {
+        frameBeginHook();
+      }
+
       uint32_t current_image_index = 0;
 
       if (device.acquireNextImageKHR(
@@ -896,40 +1045,36 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
         throw std::runtime_error{std::format(
             "{}:{}: vkAcquireNextImageKHR erred out", __FILE__, __LINE__)};
       }
+      auto const recording_since = std::chrono::steady_clock::now();
+      lastBlocked = recording_since - blocked_since;
+
+      if (computePresent) {
+        submitComputeFrame(current_image_index);
+        present(current_image_index);
+        lastRecorded = std::chrono::steady_clock::now() - recording_since;
+        return;
+      }
 
       commandBuffers.graphics[current_image_index].reset();
-      commandBuffers.present[0].reset();
 
       vk::CommandBufferBeginInfo begin_info;
       commandBuffers.graphics[current_image_index].begin(begin_info);
+      beginFrameQueries(commandBuffers.graphics[current_image_index]);
 
-      vk::RenderPassBeginInfo render_pass_info;
-      render_pass_info.renderPass = renderPass;
-      render_pass_info.framebuffer = framebuffers[current_image_index];
-      render_pass_info.renderArea.offset = {{0, 0}};
-      render_pass_info.renderArea.extent = extent;
-
-      vk::ClearValue clear_color =
-          vk::ClearColorValue(std::array{1.0f, 0.3f, 0.0f, 1.0f});
-      render_pass_info.clearValueCount = 1;
-      render_pass_info.pClearValues = &clear_color;
-
-      commandBuffers.graphics[current_image_index].beginRenderPass(
-          render_pass_info, vk::SubpassContents::eInline);
-
-      // commandBuffers.graphics[currentImageIndex].draw(0, 0, 0, 0);
-
-      commandBuffers.graphics[current_image_index].endRenderPass();
+      recordFrame(commandBuffers.graphics[current_image_index],
+                  current_image_index);
 
+      endFrameQueries(commandBuffers.graphics[current_image_index]);
       commandBuffers.graphics[current_image_index].end();
 
       auto submit_info = vk::SubmitInfo();
-      auto wait_stages = std::array<vk::PipelineStageFlags, 1>{
+      auto wait_semaphores =
+          std::vector<vk::Semaphore>{imageAvailableSemaphore};
+      auto wait_stages = std::vector<vk::PipelineStageFlags>{
           vk::PipelineStageFlagBits::eColorAttachmentOutput};
-      submit_info.waitSemaphoreCount = 1;
-      submit_info.pWaitSemaphores = &imageAvailableSemaphore;
-
-      submit_info.pWaitDstStageMask = wait_stages.data();
+      takeFrameWaits(wait_semaphores, wait_stages);
+      submit_info.setWaitSemaphores(wait_semaphores);
+      submit_info.setWaitDstStageMask(wait_stages);
       submit_info.commandBufferCount = 1;
 
       submit_info.pCommandBuffers =
@@ -947,17 +1092,123 @@ struct WaylandGfx : public PlatformGfx, protected VulkanGfxBase {
             std::format("{}:{}: vkQueue.submit erred out", __FILE__, __LINE__)};
       }
 
-      auto present_info = vk::PresentInfoKHR{};
-      present_info.waitSemaphoreCount = 1;
-      present_info.pWaitSemaphores = &renderFinishedSemaphore;
-      present_info.swapchainCount = 1;
-      present_info.pSwapchains = &swapchain;
-      present_info.pImageIndices = &current_image_index;
+      present(current_image_index);
+      lastRecorded = std::chrono::steady_clock::now() - recording_since;
+    }
+  };
+
+  /**
+   * Benchmark present modes, swapchain image counts and upload chunk sizes
+   * on this device, store the winners in Config under the device's key and
+   * switch to them. Takes a few seconds of frames. Frames in flight are not a
+   * trial: the frame loop has one inFlightFence, see DeviceTuning.
+   */
+  void autotune() {
+    constexpr auto warmup_frames = 5;
+    constexpr auto measured_frames = 40;
+
+    std::cerr << std::format("autotuning device {}\n", tuningKey);
+
+    auto const capabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
+    auto const supported = physicalDevice.getSurfacePresentModesKHR(surface);
+    auto const max_images = capabilities.maxImageCount == 0
+                                ? capabilities.minImageCount + 2
+                                : capabilities.maxImageCount;
+
+    // tearing (IMMEDIATE) is never picked automatically
+    auto trials = std::vector<PresentTrial>();
+    for (auto const *mode : {"FIFO", "FIFO_RELAXED", "MAILBOX"}) {
+      if (std::ranges::find(supported, presentModeByName(mode)) ==
+          supported.end())
+        continue;
+      for (auto images = capabilities.minImageCount + 1;
+           images <= std::min(capabilities.minImageCount + 2, max_images);
+           ++images)
+        trials.push_back({.present_mode = mode, .image_count = images});
+    }
 
-      if (presentQueue.presentKHR(present_info) != vk::Result::eSuccess) {
-        throw std::runtime_error{std::format(
-            "{}:{}: vkQueue.presentKHR erred out", __FILE__, __LINE__)};
+    for (auto &trial : trials) {
+      tuning.present_mode = trial.present_mode;
+      tuning.image_count = trial.image_count;
+      reinitSwapchain();
+
+      auto intervals = std::vector<double>();
+      auto blocked = 0.0;
+      auto last = std::chrono::steady_clock::now();
+      for (auto frame = 0; frame < warmup_frames + measured_frames; ++frame) {
+        redraw();
+        auto const now = std::chrono::steady_clock::now();
+        if (frame >= warmup_frames) {
+          intervals.push_back(
+              std::chrono::duration<double, std::milli>(now - last).count());
+          blocked +=
+              std::chrono::duration<double, std::milli>(lastBlocked).count();
+        }
+        last = now;
+      }
+      auto const p95 = intervals.begin() + intervals.size() * 95 / 100;
+      std::ranges::nth_element(intervals, p95);
+      trial.p95_interval_ms = *p95;
+      trial.mean_blocked_ms = blocked / measured_frames;
+
+      if (Args::verbose() > 0) {
+        std::cerr << std::format(
+            "{}:{}: {} x{}: p95 interval {} ms, blocked {} ms\n", __FILE__,
+            __LINE__, trial.present_mode, trial.image_count,
+            trial.p95_interval_ms, trial.mean_blocked_ms);
       }
     }
-  };
+
+    auto uploads = std::vector<UploadTrial>();
+    for (auto const chunk : {vk::DeviceSize{256} << 10, vk::DeviceSize{1} << 20,
+                             vk::DeviceSize{4} << 20, vk::DeviceSize{16} << 20})
+      uploads.push_back(measureUploadChunk(gpuContext(), chunk));
+
+    auto tuned = DeviceTuning();
+    if (auto const *best = pickPresentTrial(trials); best) {
+      tuned.present_mode = best->present_mode;
+      tuned.image_count = best->image_count;
+    }
+    tuned.upload_chunk = pickUploadChunk(uploads);
+
+    tuning = tuned;
+    tuningStored = true;
+    Config::setSection("/autotune/" + tuningKey, tuning.toJson());
+    reinitSwapchain();
+
+    std::cerr << std::format("autotuned: {}\n", tuning.toJson().dump());
+  }
+
+  /**
+   * Rebuild the swapchain and everything sized by it, e.g. after tuning
+   * changed; the device and surface stay
+   */
+  void reinitSwapchain() {
+    initialized.store(false);
+    initialized.notify_all();
+
+    VulkanGfxBase::destroy();
+    VulkanGfxBase::init(nullptr);
+
+    initialized.store(true);
+    initialized.notify_all();
+  }
+
+  /**
+   * Queue presentation of a swapchain image once renderFinishedSemaphore is
+   * signalled (by either the graphics or the compute path).
+   */
+  void present(uint32_t image_index) {
+    auto present_info = vk::PresentInfoKHR{};
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &renderFinishedSemaphore;
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &swapchain;
+    present_info.pImageIndices = &image_index;
+
+    if (presentQueue.presentKHR(present_info) != vk::Result::eSuccess) {
+      throw std::runtime_error{std::format(
+          "{}:{}: vkQueue.presentKHR erred out", __FILE__, __LINE__)};
+    }
+  }
 };
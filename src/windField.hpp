@@ -0,0 +1,593 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "vulkanCommon.hpp"
+#include "windGrid.hpp"
+
+/**
+ * 3D wind field solved with stable fluids (advect, diffuse, project) on the
+ * compute queue.
+ *
+ * Velocity (RGBA16F) and pressure (R32F) live in 3D storage images that
+ * never leave the compute family. Nothing on the graphics queue waits for a
+ * step, so on GPUs with a separate compute queue the solve overlaps
+ * rendering. The Jacobi iteration count adapts to the measured GPU time so
+ * a step stays within the configured budget.
+ *
+ * Every step ends with a copy of the velocity image into one slot of a
+ * small ring of host-visible buffers; latest() hands the newest finished
+ * slot to the CPU as a WindGrid without ever blocking, so the entity
+ * simulation samples a field at most a couple of steps old.
+ */
+struct WindField {
+  /**
+   * Must match PASS_* in shaders/wind.comp
+   */
+  enum class Pass : int32_t {
+    ADVECT = 0,
+    DIFFUSE = 1,
+    DIVERGENCE = 2,
+    PRESSURE = 3,
+    PROJECT = 4,
+  };
+
+  /**
+   * Must match SolveParams in shaders/wind.comp
+   */
+  struct SolveParams {
+    std::array<float, 4> ambient{}; // w: relaxation rate (1/s)
+    float dt = 0.0f;
+    float cell_size = 1.0f;
+    float viscosity = 0.0f;
+    float reference_height = 10.0f;
+    int32_t src = 0;
+    int32_t dst = 0;
+    int32_t aux = 0;
+    int32_t pad = 0;
+  };
+
+  /**
+   * Large-scale weather the field relaxes to
+   */
+  struct Weather {
+    std::array<float, 3> wind{4.0f, 0.0f, 0.0f}; // m/s at 10 m
+    float relaxation = 0.05f;                    // 1/s
+    float viscosity = 20.0f; // eddy viscosity, m^2/s
+  };
+
+  static constexpr uint32_t readbackSlots = 3;
+  static constexpr uint32_t diffuseIterations = 4;
+  static constexpr uint32_t minPressureIterations = 4;
+  static constexpr uint32_t maxPressureIterations = 64;
+
+private:
+  struct Image {
+    vk::Image image;
+    vk::DeviceMemory memory;
+    vk::ImageView view;
+  };
+
+  struct Slot {
+    vk::CommandBuffer cmd;
+    vk::Fence done;
+    GpuBuffer readback;
+    uint64_t step = 0;
+    bool pending = false; // submitted, not yet seen finished
+  };
+
+  GpuContext context;
+  vk::Extent3D extent;
+  float cellSize;
+  float budgetMs;
+
+  std::array<Image, 3> velocity;
+  std::array<Image, 2> pressure;
+  Image divergence;
+
+  vk::DescriptorSetLayout setLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+  vk::PipelineLayout pipelineLayout;
+  std::array<vk::Pipeline, 5> pipelines; // indexed by Pass
+
+  vk::CommandPool commandPool;
+  std::array<Slot, readbackSlots> slots;
+  uint32_t nextSlot = 0;
+  int32_t newestSlot = -1; // finished slot latest() returns
+
+  vk::QueryPool timestamps;
+  float timestampPeriod = 0.0f; // ns per tick, 0 without timestamps
+
+  bool initialized = false;
+  int32_t currentVelocity = 0;
+  int32_t currentPressure = 0;
+  uint32_t pressureIterations = 16;
+  uint64_t stepCount = 0;
+  float lastGpuMs = 0.0f;
+
+public:
+  Weather weather;
+
+  /**
+   * Grid size, cell size and time budget come from Config (SIM_WIND_*)
+   */
+  explicit WindField(GpuContext const &gpu_context) : context{gpu_context} {
+    auto const number = [](Config::Key const key) {
+      return std::visit(
+          [](auto const &value) -> double {
+            if constexpr (std::is_arithmetic_v<
+                              std::decay_t<decltype(value)>>) {
+              return static_cast<double>(value);
+            } else {
+              throw std::runtime_error(std::format(
+                  "{}:{}: wind setting must be a number", __FILE__, __LINE__));
+            }
+          },
+          Config::get(key));
+    };
+
+    auto const cells = static_cast<uint32_t>(
+        std::clamp(number(Config::Key::SIM_WIND_CELLS), 8.0, 256.0));
+    extent = vk::Extent3D(cells, std::max(cells / 2, 4U), cells);
+    cellSize = static_cast<float>(
+        std::max(number(Config::Key::SIM_WIND_CELL_SIZE), 0.01));
+    budgetMs = static_cast<float>(
+        std::max(number(Config::Key::SIM_WIND_BUDGET_MS), 0.01));
+
+    for (auto &image : velocity)
+      image = createImage(vk::Format::eR16G16B16A16Sfloat);
+    for (auto &image : pressure)
+      image = createImage(vk::Format::eR32Sfloat);
+    divergence = createImage(vk::Format::eR32Sfloat);
+
+    createDescriptors();
+    createPipelines();
+
+    auto pool_info = vk::CommandPoolCreateInfo();
+    pool_info.queueFamilyIndex = context.compute_family;
+    pool_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    commandPool = context.device.createCommandPool(pool_info);
+    if (!commandPool) {
+      throw std::runtime_error(std::format(
+          "{}:{}: failed to create wind command pool", __FILE__, __LINE__));
+    }
+    auto const cmds = context.device.allocateCommandBuffers(
+        vk::CommandBufferAllocateInfo(
+            commandPool, vk::CommandBufferLevel::ePrimary, readbackSlots));
+
+    auto const texels = vk::DeviceSize{extent.width} * extent.height *
+                        extent.depth;
+    for (auto i = 0U; i < readbackSlots; ++i) {
+      slots[i].cmd = cmds[i];
+      slots[i].done = context.device.createFence(
+          vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+      slots[i].readback = createReadbackBuffer(texels * 8);
+    }
+
+    auto const family_properties =
+        context.physical_device.getQueueFamilyProperties();
+    if (family_properties[context.compute_family].timestampValidBits > 0) {
+      timestampPeriod =
+          context.physical_device.getProperties().limits.timestampPeriod;
+      timestamps = context.device.createQueryPool(vk::QueryPoolCreateInfo(
+          {}, vk::QueryType::eTimestamp, 2 * readbackSlots));
+    }
+
+    if (Args::verbose() > 0) {
+      std::cerr << std::format(
+          "{}:{}: wind field {}x{}x{} cells of {} m, {} ms budget{}\n",
+          __FILE__, __LINE__, extent.width, extent.height, extent.depth,
+          cellSize, budgetMs,
+          timestamps ? "" : " (no timestamps, fixed iterations)");
+    }
+  }
+
+  WindField(WindField const &) = delete;
+  WindField &operator=(WindField const &) = delete;
+  WindField(WindField &&) = delete;
+  WindField &operator=(WindField &&) = delete;
+
+  ~WindField() {
+    auto const &device = context.device;
+    for (auto &slot : slots) {
+      if (device.waitForFences(slot.done, vk::Bool32{true}, UINT64_MAX) !=
+          vk::Result::eSuccess) {
+        std::cerr << std::format("{}:{}: failed to wait for wind step\n",
+                                 __FILE__, __LINE__);
+      }
+      device.destroyFence(slot.done);
+      destroyBuffer(context, slot.readback);
+    }
+    if (timestamps)
+      device.destroyQueryPool(timestamps);
+    device.destroyCommandPool(commandPool);
+
+    for (auto &pipeline : pipelines)
+      device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(pipelineLayout);
+    device.destroyDescriptorPool(descriptorPool); // frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+
+    for (auto *image : {&velocity[0], &velocity[1], &velocity[2],
+                        &pressure[0], &pressure[1], &divergence}) {
+      device.destroyImageView(image->view);
+      device.destroyImage(image->image);
+      device.freeMemory(image->memory);
+    }
+  }
+
+  /**
+   * Advance the field by dt seconds and queue its readback. Only waits for
+   * the step that used the same ring slot readbackSlots steps ago.
+   */
+  void step(float const dt) {
+    auto const &device = context.device;
+    auto &slot = slots[nextSlot];
+    if (device.waitForFences(slot.done, vk::Bool32{true}, UINT64_MAX) !=
+        vk::Result::eSuccess) {
+      throw std::runtime_error(std::format("{}:{}: failed to wait for wind step",
+                                           __FILE__, __LINE__));
+    }
+    collect(nextSlot);
+    device.resetFences(slot.done);
+
+    auto &cmd = slot.cmd;
+    cmd.reset();
+    cmd.begin(vk::CommandBufferBeginInfo(
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    if (timestamps) {
+      cmd.resetQueryPool(timestamps, 2 * nextSlot, 2);
+      cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestamps,
+                         2 * nextSlot);
+    }
+
+    if (!initialized) {
+      clearImages(cmd);
+      initialized = true;
+    }
+    // the previous step's writes and readback copy
+    barrier(cmd, vk::PipelineStageFlagBits::eComputeShader |
+                     vk::PipelineStageFlagBits::eTransfer);
+
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0,
+                           descriptorSet, nullptr);
+
+    auto params = SolveParams{
+        .ambient = {weather.wind[0], weather.wind[1], weather.wind[2],
+                    weather.relaxation},
+        .dt = dt,
+        .cell_size = cellSize,
+        .viscosity = weather.viscosity};
+
+    // three velocity images: a is the current field, b and c scratch
+    auto const a = currentVelocity;
+    auto const b = (a + 1) % 3;
+    auto const c = (a + 2) % 3;
+
+    dispatch(cmd, Pass::ADVECT, params, a, b);
+
+    // Jacobi ping-pongs between c and a, keeping the advected field in b
+    // as the right-hand side
+    auto x = b;
+    for (auto i = 0U; i < diffuseIterations; ++i) {
+      auto const out = (i % 2 == 0) ? c : a;
+      dispatch(cmd, Pass::DIFFUSE, params, x, out, b);
+      x = out;
+    }
+
+    dispatch(cmd, Pass::DIVERGENCE, params, x, 0);
+    for (auto i = 0U; i < pressureIterations; ++i) {
+      dispatch(cmd, Pass::PRESSURE, params, currentPressure,
+               1 - currentPressure);
+      currentPressure = 1 - currentPressure;
+    }
+
+    auto const result = (x == b) ? c : b;
+    dispatch(cmd, Pass::PROJECT, params, x, result, currentPressure);
+    currentVelocity = result;
+
+    // readback of the new field
+    barrier(cmd, vk::PipelineStageFlagBits::eTransfer);
+    auto const copy = vk::BufferImageCopy(
+        0, 0, 0,
+        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+        vk::Offset3D(0, 0, 0), extent);
+    cmd.copyImageToBuffer(velocity[currentVelocity].image,
+                          vk::ImageLayout::eGeneral, slot.readback.buffer,
+                          copy);
+    auto const host_barrier = vk::MemoryBarrier(
+        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eHost, {}, host_barrier,
+                        nullptr, nullptr);
+
+    if (timestamps) {
+      cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestamps,
+                         2 * nextSlot + 1);
+    }
+    cmd.end();
+
+    auto submit_info = vk::SubmitInfo();
+    submit_info.setCommandBuffers(cmd);
+    context.compute_queue.submit(submit_info, slot.done);
+
+    slot.step = ++stepCount;
+    slot.pending = true;
+    nextSlot = (nextSlot + 1) % readbackSlots;
+  }
+
+  /**
+   * Newest readback the GPU has finished, without waiting. The grid is
+   * centred on the world origin in x and z and starts at the ground. Empty
+   * before the first step completes. Valid until readbackSlots - 1 further step()
+   * calls.
+   */
+  [[nodiscard]] WindGrid latest() {
+    for (auto i = 0U; i < readbackSlots; ++i) {
+      if (slots[i].pending &&
+          context.device.getFenceStatus(slots[i].done) ==
+              vk::Result::eSuccess) {
+        collect(i);
+      }
+    }
+    if (newestSlot < 0)
+      return {};
+
+    auto const &slot = slots[newestSlot];
+    return {.extent = {extent.width, extent.height, extent.depth},
+            .origin = {-0.5f * cellSize * static_cast<float>(extent.width),
+                       0.0f,
+                       -0.5f * cellSize * static_cast<float>(extent.depth)},
+            .cell_size = cellSize,
+            .texels = {static_cast<uint16_t const *>(slot.readback.mapped),
+                       slot.readback.size / sizeof(uint16_t)},
+            .step = slot.step};
+  }
+
+  [[nodiscard]] vk::Extent3D cells() const { return extent; }
+  [[nodiscard]] float lastStepMs() const { return lastGpuMs; }
+  [[nodiscard]] uint32_t iterations() const { return pressureIterations; }
+
+private:
+  /**
+   * Bookkeeping for a slot whose step has finished: newest readback and
+   * the time budget
+   */
+  void collect(uint32_t const i) {
+    auto &slot = slots[i];
+    if (!slot.pending)
+      return;
+    slot.pending = false;
+
+    if (newestSlot < 0 || slot.step > slots[newestSlot].step)
+      newestSlot = static_cast<int32_t>(i);
+
+    if (!timestamps)
+      return;
+    auto ticks = std::array<uint64_t, 2>{};
+    if (context.device.getQueryPoolResults(
+            timestamps, 2 * i, 2, sizeof(ticks), ticks.data(),
+            sizeof(uint64_t), vk::QueryResultFlagBits::e64) !=
+        vk::Result::eSuccess) {
+      return;
+    }
+    lastGpuMs = static_cast<float>(ticks[1] - ticks[0]) * timestampPeriod *
+                1e-6f;
+
+    // pressure iterations dominate; scale them towards the budget, and grow
+    // slowly so a single fast step doesn't overshoot
+    if (lastGpuMs > budgetMs) {
+      pressureIterations = std::max(
+          minPressureIterations,
+          static_cast<uint32_t>(static_cast<float>(pressureIterations) *
+                                budgetMs / lastGpuMs));
+    } else if (lastGpuMs < 0.75f * budgetMs) {
+      pressureIterations =
+          std::min(maxPressureIterations, pressureIterations + 2);
+    }
+  }
+
+  void dispatch(vk::CommandBuffer const cmd, Pass const pass,
+                SolveParams &params, int32_t const src, int32_t const dst,
+                int32_t const aux = 0) {
+    params.src = src;
+    params.dst = dst;
+    params.aux = aux;
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute,
+                     pipelines[static_cast<size_t>(pass)]);
+    cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+                      sizeof(SolveParams), &params);
+    cmd.dispatch((extent.width + 3) / 4, (extent.height + 3) / 4,
+                 (extent.depth + 3) / 4);
+    barrier(cmd, vk::PipelineStageFlagBits::eComputeShader);
+  }
+
+  /**
+   * Make compute writes (and copies) visible to what follows
+   */
+  static void barrier(vk::CommandBuffer const cmd,
+                      vk::PipelineStageFlags const dst_stages) {
+    auto const memory_barrier = vk::MemoryBarrier(
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite |
+            vk::AccessFlagBits::eTransferRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader |
+                            vk::PipelineStageFlagBits::eTransfer,
+                        dst_stages, {}, memory_barrier, nullptr, nullptr);
+  }
+
+  /**
+   * First step: everything to GENERAL, still air and zero pressure
+   */
+  void clearImages(vk::CommandBuffer const cmd) {
+    auto const range =
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    auto const all = std::array{&velocity[0], &velocity[1], &velocity[2],
+                                &pressure[0], &pressure[1], &divergence};
+
+    auto barriers = std::vector<vk::ImageMemoryBarrier>();
+    for (auto const *image : all) {
+      auto image_barrier = vk::ImageMemoryBarrier();
+      image_barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+      image_barrier.oldLayout = vk::ImageLayout::eUndefined;
+      image_barrier.newLayout = vk::ImageLayout::eGeneral;
+      image_barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+      image_barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+      image_barrier.image = image->image;
+      image_barrier.subresourceRange = range;
+      barriers.push_back(image_barrier);
+    }
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                        vk::PipelineStageFlagBits::eTransfer, {}, nullptr,
+                        nullptr, barriers);
+
+    for (auto const *image : all) {
+      cmd.clearColorImage(image->image, vk::ImageLayout::eGeneral,
+                          vk::ClearColorValue(0.0f, 0.0f, 0.0f, 0.0f), range);
+    }
+  }
+
+  [[nodiscard]] Image createImage(vk::Format const format) {
+    auto const &device = context.device;
+
+    auto image_info = vk::ImageCreateInfo();
+    image_info.imageType = vk::ImageType::e3D;
+    image_info.format = format;
+    image_info.extent = extent;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = vk::SampleCountFlagBits::e1;
+    image_info.tiling = vk::ImageTiling::eOptimal;
+    image_info.usage = vk::ImageUsageFlagBits::eStorage |
+                       vk::ImageUsageFlagBits::eTransferSrc |
+                       vk::ImageUsageFlagBits::eTransferDst;
+    image_info.sharingMode = vk::SharingMode::eExclusive; // compute only
+    image_info.initialLayout = vk::ImageLayout::eUndefined;
+
+    auto result = Image();
+    result.image = device.createImage(image_info);
+    if (!result.image) {
+      throw std::runtime_error("failed to create wind image");
+    }
+
+    auto const requirements = device.getImageMemoryRequirements(result.image);
+    result.memory = device.allocateMemory(vk::MemoryAllocateInfo(
+        requirements.size,
+        findMemoryType(context.physical_device, requirements.memoryTypeBits,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    if (!result.memory) {
+      throw std::runtime_error("failed to allocate wind image memory");
+    }
+    device.bindImageMemory(result.image, result.memory, 0);
+
+    auto view_info = vk::ImageViewCreateInfo();
+    view_info.image = result.image;
+    view_info.viewType = vk::ImageViewType::e3D;
+    view_info.format = format;
+    view_info.subresourceRange =
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    result.view = device.createImageView(view_info);
+    if (!result.view) {
+      throw std::runtime_error("failed to create wind image view");
+    }
+    return result;
+  }
+
+  /**
+   * Host-cached memory when there is some: the CPU reads these texel by
+   * texel, which is slow from write-combined memory
+   */
+  [[nodiscard]] GpuBuffer createReadbackBuffer(vk::DeviceSize const size) {
+    auto const usage = vk::BufferUsageFlagBits::eTransferDst;
+    auto const visible = vk::MemoryPropertyFlagBits::eHostVisible |
+                         vk::MemoryPropertyFlagBits::eHostCoherent;
+    try {
+      return createBuffer(context, size, usage,
+                          visible | vk::MemoryPropertyFlagBits::eHostCached);
+    } catch (std::runtime_error const &) {
+      return createBuffer(context, size, usage, visible);
+    }
+  }
+
+  void createDescriptors() {
+    auto const &device = context.device;
+
+    auto bindings = std::array<vk::DescriptorSetLayoutBinding, 6>{};
+    for (auto i = 0U; i < bindings.size(); ++i) {
+      bindings[i] = vk::DescriptorSetLayoutBinding(
+          i, vk::DescriptorType::eStorageImage, 1,
+          vk::ShaderStageFlagBits::eCompute);
+    }
+    setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, bindings));
+    if (!setLayout) {
+      throw std::runtime_error("failed to create wind descriptor set layout");
+    }
+
+    auto const pool_size = vk::DescriptorPoolSize(
+        vk::DescriptorType::eStorageImage, bindings.size());
+    descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo({}, 1, pool_size));
+    if (!descriptorPool) {
+      throw std::runtime_error("failed to create wind descriptor pool");
+    }
+    descriptorSet = device
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo(
+                            descriptorPool, setLayout))
+                        .front();
+
+    auto const images = std::array{&velocity[0], &velocity[1], &velocity[2],
+                                   &pressure[0], &pressure[1], &divergence};
+    auto infos = std::array<vk::DescriptorImageInfo, 6>{};
+    auto writes = std::array<vk::WriteDescriptorSet, 6>{};
+    for (auto i = 0U; i < images.size(); ++i) {
+      infos[i] = vk::DescriptorImageInfo(nullptr, images[i]->view,
+                                         vk::ImageLayout::eGeneral);
+      writes[i] = vk::WriteDescriptorSet(
+          descriptorSet, i, 0, vk::DescriptorType::eStorageImage, infos[i]);
+    }
+    device.updateDescriptorSets(writes, nullptr);
+
+    auto const push_range = vk::PushConstantRange(
+        vk::ShaderStageFlagBits::eCompute, 0, sizeof(SolveParams));
+    pipelineLayout = device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, setLayout, push_range));
+    if (!pipelineLayout) {
+      throw std::runtime_error("failed to create wind pipeline layout");
+    }
+  }
+
+  void createPipelines() {
+    static auto const comp_code = std::vector<uint32_t>{
+#include "shaders/wind.comp.spv"
+    };
+
+    auto const module = createShaderModule(context, comp_code);
+    auto const spec_entry = vk::SpecializationMapEntry(0, 0, sizeof(int32_t));
+
+    for (auto i = 0U; i < pipelines.size(); ++i) {
+      auto const pass_value = static_cast<int32_t>(i);
+      auto const spec_info = vk::SpecializationInfo(
+          1, &spec_entry, sizeof(int32_t), &pass_value);
+
+      auto const pipeline_info = vk::ComputePipelineCreateInfo(
+          {},
+          vk::PipelineShaderStageCreateInfo(
+              {}, vk::ShaderStageFlagBits::eCompute, module, "main",
+              &spec_info),
+          pipelineLayout);
+
+      auto pipeline_result =
+          context.device.createComputePipeline(nullptr, pipeline_info);
+      if (pipeline_result.result != vk::Result::eSuccess) {
+        context.device.destroyShaderModule(module);
+        throw std::runtime_error(
+            std::format("failed to create wind pipeline: {}\n",
+                        vk::to_string(pipeline_result.result)));
+      }
+      pipelines[i] = pipeline_result.value;
+    }
+
+    context.device.destroyShaderModule(module);
+  }
+};
@@ -0,0 +1,63 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include "halfFloat.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+/**
+ * CPU view of one wind field readback: RGBA16F texels, x fastest, then y
+ * (up), then z, with cell centres at origin + (i + 0.5) * cell_size.
+ * Doesn't own the texels; see WindField::latest().
+ */
+struct WindGrid {
+  std::array<uint32_t, 3> extent{};
+  std::array<float, 3> origin{}; // m, corner of cell (0, 0, 0)
+  float cell_size = 1.0f;        // m
+  std::span<uint16_t const> texels;
+  uint64_t step = 0; // WindField step the texels were copied after
+
+  [[nodiscard]] bool empty() const { return texels.empty(); }
+
+  /**
+   * Wind velocity (m/s) at a position, trilinearly filtered and clamped to
+   * the border cells outside the grid
+   */
+  [[nodiscard]] std::array<float, 3>
+  sample(std::array<float, 3> const &position) const {
+    if (empty())
+      return {};
+
+    auto base = std::array<uint32_t, 3>{};
+    auto next = std::array<uint32_t, 3>{};
+    auto weight = std::array<float, 3>{};
+    for (auto axis = 0U; axis < 3; ++axis) {
+      auto const last = static_cast<float>(extent[axis] - 1);
+      auto const g = std::clamp(
+          (position[axis] - origin[axis]) / cell_size - 0.5f, 0.0f, last);
+      auto const floor = std::floor(g);
+      base[axis] = static_cast<uint32_t>(floor);
+      next[axis] = std::min(base[axis] + 1, extent[axis] - 1);
+      weight[axis] = g - floor;
+    }
+
+    auto result = std::array<float, 3>{};
+    for (auto corner = 0U; corner < 8; ++corner) {
+      auto w = 1.0f;
+      auto cell = std::array<uint32_t, 3>{};
+      for (auto axis = 0U; axis < 3; ++axis) {
+        auto const upper = (corner >> axis) & 1U;
+        cell[axis] = upper ? next[axis] : base[axis];
+        w *= upper ? weight[axis] : 1.0f - weight[axis];
+      }
+      auto const texel =
+          (size_t{cell[2]} * extent[1] + cell[1]) * extent[0] + cell[0];
+      for (auto c = 0U; c < 3; ++c)
+        result[c] += w * halfToFloat(texels[texel * 4 + c]);
+    }
+    return result;
+  }
+};
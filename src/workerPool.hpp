@@ -0,0 +1,139 @@
+#pragma once
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads for data-parallel loops. parallelFor() hands
+ * out chunks of an index range through one atomic counter; the calling
+ * thread takes chunks too, so a pool of N workers runs N + 1 wide and a
+ * pool of zero workers simply runs the loop inline. One loop at a time.
+ */
+struct WorkerPool {
+  using ChunkFn = std::function<void(size_t begin, size_t end)>;
+
+private:
+  std::mutex mutex;
+  std::condition_variable_any wake;
+  std::condition_variable finished;
+
+  /* current loop, guarded by mutex except for the counters */
+  ChunkFn const *job = nullptr;
+  size_t jobCount = 0;
+  size_t jobChunk = 1;
+  uint64_t generation = 0;
+  std::atomic<size_t> nextChunk{0};
+  size_t busy = 0; // workers inside the current loop
+
+  std::vector<std::jthread> workers;
+
+public:
+  /**
+   * Defaults to one worker per hardware thread besides the caller
+   */
+  explicit WorkerPool(
+      unsigned const threads =
+          std::max(std::thread::hardware_concurrency(), 1U) - 1) {
+    workers.reserve(threads);
+    for (auto i = 0U; i < threads; ++i) {
+      workers.emplace_back(
+          [this](std::stop_token const &stop) { workerLoop(stop); });
+    }
+  }
+
+  WorkerPool(WorkerPool const &) = delete;
+  WorkerPool &operator=(WorkerPool const &) = delete;
+  WorkerPool(WorkerPool &&) = delete;
+  WorkerPool &operator=(WorkerPool &&) = delete;
+
+  ~WorkerPool() {
+    for (auto &worker : workers)
+      worker.request_stop();
+    wake.notify_all();
+  }
+
+  /**
+   * Threads taking part in a loop, the caller included
+   */
+  [[nodiscard]] size_t width() const { return workers.size() + 1; }
+
+  /**
+   * Run fn over [0, count) in chunks of chunk indices (the last one may be
+   * short) and return once every chunk is done. Chunk boundaries are
+   * multiples of chunk, so aligned SoA kernels stay aligned.
+   */
+  void parallelFor(size_t const count, size_t const chunk, ChunkFn const &fn) {
+    if (count == 0)
+      return;
+
+    auto const step = std::max<size_t>(chunk, 1);
+    if (workers.empty() || count <= step) {
+      fn(0, count);
+      return;
+    }
+
+    {
+      auto const lock = std::scoped_lock(mutex);
+      job = &fn;
+      jobCount = count;
+      jobChunk = step;
+      nextChunk.store(0, std::memory_order_relaxed);
+      ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(fn, count, step);
+
+    // workers that never woke up for this loop will find no chunks left
+    auto lock = std::unique_lock(mutex);
+    finished.wait(lock, [&] { return busy == 0; });
+    job = nullptr;
+  }
+
+private:
+  void runChunks(ChunkFn const &fn, size_t const count, size_t const step) {
+    for (;;) {
+      auto const begin =
+          nextChunk.fetch_add(1, std::memory_order_relaxed) * step;
+      if (begin >= count)
+        return;
+      fn(begin, std::min(begin + step, count));
+    }
+  }
+
+  void workerLoop(std::stop_token const &stop) {
+    auto seen = uint64_t{0};
+    while (true) {
+      ChunkFn const *fn = nullptr;
+      auto count = size_t{0};
+      auto step = size_t{1};
+      {
+        auto lock = std::unique_lock(mutex);
+        if (!wake.wait(lock, stop,
+                       [&] { return job != nullptr && generation != seen; }))
+          return;
+        seen = generation;
+        fn = job;
+        count = jobCount;
+        step = jobChunk;
+        ++busy;
+      }
+
+      runChunks(*fn, count, step);
+
+      {
+        auto const lock = std::scoped_lock(mutex);
+        --busy;
+      }
+      finished.notify_one();
+    }
+  }
+};
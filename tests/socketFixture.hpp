@@ -0,0 +1,72 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "../src/platformGfx.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Shared by the tests of servers that listen on a Unix socket through the
+ * platform event loop (FeedServer, ControlServer)
+ */
+
+/* records event sources; pump() stands in for the platform event loop */
+struct StubPlatform : PlatformGfx {
+  std::map<int, std::function<void()>> sources;
+
+  auto getGeometry() -> Geometry override { return {}; }
+  void init() override {}
+  void platformEventLoop(std::function<bool()> &&) override {}
+
+  void addEventSource(int fd, std::function<void()> &&on_readable) override {
+    sources[fd] = std::move(on_readable);
+  }
+  void removeEventSource(int fd) override { sources.erase(fd); }
+
+  void pump() {
+    for (auto round = 0; round < 8; ++round) {
+      auto fds = std::vector<pollfd>();
+      for (auto const &[fd, _] : sources)
+        fds.push_back({fd, POLLIN, 0});
+      if (poll(fds.data(), fds.size(), 20) <= 0)
+        return;
+      for (auto const &ready : fds) {
+        if (!(ready.revents & (POLLIN | POLLHUP)))
+          continue;
+        if (auto const source = sources.find(ready.fd);
+            source != sources.end()) {
+          auto const on_readable = source->second;
+          on_readable();
+        }
+      }
+    }
+  }
+};
+
+/* per test binary and process, so parallel ctest runs don't collide */
+inline std::filesystem::path socketPath(std::string_view const name) {
+  return std::filesystem::temp_directory_path() /
+         std::format("hotair-test-{}-{}.sock", name, getpid());
+}
+
+inline int connectTo(std::filesystem::path const &path) {
+  auto address = sockaddr_un{.sun_family = AF_UNIX, .sun_path = {}};
+  std::ranges::copy(path.native(), address.sun_path);
+  auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr const *>(&address),
+                    sizeof(address)),
+            0);
+  return fd;
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <numeric>
+
+#include "../src/balloonSim.hpp"
+
+TEST(TestBalloonSim, ArenaAlignsEveryArray) {
+  auto arena = AlignedArena(1024);
+  auto const a = arena.allocate<float>(3);
+  auto const b = arena.allocate<double>(5);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data()) % AlignedArena::alignment,
+            0U);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b.data()) % AlignedArena::alignment,
+            0U);
+  EXPECT_EQ(a[2], 0.0f);
+  EXPECT_EQ(arena.used(), 2 * AlignedArena::alignment);
+  EXPECT_THROW(arena.allocate<std::byte>(1024), std::runtime_error);
+
+  arena.reset();
+  EXPECT_EQ(arena.used(), 0U);
+}
+
+TEST(TestBalloonSim, WorkerPoolCoversEveryIndexOnce) {
+  auto pool = WorkerPool(3);
+  EXPECT_EQ(pool.width(), 4U);
+
+  auto hits = std::vector<std::atomic<int>>(10007);
+  for (auto round = 0; round < 3; ++round) {
+    pool.parallelFor(hits.size(), 64, [&](size_t begin, size_t end) {
+      EXPECT_EQ(begin % 64, 0U);
+      for (auto i = begin; i < end; ++i)
+        hits[i].fetch_add(1);
+    });
+  }
+  for (auto const &hit : hits)
+    EXPECT_EQ(hit.load(), 3);
+}
+
+TEST(TestBalloonSim, HotBalloonsRiseColdOnesStay) {
+  auto sim = BalloonSim(4);
+  auto const hot = sim.add({.temperature = 373.15f});
+  auto const cold = sim.add({.temperature = 288.15f});
+
+  for (auto i = 0; i < 600; ++i) // 5 s
+    sim.advance();
+
+  EXPECT_GT(sim.positionY()[hot], 1.0f);
+  EXPECT_GT(sim.buoyancy()[hot], 0.0f);
+  EXPECT_EQ(sim.positionY()[cold], 0.0f);
+  EXPECT_LT(sim.buoyancy()[cold], 0.0f);
+  // unburnt envelopes cool towards ambient
+  EXPECT_LT(sim.temperature()[hot], 373.15f);
+  EXPECT_EQ(sim.steps(), 600U);
+}
+
+TEST(TestBalloonSim, WindCarriesBalloons) {
+  auto sim = BalloonSim(1);
+  sim.environment.wind = {5.0f, 0.0f, 0.0f};
+  sim.add({.position = {0.0f, 500.0f, 0.0f}, .temperature = 360.0f});
+
+  for (auto i = 0; i < 120 * 60; ++i)
+    sim.advance();
+
+  auto const balloon = sim.get(0);
+  EXPECT_NEAR(balloon.velocity[0], 5.0f, 0.1f);
+  EXPECT_GT(balloon.position[0], 100.0f);
+}
+
+TEST(TestBalloonSim, VectorMatchesScalarAndThreads) {
+  auto pool = WorkerPool(2);
+  auto scalar = BalloonSim(10000);
+  auto vector = BalloonSim(10000, 1.0f / 120.0f, &pool);
+
+  for (auto i = 0U; i < 10000; ++i) {
+    auto const balloon =
+        Balloon{.position = {static_cast<float>(i), 10.0f * (i % 7), 0.0f},
+                .temperature = 330.0f + static_cast<float>(i % 50),
+                .mass = 300.0f + static_cast<float>(i % 13) * 10.0f,
+                .burner = (i % 3) * 0.5f};
+    scalar.add(balloon);
+    vector.add(balloon);
+  }
+  scalar.remove(17);
+  vector.remove(17);
+
+  for (auto step = 0; step < 240; ++step) {
+    scalar.advanceWith<stdx::simd<float, stdx::simd_abi::scalar>>();
+    vector.advance();
+  }
+
+  ASSERT_EQ(scalar.size(), vector.size());
+  for (auto i = 0U; i < scalar.size(); ++i) {
+    EXPECT_NEAR(scalar.positionY()[i], vector.positionY()[i],
+                1e-3f * (1.0f + std::abs(scalar.positionY()[i])));
+    EXPECT_NEAR(scalar.temperature()[i], vector.temperature()[i], 1e-3f);
+  }
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include "../src/controlServer.hpp"
+#include "../src/frameTrace.hpp"
+#include "socketFixture.hpp"
+
+#include <fstream>
+
+namespace {
+
+void sendLine(int const fd, std::string const &line) {
+  ASSERT_EQ(write(fd, line.data(), line.size()),
+            static_cast<ssize_t>(line.size()));
+}
+
+/* replies available without blocking, one per line */
+std::vector<nlohmann::json> replies(int const fd) {
+  auto text = std::string();
+  char chunk[4096];
+  auto ready = pollfd{fd, POLLIN, 0};
+  while (poll(&ready, 1, 20) > 0) {
+    auto const got = read(fd, chunk, sizeof(chunk));
+    if (got <= 0)
+      break;
+    text.append(chunk, static_cast<size_t>(got));
+  }
+  auto lines = std::vector<nlohmann::json>();
+  for (auto end = text.find('\n'), begin = size_t{0};
+       end != std::string::npos; begin = end + 1, end = text.find('\n', begin))
+    lines.push_back(nlohmann::json::parse(text.substr(begin, end - begin)));
+  return lines;
+}
+
+} // namespace
+
+TEST(TestControlServer, RunsHandlersAndReportsFailures) {
+  auto platform = StubPlatform();
+  auto server = ControlServer(platform, socketPath("control"));
+  auto cap = 0.0;
+  server.on("frame_cap", "set cap", [&](nlohmann::json const &request) {
+    cap = request.at("fps").get<double>();
+    return nlohmann::json{{"fps", cap}};
+  });
+
+  auto const set = server.run({{"cmd", "frame_cap"}, {"fps", 144.0}});
+  EXPECT_TRUE(set["ok"].get<bool>());
+  EXPECT_EQ(set["fps"].get<double>(), 144.0);
+  EXPECT_EQ(cap, 144.0);
+
+  auto const help = server.run({{"cmd", "help"}});
+  EXPECT_TRUE(help["commands"].contains("frame_cap"));
+  EXPECT_TRUE(help["commands"].contains("help"));
+
+  // a missing field is the handler's exception, not a crash
+  auto const missing = server.run({{"cmd", "frame_cap"}});
+  EXPECT_FALSE(missing["ok"].get<bool>());
+  EXPECT_FALSE(missing["error"].get<std::string>().empty());
+  EXPECT_EQ(cap, 144.0);
+
+  EXPECT_FALSE(server.run({{"cmd", "reboot"}})["ok"].get<bool>());
+  EXPECT_FALSE(server.run(nlohmann::json::array())["ok"].get<bool>());
+  EXPECT_FALSE(server.run({{"fps", 1}})["ok"].get<bool>());
+}
+
+TEST(TestControlServer, CommandsWaitForApply) {
+  auto platform = StubPlatform();
+  auto const path = socketPath("control");
+  auto server = ControlServer(platform, path);
+  auto calls = 0;
+  server.on("bump", "count", [&](nlohmann::json const &) {
+    return nlohmann::json(++calls);
+  });
+
+  auto const fd = connectTo(path);
+  platform.pump();
+  // two commands in one write, the second split across writes
+  sendLine(fd, "{\"cmd\":\"bump\"}\n{\"cmd\":");
+  platform.pump();
+  sendLine(fd, "\"bump\"}\n");
+  platform.pump();
+
+  EXPECT_EQ(calls, 0);
+  EXPECT_TRUE(replies(fd).empty());
+
+  EXPECT_EQ(server.apply(), 2u);
+  EXPECT_EQ(calls, 2);
+  auto const answers = replies(fd);
+  ASSERT_EQ(answers.size(), 2u);
+  EXPECT_EQ(answers[0]["result"].get<int>(), 1);
+  EXPECT_EQ(answers[1]["result"].get<int>(), 2);
+  EXPECT_TRUE(answers[1]["ok"].get<bool>());
+  close(fd);
+}
+
+TEST(TestControlServer, MalformedLinesAnsweredImmediately) {
+  auto platform = StubPlatform();
+  auto const path = socketPath("control");
+  auto server = ControlServer(platform, path);
+
+  auto const fd = connectTo(path);
+  platform.pump();
+  sendLine(fd, "{not json\n\n{\"cmd\":\"help\"}\n");
+  platform.pump();
+
+  auto const early = replies(fd);
+  ASSERT_EQ(early.size(), 1u);
+  EXPECT_EQ(early[0]["error"].get<std::string>(), "malformed JSON");
+
+  EXPECT_EQ(server.apply(), 1u);
+  auto const late = replies(fd);
+  ASSERT_EQ(late.size(), 1u);
+  EXPECT_TRUE(late[0]["ok"].get<bool>());
+  close(fd);
+}
+
+TEST(TestControlServer, DisconnectedClientsAreDropped) {
+  auto platform = StubPlatform();
+  auto const path = socketPath("control");
+  auto server = ControlServer(platform, path);
+
+  auto const fd = connectTo(path);
+  platform.pump();
+  EXPECT_EQ(platform.sources.size(), 2u);
+
+  // the command still runs after its client is gone; the reply is dropped
+  sendLine(fd, "{\"cmd\":\"help\"}\n");
+  close(fd);
+  platform.pump();
+  EXPECT_EQ(server.apply(), 1u);
+  EXPECT_EQ(platform.sources.size(), 1u);
+}
+
+TEST(TestFrameTrace, WritesChromeTraceEvents) {
+  auto const path = std::filesystem::temp_directory_path() /
+                    std::format("hotair-test-trace-{}.json", getpid());
+  auto trace = FrameTrace();
+  auto const t0 = FrameTrace::Clock::now();
+
+  trace.record("ignored", t0, t0);
+  trace.start(path);
+  EXPECT_TRUE(trace.active());
+  trace.record("frame", t0 + std::chrono::microseconds(100),
+               t0 + std::chrono::microseconds(350));
+  trace.record("pace", t0 + std::chrono::microseconds(350),
+               t0 + std::chrono::microseconds(400));
+  EXPECT_EQ(trace.stop(), 2u);
+  EXPECT_FALSE(trace.active());
+
+  auto const written = nlohmann::json::parse(std::ifstream(path));
+  auto const &events = written["traceEvents"];
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0]["name"].get<std::string>(), "frame");
+  EXPECT_EQ(events[0]["ph"].get<std::string>(), "X");
+  EXPECT_NEAR(events[0]["dur"].get<double>(), 250.0, 0.01);
+  EXPECT_NEAR(events[1]["dur"].get<double>(), 50.0, 0.01);
+  EXPECT_EQ(written["otherData"]["dropped"].get<int>(), 0);
+  std::filesystem::remove(path);
+}
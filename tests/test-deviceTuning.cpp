@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "../src/deviceTuning.hpp"
+
+TEST(TestDeviceTuning, RoundTripsThroughJson) {
+  auto const tuning = DeviceTuning{
+      .present_mode = "MAILBOX", .image_count = 3, .upload_chunk = 1 << 20};
+  auto const back = DeviceTuning::fromJson(tuning.toJson());
+  EXPECT_EQ(back.present_mode, "MAILBOX");
+  EXPECT_EQ(back.image_count, 3U);
+  EXPECT_EQ(back.upload_chunk, 1U << 20);
+
+  // hand-edited entries keep defaults for what they get wrong
+  auto const partial = DeviceTuning::fromJson(
+      nlohmann::json{{"image_count", "four"}, {"upload_chunk", 4096}});
+  EXPECT_EQ(partial.present_mode, "FIFO");
+  EXPECT_EQ(partial.image_count, 0U);
+  EXPECT_EQ(partial.upload_chunk, 4096U);
+  EXPECT_EQ(DeviceTuning::fromJson(nullptr).present_mode, "FIFO");
+}
+
+TEST(TestDeviceTuning, KeyIdentifiesDeviceAndDriver) {
+  auto uuid = std::array<uint8_t, 16>{};
+  uuid[0] = 0xab;
+  uuid[15] = 0x01;
+  auto const key = deviceTuningKey(0x10de, 0x2684, uuid, 0x8d8c4000);
+  EXPECT_EQ(key, "10de-2684-ab000000000000000000000000000001-8d8c4000");
+  EXPECT_NE(key, deviceTuningKey(0x10de, 0x2684, uuid, 0x8d8c4001));
+  // usable as a single JSON pointer token
+  EXPECT_EQ(key.find_first_of("/~"), std::string::npos);
+}
+
+TEST(TestDeviceTuning, PicksLowestLatencyAtEqualPacing) {
+  auto const trials = std::vector<PresentTrial>{
+      {"FIFO", 3, 16.7, 14.0},
+      {"FIFO", 4, 16.7, 15.0},
+      {"MAILBOX", 3, 16.7, 1.0},
+      {"MAILBOX", 4, 16.8, 0.9},
+  };
+  auto const *best = pickPresentTrial(trials);
+  ASSERT_NE(best, nullptr);
+  EXPECT_EQ(best->present_mode, "MAILBOX");
+  // within 2%: the fewer images win
+  EXPECT_EQ(best->image_count, 3U);
+  EXPECT_EQ(pickPresentTrial({}), nullptr);
+}
+
+TEST(TestDeviceTuning, PicksSmallestChunkNearBestThroughput) {
+  auto const trials = std::vector<UploadTrial>{
+      {256 << 10, 4.0}, {1 << 20, 9.6}, {4 << 20, 10.0}, {16 << 20, 9.9}};
+  EXPECT_EQ(pickUploadChunk(trials), 1U << 20);
+  EXPECT_EQ(pickUploadChunk({}), 0U);
+}
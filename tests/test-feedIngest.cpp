@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include "../src/feedIngest.hpp"
+
+#include <fstream>
+
+namespace {
+
+/* simdjson reads past the end of its input */
+std::vector<char> padded(std::string_view const text) {
+  auto buffer = std::vector<char>(text.size() + FeedDecoder::padding);
+  std::ranges::copy(text, buffer.begin());
+  return buffer;
+}
+
+std::string lines(size_t const count) {
+  auto text = std::string();
+  for (auto i = size_t{0}; i < count; ++i)
+    text += R"({"t":)" + std::to_string(1700000000000 + i) + R"(,"name":"b)" +
+            std::to_string(i) + R"(","alt":)" + std::to_string(i) + ".5}\n";
+  return text;
+}
+
+} // namespace
+
+TEST(TestFeedIngest, SpscQueueKeepsOrderAcrossThreads) {
+  auto queue = SpscQueue<uint32_t>(64);
+  EXPECT_EQ(queue.capacity(), 64U);
+  constexpr auto count = 200000U;
+
+  auto producer = std::jthread([&] {
+    for (auto i = 0U; i < count;) {
+      if (queue.tryPush(i)) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  auto expected = 0U;
+  while (expected < count) {
+    if (auto const value = queue.tryPop()) {
+      ASSERT_EQ(*value, expected);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  EXPECT_FALSE(queue.tryPop());
+}
+
+TEST(TestFeedIngest, DecodesFieldsIntoRows) {
+  auto decoder = FeedDecoder({"alt", "t", "missing"});
+  auto const text = std::string(R"({"t": 5, "alt": 1.5, "skip": [1, {"a": 2}]})"
+                                "\n"
+                                R"({"alt": "high", "t": -2e3})"
+                                "\n\n"
+                                R"({"t": 7})");
+  auto const buffer = padded(text);
+
+  auto rows = std::vector<std::vector<double>>();
+  auto const n = decoder.decode(buffer.data(), text.size(),
+                                [&](std::span<double const> const row) {
+                                  rows.emplace_back(row.begin(), row.end());
+                                  return true;
+                                });
+
+  ASSERT_EQ(n, 3U);
+  ASSERT_EQ(rows.size(), 3U);
+  EXPECT_EQ(rows[0][0], 1.5);
+  EXPECT_EQ(rows[0][1], 5.0);
+  EXPECT_TRUE(std::isnan(rows[0][2]));
+  EXPECT_TRUE(std::isnan(rows[1][0])); // not a number
+  EXPECT_EQ(rows[1][1], -2000.0);
+  EXPECT_EQ(rows[2][1], 7.0);
+  EXPECT_EQ(decoder.errors(), 0U);
+}
+
+TEST(TestFeedIngest, SkipsMalformedLines) {
+  auto decoder = FeedDecoder({"v"});
+  auto const text = std::string("{\"v\": 1}\n"
+                                "{\"v\": 2, oops}\n"
+                                "{\"v\": 3}\n"
+                                "[4]\n"
+                                "{\"v\": 5}\n");
+  auto const buffer = padded(text);
+
+  auto values = std::vector<double>();
+  decoder.decode(buffer.data(), text.size(),
+                 [&](std::span<double const> const row) {
+                   values.push_back(row[0]);
+                   return true;
+                 });
+
+  EXPECT_EQ(values, (std::vector<double>{1.0, 3.0, 5.0}));
+  EXPECT_EQ(decoder.errors(), 2U);
+}
+
+TEST(TestFeedIngest, IngestsFileInBatches) {
+  auto const path =
+      std::filesystem::temp_directory_path() /
+      std::format("feed-ingest-{}.ndjson",
+                  std::chrono::system_clock::now().time_since_epoch().count());
+  auto const text = lines(10000);
+  {
+    std::ofstream{path} << text;
+  }
+
+  auto ingest = FeedIngest(path, {"t", "alt"}, 1000, 4);
+  auto seen = size_t{0};
+  auto ordered = true;
+  while (!ingest.finished()) {
+    ingest.poll([&](FeedBatch const &batch) {
+      for (auto r = size_t{0}; r < batch.rows; ++r) {
+        ordered = ordered &&
+                  batch.columns[0][r] == 1700000000000.0 +
+                                             static_cast<double>(seen) &&
+                  batch.columns[1][r] == static_cast<double>(seen) + 0.5;
+        ++seen;
+      }
+    });
+    std::this_thread::yield();
+  }
+
+  EXPECT_EQ(seen, 10000U);
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(ingest.stats().rows, 10000U);
+  EXPECT_EQ(ingest.stats().errors, 0U);
+  EXPECT_EQ(ingest.stats().bytes, text.size());
+  std::filesystem::remove(path);
+}
+
+TEST(TestFeedIngest, IngestsPipe) {
+  auto fds = std::array<int, 2>{};
+  ASSERT_EQ(pipe(fds.data()), 0);
+
+  auto const text = lines(5000);
+  auto writer = std::jthread([&] {
+    // uneven writes split lines across reads
+    for (auto offset = size_t{0}; offset < text.size();) {
+      auto const n = std::min<size_t>(777, text.size() - offset);
+      offset += static_cast<size_t>(write(fds[1], text.data() + offset, n));
+    }
+    close(fds[1]);
+  });
+
+  auto ingest = FeedIngest(fds[0], {"alt"}, 512, 4);
+  auto sum = 0.0;
+  auto seen = size_t{0};
+  while (!ingest.finished()) {
+    seen += ingest.poll([&](FeedBatch const &batch) {
+      for (auto r = size_t{0}; r < batch.rows; ++r)
+        sum += batch.columns[0][r];
+    });
+    std::this_thread::yield();
+  }
+  writer.join();
+  close(fds[0]);
+
+  EXPECT_EQ(seen, 5000U);
+  EXPECT_EQ(sum, 4999.0 * 5000.0 / 2 + 0.5 * 5000);
+}
+
+TEST(TestFeedIngest, SkipsOverlongLineInPipe) {
+  auto fds = std::array<int, 2>{};
+  ASSERT_EQ(pipe(fds.data()), 0);
+
+  // longer than the 1 MiB read buffer; the lines after it must survive
+  auto const text = R"({"name":")" + std::string(size_t{3} << 19, 'x') +
+                    "\"}\n" + lines(100);
+  auto writer = std::jthread([&] {
+    for (auto offset = size_t{0}; offset < text.size();) {
+      auto const n = std::min<size_t>(4096, text.size() - offset);
+      offset += static_cast<size_t>(write(fds[1], text.data() + offset, n));
+    }
+    close(fds[1]);
+  });
+
+  auto ingest = FeedIngest(fds[0], {"alt"}, 512, 4);
+  auto sum = 0.0;
+  auto seen = size_t{0};
+  while (!ingest.finished()) {
+    seen += ingest.poll([&](FeedBatch const &batch) {
+      for (auto r = size_t{0}; r < batch.rows; ++r)
+        sum += batch.columns[0][r];
+    });
+    std::this_thread::yield();
+  }
+  writer.join();
+  close(fds[0]);
+
+  EXPECT_EQ(seen, 100U);
+  EXPECT_EQ(sum, 99.0 * 100.0 / 2 + 0.5 * 100);
+  EXPECT_EQ(ingest.stats().errors, 1U);
+}
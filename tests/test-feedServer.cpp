@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include "../src/feedServer.hpp"
+#include "socketFixture.hpp"
+
+#include <numeric>
+
+namespace {
+
+/* inline message: two columns, padded blocks after the table */
+std::vector<std::byte> inlineMessage(uint32_t const stream,
+                                     std::vector<double> const &altitude,
+                                     std::vector<float> const &heat) {
+  auto const table = std::array{FeedColumnInfo{1, FeedType::F64},
+                                FeedColumnInfo{2, FeedType::F32}};
+  auto bytes = encodeFeedMessage(
+      stream, static_cast<uint32_t>(altitude.size()), table);
+  auto const append = [&bytes](void const *data, size_t const size) {
+    auto const at = bytes.size();
+    bytes.resize(at + feedPad(size));
+    std::memcpy(bytes.data() + at, data, size);
+  };
+  append(altitude.data(), altitude.size() * sizeof(double));
+  append(heat.data(), heat.size() * sizeof(float));
+  return bytes;
+}
+
+void sendAll(int const fd, std::span<std::byte const> const bytes) {
+  ASSERT_EQ(send(fd, bytes.data(), bytes.size(), 0),
+            static_cast<ssize_t>(bytes.size()));
+}
+
+} // namespace
+
+TEST(TestFeedServer, ParseWaitsForCompleteHeaderAndTable) {
+  auto const table = std::array{FeedColumnInfo{7, FeedType::I64}};
+  auto const bytes = encodeFeedMessage(3, 5, table);
+  auto error = std::string();
+
+  EXPECT_FALSE(parseFeedMessage(std::span(bytes).first(20), error));
+  EXPECT_TRUE(error.empty());
+  EXPECT_FALSE(parseFeedMessage(std::span(bytes).first(36), error));
+  EXPECT_TRUE(error.empty());
+
+  auto const message = parseFeedMessage(bytes, error);
+  ASSERT_TRUE(message);
+  EXPECT_EQ(message->header.stream, 3U);
+  EXPECT_EQ(message->header.payload_bytes, 40U);
+  EXPECT_EQ(message->size(), 32U + 8U + 40U);
+
+  auto corrupt = bytes;
+  corrupt[0] = std::byte{'X'};
+  EXPECT_FALSE(parseFeedMessage(corrupt, error));
+  EXPECT_EQ(error, "bad magic");
+}
+
+TEST(TestFeedServer, BatchesInlineMessagesPerDrain) {
+  auto platform = StubPlatform();
+  auto server = FeedServer(platform, socketPath("feed"));
+  auto const client = connectTo(socketPath("feed"));
+  platform.pump();
+  EXPECT_EQ(server.clientCount(), 1U);
+
+  auto wire = inlineMessage(1, {100.0, 200.0, 300.0}, {1.f, 2.f, 3.f});
+  auto const second = inlineMessage(2, {400.0}, {4.f});
+  wire.insert(wire.end(), second.begin(), second.end());
+  // the first message in full, the second split across reads
+  sendAll(client, std::span(wire).first(wire.size() - 12));
+  platform.pump();
+
+  auto streams = std::vector<uint32_t>();
+  auto altitudes = std::vector<double>();
+  auto const collect = [&](FeedServer::Update const &update) {
+    streams.push_back(update.stream);
+    ASSERT_EQ(update.columns.size(), 2U);
+    EXPECT_EQ(update.columns[0].id, 1U);
+    EXPECT_TRUE(update.columns[0].values<float>().empty());
+    auto const values = update.columns[0].values<double>();
+    ASSERT_EQ(values.size(), update.rows);
+    altitudes.insert(altitudes.end(), values.begin(), values.end());
+    EXPECT_EQ(update.columns[1].values<float>().size(), update.rows);
+  };
+  EXPECT_EQ(server.drain(collect), 1U);
+
+  sendAll(client, std::span(wire).last(12));
+  platform.pump();
+  EXPECT_EQ(server.drain(collect), 1U);
+
+  EXPECT_EQ(streams, (std::vector<uint32_t>{1, 2}));
+  EXPECT_EQ(altitudes, (std::vector<double>{100.0, 200.0, 300.0, 400.0}));
+  EXPECT_EQ(server.stats().updates, 2U);
+  close(client);
+}
+
+TEST(TestFeedServer, MapsSealedMemfdPayload) {
+  auto platform = StubPlatform();
+  auto server = FeedServer(platform, socketPath("feed"));
+  auto const client = connectTo(socketPath("feed"));
+  platform.pump();
+
+  auto const rows = uint32_t{1000};
+  auto values = std::vector<int64_t>(rows);
+  std::iota(values.begin(), values.end(), 0);
+
+  auto const memfd = memfd_create("feed", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  ASSERT_NE(memfd, -1);
+  ASSERT_EQ(write(memfd, values.data(), values.size() * sizeof(int64_t)),
+            static_cast<ssize_t>(values.size() * sizeof(int64_t)));
+  ASSERT_EQ(fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK), 0);
+
+  auto const table = std::array{FeedColumnInfo{9, FeedType::I64}};
+  auto header = encodeFeedMessage(5, rows, table, true);
+  auto data = iovec{.iov_base = header.data(), .iov_len = header.size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  auto message = msghdr{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  auto *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+  ASSERT_EQ(sendmsg(client, &message, 0),
+            static_cast<ssize_t>(header.size()));
+  close(memfd);
+  platform.pump();
+
+  auto sum = int64_t{0};
+  EXPECT_EQ(server.drain([&](FeedServer::Update const &update) {
+    EXPECT_EQ(update.stream, 5U);
+    for (auto const value : update.columns[0].values<int64_t>())
+      sum += value;
+  }),
+            1U);
+  EXPECT_EQ(sum, int64_t{rows} * (rows - 1) / 2);
+  EXPECT_EQ(server.stats().memfd_bytes, rows * sizeof(int64_t));
+  close(client);
+}
+
+TEST(TestFeedServer, DropsClientOnProtocolError) {
+  auto platform = StubPlatform();
+  auto server = FeedServer(platform, socketPath("feed"));
+  auto const good = connectTo(socketPath("feed"));
+  auto const bad = connectTo(socketPath("feed"));
+  platform.pump();
+  ASSERT_EQ(server.clientCount(), 2U);
+
+  sendAll(good, inlineMessage(1, {1.0}, {1.f}));
+  auto garbage = inlineMessage(2, {2.0}, {2.f});
+  garbage[0] = std::byte{'X'};
+  sendAll(bad, garbage);
+  // a memfd message without the descriptor is rejected too
+  auto const table = std::array{FeedColumnInfo{1, FeedType::F64}};
+  sendAll(bad, encodeFeedMessage(3, 4, table, true));
+  platform.pump();
+
+  auto delivered = size_t{0};
+  server.drain([&](FeedServer::Update const &) { ++delivered; });
+  EXPECT_EQ(delivered, 1U);
+  EXPECT_EQ(server.clientCount(), 1U);
+  EXPECT_EQ(server.stats().rejected, 1U);
+
+  // a hang-up is noticed and the client removed after its last messages
+  sendAll(good, inlineMessage(4, {5.0}, {5.f}));
+  close(good);
+  platform.pump();
+  server.drain([&](FeedServer::Update const &) { ++delivered; });
+  EXPECT_EQ(delivered, 2U);
+  EXPECT_EQ(server.clientCount(), 0U);
+  close(bad);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "../src/balloonSim.hpp"
+#include "../src/fixedStep.hpp"
+
+namespace {
+
+struct Snapshot {
+  uint64_t step = 0;
+  std::vector<float> altitude;
+};
+
+void addFleet(BalloonSim &sim) {
+  for (auto i = 0; i < 4; ++i)
+    sim.add({.temperature = 360.0f + 5.0f * static_cast<float>(i)});
+}
+
+FixedStepRunner<Snapshot> makeRunner(BalloonSim &sim, bool const threaded) {
+  return {FixedStep(sim.step()), [&sim] { sim.advance(); },
+          [&sim](Snapshot &snapshot) {
+            snapshot.step = sim.steps();
+            snapshot.altitude.assign(sim.positionY().begin(),
+                                     sim.positionY().end());
+          },
+          threaded};
+}
+
+std::vector<float> referenceAltitudes(uint64_t const steps) {
+  auto sim = BalloonSim(8);
+  addFleet(sim);
+  for (auto i = uint64_t{0}; i < steps; ++i)
+    sim.advance();
+  return {sim.positionY().begin(), sim.positionY().end()};
+}
+
+} // namespace
+
+TEST(TestFixedStep, AccumulatesWholeStepsAndBoundsCatchUp) {
+  auto clock = FixedStep(0.01, 4);
+  EXPECT_EQ(clock.accumulate(0.025), 2U);
+  EXPECT_NEAR(clock.alpha(), 0.5f, 1e-4f);
+  EXPECT_EQ(clock.accumulate(0.004), 0U);
+  EXPECT_EQ(clock.accumulate(0.002), 1U);
+
+  // a one second stall runs at most four steps and drops the rest
+  EXPECT_EQ(clock.accumulate(1.0), 4U);
+  EXPECT_EQ(clock.dropped(), 96U);
+  EXPECT_EQ(clock.accumulate(-1.0), 0U);
+}
+
+TEST(TestFixedStep, StepCountIndependentOfFrameRate) {
+  for (auto const hz : {30.0, 60.0, 144.0, 240.0}) {
+    auto clock = FixedStep(1.0 / 120.0);
+    auto steps = uint64_t{0};
+    for (auto frame = 0; frame < static_cast<int>(hz) * 10; ++frame)
+      steps += clock.accumulate(1.0 / hz);
+    EXPECT_NEAR(static_cast<double>(steps), 1200.0, 1.0) << hz << " Hz";
+  }
+}
+
+TEST(TestFixedStep, FramesInterpolateAdjacentSteps) {
+  for (auto const threaded : {false, true}) {
+    auto sim = BalloonSim(8);
+    addFleet(sim);
+    auto runner = makeRunner(sim, threaded);
+    auto last = uint64_t{0};
+    for (auto frame = 0; frame < 144; ++frame) {
+      auto const view = runner.frame(1.0 / 144.0);
+      EXPECT_GE(view.step, last);
+      EXPECT_GE(view.alpha, 0.0f);
+      EXPECT_LE(view.alpha, 1.0f);
+      EXPECT_EQ(view.from.step, view.step);
+      if (view.alpha > 0.0f) {
+        EXPECT_EQ(view.to.step, view.step + 1);
+      }
+      last = view.step;
+    }
+    EXPECT_NEAR(static_cast<double>(last), 120.0, 1.0);
+    EXPECT_GE(runner.completedSteps(), last);
+  }
+}
+
+TEST(TestFixedStep, SnapshotsMatchReferenceAtEveryRate) {
+  auto const run = [](double const hz, bool const threaded) {
+    auto sim = BalloonSim(8);
+    addFleet(sim);
+    auto runner = makeRunner(sim, threaded);
+    auto result = Snapshot();
+    for (auto frame = 0; frame < static_cast<int>(hz); ++frame) {
+      auto const view = runner.frame(1.0 / hz);
+      result = view.from;
+    }
+    return result;
+  };
+
+  for (auto const hz : {60.0, 144.0}) {
+    for (auto const threaded : {false, true}) {
+      auto const snapshot = run(hz, threaded);
+      EXPECT_EQ(snapshot.altitude, referenceAltitudes(snapshot.step))
+          << hz << " Hz, threaded " << threaded;
+    }
+  }
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "../src/frameLimiter.hpp"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(TestFrameLimiter, UncappedDoesNotWait) {
+  auto limiter = FrameLimiter();
+  EXPECT_FALSE(limiter.capped());
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < 1000; ++i)
+    limiter.wait();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 10ms);
+  EXPECT_EQ(limiter.takeStats().frames, 1000U);
+}
+
+TEST(TestFrameLimiter, PacesToCapWithoutDrift) {
+  auto limiter = FrameLimiter(500.0);
+  limiter.wait(); // starts the schedule
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < 100; ++i)
+    limiter.wait();
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  // 100 periods of 2 ms; loose bounds for a loaded test machine
+  EXPECT_GE(elapsed, 199ms);
+  EXPECT_LT(elapsed, 230ms);
+
+  auto const stats = limiter.takeStats();
+  EXPECT_EQ(stats.frames, 101U);
+  EXPECT_GE(stats.overshoot, 0ns);
+  EXPECT_GE(stats.spin, FrameLimiter::minSpin);
+  EXPECT_LE(stats.spin, FrameLimiter::maxSpin);
+  EXPECT_EQ(limiter.takeStats().frames, 0U);
+}
+
+TEST(TestFrameLimiter, LateFrameRestartsSchedule) {
+  auto limiter = FrameLimiter(1000.0);
+  limiter.wait();
+  std::this_thread::sleep_for(20ms);
+  limiter.wait(); // late by far more than a period
+  auto const start = std::chrono::steady_clock::now();
+  limiter.wait();
+  // paced one period after the late frame, not bunched up to catch up
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 500us);
+  EXPECT_EQ(limiter.takeStats().late, 1U);
+
+  limiter.setCap(0.0);
+  EXPECT_FALSE(limiter.capped());
+}
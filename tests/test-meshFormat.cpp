@@ -0,0 +1,209 @@
+#include <format>
+#include <gtest/gtest.h>
+#include <set>
+
+#include "../src/meshFormat.hpp"
+
+namespace {
+
+/* n x n grid of quads in the xy plane, two triangles each */
+MeshSource gridMesh(uint32_t const n) {
+  auto source = MeshSource();
+  for (auto y = 0U; y <= n; ++y) {
+    for (auto x = 0U; x <= n; ++x) {
+      source.positions.push_back(
+          {static_cast<float>(x), static_cast<float>(y), 0.0f});
+      source.normals.push_back({0.0f, 0.0f, 1.0f});
+      source.uvs.push_back({static_cast<float>(x) / static_cast<float>(n),
+                            static_cast<float>(y) / static_cast<float>(n)});
+    }
+  }
+  for (auto y = 0U; y < n; ++y) {
+    for (auto x = 0U; x < n; ++x) {
+      auto const i = y * (n + 1) + x;
+      source.indices.insert(source.indices.end(),
+                            {i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1});
+    }
+  }
+  return source;
+}
+
+std::multiset<std::array<uint32_t, 3>>
+triangleSet(std::span<uint32_t const> indices) {
+  auto set = std::multiset<std::array<uint32_t, 3>>();
+  for (auto t = 0U; t < indices.size(); t += 3) {
+    auto tri = std::array<uint32_t, 3>{indices[t], indices[t + 1],
+                                       indices[t + 2]};
+    // canonical rotation, winding preserved
+    std::ranges::rotate(tri, std::ranges::min_element(tri));
+    set.insert(tri);
+  }
+  return set;
+}
+
+/* average cache miss ratio for a FIFO cache of the given size */
+float acmr(std::span<uint32_t const> indices, uint32_t const cache_size) {
+  auto cache = std::vector<uint32_t>();
+  auto misses = 0U;
+  for (auto const index : indices) {
+    if (std::ranges::find(cache, index) == cache.end()) {
+      ++misses;
+      cache.push_back(index);
+      if (cache.size() > cache_size)
+        cache.erase(cache.begin());
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+} // namespace
+
+TEST(TestMeshFormat, HalfRoundTrip) {
+  for (auto const value : {0.0f, 1.0f, -2.5f, 0.333251953125f, 65504.0f}) {
+    EXPECT_EQ(halfToFloat(floatToHalf(value)), value);
+  }
+  EXPECT_EQ(floatToHalf(1.0f), 0x3c00);
+  EXPECT_EQ(floatToHalf(1e6f), 0x7c00); // overflow to inf
+  EXPECT_NEAR(halfToFloat(floatToHalf(0.1f)), 0.1f, 1e-4f);
+  EXPECT_NEAR(halfToFloat(floatToHalf(1e-6f)), 1e-6f, 1e-7f); // subnormal
+}
+
+TEST(TestMeshFormat, OctahedralRoundTrip) {
+  auto const normals = std::vector<std::array<float, 3>>{
+      {0.0f, 0.0f, 1.0f},   {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 0.0f},
+      {0.0f, -1.0f, 0.0f},  {0.577f, 0.577f, -0.577f},
+      {-0.267f, 0.534f, 0.802f}};
+
+  for (auto const &n : normals) {
+    auto const length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    auto const decoded = octDecode(octEncode(n));
+    for (auto k = 0U; k < 3; ++k) {
+      EXPECT_NEAR(decoded[k], n[k] / length, 1e-3f);
+    }
+  }
+}
+
+TEST(TestMeshFormat, VertexCacheKeepsTrianglesAndHelps) {
+  auto const source = gridMesh(32);
+  auto const optimized = optimizeVertexCache(
+      source.indices, static_cast<uint32_t>(source.positions.size()));
+
+  EXPECT_EQ(triangleSet(optimized), triangleSet(source.indices));
+  EXPECT_LT(acmr(optimized, 16), acmr(source.indices, 16));
+}
+
+TEST(TestMeshFormat, VertexFetchIsFirstUseOrder) {
+  auto indices = std::vector<uint32_t>{5, 2, 7, 2, 7, 0};
+  auto const remap = optimizeVertexFetch(indices, 8);
+
+  EXPECT_EQ(indices, (std::vector<uint32_t>{0, 1, 2, 1, 2, 3}));
+  EXPECT_EQ(remap[5], 0U);
+  EXPECT_EQ(remap[0], 3U);
+  EXPECT_EQ(remap[1], std::numeric_limits<uint32_t>::max());
+}
+
+TEST(TestMeshFormat, MeshletLimits) {
+  auto const source = gridMesh(40);
+  auto const build = buildMeshlets(source.indices, source.positions);
+
+  auto triangles = 0U;
+  for (auto const &meshlet : build.meshlets) {
+    EXPECT_LE(meshlet.vertex_count, meshletMaxVertices);
+    EXPECT_LE(meshlet.triangle_count, meshletMaxTriangles);
+    triangles += meshlet.triangle_count;
+
+    for (auto i = 0U; i < meshlet.triangle_count * 3; ++i) {
+      auto const local = build.triangles[meshlet.triangle_offset + i];
+      ASSERT_LT(local, meshlet.vertex_count);
+      auto const &p =
+          source.positions[build.vertices[meshlet.vertex_offset + local]];
+      auto const dx = p[0] - meshlet.bounds[0];
+      auto const dy = p[1] - meshlet.bounds[1];
+      auto const dz = p[2] - meshlet.bounds[2];
+      EXPECT_LE(std::sqrt(dx * dx + dy * dy + dz * dz),
+                meshlet.bounds[3] + 1e-4f);
+    }
+  }
+  EXPECT_EQ(triangles, source.indices.size() / 3);
+}
+
+TEST(TestMeshFormat, LodChainShrinks) {
+  auto const source = gridMesh(64);
+  auto const chain = buildLodChain(source.indices, source.positions);
+
+  ASSERT_GE(chain.size(), 4U);
+  ASSERT_LE(chain.size(), meshMaxLods);
+  EXPECT_EQ(chain[0].indices, source.indices);
+  EXPECT_EQ(chain[0].error, 0.0f);
+
+  for (auto l = 1U; l < chain.size(); ++l) {
+    EXPECT_LE(chain[l].indices.size(), chain[l - 1].indices.size() / 2 + 3);
+    EXPECT_GE(chain[l].error, chain[l - 1].error);
+    for (auto const index : chain[l].indices)
+      ASSERT_LT(index, source.positions.size());
+  }
+}
+
+TEST(TestMeshFormat, SelectLodByProjectedError) {
+  auto const lods = std::array<MeshLod, 4>{MeshLod{.error = 0.0f},
+                                           MeshLod{.error = 0.01f},
+                                           MeshLod{.error = 0.1f},
+                                           MeshLod{.error = 1.0f}};
+  auto const projection_scale = 1000.0f; // ~1080p at 57 degrees
+
+  EXPECT_EQ(selectMeshLod(lods, 1.0f, projection_scale), 0U);
+  EXPECT_EQ(selectMeshLod(lods, 20.0f, projection_scale), 1U);
+  EXPECT_EQ(selectMeshLod(lods, 200.0f, projection_scale), 2U);
+  EXPECT_EQ(selectMeshLod(lods, 5000.0f, projection_scale), 3U);
+  EXPECT_EQ(selectMeshLod(lods, 200.0f, projection_scale, 1000.0f), 3U);
+}
+
+TEST(TestMeshFormat, FileRoundTrip) {
+  auto const path =
+      std::filesystem::temp_directory_path() /
+      std::format("mesh-file-{}",
+                  std::chrono::system_clock::now().time_since_epoch().count());
+
+  auto const source = gridMesh(8);
+  writeMeshFile(path, buildMeshFile(source));
+
+  auto const view = MeshView{path};
+  EXPECT_EQ(view.header->vertex_count, source.positions.size());
+  ASSERT_FALSE(view.lods().empty());
+  EXPECT_EQ(view.lods()[0].index_offset, 0U);
+  EXPECT_EQ(view.lods()[0].index_count, source.indices.size());
+  EXPECT_EQ(view.header->index_size, 2U);
+  EXPECT_FALSE(view.meshlets().empty());
+
+  auto const *vertices =
+      reinterpret_cast<MeshVertex const *>(view.vertexBytes().data());
+  auto const *indices =
+      reinterpret_cast<uint16_t const *>(view.indexBytes().data());
+  for (auto i = 0U; i < view.header->index_count; ++i) {
+    ASSERT_LT(indices[i], view.header->vertex_count);
+    auto const &vertex = vertices[indices[i]];
+    for (auto k = 0U; k < 3; ++k) {
+      auto const position =
+          view.header->position_min[k] +
+          static_cast<float>(vertex.position[k]) * view.header->position_scale[k];
+      EXPECT_NEAR(position, std::round(position), 1e-3f);
+    }
+    EXPECT_NEAR(octDecode(vertex.normal)[2], 1.0f, 1e-4f);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(TestMeshFormat, RejectsForeignFile) {
+  auto const path =
+      std::filesystem::temp_directory_path() /
+      std::format("mesh-file-{}",
+                  std::chrono::system_clock::now().time_since_epoch().count());
+  {
+    std::ofstream{path} << std::string(sizeof(MeshFileHeader), 'x');
+  }
+
+  EXPECT_THROW(MeshView{path}, std::runtime_error);
+
+  std::filesystem::remove(path);
+}
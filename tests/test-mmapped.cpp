@@ -64,4 +64,32 @@ TEST(TestMMappedFile, LazyRegularFile) {
   EXPECT_EQ(mmapped.size(), 13);
 
   std::filesystem::remove(path);
-}
\ No newline at end of file
+}
+
+TEST(TestMMappedFile, WindowedViews) {
+  auto const path =
+      std::filesystem::temp_directory_path() /
+      std::format("mmapped-window-{}",
+                  std::chrono::system_clock::now().time_since_epoch().count());
+
+  auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  {
+    auto out = std::ofstream{path, std::ios::binary};
+    for (auto i = 0U; i < page * 4; ++i)
+      out.put(static_cast<char>(i % 251));
+  }
+
+  // one-page windows, at most two mapped
+  auto window = MMappedWindow{path, page, 2};
+  EXPECT_EQ(window.size(), page * 4);
+
+  for (auto const offset : {size_t{0}, page * 3 + 5, page - 2, size_t{17}}) {
+    auto const *data = window.view(offset, 4);
+    for (auto i = 0U; i < 4; ++i)
+      EXPECT_EQ(static_cast<unsigned char>(data[i]), (offset + i) % 251);
+  }
+
+  EXPECT_THROW(window.view(page * 4 - 2, 4), std::runtime_error);
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,144 @@
+#include <chrono>
+#include <format>
+#include <gtest/gtest.h>
+#include <random>
+
+#include "../src/pointCloudFormat.hpp"
+
+namespace {
+
+std::vector<PointSource> randomCloud(size_t const count, uint32_t const seed) {
+  auto rng = std::mt19937(seed);
+  auto dist = std::uniform_real_distribution<float>(-50.0f, 50.0f);
+  auto points = std::vector<PointSource>(count);
+  for (auto i = 0U; i < count; ++i) {
+    points[i].position = {dist(rng), dist(rng) * 0.1f, dist(rng)};
+    points[i].colour = {static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8U),
+                        0, 255};
+  }
+  return points;
+}
+
+std::array<float, 3> decode(PointNode const &node, PointVertex const &v) {
+  return {node.min[0] + v.position[0] / 65535.0f * node.size,
+          node.min[1] + v.position[1] / 65535.0f * node.size,
+          node.min[2] + v.position[2] / 65535.0f * node.size};
+}
+
+} // namespace
+
+TEST(TestPointCloudFormat, OctreeKeepsEveryPoint) {
+  auto const source = randomCloud(20000, 1);
+  auto const octree = buildPointOctree(source, 1000);
+
+  ASSERT_GT(octree.nodes.size(), 8U);
+  EXPECT_EQ(octree.dropped, 0U);
+  EXPECT_EQ(octree.points.size(), source.size());
+
+  auto total = uint64_t{0};
+  auto covered = std::vector<bool>(octree.points.size());
+  for (auto i = 0U; i < octree.nodes.size(); ++i) {
+    auto const &node = octree.nodes[i];
+    EXPECT_LE(node.point_count, 1000U);
+    total += node.point_count;
+
+    for (auto p = node.point_offset; p < node.point_offset + node.point_count;
+         ++p) {
+      EXPECT_FALSE(covered[p]);
+      covered[p] = true;
+      // decoded position stays inside the node's cube
+      auto const position = decode(node, octree.points[p]);
+      for (auto k = 0U; k < 3; ++k) {
+        EXPECT_GE(position[k], node.min[k] - 1e-3f);
+        EXPECT_LE(position[k], node.min[k] + node.size + 1e-3f);
+      }
+    }
+
+    for (auto c = node.first_child; c < node.first_child + node.child_count;
+         ++c) {
+      EXPECT_GT(c, i); // children follow their parent
+      EXPECT_EQ(octree.nodes[c].depth, node.depth + 1);
+      EXPECT_FLOAT_EQ(octree.nodes[c].size, node.size / 2);
+    }
+  }
+  EXPECT_EQ(total, source.size());
+}
+
+TEST(TestPointCloudFormat, CoincidentPointsAreBounded) {
+  auto source = std::vector<PointSource>(5000, PointSource{{1, 2, 3}, {}});
+  source.push_back({{5, 5, 5}, {}});
+
+  auto const octree = buildPointOctree(source, 100);
+  for (auto const &node : octree.nodes) {
+    EXPECT_LT(node.depth, pointCloudMaxDepth);
+    EXPECT_LE(node.point_count, 100U);
+  }
+  EXPECT_GT(octree.dropped, 0U);
+}
+
+TEST(TestPointCloudFormat, SelectionHonoursBudgetAndOrder) {
+  auto const octree = buildPointOctree(randomCloud(50000, 2), 2000);
+  auto const eye = std::array<float, 3>{0.0f, 10.0f, 0.0f};
+
+  auto const everything =
+      selectPointNodes(octree.nodes, eye, 1000.0f, UINT64_MAX, 0.0f);
+  EXPECT_EQ(everything.size(), octree.nodes.size());
+
+  auto const budgeted = selectPointNodes(octree.nodes, eye, 1000.0f, 10000);
+  ASSERT_FALSE(budgeted.empty());
+  EXPECT_EQ(budgeted.front(), 0U);
+
+  auto total = uint64_t{0};
+  auto parent = std::vector<int64_t>(octree.nodes.size(), -1);
+  for (auto i = 0U; i < octree.nodes.size(); ++i)
+    for (auto c = 0U; c < octree.nodes[i].child_count; ++c)
+      parent[octree.nodes[i].first_child + c] = i;
+
+  auto chosen = std::vector<bool>(octree.nodes.size());
+  for (auto const index : budgeted) {
+    total += octree.nodes[index].point_count;
+    if (parent[index] >= 0) { // coarse to fine
+      EXPECT_TRUE(chosen[static_cast<size_t>(parent[index])]);
+    }
+    chosen[index] = true;
+  }
+  EXPECT_LE(total, 10000U);
+
+  // far away, the root alone is fine enough
+  auto const far = selectPointNodes(octree.nodes, {0.0f, 1e6f, 0.0f}, 1000.0f,
+                                    UINT64_MAX);
+  EXPECT_EQ(far.size(), 1U);
+
+  // the inside of this plane is y <= -1000, well below the cloud
+  auto const plane = std::array<std::array<float, 4>, 1>{
+      {{0.0f, -1.0f, 0.0f, -1000.0f}}};
+  EXPECT_TRUE(
+      selectPointNodes(octree.nodes, eye, 1000.0f, UINT64_MAX, 1.0f, plane)
+          .empty());
+}
+
+TEST(TestPointCloudFormat, FileRoundTrip) {
+  auto const octree = buildPointOctree(randomCloud(5000, 3), 500);
+
+  auto const path =
+      std::filesystem::temp_directory_path() /
+      std::format("pointcloud-{}.pc",
+                  std::chrono::system_clock::now().time_since_epoch().count());
+  writePointCloudFile(path, octree);
+
+  {
+    auto const view = PointCloudView(path);
+    EXPECT_EQ(view.header->point_count, octree.points.size());
+    EXPECT_EQ(view.header->points_offset % 4096, 0U);
+    ASSERT_EQ(view.nodes().size(), octree.nodes.size());
+
+    auto const &node = view.nodes()[3];
+    auto const bytes = view.pointBytes(node);
+    ASSERT_EQ(bytes.size(), node.point_count * sizeof(PointVertex));
+    EXPECT_EQ(std::memcmp(bytes.data(), &octree.points[node.point_offset],
+                          bytes.size()),
+              0);
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include "../src/qualityGovernor.hpp"
+
+namespace {
+
+QualityGovernor::Settings fastSettings() {
+  return {.budget_ms = 10.0,
+          .headroom = 0.8,
+          .window = 10,
+          .raise_after = 20,
+          .cooldown = 10};
+}
+
+/* a renderer whose GPU time is a base cost scaled by the knob levels */
+struct FakeRenderer {
+  size_t resolution = 2;
+  size_t msaa = 2;
+  double base_ms = 14.0;
+
+  [[nodiscard]] double gpuMs() const {
+    return base_ms * (0.5 + 0.25 * static_cast<double>(resolution)) *
+           (0.8 + 0.1 * static_cast<double>(msaa));
+  }
+};
+
+} // namespace
+
+TEST(TestQualityGovernor, LowersInOrderUntilWithinBudget) {
+  auto renderer = FakeRenderer();
+  auto governor = QualityGovernor(fastSettings());
+  auto const msaa = governor.addKnob(
+      {.name = "msaa",
+       .levels = {"off", "low", "high"},
+       .level = 2,
+       .apply = [&](size_t const level) { renderer.msaa = level; }});
+  auto const resolution = governor.addKnob(
+      {.name = "resolution",
+       .levels = {"50%", "75%", "100%"},
+       .level = 2,
+       .apply = [&](size_t const level) { renderer.resolution = level; }});
+
+  for (auto i = 0; i < 500; ++i)
+    governor.frame(2.0, renderer.gpuMs());
+
+  EXPECT_LE(renderer.gpuMs(), 10.0);
+  ASSERT_GE(governor.decisions().size(), 2U);
+  // the first knob goes first
+  EXPECT_EQ(governor.decisions()[0].knob, msaa);
+  EXPECT_EQ(governor.decisions()[0].from, 2U);
+  EXPECT_EQ(governor.decisions()[0].to, 1U);
+  EXPECT_TRUE(governor.decisions()[0].gpu_bound);
+  EXPECT_EQ(governor.knob(msaa).level, renderer.msaa);
+  EXPECT_EQ(governor.knob(resolution).level, renderer.resolution);
+}
+
+TEST(TestQualityGovernor, IgnoresHitchesAndCpuBoundFrames) {
+  auto governor = QualityGovernor(fastSettings());
+  auto level = size_t{1};
+  governor.addKnob({.name = "post",
+                    .levels = {"off", "on"},
+                    .level = 1,
+                    .relieves = QualityGovernor::Relieves::Gpu,
+                    .apply = [&](size_t const l) { level = l; }});
+
+  // one long frame in every ten stays above the 90th percentile
+  for (auto i = 0; i < 200; ++i)
+    governor.frame(2.0, i % 10 == 0 ? 30.0 : 6.0);
+  EXPECT_TRUE(governor.decisions().empty());
+
+  // CPU bound: a GPU-only knob cannot help
+  for (auto i = 0; i < 200; ++i)
+    governor.frame(20.0, 6.0);
+  EXPECT_TRUE(governor.decisions().empty());
+  EXPECT_EQ(level, 1U);
+}
+
+TEST(TestQualityGovernor, RaisesWithHeadroomAndBacksOffOscillation) {
+  auto renderer = FakeRenderer{.resolution = 2, .msaa = 0, .base_ms = 11.0};
+  auto governor = QualityGovernor(fastSettings());
+  governor.addKnob(
+      {.name = "resolution",
+       .levels = {"50%", "75%", "100%"},
+       .level = 2,
+       .apply = [&](size_t const level) { renderer.resolution = level; }});
+
+  // 100% costs 11.0 * 1.0 * 0.8 = 8.8 ms: over headroom (8 ms), under budget
+  // 75% costs 6.6 ms; so with base 13 the governor settles on 75%
+  renderer.base_ms = 13.0;
+  for (auto i = 0; i < 2000; ++i)
+    governor.frame(1.0, renderer.gpuMs());
+  EXPECT_EQ(renderer.resolution, 1U);
+
+  // every raise to 100% is immediately undone; the waits between tries
+  // grow, so there are far fewer than one attempt per raise_after frames
+  auto const &decisions = governor.decisions();
+  auto raises = std::ranges::count_if(
+      decisions, [](auto const &d) { return d.to > d.from; });
+  EXPECT_GE(raises, 1);
+  EXPECT_LT(raises, 2000 / 20 / 4);
+  EXPECT_LT(governor.decisionCount(), 2U * (2000 / 20 / 4));
+
+  // load drops: back to full quality
+  renderer.base_ms = 5.0;
+  for (auto i = 0; i < 5000; ++i)
+    governor.frame(1.0, renderer.gpuMs());
+  EXPECT_EQ(renderer.resolution, 2U);
+}
+
+TEST(TestQualityGovernor, ManualLevelSticks) {
+  auto governor = QualityGovernor(fastSettings());
+  auto level = size_t{2};
+  governor.addKnob({.name = "lod",
+                    .levels = {"coarse", "medium", "fine"},
+                    .level = 2,
+                    .apply = [&](size_t const l) { level = l; }});
+
+  EXPECT_FALSE(governor.setLevel("lod", 3));
+  EXPECT_FALSE(governor.setLevel("msaa", 0));
+  EXPECT_TRUE(governor.setLevel("lod", 0));
+  EXPECT_EQ(level, 0U);
+  ASSERT_EQ(governor.decisions().size(), 1U);
+  EXPECT_TRUE(governor.decisions()[0].manual);
+
+  // plenty of headroom, but a forced level is not the governor's to undo
+  for (auto i = 0; i < 1000; ++i)
+    governor.frame(1.0, 1.0);
+  EXPECT_EQ(level, 0U);
+}
+
+TEST(TestQualityGovernor, KeepsOnlyRecentDecisions) {
+  auto settings = fastSettings();
+  settings.history = 4;
+  auto governor = QualityGovernor(settings);
+  governor.addKnob({.name = "lod",
+                    .levels = {"coarse", "fine"},
+                    .level = 1,
+                    .apply = [](size_t) {}});
+
+  for (auto i = 0U; i < 10; ++i)
+    ASSERT_TRUE(governor.setLevel("lod", i % 2));
+
+  EXPECT_EQ(governor.decisionCount(), 10U);
+  ASSERT_EQ(governor.decisions().size(), 4U);
+  // oldest first: the 7th to the 10th change
+  EXPECT_EQ(governor.decisions().front().to, 0U);
+  EXPECT_EQ(governor.decisions().back().to, 1U);
+  EXPECT_EQ(governor.decisions().back().from, 0U);
+}
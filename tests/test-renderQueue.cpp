@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "../src/renderQueue.hpp"
+
+TEST(TestRenderQueue, KeysRoundTripAndOrderByField) {
+  auto const fields = RenderQueue::Fields{
+      .pass = 3, .pipeline = 1000, .material = 9000, .geometry = 4000,
+      .depth = 0xabcdef};
+  auto const unpacked = RenderQueue::fields(RenderQueue::key(fields));
+  EXPECT_EQ(unpacked.pass, 3U);
+  EXPECT_EQ(unpacked.pipeline, 1000U);
+  EXPECT_EQ(unpacked.material, 9000U);
+  EXPECT_EQ(unpacked.geometry, 4000U);
+  EXPECT_EQ(unpacked.depth, 0xabcdefU);
+
+  // pass dominates everything below it
+  EXPECT_LT(RenderQueue::key({.pass = 0, .pipeline = 1023}),
+            RenderQueue::key({.pass = 1}));
+  // out of range values don't spill into other fields
+  EXPECT_EQ(RenderQueue::fields(RenderQueue::key({.geometry = 4096})).material,
+            0U);
+}
+
+TEST(TestRenderQueue, DepthEncodings) {
+  EXPECT_LT(RenderQueue::depthFrontToBack(0.5f),
+            RenderQueue::depthFrontToBack(2.0f));
+  EXPECT_LT(RenderQueue::depthFrontToBack(2.0f),
+            RenderQueue::depthFrontToBack(1000.0f));
+  EXPECT_GT(RenderQueue::depthBackToFront(0.5f),
+            RenderQueue::depthBackToFront(2.0f));
+  EXPECT_EQ(RenderQueue::depthFrontToBack(-1.0f), 0U);
+}
+
+TEST(TestRenderQueue, ParallelSortMatchesStableSort) {
+  auto pool = WorkerPool(3);
+  auto queue = RenderQueue(pool.width());
+  auto expected = std::vector<RenderQueue::Item>();
+
+  auto rng = std::mt19937(3);
+  auto next = [&](uint32_t const n) { return static_cast<uint32_t>(rng() % n); };
+  for (auto thread = size_t{0}; thread < pool.width(); ++thread) {
+    for (auto i = 0U; i < 10000; ++i) {
+      auto const fields =
+          RenderQueue::Fields{.pass = next(3),
+                              .pipeline = next(8),
+                              .material = next(64),
+                              .geometry = next(16),
+                              .depth = RenderQueue::depthFrontToBack(
+                                  static_cast<float>(next(1000)))};
+      auto const payload = static_cast<uint32_t>(thread * 10000 + i);
+      queue.push(thread, fields, payload);
+      expected.push_back({RenderQueue::key(fields), payload});
+    }
+  }
+
+  queue.sort(&pool);
+  std::ranges::stable_sort(expected, {}, &RenderQueue::Item::key);
+
+  ASSERT_EQ(queue.sorted().size(), expected.size());
+  for (auto i = size_t{0}; i < expected.size(); ++i) {
+    ASSERT_EQ(queue.sorted()[i].key, expected[i].key) << i;
+    ASSERT_EQ(queue.sorted()[i].payload, expected[i].payload) << i;
+  }
+  EXPECT_TRUE(queue.bucket(0).empty());
+}
+
+TEST(TestRenderQueue, SubmitBindsOnlyOnChange) {
+  auto queue = RenderQueue();
+  queue.push(0, {.pipeline = 2, .material = 1, .geometry = 1}, 0);
+  queue.push(0, {.pipeline = 1, .material = 5, .geometry = 1}, 1);
+  queue.push(0, {.pipeline = 1, .material = 5, .geometry = 2}, 2);
+  queue.push(0, {.pipeline = 2, .material = 1, .geometry = 1}, 3);
+  queue.push(0, {.pipeline = 1, .material = 5, .geometry = 1}, 4);
+  // same pipeline, material and geometry as 0 and 3, but a later pass
+  queue.push(0, {.pass = 1, .pipeline = 2, .material = 1, .geometry = 1}, 5);
+  queue.sort();
+
+  auto passes = std::vector<uint32_t>();
+  auto drawn = std::vector<uint32_t>();
+  auto const stats = queue.submit(
+      {.pass = [&](uint32_t const pass) { passes.push_back(pass); },
+       .pipeline = [](uint32_t) {},
+       .material = [](uint32_t) {},
+       .geometry = [](uint32_t) {},
+       .draw = [&](RenderQueue::Item const &item) {
+         drawn.push_back(item.payload);
+       }});
+
+  EXPECT_EQ(passes, (std::vector<uint32_t>{0, 1}));
+  EXPECT_EQ(drawn, (std::vector<uint32_t>{1, 4, 2, 0, 3, 5}));
+  EXPECT_EQ(stats.draws, 6U);
+  EXPECT_EQ(stats.passes, 2U);
+  EXPECT_EQ(stats.pipeline_binds, 3U);
+  EXPECT_EQ(stats.material_binds, 3U);
+  EXPECT_EQ(stats.geometry_binds, 4U);
+}
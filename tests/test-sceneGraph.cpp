@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "../src/sceneGraph.hpp"
+
+namespace {
+
+Mat4 translation(float const x, float const y, float const z) {
+  auto m = mat4Identity;
+  m[12] = x;
+  m[13] = y;
+  m[14] = z;
+  return m;
+}
+
+Mat4 referenceMultiply(Mat4 const &a, Mat4 const &b) {
+  auto r = Mat4{};
+  for (auto column = 0; column < 4; ++column)
+    for (auto row = 0; row < 4; ++row)
+      for (auto k = 0; k < 4; ++k)
+        r[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+  return r;
+}
+
+} // namespace
+
+TEST(TestSceneGraph, MultiplyMatchesReference) {
+  auto a = Mat4{};
+  auto b = Mat4{};
+  for (auto i = 0; i < 16; ++i) {
+    a[i] = static_cast<float>(i + 1);
+    b[i] = static_cast<float>(16 - 2 * i);
+  }
+  EXPECT_EQ(multiply(a, b), referenceMultiply(a, b));
+  EXPECT_EQ(multiply(a, mat4Identity), a);
+}
+
+TEST(TestSceneGraph, PropagatesOnlyDirtySubtrees) {
+  auto graph = SceneGraph();
+  auto const root = graph.add(SceneGraph::noParent, translation(1, 0, 0));
+  auto const left = graph.add(root, translation(0, 2, 0));
+  auto const right = graph.add(root, translation(0, 0, 3));
+  auto const leaf = graph.add(left, translation(4, 0, 0));
+
+  EXPECT_EQ(graph.depth(leaf), 2);
+  EXPECT_EQ(graph.update().size(), 4U);
+  EXPECT_EQ(graph.world(leaf), translation(5, 2, 0));
+  EXPECT_EQ(graph.world(right), translation(1, 0, 3));
+
+  EXPECT_TRUE(graph.update().empty());
+
+  graph.setLocal(left, translation(0, 7, 0));
+  auto const changed = graph.update();
+  EXPECT_EQ(std::vector(changed.begin(), changed.end()),
+            (std::vector{left, leaf}));
+  EXPECT_EQ(graph.world(leaf), translation(5, 7, 0));
+  EXPECT_EQ(graph.world(right), translation(1, 0, 3));
+
+  graph.setLocal(root, mat4Identity);
+  EXPECT_EQ(graph.update().size(), 4U);
+  EXPECT_EQ(graph.world(leaf), translation(4, 7, 0));
+}
+
+TEST(TestSceneGraph, ParentMustExist) {
+  auto graph = SceneGraph();
+  EXPECT_THROW(graph.add(0), std::runtime_error);
+  auto const root = graph.add(SceneGraph::noParent);
+  EXPECT_THROW(graph.add(root + 1), std::runtime_error);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include "../src/seriesPyramid.hpp"
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+std::vector<float> noise(size_t const n, unsigned const seed) {
+  auto rng = std::mt19937(seed);
+  auto dist = std::normal_distribution<float>(0.0f, 1.0f);
+  auto samples = std::vector<float>(n);
+  for (auto &s : samples)
+    s = dist(rng);
+  return samples;
+}
+
+} // namespace
+
+TEST(TestSeriesPyramid, IncrementalMatchesBruteForce) {
+  auto const samples = noise(1000, 1);
+  auto pyramid = SeriesPyramid(1024);
+
+  // uneven appends, so buckets are completed across calls
+  for (auto offset = size_t{0}; offset < samples.size();) {
+    auto const n = std::min<size_t>(1 + offset % 37, samples.size() - offset);
+    EXPECT_EQ(pyramid.append(std::span(samples).subspan(offset, n)), n);
+    offset += n;
+  }
+
+  ASSERT_EQ(pyramid.size(), 1000U);
+  ASSERT_EQ(pyramid.levels(), 11U);
+  for (auto level = 0U; level < pyramid.levels(); ++level) {
+    auto const buckets = pyramid.level(level);
+    auto const width = size_t{1} << level;
+    ASSERT_EQ(buckets.size(), (samples.size() + width - 1) / width);
+    for (auto b = size_t{0}; b < buckets.size(); ++b) {
+      auto const begin = samples.begin() + static_cast<ptrdiff_t>(b * width);
+      auto const end = samples.begin() + static_cast<ptrdiff_t>(std::min(
+                                             (b + 1) * width, samples.size()));
+      EXPECT_EQ(buckets[b].min, *std::min_element(begin, end));
+      EXPECT_EQ(buckets[b].max, *std::max_element(begin, end));
+    }
+  }
+}
+
+TEST(TestSeriesPyramid, WindowFitsColumns) {
+  auto const samples = noise(1 << 20, 2);
+  auto pyramid = SeriesPyramid(static_cast<uint32_t>(samples.size()));
+  pyramid.append(samples);
+
+  for (auto const columns : {1U, 100U, 800U, 1920U}) {
+    auto const w = pyramid.window(12345, 900000, columns);
+    EXPECT_LE(w.buckets, columns);
+    EXPECT_LE(w.first_bucket << w.level, 12345U);
+    EXPECT_GE((w.first_bucket + w.buckets) << w.level, 12345U + 900000U);
+    // one level finer would not fit
+    if (w.level > 0) {
+      auto const finer = ((12345U + 900000U - 1) >> (w.level - 1)) -
+                         (12345U >> (w.level - 1)) + 1;
+      EXPECT_GT(finer, columns);
+    }
+
+    auto const r = pyramid.range(w);
+    auto const begin = samples.begin() + 12345;
+    EXPECT_LE(r.min, *std::min_element(begin, begin + 900000));
+    EXPECT_GE(r.max, *std::max_element(begin, begin + 900000));
+  }
+
+  // fewer samples than columns: raw samples
+  auto const raw = pyramid.window(10, 50, 800);
+  EXPECT_EQ(raw.level, 0U);
+  EXPECT_EQ(raw.first_bucket, 10U);
+  EXPECT_EQ(raw.buckets, 50U);
+  EXPECT_EQ(pyramid.window(1 << 20, 10, 800).buckets, 0U);
+}
+
+TEST(TestSeriesPyramid, DirtyRangesCoverOnlyAppends) {
+  auto pyramid = SeriesPyramid(4096);
+  auto const first = noise(1000, 3);
+  pyramid.append(first);
+  pyramid.takeDirty([](uint32_t, uint32_t) {});
+
+  auto const more = noise(10, 4);
+  pyramid.append(more);
+
+  auto nodes = uint32_t{0};
+  auto runs = uint32_t{0};
+  pyramid.takeDirty([&](uint32_t const offset, uint32_t const count) {
+    ++runs;
+    nodes += count;
+    EXPECT_LE(offset + count, pyramid.data().size());
+  });
+  EXPECT_EQ(runs, pyramid.levels());
+  // 10 samples, then the tail bucket or two of each coarser level
+  EXPECT_LE(nodes, 10U + 2 * pyramid.levels());
+
+  auto again = uint32_t{0};
+  pyramid.takeDirty([&](uint32_t, uint32_t) { ++again; });
+  EXPECT_EQ(again, 0U);
+}
+
+TEST(TestSeriesPyramid, StopsAtCapacity) {
+  auto pyramid = SeriesPyramid(100);
+  auto const samples = noise(150, 5);
+  EXPECT_EQ(pyramid.append(samples), 100U);
+  EXPECT_EQ(pyramid.append(samples), 0U);
+  EXPECT_EQ(pyramid.size(), 100U);
+
+  pyramid.clear();
+  EXPECT_EQ(pyramid.append(std::span(samples).first(3)), 3U);
+  EXPECT_EQ(pyramid.level(1)[1].min, samples[2]);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "../src/spatialHash.hpp"
+
+namespace {
+
+struct Cloud {
+  std::vector<float> x, y, z;
+
+  explicit Cloud(size_t const n, float const extent) {
+    auto rng = std::mt19937(7);
+    auto dist = std::uniform_real_distribution<float>(-extent, extent);
+    for (auto i = size_t{0}; i < n; ++i) {
+      x.push_back(dist(rng));
+      y.push_back(dist(rng));
+      z.push_back(dist(rng));
+    }
+  }
+
+  [[nodiscard]] std::vector<uint32_t>
+  bruteForce(std::array<float, 3> const &p, float const radius) const {
+    auto result = std::vector<uint32_t>();
+    for (auto i = 0U; i < x.size(); ++i) {
+      auto const dx = x[i] - p[0];
+      auto const dy = y[i] - p[1];
+      auto const dz = z[i] - p[2];
+      if (dx * dx + dy * dy + dz * dz <= radius * radius)
+        result.push_back(i);
+    }
+    return result;
+  }
+};
+
+void expectMatchesBruteForce(SpatialHash const &hash, Cloud const &cloud,
+                             float const radius) {
+  auto points = std::vector<std::array<float, 3>>();
+  for (auto i = 0U; i < cloud.x.size(); i += 97)
+    points.push_back({cloud.x[i], cloud.y[i], cloud.z[i]});
+  points.push_back({1000.0f, 1000.0f, 1000.0f}); // far away, no hits
+
+  auto hits = SpatialHash::Hits();
+  hash.queryRadius(points, radius, hits);
+  ASSERT_EQ(hits.offsets.size(), points.size() + 1);
+
+  for (auto q = 0U; q < points.size(); ++q) {
+    auto found = std::vector<uint32_t>(hits.of(q).begin(), hits.of(q).end());
+    std::ranges::sort(found);
+    EXPECT_EQ(found, cloud.bruteForce(points[q], radius)) << "query " << q;
+  }
+}
+
+} // namespace
+
+TEST(TestSpatialHash, MatchesBruteForce) {
+  auto const cloud = Cloud(20000, 50.0f);
+  auto hash = SpatialHash();
+  hash.build(cloud.x, cloud.y, cloud.z, 2.0f);
+  EXPECT_EQ(hash.size(), cloud.x.size());
+
+  expectMatchesBruteForce(hash, cloud, 2.0f);
+  expectMatchesBruteForce(hash, cloud, 0.5f);
+  // many more cells than the visited list holds: full scan
+  expectMatchesBruteForce(hash, cloud, 30.0f);
+}
+
+TEST(TestSpatialHash, ParallelBuildMatchesBruteForce) {
+  auto pool = WorkerPool(3);
+  auto const cloud = Cloud(100000, 200.0f);
+  auto hash = SpatialHash(&pool);
+
+  // rebuilding reuses the arrays
+  hash.build(cloud.x, cloud.y, cloud.z, 8.0f);
+  hash.build(cloud.x, cloud.y, cloud.z, 4.0f);
+  expectMatchesBruteForce(hash, cloud, 4.0f);
+}
+
+TEST(TestSpatialHash, EmptyAndSinglePoint) {
+  auto hash = SpatialHash();
+  hash.build({}, {}, {}, 1.0f);
+
+  auto hits = SpatialHash::Hits();
+  auto const origin = std::array<std::array<float, 3>, 1>{{{0.0f, 0.0f, 0.0f}}};
+  hash.queryRadius(origin, 10.0f, hits);
+  EXPECT_TRUE(hits.of(0).empty());
+
+  auto const x = std::array{-0.5f};
+  auto const y = std::array{0.25f};
+  auto const z = std::array{-3.0f};
+  hash.build(x, y, z, 1.0f);
+  hash.queryRadius(origin, 3.1f, hits);
+  ASSERT_EQ(hits.of(0).size(), 1U);
+  EXPECT_EQ(hits.of(0)[0], 0U);
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "../src/statsPage.hpp"
+
+#include <thread>
+
+#include <sys/wait.h>
+
+namespace {
+
+std::string pageName() { return std::format("/hotair-test-stats-{}", getpid()); }
+
+/* a page as left by the writer owner, without its sample */
+void writePageHeader(pid_t const owner) {
+  auto const fd =
+      shm_open(pageName().c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  ASSERT_NE(fd, -1);
+  auto const header = std::array<uint32_t, 4>{
+      statsPageMagic, statsPageVersion, static_cast<uint32_t>(statsSampleWords),
+      static_cast<uint32_t>(owner)};
+  EXPECT_EQ(ftruncate(fd, sizeof(StatsPageLayout)), 0);
+  EXPECT_EQ(pwrite(fd, header.data(), sizeof(header), 0),
+            static_cast<ssize_t>(sizeof(header)));
+  close(fd);
+}
+
+} // namespace
+
+TEST(TestStatsPage, PublishedSampleIsRead) {
+  auto page = StatsPage(pageName());
+  auto const reader = StatsPageReader(pageName());
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(reader.pid(), static_cast<uint32_t>(getpid()));
+  EXPECT_EQ(reader.read()->frames, 0u);
+
+  page.publish({.frames = 42, .fps = 143.5, .frame_ms_p99 = 9.25,
+                .feed_clients = 3, .rss_bytes = uint64_t{1} << 30,
+                .quality_changes = 1,
+                .quality_recent = {StatsQualityDecision{
+                    .frame = 7, .knob = 1, .from = 1,
+                    .flags = statsQualityGpuBound}}});
+  auto const sample = reader.read();
+  ASSERT_TRUE(sample);
+  EXPECT_EQ(sample->frames, 42u);
+  EXPECT_EQ(sample->fps, 143.5);
+  EXPECT_EQ(sample->frame_ms_p99, 9.25);
+  EXPECT_EQ(sample->feed_clients, 3u);
+  EXPECT_EQ(sample->rss_bytes, uint64_t{1} << 30);
+  EXPECT_EQ(sample->quality_recent[0].frame, 7u);
+  EXPECT_EQ(sample->quality_recent[0].from, 1u);
+  EXPECT_EQ(sample->quality_recent[0].flags, statsQualityGpuBound);
+}
+
+TEST(TestStatsPage, GoneWithWriter) {
+  {
+    auto page = StatsPage(pageName());
+  }
+  EXPECT_THROW(StatsPageReader{pageName()}, std::runtime_error);
+}
+
+TEST(TestStatsPage, RefusesPageOfRunningWriter) {
+  // our parent stands in for another running HotAir
+  writePageHeader(getppid());
+  EXPECT_THROW(StatsPage{pageName()}, std::runtime_error);
+  {
+    auto const reader = StatsPageReader(pageName());
+    EXPECT_TRUE(reader.valid());
+    EXPECT_EQ(reader.pid(), static_cast<uint32_t>(getppid()));
+  }
+  shm_unlink(pageName().c_str());
+}
+
+TEST(TestStatsPage, TakesOverPageOfExitedWriter) {
+  auto const child = fork();
+  ASSERT_NE(child, -1);
+  if (child == 0)
+    _exit(0);
+  ASSERT_EQ(waitpid(child, nullptr, 0), child);
+
+  writePageHeader(child);
+  auto page = StatsPage(pageName());
+  EXPECT_EQ(StatsPageReader(pageName()).pid(),
+            static_cast<uint32_t>(getpid()));
+}
+
+TEST(TestStatsPage, ReadsAreNeverTorn) {
+  auto page = StatsPage(pageName());
+  auto const reader = StatsPageReader(pageName());
+
+  auto done = std::atomic<bool>(false);
+  auto writer = std::jthread([&] {
+    for (auto i = uint64_t{1}; i <= 200000; ++i) {
+      page.publish({.published_ns = i, .frames = i, .late_frames = i,
+                    .feed_updates = i, .peak_rss_bytes = i});
+    }
+    done = true;
+  });
+
+  // every field of a sample must come from the same publish
+  auto consistent = 0;
+  auto last = uint64_t{0};
+  while (!done) {
+    auto const sample = reader.read();
+    if (!sample)
+      continue;
+    ASSERT_EQ(sample->frames, sample->published_ns);
+    ASSERT_EQ(sample->late_frames, sample->published_ns);
+    ASSERT_EQ(sample->feed_updates, sample->published_ns);
+    ASSERT_EQ(sample->peak_rss_bytes, sample->published_ns);
+    ASSERT_GE(sample->frames, last);
+    last = sample->frames;
+    ++consistent;
+  }
+  writer.join();
+  EXPECT_GT(consistent, 0);
+  EXPECT_EQ(reader.read()->frames, 200000u);
+}
+
+TEST(TestFrameTimeWindow, PercentilesOverLastFrames) {
+  auto window = FrameTimeWindow(100);
+  EXPECT_EQ(window.percentiles().max, 0.0);
+
+  for (auto i = 1; i <= 100; ++i)
+    window.add(static_cast<float>(i));
+  auto const full = window.percentiles();
+  EXPECT_EQ(full.p50, 50.0);
+  EXPECT_EQ(full.p90, 90.0);
+  EXPECT_EQ(full.p99, 99.0);
+  EXPECT_EQ(full.max, 100.0);
+
+  // the oldest frames age out
+  for (auto i = 0; i < 100; ++i)
+    window.add(1.0f);
+  EXPECT_EQ(window.size(), 100u);
+  EXPECT_EQ(window.percentiles().max, 1.0);
+}
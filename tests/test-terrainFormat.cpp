@@ -0,0 +1,139 @@
+#include <format>
+#include <gtest/gtest.h>
+
+#include "../src/terrainFormat.hpp"
+
+namespace {
+
+std::filesystem::path tempPath() {
+  return std::filesystem::temp_directory_path() /
+         std::format("terrain-file-{}",
+                     std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+/* every covered sample of the region at next, counted once */
+void expectCovers(std::vector<ClipRect> const &rects,
+                  std::array<int64_t, 2> const &previous,
+                  std::array<int64_t, 2> const &next) {
+  auto covered = std::vector<int>(clipmapSize * clipmapSize, 0);
+  for (auto const &rect : rects) {
+    for (auto y = rect.y; y < rect.y + rect.height; ++y) {
+      for (auto x = rect.x; x < rect.x + rect.width; ++x) {
+        ASSERT_GE(x, next[0]);
+        ASSERT_LT(x, next[0] + clipmapSize);
+        ASSERT_GE(y, next[1]);
+        ASSERT_LT(y, next[1] + clipmapSize);
+        ++covered[(y - next[1]) * clipmapSize + (x - next[0])];
+      }
+    }
+  }
+  for (auto y = next[1]; y < next[1] + clipmapSize; ++y) {
+    for (auto x = next[0]; x < next[0] + clipmapSize; ++x) {
+      auto const resident = x >= previous[0] &&
+                            x < previous[0] + clipmapSize &&
+                            y >= previous[1] && y < previous[1] + clipmapSize;
+      EXPECT_EQ(covered[(y - next[1]) * clipmapSize + (x - next[0])],
+                resident ? 0 : 1);
+    }
+  }
+}
+
+} // namespace
+
+TEST(TestTerrainFormat, OriginSnapsAndCentres) {
+  auto const origin = clipmapOrigin(1000.5, -70.25);
+  EXPECT_EQ(origin[0] % clipmapSnap, 0);
+  EXPECT_EQ(origin[1] % clipmapSnap, 0);
+  EXPECT_GE(1000.5 - static_cast<double>(origin[0]), clipmapSize / 2);
+  EXPECT_LT(1000.5 - static_cast<double>(origin[0]),
+            clipmapSize / 2 + clipmapSnap);
+  EXPECT_GE(-70.25 - static_cast<double>(origin[1]), clipmapSize / 2);
+}
+
+TEST(TestTerrainFormat, DeltaCoversExactlyTheNewSamples) {
+  EXPECT_EQ(clipmapDelta(std::nullopt, {0, 0}).size(), 1U);
+  EXPECT_TRUE(clipmapDelta(std::array<int64_t, 2>{64, 64}, {64, 64}).empty());
+
+  for (auto const &[dx, dy] : std::vector<std::pair<int64_t, int64_t>>{
+           {32, 0}, {-32, 0}, {0, 64}, {0, -32}, {32, -64}, {-96, 32}}) {
+    auto const previous = std::array<int64_t, 2>{-128, 256};
+    auto const next = std::array<int64_t, 2>{-128 + dx, 256 + dy};
+    expectCovers(clipmapDelta(previous, next), previous, next);
+  }
+
+  auto const far = clipmapDelta(std::array<int64_t, 2>{0, 0}, {4096, 0});
+  ASSERT_EQ(far.size(), 1U);
+  EXPECT_EQ(far[0], (ClipRect{4096, 0, clipmapSize, clipmapSize}));
+}
+
+TEST(TestTerrainFormat, WrapSplitsAtTextureEdges) {
+  auto const pieces = clipmapWrap({-32, 240, 64, 32});
+  ASSERT_EQ(pieces.size(), 4U);
+  auto area = 0U;
+  for (auto const &piece : pieces) {
+    auto const tx = ((piece.x % clipmapSize) + clipmapSize) % clipmapSize;
+    auto const ty = ((piece.y % clipmapSize) + clipmapSize) % clipmapSize;
+    EXPECT_LE(tx + piece.width, static_cast<int64_t>(clipmapSize));
+    EXPECT_LE(ty + piece.height, static_cast<int64_t>(clipmapSize));
+    area += piece.width * piece.height;
+  }
+  EXPECT_EQ(area, 64U * 32U);
+
+  EXPECT_EQ(clipmapWrap({0, 0, clipmapSize, clipmapSize}).size(), 1U);
+}
+
+TEST(TestTerrainFormat, DownsampleKeepsAlignment) {
+  // a single spike at an even sample stays centred on its coarse sample
+  auto fine = std::vector<uint16_t>(8 * 8, 0);
+  fine[4 * 8 + 4] = 1600;
+  auto const coarse = downsampleHeights(fine, 8, 8);
+  ASSERT_EQ(coarse.size(), 16U);
+  EXPECT_EQ(coarse[2 * 4 + 2], 400);
+  EXPECT_EQ(coarse[2 * 4 + 1], 0);
+  EXPECT_EQ(coarse[1 * 4 + 2], 0);
+}
+
+TEST(TestTerrainFormat, TilesRoundTrip) {
+  auto const path = tempPath();
+
+  auto header = TerrainFileHeader();
+  header.tile_size = 4;
+  header.width = 10;
+  header.height = 7;
+  auto samples = std::vector<uint16_t>(10 * 7);
+  for (auto i = 0U; i < samples.size(); ++i)
+    samples[i] = static_cast<uint16_t>(i * 100);
+  writeTerrainFile(path, header, samples);
+
+  auto tiles = TerrainTiles{path};
+  EXPECT_EQ(tiles.header.level_count, 3U); // 10x7, 5x3, 2x1
+
+  // spans tile boundaries and the terrain border (clamped)
+  auto out = std::vector<uint16_t>(6 * 3);
+  tiles.readRect(0, 7, 5, 6, 3, out);
+  for (auto row = 0U; row < 3; ++row) {
+    for (auto col = 0U; col < 6; ++col) {
+      auto const sx = std::min(7U + col, 9U);
+      auto const sy = std::min(5U + row, 6U);
+      EXPECT_EQ(out[row * 6 + col], samples[sy * 10 + sx]);
+    }
+  }
+
+  auto before = std::vector<uint16_t>(2);
+  tiles.readRect(0, -3, -1, 2, 1, before);
+  EXPECT_EQ(before[0], samples[0]);
+  EXPECT_EQ(before[1], samples[0]);
+
+  std::filesystem::remove(path);
+}
+
+TEST(TestTerrainFormat, RejectsForeignFile) {
+  auto const path = tempPath();
+  {
+    std::ofstream{path} << std::string(sizeof(TerrainFileHeader), 'x');
+  }
+
+  EXPECT_THROW(TerrainTiles{path}, std::runtime_error);
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "../src/uiBatch.hpp"
+
+namespace {
+
+struct Panel {
+  float value = 0.5f;
+  bool clicked = false;
+
+  void frame(Ui &ui, UiInput const &input) {
+    ui.begin(input);
+    ui.beginPanel("Balloons", {10.0f, 10.0f, 300.0f, 400.0f});
+    ui.label("altitude 120 m");
+    clicked = ui.button("Burner");
+    ui.slider("Wind", value, 0.0f, 10.0f);
+    ui.endPanel();
+    ui.end();
+  }
+};
+
+} // namespace
+
+TEST(TestUiBatch, FontAtlas) {
+  auto const atlas = UiFont::atlas();
+  ASSERT_EQ(atlas.size(), UiFont::atlasWidth * UiFont::atlasHeight);
+  // '!' is a vertical bar in column 2 with a gap above the dot
+  auto const bang = 1U;
+  auto const at = [&](uint32_t cell, uint32_t x, uint32_t y) {
+    return atlas[(cell / UiFont::columns * UiFont::cellHeight + y) *
+                     UiFont::atlasWidth +
+                 cell % UiFont::columns * UiFont::cellWidth + x];
+  };
+  EXPECT_EQ(at(bang, 2, 0), 0xff);
+  EXPECT_EQ(at(bang, 2, 5), 0x00);
+  EXPECT_EQ(at(bang, 2, 6), 0xff);
+  EXPECT_EQ(at(bang, 0, 0), 0x00);
+  EXPECT_EQ(at(UiFont::solidCell, 5, 7), 0xff);
+}
+
+TEST(TestUiBatch, ReusesGeometryWhenNothingChanges) {
+  auto ui = Ui();
+  auto panel = Panel();
+  auto input = UiInput{.screen = {800.0f, 600.0f}, .mouse = {700.0f, 500.0f}};
+
+  panel.frame(ui, input);
+  EXPECT_TRUE(ui.geometryChanged());
+  EXPECT_FALSE(ui.vertices().empty());
+  EXPECT_EQ(ui.indices().size() / 6, ui.vertices().size() / 4);
+  ASSERT_EQ(ui.draws().size(), 1U); // everything under the panel clip
+  EXPECT_EQ(ui.draws()[0].index_count, ui.indices().size());
+  EXPECT_EQ(ui.draws()[0].clip.width, 300.0f);
+
+  // the mouse moving over empty screen changes nothing drawn
+  input.mouse = {750.0f, 550.0f};
+  panel.frame(ui, input);
+  EXPECT_FALSE(ui.geometryChanged());
+  EXPECT_FALSE(ui.wantsMouse());
+}
+
+TEST(TestUiBatch, ButtonsAndSliders) {
+  auto ui = Ui();
+  auto panel = Panel();
+  auto input = UiInput{.screen = {800.0f, 600.0f}};
+  panel.frame(ui, input);
+
+  // rows below the title: label, button, slider
+  auto const line = UiFont::cellHeight * ui.style.scale;
+  auto const title = line + 2 * ui.style.padding + ui.style.spacing;
+  auto const row = line + 2 * ui.style.padding + ui.style.spacing;
+  auto const button_y = 10.0f + title + line + ui.style.spacing + 1.0f;
+  auto const slider_y = button_y + row;
+
+  input.mouse = {100.0f, button_y};
+  panel.frame(ui, input);
+  EXPECT_TRUE(ui.geometryChanged()); // hover highlight
+  EXPECT_TRUE(ui.wantsMouse());
+  EXPECT_FALSE(panel.clicked);
+
+  input.mouse_down = true;
+  panel.frame(ui, input);
+  EXPECT_TRUE(panel.clicked);
+  panel.frame(ui, input);
+  EXPECT_FALSE(panel.clicked); // held, not clicked again
+
+  input.mouse_down = false;
+  panel.frame(ui, input);
+  input = {.screen = {800.0f, 600.0f},
+           .mouse = {16.0f + 288.0f * 0.25f, slider_y},
+           .mouse_down = true};
+  panel.frame(ui, input);
+  EXPECT_NEAR(panel.value, 2.5f, 1e-3f);
+
+  // dragging keeps the slider even outside its row
+  input.mouse = {1000.0f, 0.0f};
+  panel.frame(ui, input);
+  EXPECT_FLOAT_EQ(panel.value, 10.0f);
+}
+
+TEST(TestUiBatch, OverflowDropsInsteadOfGrowing) {
+  auto ui = Ui();
+  ui.begin({.screen = {800.0f, 600.0f}});
+  auto const long_text = std::string(200, 'x');
+  for (auto i = 0; i < 400; ++i)
+    ui.label(long_text);
+  ui.end();
+
+  EXPECT_TRUE(ui.overflowed());
+  EXPECT_LE(ui.vertices().size(), Ui::maxVertices);
+}
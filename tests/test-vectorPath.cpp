@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "../src/vectorPath.hpp"
+
+#include <numbers>
+
+namespace {
+
+/* total area of the mesh's triangles, overlaps counted twice */
+float area(VectorMesh const &mesh) {
+  auto total = 0.0f;
+  for (auto i = size_t{0}; i + 2 < mesh.indices.size(); i += 3) {
+    auto const &a = mesh.vertices[mesh.indices[i]];
+    auto const &b = mesh.vertices[mesh.indices[i + 1]];
+    auto const &c = mesh.vertices[mesh.indices[i + 2]];
+    total += 0.5f * std::abs((b[0] - a[0]) * (c[1] - a[1]) -
+                             (c[0] - a[0]) * (b[1] - a[1]));
+  }
+  return total;
+}
+
+} // namespace
+
+TEST(TestVectorPath, FillsRectangle) {
+  auto mesh = VectorMesh();
+  VectorPath().rect(10.0f, 20.0f, 30.0f, 40.0f).fill(mesh);
+
+  EXPECT_NEAR(area(mesh), 1200.0f, 1e-3f);
+  for (auto const &v : mesh.vertices) {
+    EXPECT_GE(v[0], 10.0f);
+    EXPECT_LE(v[0], 40.0f);
+    EXPECT_GE(v[1], 20.0f);
+    EXPECT_LE(v[1], 60.0f);
+  }
+}
+
+TEST(TestVectorPath, FillRules) {
+  // inner square wound the same way as the outer one
+  auto path = VectorPath();
+  path.rect(0.0f, 0.0f, 10.0f, 10.0f).rect(3.0f, 3.0f, 4.0f, 4.0f);
+
+  auto non_zero = VectorMesh();
+  path.fill(non_zero, VectorPath::FillRule::NonZero);
+  EXPECT_NEAR(area(non_zero), 100.0f, 1e-3f);
+
+  auto even_odd = VectorMesh();
+  path.fill(even_odd, VectorPath::FillRule::EvenOdd);
+  EXPECT_NEAR(area(even_odd), 84.0f, 1e-3f);
+
+  // a bow tie crosses itself: two triangles of 25 each
+  auto bow_tie = VectorMesh();
+  VectorPath()
+      .moveTo(0.0f, 0.0f)
+      .lineTo(10.0f, 10.0f)
+      .lineTo(10.0f, 0.0f)
+      .lineTo(0.0f, 10.0f)
+      .close()
+      .fill(bow_tie);
+  EXPECT_NEAR(area(bow_tie), 50.0f, 0.05f);
+}
+
+TEST(TestVectorPath, FlattensCurvesWithinTolerance) {
+  auto const r = 100.0f;
+  auto const tolerance = 0.1f;
+  auto const polyline = VectorPath().circle(0.0f, 0.0f, r).flatten(tolerance);
+
+  ASSERT_EQ(polyline.contours.size(), 1U);
+  EXPECT_TRUE(polyline.contours[0].closed);
+  for (auto const &p : polyline.points)
+    EXPECT_NEAR(std::hypot(p[0], p[1]), r, 0.05f);
+
+  auto mesh = VectorMesh();
+  VectorPath::fillPolyline(polyline, mesh, VectorPath::FillRule::NonZero);
+  auto const expected = std::numbers::pi_v<float> * r * r;
+  EXPECT_NEAR(area(mesh), expected, expected * 0.002f);
+}
+
+TEST(TestVectorPath, StrokesLinesAndJoins) {
+  auto line = VectorMesh();
+  VectorPath().moveTo(0.0f, 0.0f).lineTo(100.0f, 0.0f).stroke(line, {4.0f});
+  EXPECT_NEAR(area(line), 400.0f, 1e-3f);
+
+  auto square = VectorMesh();
+  VectorPath()
+      .moveTo(0.0f, 0.0f)
+      .lineTo(100.0f, 0.0f)
+      .stroke(square, {4.0f, VectorPath::Cap::Square});
+  EXPECT_NEAR(area(square), 416.0f, 1e-3f);
+
+  // a right angle gets a bevel (2) plus a miter (2) to fill the corner
+  auto corner = VectorMesh();
+  VectorPath()
+      .moveTo(0.0f, 0.0f)
+      .lineTo(10.0f, 0.0f)
+      .lineTo(10.0f, 10.0f)
+      .stroke(corner, {4.0f});
+  EXPECT_NEAR(area(corner), 80.0f + 4.0f, 1e-3f);
+
+  // past the miter limit only the bevel remains
+  auto beveled = VectorMesh();
+  VectorPath()
+      .moveTo(0.0f, 0.0f)
+      .lineTo(10.0f, 0.0f)
+      .lineTo(10.0f, 10.0f)
+      .stroke(beveled, {4.0f, VectorPath::Cap::Butt, 1.0f});
+  EXPECT_NEAR(area(beveled), 80.0f + 2.0f, 1e-3f);
+}
+
+TEST(TestVectorPath, AffineComposes) {
+  auto const t = Affine2::translation(5.0f, 0.0f) *
+                 Affine2::rotationScale(std::numbers::pi_v<float> / 2, 2.0f);
+  auto const p = t.apply({1.0f, 0.0f});
+  EXPECT_NEAR(p[0], 5.0f, 1e-5f);
+  EXPECT_NEAR(p[1], 2.0f, 1e-5f);
+}
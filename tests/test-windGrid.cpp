@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/balloonSim.hpp"
+#include "../src/windGrid.hpp"
+
+TEST(TestWindGrid, HalfToFloat) {
+  EXPECT_EQ(halfToFloat(0x0000), 0.0f);
+  EXPECT_TRUE(std::signbit(halfToFloat(0x8000)));
+  EXPECT_EQ(halfToFloat(0x3c00), 1.0f);
+  EXPECT_EQ(halfToFloat(0xc000), -2.0f);
+  EXPECT_EQ(halfToFloat(0x7bff), 65504.0f);
+  EXPECT_EQ(halfToFloat(0x0001), std::ldexp(1.0f, -24));
+  EXPECT_EQ(halfToFloat(0x03ff), std::ldexp(1023.0f, -24));
+  EXPECT_TRUE(std::isinf(halfToFloat(0x7c00)));
+  EXPECT_TRUE(std::isnan(halfToFloat(0x7e00)));
+}
+
+TEST(TestWindGrid, SamplesTrilinearlyAndClamps) {
+  // 2x2x2 cells of 10 m, x component = cell x index, z component = cell z
+  auto texels = std::vector<uint16_t>();
+  for (auto z = 0; z < 2; ++z)
+    for (auto y = 0; y < 2; ++y)
+      for (auto x = 0; x < 2; ++x)
+        for (auto const c : {float(x), 0.0f, float(z), 0.0f})
+          texels.push_back(floatToHalf(c));
+
+  auto const grid = WindGrid{.extent = {2, 2, 2},
+                             .origin = {-10.0f, 0.0f, -10.0f},
+                             .cell_size = 10.0f,
+                             .texels = texels};
+
+  auto const centre = grid.sample({0.0f, 10.0f, 0.0f});
+  EXPECT_FLOAT_EQ(centre[0], 0.5f);
+  EXPECT_FLOAT_EQ(centre[1], 0.0f);
+  EXPECT_FLOAT_EQ(centre[2], 0.5f);
+
+  EXPECT_FLOAT_EQ(grid.sample({-2.5f, 5.0f, 2.5f})[0], 0.25f);
+  EXPECT_FLOAT_EQ(grid.sample({-2.5f, 5.0f, 2.5f})[2], 0.75f);
+
+  // outside: border cells
+  EXPECT_FLOAT_EQ(grid.sample({1000.0f, -50.0f, -1000.0f})[0], 1.0f);
+  EXPECT_FLOAT_EQ(grid.sample({1000.0f, -50.0f, -1000.0f})[2], 0.0f);
+
+  EXPECT_EQ(WindGrid{}.sample({0.0f, 0.0f, 0.0f})[0], 0.0f);
+}
+
+TEST(TestWindGrid, BalloonsDriftWithSampledWind) {
+  struct Uniform {
+    std::array<float, 3> wind;
+    std::array<float, 3> sample(std::array<float, 3> const &) const {
+      return wind;
+    }
+  };
+
+  auto sim = BalloonSim(2);
+  sim.add({.position = {0.0f, 300.0f, 0.0f}, .temperature = 360.0f});
+  sim.add({.position = {0.0f, 300.0f, 0.0f}, .temperature = 360.0f});
+  sim.sampleWind(Uniform{{0.0f, 0.0f, -6.0f}});
+  sim.remove(0);
+
+  for (auto i = 0; i < 120 * 60; ++i)
+    sim.advance();
+
+  EXPECT_NEAR(sim.get(0).velocity[2], -6.0f, 0.1f);
+  EXPECT_LT(sim.positionZ()[0], -100.0f);
+}
@@ -0,0 +1,221 @@
+
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <format>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <getopt.h>
+
+#include <nlohmann/json.hpp>
+
+#include "../src/statsPage.hpp"
+
+/**
+ * Live view of a running HotAir's stats page (StatsPage). Only reads the
+ * shared page, so watching costs the renderer nothing; --json prints one
+ * sample per line for monitoring agents that would rather not follow the
+ * page layout themselves.
+ */
+
+namespace {
+
+std::string bytes(uint64_t const count) {
+  if (count >= uint64_t{1} << 30)
+    return std::format("{:.2f} GiB", static_cast<double>(count) / (1 << 30));
+  return std::format("{:.1f} MiB", static_cast<double>(count) / (1 << 20));
+}
+
+std::string knobName(uint8_t const knob) {
+  return knob < statsQualityKnobs.size() ? statsQualityKnobs[knob]
+                                         : std::format("knob {}", knob);
+}
+
+/**
+ * The governed knob levels and its last changes, most recent first; empty
+ * without a quality governor
+ */
+std::string quality(StatsSample const &s) {
+  if (!s.quality_governed)
+    return {};
+  auto text = std::format("\nquality  msaa {}   post chain {}   changes {}\n",
+                          s.quality_msaa, s.quality_post_chain,
+                          s.quality_changes);
+  auto const recent = std::min<uint64_t>(s.quality_changes, statsQualityRecent);
+  for (auto i = size_t{0}; i < recent; ++i) {
+    auto const &d = s.quality_recent[i];
+    text += std::format(
+        "  frame {:>10}   {} {} -> {}   {}\n", d.frame, knobName(d.knob),
+        d.from, d.to,
+        d.flags & statsQualityManual
+            ? std::string("set")
+            : std::format("p90 {:.2f} ms, {} bound", d.frame_ms,
+                          d.flags & statsQualityGpuBound ? "GPU" : "CPU"));
+  }
+  return text;
+}
+
+std::string table(StatsSample const &s, uint32_t const pid, double const age) {
+  return std::format(
+             "hotair pid {}{}\n\n"
+             "frames   {:>10}   fps {:>7.1f}   cap {}\n"
+             "frame ms p50 {:>7.2f}   p90 {:>7.2f}   p99 {:>7.2f}   max "
+             "{:>7.2f}\n"
+             "late     {:>10}\n\n",
+             pid, age > 2.0 ? std::format("  (stale {:.0f}s)", age) : "",
+             s.frames, s.fps,
+             s.frame_cap > 0.0 ? std::format("{:.0f}", s.frame_cap) : "off",
+             s.frame_ms_p50, s.frame_ms_p90, s.frame_ms_p99, s.frame_ms_max,
+             s.late_frames) +
+         std::format("queues   control {:>4}   feed batch {:>6}\n"
+                     "feed     clients {:>4}   updates {:>10}   {}   rejected "
+                     "{}\n\n"
+                     "memory   rss {}   peak {}\n",
+                     s.control_queued, s.feed_batch, s.feed_clients,
+                     s.feed_updates, bytes(s.feed_bytes), s.feed_rejected,
+                     bytes(s.rss_bytes), bytes(s.peak_rss_bytes)) +
+         quality(s);
+}
+
+nlohmann::json json(StatsSample const &s, uint32_t const pid,
+                    double const age) {
+  auto out = nlohmann::json{{"pid", pid},
+                          {"age_s", age},
+                          {"frames", s.frames},
+                          {"fps", s.fps},
+                          {"frame_ms",
+                           {{"p50", s.frame_ms_p50},
+                            {"p90", s.frame_ms_p90},
+                            {"p99", s.frame_ms_p99},
+                            {"max", s.frame_ms_max}}},
+                          {"frame_cap", s.frame_cap},
+                          {"late_frames", s.late_frames},
+                          {"control_queued", s.control_queued},
+                          {"feed",
+                           {{"batch", s.feed_batch},
+                            {"clients", s.feed_clients},
+                            {"updates", s.feed_updates},
+                            {"bytes", s.feed_bytes},
+                            {"rejected", s.feed_rejected}}},
+                          {"rss_bytes", s.rss_bytes},
+                          {"peak_rss_bytes", s.peak_rss_bytes}};
+  if (s.quality_governed) {
+    auto decisions = nlohmann::json::array();
+    auto const recent =
+        std::min<uint64_t>(s.quality_changes, statsQualityRecent);
+    for (auto i = size_t{0}; i < recent; ++i) {
+      auto const &d = s.quality_recent[i];
+      decisions.push_back({{"frame", d.frame},
+                           {"knob", knobName(d.knob)},
+                           {"from", d.from},
+                           {"to", d.to},
+                           {"frame_ms", d.frame_ms},
+                           {"gpu_bound", (d.flags & statsQualityGpuBound) != 0},
+                           {"manual", (d.flags & statsQualityManual) != 0}});
+    }
+    out["quality"] = {{"msaa", s.quality_msaa},
+                      {"post_chain", s.quality_post_chain},
+                      {"changes", s.quality_changes},
+                      {"recent", decisions}};
+  }
+  return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  static auto const long_opts =
+      std::array{option{"interval", required_argument, nullptr, 'i'},
+                 option{"count", required_argument, nullptr, 'n'},
+                 option{"json", no_argument, nullptr, 'j'},
+                 option{"help", no_argument, nullptr, 'h'},
+                 option{nullptr, 0, nullptr, 0}};
+
+  static auto const help = std::format(
+      "Usage: {} [-jh] [-i <ms>] [-n <count>] <page>\n"
+      "Options:\n"
+      "  -i, --interval <ms>  refresh interval (default 1000)\n"
+      "  -n, --count <n>      exit after n samples (default: run until "
+      "interrupted)\n"
+      "  -j, --json           one JSON object per sample instead of a table\n"
+      "  -h, --help           display this help and exit\n"
+      "page is the shm name set as /stats/page, e.g. /hotair-stats\n",
+      argv[0]);
+
+  auto interval = std::chrono::milliseconds(1000);
+  auto count = 0UL;
+  auto as_json = false;
+
+  try {
+    for (int opt; (opt = getopt_long(argc, argv, "i:n:jh", long_opts.data(),
+                                     nullptr)) != -1;) {
+      switch (opt) {
+      case 'i':
+        interval = std::chrono::milliseconds(std::stoul(optarg));
+        break;
+      case 'n':
+        count = std::stoul(optarg);
+        break;
+      case 'j':
+        as_json = true;
+        break;
+      case 'h':
+        std::cout << help;
+        return EXIT_SUCCESS;
+      default:
+        std::cerr << help;
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (std::logic_error const &) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  if (argc - optind != 1 || interval.count() == 0) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  auto const name = std::string(argv[optind]);
+
+  try {
+    auto const reader = StatsPageReader(name);
+    for (auto shown = 0UL; count == 0 || shown < count; ++shown) {
+      if (shown > 0)
+        std::this_thread::sleep_for(interval);
+
+      if (!reader.valid() || kill(static_cast<pid_t>(reader.pid()), 0) != 0) {
+        std::cerr << std::format("{}: no running writer\n", name);
+        return EXIT_FAILURE;
+      }
+      auto const sample = reader.read();
+      if (!sample)
+        continue; // writer busy every attempt; try next interval
+
+      auto const now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+      auto const age =
+          static_cast<double>(static_cast<uint64_t>(now) -
+                              sample->published_ns) *
+          1e-9;
+
+      if (as_json)
+        std::cout << json(*sample, reader.pid(), age).dump() << std::endl;
+      else
+        std::cout << "\x1b[H\x1b[2J" << table(*sample, reader.pid(), age)
+                  << std::flush;
+    }
+  } catch (std::exception const &e) {
+    std::cerr << std::format("{}: {}\n", name, e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,452 @@
+
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <nlohmann/json.hpp>
+
+#include "../args.hpp"
+#include "../src/meshFormat.hpp"
+
+/**
+ * Offline glTF 2.0 (.gltf / .glb) to HotAir mesh file converter.
+ *
+ * Every triangle primitive reachable from the default scene is baked into
+ * one mesh with its node's world transform applied, then simplified into
+ * a LOD chain, quantized, cache/fetch optimized and split into meshlets
+ * (see meshFormat.hpp).
+ */
+
+namespace {
+
+using Mat4 = std::array<float, 16>; // column major, as in glTF
+
+Mat4 identity() {
+  return {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+}
+
+Mat4 multiply(Mat4 const &a, Mat4 const &b) {
+  auto r = Mat4{};
+  for (auto c = 0U; c < 4; ++c)
+    for (auto row = 0U; row < 4; ++row)
+      for (auto k = 0U; k < 4; ++k)
+        r[c * 4 + row] += a[k * 4 + row] * b[c * 4 + k];
+  return r;
+}
+
+Mat4 nodeMatrix(nlohmann::json const &node) {
+  if (node.contains("matrix"))
+    return node["matrix"].get<Mat4>();
+
+  auto const t = node.value("translation", std::array<float, 3>{0, 0, 0});
+  auto const q = node.value("rotation", std::array<float, 4>{0, 0, 0, 1});
+  auto const s = node.value("scale", std::array<float, 3>{1, 1, 1});
+
+  auto const [x, y, z, w] = q;
+  // T * R * S
+  return {(1 - 2 * (y * y + z * z)) * s[0],
+          (2 * (x * y + z * w)) * s[0],
+          (2 * (x * z - y * w)) * s[0],
+          0,
+          (2 * (x * y - z * w)) * s[1],
+          (1 - 2 * (x * x + z * z)) * s[1],
+          (2 * (y * z + x * w)) * s[1],
+          0,
+          (2 * (x * z + y * w)) * s[2],
+          (2 * (y * z - x * w)) * s[2],
+          (1 - 2 * (x * x + y * y)) * s[2],
+          0,
+          t[0],
+          t[1],
+          t[2],
+          1};
+}
+
+std::vector<std::byte> decodeBase64(std::string_view text) {
+  static constexpr std::string_view alphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  auto out = std::vector<std::byte>();
+  out.reserve(text.size() * 3 / 4);
+  auto bits = 0U;
+  auto bit_count = 0;
+  for (auto const c : text) {
+    if (c == '=')
+      break;
+    auto const value = alphabet.find(c);
+    if (value == std::string_view::npos)
+      continue;
+    bits = (bits << 6U) | static_cast<uint32_t>(value);
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      out.push_back(static_cast<std::byte>((bits >> bit_count) & 0xffU));
+    }
+  }
+  return out;
+}
+
+std::vector<std::byte> readFile(std::filesystem::path const &path) {
+  auto in = std::ifstream(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error(
+        std::format("{}:{}: cannot open {}", __FILE__, __LINE__, path.string()));
+  auto data = std::vector<std::byte>(std::filesystem::file_size(path));
+  in.read(reinterpret_cast<char *>(data.data()),
+          static_cast<std::streamsize>(data.size()));
+  return data;
+}
+
+struct Gltf {
+  nlohmann::json doc;
+  std::vector<std::vector<std::byte>> buffers;
+
+  explicit Gltf(std::filesystem::path const &path) {
+    auto const file = readFile(path);
+
+    auto glb_chunk = std::vector<std::byte>();
+    if (file.size() >= 20 && std::memcmp(file.data(), "glTF", 4) == 0) {
+      // 12 byte header, then JSON chunk, then optional BIN chunk
+      auto read_u32 = [&file](size_t const offset) {
+        auto value = uint32_t{};
+        std::memcpy(&value, file.data() + offset, sizeof(value));
+        return value;
+      };
+      auto const json_length = read_u32(12);
+      auto const *json_begin =
+          reinterpret_cast<char const *>(file.data() + 20);
+      doc = nlohmann::json::parse(json_begin, json_begin + json_length);
+
+      auto const bin_offset = size_t{20} + json_length;
+      if (bin_offset + 8 <= file.size()) {
+        auto const bin_length = read_u32(bin_offset);
+        auto const *bin_begin = file.data() + bin_offset + 8;
+        glb_chunk.assign(bin_begin, bin_begin + bin_length);
+      }
+    } else {
+      auto const *begin = reinterpret_cast<char const *>(file.data());
+      doc = nlohmann::json::parse(begin, begin + file.size());
+    }
+
+    for (auto const &buffer : doc.value("buffers", nlohmann::json::array())) {
+      if (!buffer.contains("uri")) {
+        buffers.push_back(std::move(glb_chunk));
+        continue;
+      }
+      auto const uri = buffer["uri"].get<std::string>();
+      if (uri.starts_with("data:")) {
+        buffers.push_back(decodeBase64(uri.substr(uri.find(',') + 1)));
+      } else {
+        buffers.push_back(readFile(path.parent_path() / uri));
+      }
+    }
+  }
+
+  /**
+   * Read an accessor as floats, components per element given by its type
+   */
+  [[nodiscard]] std::vector<float> readFloats(uint32_t const accessor_index,
+                                              uint32_t &components) const {
+    auto const &accessor = doc["accessors"].at(accessor_index);
+    if (accessor.contains("sparse"))
+      throw std::runtime_error(std::format(
+          "{}:{}: sparse accessors are not supported", __FILE__, __LINE__));
+
+    auto const type = accessor["type"].get<std::string>();
+    components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3
+                                                                            : 4;
+    auto const count = accessor["count"].get<size_t>();
+    auto const component_type = accessor["componentType"].get<int>();
+    auto const normalized = accessor.value("normalized", false);
+
+    auto const component_size = component_type == 5126 || component_type == 5125
+                                    ? 4U
+                                : component_type == 5123 || component_type == 5122
+                                    ? 2U
+                                    : 1U;
+
+    auto values = std::vector<float>(count * components, 0.0f);
+    if (!accessor.contains("bufferView"))
+      return values; // all zeros per spec
+
+    auto const &view = doc["bufferViews"].at(accessor["bufferView"].get<size_t>());
+    auto const &buffer = buffers.at(view["buffer"].get<size_t>());
+    auto const stride =
+        view.value("byteStride", size_t{component_size * components});
+    auto const base =
+        view.value("byteOffset", size_t{0}) + accessor.value("byteOffset", size_t{0});
+
+    if (count > 0 &&
+        base + (count - 1) * stride + component_size * components > buffer.size())
+      throw std::runtime_error(std::format(
+          "{}:{}: accessor {} reads past its buffer", __FILE__, __LINE__,
+          accessor_index));
+
+    for (auto i = size_t{0}; i < count; ++i) {
+      for (auto c = 0U; c < components; ++c) {
+        auto const *src = buffer.data() + base + i * stride + c * component_size;
+        auto value = 0.0f;
+        switch (component_type) {
+        case 5126: std::memcpy(&value, src, 4); break;
+        case 5125: {
+          auto v = uint32_t{};
+          std::memcpy(&v, src, 4);
+          value = static_cast<float>(v);
+        } break;
+        case 5123: {
+          auto v = uint16_t{};
+          std::memcpy(&v, src, 2);
+          value = normalized ? static_cast<float>(v) / 65535.0f
+                             : static_cast<float>(v);
+        } break;
+        case 5122: {
+          auto v = int16_t{};
+          std::memcpy(&v, src, 2);
+          value = normalized ? std::max(static_cast<float>(v) / 32767.0f, -1.0f)
+                             : static_cast<float>(v);
+        } break;
+        case 5121: {
+          auto const v = std::to_integer<uint8_t>(*src);
+          value = normalized ? static_cast<float>(v) / 255.0f
+                             : static_cast<float>(v);
+        } break;
+        case 5120: {
+          auto const v = static_cast<int8_t>(std::to_integer<uint8_t>(*src));
+          value = normalized ? std::max(static_cast<float>(v) / 127.0f, -1.0f)
+                             : static_cast<float>(v);
+        } break;
+        default:
+          throw std::runtime_error(std::format("{}:{}: componentType {}",
+                                               __FILE__, __LINE__,
+                                               component_type));
+        }
+        values[i * components + c] = value;
+      }
+    }
+    return values;
+  }
+
+  /**
+   * Index accessors are read as integers; floats lose precision above 2^24
+   */
+  [[nodiscard]] std::vector<uint32_t>
+  readIndices(uint32_t const accessor_index) const {
+    auto const &accessor = doc["accessors"].at(accessor_index);
+    auto const count = accessor["count"].get<size_t>();
+    auto const component_type = accessor["componentType"].get<int>();
+    auto const size = component_type == 5125 ? 4U
+                      : component_type == 5123 ? 2U
+                      : component_type == 5121
+                          ? 1U
+                          : throw std::runtime_error(std::format(
+                                "{}:{}: index componentType {}", __FILE__,
+                                __LINE__, component_type));
+
+    auto const &view = doc["bufferViews"].at(accessor["bufferView"].get<size_t>());
+    auto const &buffer = buffers.at(view["buffer"].get<size_t>());
+    auto const base =
+        view.value("byteOffset", size_t{0}) + accessor.value("byteOffset", size_t{0});
+    if (base + count * size > buffer.size())
+      throw std::runtime_error(std::format(
+          "{}:{}: accessor {} reads past its buffer", __FILE__, __LINE__,
+          accessor_index));
+
+    auto indices = std::vector<uint32_t>(count);
+    for (auto i = size_t{0}; i < count; ++i) {
+      auto value = uint32_t{};
+      std::memcpy(&value, buffer.data() + base + i * size, size); // little endian
+      indices[i] = value;
+    }
+    return indices;
+  }
+};
+
+void appendPrimitive(Gltf const &gltf, nlohmann::json const &primitive,
+                     Mat4 const &world, MeshSource &out) {
+  if (primitive.value("mode", 4) != 4) {
+    if (Args::verbose() > 0)
+      std::cerr << "skipping non-triangle-list primitive\n";
+    return;
+  }
+
+  auto const &attributes = primitive["attributes"];
+  if (!attributes.contains("POSITION"))
+    return;
+
+  // the loop below indexes positions and normals as VEC3, uvs as VEC2
+  auto const read_attribute = [&](char const *name, uint32_t const expected) {
+    auto components = 0U;
+    auto values =
+        gltf.readFloats(attributes[name].get<uint32_t>(), components);
+    if (components != expected)
+      throw std::runtime_error(std::format(
+          "{}:{}: {} has {} components per element, expected {}", __FILE__,
+          __LINE__, name, components, expected));
+    return values;
+  };
+
+  auto const positions = read_attribute("POSITION", 3);
+  auto const vertex_count = positions.size() / 3;
+
+  auto normals = std::vector<float>();
+  if (attributes.contains("NORMAL"))
+    normals = read_attribute("NORMAL", 3);
+  if (attributes.contains("NORMAL") && normals.size() / 3 != vertex_count)
+    throw std::runtime_error(std::format(
+        "{}:{}: NORMAL has {} elements for {} vertices", __FILE__, __LINE__,
+        normals.size() / 3, vertex_count));
+
+  auto uvs = std::vector<float>();
+  if (attributes.contains("TEXCOORD_0"))
+    uvs = read_attribute("TEXCOORD_0", 2);
+  if (attributes.contains("TEXCOORD_0") && uvs.size() / 2 != vertex_count)
+    throw std::runtime_error(std::format(
+        "{}:{}: TEXCOORD_0 has {} elements for {} vertices", __FILE__,
+        __LINE__, uvs.size() / 2, vertex_count));
+
+  auto const base = static_cast<uint32_t>(out.positions.size());
+
+  // normals go through the inverse transpose; for the rigid/uniform scale
+  // transforms glTF scenes use in practice the upper 3x3 plus renormalize
+  // is equivalent
+  for (auto v = size_t{0}; v < vertex_count; ++v) {
+    auto const *p = &positions[v * 3];
+    auto position = std::array<float, 3>{};
+    for (auto r = 0U; r < 3; ++r)
+      position[r] = world[r] * p[0] + world[4 + r] * p[1] + world[8 + r] * p[2] +
+                    world[12 + r];
+    out.positions.push_back(position);
+
+    auto normal = std::array<float, 3>{0.0f, 0.0f, 1.0f};
+    if (!normals.empty()) {
+      auto const *n = &normals[v * 3];
+      for (auto r = 0U; r < 3; ++r)
+        normal[r] = world[r] * n[0] + world[4 + r] * n[1] + world[8 + r] * n[2];
+      auto const length = std::sqrt(normal[0] * normal[0] +
+                                    normal[1] * normal[1] + normal[2] * normal[2]);
+      if (length > 0.0f)
+        for (auto &c : normal)
+          c /= length;
+    }
+    out.normals.push_back(normal);
+
+    out.uvs.push_back(uvs.empty() ? std::array<float, 2>{0.0f, 0.0f}
+                                  : std::array<float, 2>{uvs[v * 2],
+                                                         uvs[v * 2 + 1]});
+  }
+
+  if (primitive.contains("indices")) {
+    for (auto const index :
+         gltf.readIndices(primitive["indices"].get<uint32_t>()))
+      out.indices.push_back(base + index);
+  } else {
+    for (auto v = 0U; v < vertex_count; ++v)
+      out.indices.push_back(base + v);
+  }
+}
+
+void visitNode(Gltf const &gltf, uint32_t const node_index,
+               Mat4 const &parent, MeshSource &out) {
+  auto const &node = gltf.doc["nodes"].at(node_index);
+  auto const world = multiply(parent, nodeMatrix(node));
+
+  if (node.contains("mesh")) {
+    auto const &mesh = gltf.doc["meshes"].at(node["mesh"].get<size_t>());
+    for (auto const &primitive : mesh["primitives"])
+      appendPrimitive(gltf, primitive, world, out);
+  }
+
+  for (auto const &child : node.value("children", nlohmann::json::array()))
+    visitNode(gltf, child.get<uint32_t>(), world, out);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  static auto const long_opts =
+      std::array{option{"verbose", no_argument, nullptr, 'v'},
+                 option{"help", no_argument, nullptr, 'h'},
+                 option{nullptr, 0, nullptr, 0}};
+
+  static auto const help = std::format(
+      "Usage: {} [-vh] <input.gltf|input.glb> <output.mesh>\n"
+      "Options:\n"
+      "  -h, --help     display this help and exit\n"
+      "  -v, --verbose  increase verbosity\n",
+      argv[0]);
+
+  for (int opt;
+       (opt = getopt_long(argc, argv, "vh", long_opts.data(), nullptr)) != -1;) {
+    switch (opt) {
+    case 'v':
+      Args::verbose()++;
+      break;
+    case 'h':
+      std::cout << help;
+      return EXIT_SUCCESS;
+    default:
+      std::cerr << help;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - optind != 2) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  auto const input = std::filesystem::path(argv[optind]);
+  auto const output = std::filesystem::path(argv[optind + 1]);
+
+  try {
+    auto const gltf = Gltf{input};
+    auto source = MeshSource();
+
+    auto const scene_index = gltf.doc.value("scene", 0U);
+    if (auto const scenes = gltf.doc.value("scenes", nlohmann::json::array());
+        scene_index < scenes.size()) {
+      for (auto const &node : scenes[scene_index].value("nodes",
+                                                        nlohmann::json::array()))
+        visitNode(gltf, node.get<uint32_t>(), identity(), source);
+    } else {
+      // no scene: take every mesh untransformed
+      for (auto const &mesh : gltf.doc.value("meshes", nlohmann::json::array()))
+        for (auto const &primitive : mesh["primitives"])
+          appendPrimitive(gltf, primitive, identity(), source);
+    }
+
+    if (source.indices.empty()) {
+      std::cerr << std::format("{}: no triangles found\n", input.string());
+      return EXIT_FAILURE;
+    }
+
+    auto const file = buildMeshFile(std::move(source));
+    writeMeshFile(output, file);
+
+    auto const *header = reinterpret_cast<MeshFileHeader const *>(file.data());
+    std::cout << std::format("{}: {} vertices, {} meshlets, {} bytes\n",
+                             output.string(), header->vertex_count,
+                             header->meshlet_count, file.size());
+    for (auto l = 0U; l < header->lod_count; ++l) {
+      std::cout << std::format("  LOD {}: {} triangles, error {:.4g}\n", l,
+                               header->lods[l].index_count / 3,
+                               header->lods[l].error);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << std::format("{}: {}\n", input.string(), e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <getopt.h>
+
+#include "../args.hpp"
+#include "../src/mmappedFile.hpp"
+#include "../src/pointCloudFormat.hpp"
+
+/**
+ * Offline point cloud to HotAir octree file converter.
+ *
+ * Reads binary little-endian PLY (vertex x/y/z as float or double, optional
+ * red/green/blue as uchar) or ASCII .xyz ("x y z [r g b]" per line) and
+ * writes the octree described in pointCloudFormat.hpp. The input is mapped,
+ * not read; the whole cloud is held in memory once while building.
+ */
+
+namespace {
+
+std::vector<PointSource> readXyz(std::string_view text) {
+  auto points = std::vector<PointSource>();
+  while (!text.empty()) {
+    auto const eol = text.find('\n');
+    auto line = text.substr(0, eol);
+    text = eol == std::string_view::npos ? std::string_view{}
+                                         : text.substr(eol + 1);
+
+    auto values = std::array<double, 6>{0, 0, 0, 255, 255, 255};
+    auto count = 0U;
+    for (; count < values.size(); ++count) {
+      auto const start = line.find_first_not_of(" \t\r,");
+      if (start == std::string_view::npos)
+        break;
+      line.remove_prefix(start);
+      auto const [end, ec] = std::from_chars(line.data(),
+                                             line.data() + line.size(),
+                                             values[count]);
+      if (ec != std::errc{})
+        break;
+      line.remove_prefix(static_cast<size_t>(end - line.data()));
+    }
+    if (count < 3)
+      continue; // blank or comment line
+
+    points.push_back(
+        {{static_cast<float>(values[0]), static_cast<float>(values[1]),
+          static_cast<float>(values[2])},
+         {static_cast<uint8_t>(values[3]), static_cast<uint8_t>(values[4]),
+          static_cast<uint8_t>(values[5]), 255}});
+  }
+  return points;
+}
+
+std::vector<PointSource> readPly(std::span<std::byte const> bytes) {
+  auto const text = std::string_view(
+      reinterpret_cast<char const *>(bytes.data()), bytes.size());
+  auto const header_end = text.find("end_header\n");
+  if (header_end == std::string_view::npos)
+    throw std::runtime_error("PLY header not terminated");
+
+  struct Property {
+    std::string name;
+    size_t offset;
+    std::string type;
+  };
+  auto properties = std::vector<Property>();
+  auto stride = size_t{0};
+  auto vertex_count = size_t{0};
+  auto in_vertex = false;
+
+  auto const type_size = [](std::string_view const type) -> size_t {
+    if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+      return 1;
+    if (type == "short" || type == "ushort" || type == "int16" ||
+        type == "uint16")
+      return 2;
+    if (type == "int" || type == "uint" || type == "float" ||
+        type == "int32" || type == "uint32" || type == "float32")
+      return 4;
+    if (type == "double" || type == "float64")
+      return 8;
+    throw std::runtime_error(std::format("unsupported PLY type {}", type));
+  };
+
+  auto header = text.substr(0, header_end);
+  while (!header.empty()) {
+    auto const eol = header.find('\n');
+    auto const line = header.substr(0, eol);
+    header = eol == std::string_view::npos ? std::string_view{}
+                                           : header.substr(eol + 1);
+
+    if (line.starts_with("format") &&
+        line.find("binary_little_endian") == std::string_view::npos)
+      throw std::runtime_error("only binary_little_endian PLY is supported");
+
+    if (line.starts_with("element")) {
+      in_vertex = line.starts_with("element vertex ");
+      if (in_vertex)
+        vertex_count = std::stoull(std::string(line.substr(15)));
+      else if (vertex_count == 0)
+        throw std::runtime_error("PLY elements before vertex are unsupported");
+    } else if (in_vertex && line.starts_with("property ")) {
+      if (line.starts_with("property list"))
+        throw std::runtime_error("list properties on vertices are unsupported");
+      auto const rest = line.substr(9);
+      auto const space = rest.find(' ');
+      auto const type = std::string(rest.substr(0, space));
+      properties.push_back({std::string(rest.substr(space + 1)), stride, type});
+      stride += type_size(type);
+    }
+  }
+
+  auto find = [&](std::string_view const name) -> Property const * {
+    auto const it = std::ranges::find(properties, name, &Property::name);
+    return it == properties.end() ? nullptr : &*it;
+  };
+  auto const *x = find("x");
+  auto const *y = find("y");
+  auto const *z = find("z");
+  if (!x || !y || !z)
+    throw std::runtime_error("PLY vertices have no x/y/z");
+  auto const colour = std::array{find("red"), find("green"), find("blue")};
+
+  auto const body = header_end + std::string_view("end_header\n").size();
+  if (body + vertex_count * stride > bytes.size())
+    throw std::runtime_error("PLY vertex data truncated");
+
+  auto read = [](std::byte const *at, Property const &p) -> double {
+    if (p.type == "double" || p.type == "float64") {
+      auto v = 0.0;
+      std::memcpy(&v, at + p.offset, sizeof(v));
+      return v;
+    }
+    if (p.type == "float" || p.type == "float32") {
+      auto v = 0.0f;
+      std::memcpy(&v, at + p.offset, sizeof(v));
+      return v;
+    }
+    if (p.type == "uchar" || p.type == "uint8")
+      return static_cast<double>(static_cast<uint8_t>(at[p.offset]));
+    throw std::runtime_error(
+        std::format("unsupported type {} for {}", p.type, p.name));
+  };
+
+  auto points = std::vector<PointSource>(vertex_count);
+  for (auto i = 0U; i < vertex_count; ++i) {
+    auto const *at = bytes.data() + body + i * stride;
+    auto &point = points[i];
+    point.position = {static_cast<float>(read(at, *x)),
+                      static_cast<float>(read(at, *y)),
+                      static_cast<float>(read(at, *z))};
+    point.colour = {255, 255, 255, 255};
+    for (auto k = 0U; k < 3; ++k) {
+      if (colour[k])
+        point.colour[k] = static_cast<uint8_t>(read(at, *colour[k]));
+    }
+  }
+  return points;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  static auto const long_opts =
+      std::array{option{"node-points", required_argument, nullptr, 'n'},
+                 option{"verbose", no_argument, nullptr, 'v'},
+                 option{"help", no_argument, nullptr, 'h'},
+                 option{nullptr, 0, nullptr, 0}};
+
+  static auto const help = std::format(
+      "Usage: {} [-vh] [-n <points>] <input.ply|input.xyz> <output.pc>\n"
+      "Options:\n"
+      "  -n, --node-points <n>  most points per octree node (default 16384)\n"
+      "  -h, --help             display this help and exit\n"
+      "  -v, --verbose          increase verbosity\n",
+      argv[0]);
+
+  auto node_points = 16384U;
+
+  try {
+    for (int opt; (opt = getopt_long(argc, argv, "n:vh", long_opts.data(),
+                                     nullptr)) != -1;) {
+      switch (opt) {
+      case 'n':
+        node_points = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'v':
+        Args::verbose()++;
+        break;
+      case 'h':
+        std::cout << help;
+        return EXIT_SUCCESS;
+      default:
+        std::cerr << help;
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (std::logic_error const &) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  if (argc - optind != 2 || node_points == 0) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  auto const input = std::filesystem::path(argv[optind]);
+  auto const output = std::filesystem::path(argv[optind + 1]);
+
+  try {
+    auto source = std::vector<PointSource>();
+    {
+      auto const mapped = MMapped<std::byte>(input);
+      auto const bytes = std::span<std::byte const>(mapped.data().get(),
+                                                    mapped.size());
+      if (input.extension() == ".ply") {
+        source = readPly(bytes);
+      } else {
+        source = readXyz(std::string_view(
+            reinterpret_cast<char const *>(bytes.data()), bytes.size()));
+      }
+    }
+
+    if (source.empty()) {
+      std::cerr << std::format("{}: no points found\n", input.string());
+      return EXIT_FAILURE;
+    }
+
+    auto const octree = buildPointOctree(std::move(source), node_points);
+    writePointCloudFile(output, octree);
+
+    auto max_depth = 0U;
+    for (auto const &node : octree.nodes)
+      max_depth = std::max(max_depth, node.depth);
+
+    std::cout << std::format("{}: {} points, {} nodes, depth {}, {} bytes\n",
+                             output.string(), octree.points.size(),
+                             octree.nodes.size(), max_depth + 1,
+                             std::filesystem::file_size(output));
+    if (octree.dropped > 0) {
+      std::cerr << std::format("{}: dropped {} coincident points\n",
+                               input.string(), octree.dropped);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << std::format("{}: {}\n", input.string(), e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+
+static_assert(__cplusplus >= 202002L, "C++20 required");
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "../args.hpp"
+#include "../src/mmappedFile.hpp"
+#include "../src/terrainFormat.hpp"
+
+/**
+ * Offline heightmap to HotAir terrain file converter.
+ *
+ * The input is raw little-endian uint16 samples, row major (as exported by
+ * most terrain tools as .r16 / .raw). The output holds the full mip pyramid
+ * cut into square tiles (see terrainFormat.hpp) for ClipmapTerrain to
+ * stream from.
+ */
+
+int main(int argc, char **argv) {
+  static auto const long_opts =
+      std::array{option{"width", required_argument, nullptr, 'W'},
+                 option{"height", required_argument, nullptr, 'H'},
+                 option{"spacing", required_argument, nullptr, 's'},
+                 option{"offset", required_argument, nullptr, 'o'},
+                 option{"scale", required_argument, nullptr, 'z'},
+                 option{"tile", required_argument, nullptr, 't'},
+                 option{"levels", required_argument, nullptr, 'l'},
+                 option{"verbose", no_argument, nullptr, 'v'},
+                 option{"help", no_argument, nullptr, 'h'},
+                 option{nullptr, 0, nullptr, 0}};
+
+  static auto const help = std::format(
+      "Usage: {} [-vh] -W <width> -H <height> [options] <input.r16> "
+      "<output.terrain>\n"
+      "Options:\n"
+      "  -W, --width <n>     samples per row\n"
+      "  -H, --height <n>    rows\n"
+      "  -s, --spacing <m>   world distance between samples (default 1)\n"
+      "  -o, --offset <m>    world height of sample value 0 (default 0)\n"
+      "  -z, --scale <m>     world height of sample value 65535 (default 1)\n"
+      "  -t, --tile <n>      tile edge in samples (default 256)\n"
+      "  -l, --levels <n>    pyramid levels, 0 for all (default 0)\n"
+      "  -h, --help          display this help and exit\n"
+      "  -v, --verbose       increase verbosity\n",
+      argv[0]);
+
+  auto header = TerrainFileHeader();
+
+  try {
+    for (int opt; (opt = getopt_long(argc, argv, "W:H:s:o:z:t:l:vh",
+                                     long_opts.data(), nullptr)) != -1;) {
+      switch (opt) {
+      case 'W':
+        header.width = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'H':
+        header.height = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 's':
+        header.sample_spacing = std::stof(optarg);
+        break;
+      case 'o':
+        header.height_offset = std::stof(optarg);
+        break;
+      case 'z':
+        header.height_scale = std::stof(optarg);
+        break;
+      case 't':
+        header.tile_size = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'l':
+        header.level_count = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'v':
+        Args::verbose()++;
+        break;
+      case 'h':
+        std::cout << help;
+        return EXIT_SUCCESS;
+      default:
+        std::cerr << help;
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (std::logic_error const &) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  if (argc - optind != 2 || header.width == 0 || header.height == 0 ||
+      header.tile_size == 0 || header.sample_spacing <= 0.0f) {
+    std::cerr << help;
+    return EXIT_FAILURE;
+  }
+
+  auto const input = std::filesystem::path(argv[optind]);
+  auto const output = std::filesystem::path(argv[optind + 1]);
+
+  try {
+    auto const raw = MMapped<uint16_t>(input);
+    auto const count = size_t{header.width} * header.height;
+    if (raw.size() != count * sizeof(uint16_t)) {
+      std::cerr << std::format("{}: {} bytes, expected {} for {}x{}\n",
+                               input.string(), raw.size(),
+                               count * sizeof(uint16_t), header.width,
+                               header.height);
+      return EXIT_FAILURE;
+    }
+
+    auto samples = std::vector<uint16_t>(raw.data().get(),
+                                         raw.data().get() + count);
+    if constexpr (std::endian::native == std::endian::big) {
+      for (auto &sample : samples)
+        sample = static_cast<uint16_t>((sample << 8U) | (sample >> 8U));
+    }
+
+    writeTerrainFile(output, header, std::move(samples));
+
+    auto const tiles = TerrainTiles(output);
+    std::cout << std::format("{}: {}x{} samples, {} levels, {} bytes\n",
+                             output.string(), tiles.header.width,
+                             tiles.header.height, tiles.header.level_count,
+                             std::filesystem::file_size(output));
+    if (Args::verbose() > 0) {
+      for (auto l = 0U; l < tiles.header.level_count; ++l) {
+        std::cout << std::format("  level {}: {}x{} samples, {}x{} tiles\n", l,
+                                 tiles.header.levelWidth(l),
+                                 tiles.header.levelHeight(l),
+                                 tiles.header.tilesX(l),
+                                 tiles.header.tilesY(l));
+      }
+    }
+  } catch (std::exception const &e) {
+    std::cerr << std::format("{}: {}\n", input.string(), e.what());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}